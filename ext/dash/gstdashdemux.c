@@ -271,6 +271,30 @@
  *   Advance to keyframe/fragment for that target_time
  *   Adaptivedemux downloads that keyframe/fragment
  *
+ *
+ * Low-latency live implementation:
+ *
+ * Low-latency DASH manifests announce an availabilityTimeOffset on the
+ * SegmentTemplate/SegmentBase, usually combined with
+ * availabilityTimeComplete="false". Segments are then requested as soon as
+ * their first CMAF chunk is available instead of once they are complete,
+ * and the server sends the remaining chunks with chunked transfer encoding
+ * while they are produced.
+ *
+ * Data is pushed downstream as it arrives. For such streams
+ * gst_dash_demux_handle_isobmff() also tracks the end of every mdat and
+ * goes back to parsing boxes afterwards, so each moof/mdat pair of the
+ * segment is handled as a unit instead of only the first one.
+ *
+ * If the manifest has a ServiceDescription with a Latency target, it is
+ * used instead of suggestedPresentationDelay for the initial position.
+ * After each segment a "dash-latency" element message is posted with the
+ * latency of the download position and the playback rate (bounded by
+ * PlaybackRate@min/max) that would let the application catch up smoothly,
+ * as dashdemux itself cannot change the pipeline rate. On each manifest
+ * update, if a stream is above Latency@max all the streams jump forward to
+ * the target together.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -383,6 +407,8 @@ static GstFlowReturn gst_dash_demux_stream_seek (GstAdaptiveDemuxStream *
     GstClockTime * final_ts);
 static gboolean gst_dash_demux_stream_has_next_fragment (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_dash_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static GstFlowReturn
 gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream);
 static gboolean
@@ -638,6 +664,8 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
       gst_dash_demux_stream_select_bitrate;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_peek_fragment =
+      gst_dash_demux_stream_peek_fragment;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
   gstadaptivedemux_class->get_live_seek_range =
       gst_dash_demux_get_live_seek_range;
@@ -941,6 +969,7 @@ gst_dash_demux_setup_streams (GstAdaptiveDemux * demux)
   period_idx = 0;
   if (gst_mpd_client_is_live (dashdemux->client)) {
     GDateTime *g_now;
+    GstMPDServiceDescriptionNode *service_description;
     if (dashdemux->client->mpd_root_node->availabilityStartTime == NULL) {
       ret = FALSE;
       GST_ERROR_OBJECT (demux, "MPD does not have availabilityStartTime");
@@ -960,7 +989,15 @@ gst_dash_demux_setup_streams (GstAdaptiveDemux * demux)
     /* get period index for period encompassing the current time */
     g_now = gst_dash_demux_get_server_now_utc (dashdemux);
     now = gst_date_time_new_from_g_date_time (g_now);
-    if (dashdemux->client->mpd_root_node->suggestedPresentationDelay != -1) {
+    service_description =
+        gst_mpd_client_get_service_description (dashdemux->client);
+    if (service_description && service_description->latency_target != -1) {
+      GstDateTime *target = gst_mpd_client_add_time_difference (now,
+          service_description->latency_target * -1000);
+      gst_date_time_unref (now);
+      now = target;
+    } else if (dashdemux->client->mpd_root_node->suggestedPresentationDelay !=
+        -1) {
       GstDateTime *target = gst_mpd_client_add_time_difference (now,
           dashdemux->client->mpd_root_node->suggestedPresentationDelay * -1000);
       gst_date_time_unref (now);
@@ -1039,7 +1076,8 @@ gst_dash_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
 
   if (gst_buffer_map (buf, &mapinfo, GST_MAP_READ)) {
     manifest = (gchar *) mapinfo.data;
-    if (gst_mpd_client_parse (dashdemux->client, manifest, mapinfo.size)) {
+    if (gst_mpd_client_parse_update (dashdemux->client, manifest,
+            mapinfo.size, NULL)) {
       if (gst_mpd_client_setup_media_presentation (dashdemux->client, 0, 0,
               NULL)) {
         ret = TRUE;
@@ -1378,6 +1416,35 @@ gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_EOS;
 }
 
+static gboolean
+gst_dash_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream, guint n,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
+  GstMediaFragmentInfo info;
+
+  /* subsegments of on-demand profile streams are only known once their
+   * index was parsed, and live fragments may not be available yet */
+  if (gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client)
+      || gst_mpd_client_is_live (dashdemux->client))
+    return FALSE;
+
+  if (!gst_mpd_client_peek_fragment (dashdemux->client, dashstream->index, n,
+          &info))
+    return FALSE;
+
+  /* the same uri and range as update_fragment_info() will set */
+  fragment->uri = info.uri;
+  fragment->range_start = MAX (info.range_start, dashstream->sidx_base_offset);
+  fragment->range_end = info.range_end;
+  fragment->duration = info.duration;
+  info.uri = NULL;
+  gst_mpdparser_media_fragment_info_clear (&info);
+
+  return TRUE;
+}
+
 static gint
 gst_dash_demux_index_entry_search (GstSidxBoxEntry * entry, GstClockTime * ts,
     gpointer user_data)
@@ -1973,6 +2040,145 @@ out:
   return ret;
 }
 
+/* Jumps all the streams forward to the ServiceDescription latency target
+ * if one of them is above Latency@max, way too late for a playback rate
+ * change to help. All the streams are moved at once to the same position so
+ * that they stay in sync */
+static void
+gst_dash_demux_check_max_latency (GstDashDemux * dashdemux)
+{
+  GstAdaptiveDemux *demux = GST_ADAPTIVE_DEMUX_CAST (dashdemux);
+  GstMPDServiceDescriptionNode *service_description;
+  GstDateTime *segment_start, *now, *target_time;
+  GDateTime *gstart, *gtarget;
+  GstClockTimeDiff latency = 0, target, max_latency;
+  GTimeSpan ts_microseconds;
+  GList *iter;
+
+  if (!gst_mpd_client_is_live (dashdemux->client)
+      || demux->segment.rate != 1.0)
+    return;
+
+  service_description =
+      gst_mpd_client_get_service_description (dashdemux->client);
+  if (service_description == NULL || service_description->latency_target == -1
+      || service_description->latency_max == -1)
+    return;
+
+  target = service_description->latency_target * GST_MSECOND;
+  max_latency = service_description->latency_max * GST_MSECOND;
+
+  now =
+      gst_date_time_new_from_g_date_time (gst_dash_demux_get_server_now_utc
+      (dashdemux));
+
+  for (iter = demux->streams; iter; iter = g_list_next (iter)) {
+    GstDashDemuxStream *dashstream = iter->data;
+
+    segment_start =
+        gst_mpd_client_get_next_segment_start_time (dashdemux->client,
+        dashstream->active_stream);
+    if (segment_start == NULL)
+      continue;
+
+    latency = gst_mpd_client_calculate_time_difference (segment_start, now);
+    gst_date_time_unref (segment_start);
+    if (latency > max_latency)
+      break;
+  }
+
+  if (iter == NULL) {
+    gst_date_time_unref (now);
+    return;
+  }
+
+  target_time = gst_mpd_client_add_time_difference (now, -target / GST_USECOND);
+  gtarget = gst_date_time_to_g_date_time (target_time);
+  gstart =
+      gst_date_time_to_g_date_time (dashdemux->client->mpd_root_node->
+      availabilityStartTime);
+  ts_microseconds = g_date_time_difference (gtarget, gstart);
+  g_date_time_unref (gstart);
+  g_date_time_unref (gtarget);
+  gst_date_time_unref (target_time);
+  gst_date_time_unref (now);
+
+  GST_INFO_OBJECT (dashdemux, "Latency %" GST_STIME_FORMAT
+      " above maximum %" GST_STIME_FORMAT ", jumping to live target",
+      GST_STIME_ARGS (latency), GST_STIME_ARGS (max_latency));
+
+  if (ts_microseconds <= 0)
+    return;
+
+  for (iter = demux->streams; iter; iter = g_list_next (iter)) {
+    GstAdaptiveDemuxStream *stream = iter->data;
+    GstDashDemuxStream *dashstream = iter->data;
+
+    if (gst_mpd_client_stream_seek (dashdemux->client,
+            dashstream->active_stream, TRUE, 0, ts_microseconds * GST_USECOND,
+            NULL))
+      stream->discont = TRUE;
+  }
+}
+
+/* Let the application know which playback rate would bring the latency of
+ * the next segment back to the ServiceDescription target */
+static void
+gst_dash_demux_stream_check_live_latency (GstDashDemux * dashdemux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstMPDServiceDescriptionNode *service_description;
+  GstDateTime *segment_start, *now;
+  GstClockTimeDiff latency, target;
+  gdouble rate, rate_min, rate_max;
+
+  service_description =
+      gst_mpd_client_get_service_description (dashdemux->client);
+  if (service_description == NULL || service_description->latency_target == -1)
+    return;
+
+  segment_start =
+      gst_mpd_client_get_next_segment_start_time (dashdemux->client,
+      dashstream->active_stream);
+  if (segment_start == NULL)
+    return;
+
+  now =
+      gst_date_time_new_from_g_date_time (gst_dash_demux_get_server_now_utc
+      (dashdemux));
+  latency = gst_mpd_client_calculate_time_difference (segment_start, now);
+  gst_date_time_unref (segment_start);
+  gst_date_time_unref (now);
+
+  target = service_description->latency_target * GST_MSECOND;
+
+  GST_LOG_OBJECT (stream->pad, "live latency %" GST_STIME_FORMAT
+      " (target %" GST_STIME_FORMAT ")", GST_STIME_ARGS (latency),
+      GST_STIME_ARGS (target));
+
+  /* Without PlaybackRate bounds the application is not allowed to change
+   * the rate, default to 1.0 */
+  rate_min = service_description->playback_rate_min > 0.0 ?
+      service_description->playback_rate_min : 1.0;
+  rate_max = service_description->playback_rate_max > 0.0 ?
+      service_description->playback_rate_max : 1.0;
+
+  /* Proportional controller: catch up the latency difference over
+   * (roughly) the target latency */
+  rate = 1.0;
+  if (target > 0)
+    rate += (gdouble) (latency - target) / target;
+  rate = CLAMP (rate, MIN (rate_min, 1.0), MAX (rate_max, 1.0));
+
+  gst_element_post_message (GST_ELEMENT_CAST (dashdemux),
+      gst_message_new_element (GST_OBJECT_CAST (dashdemux),
+          gst_structure_new ("dash-latency",
+              "latency", G_TYPE_INT64, latency,
+              "target-latency", G_TYPE_INT64, target,
+              "suggested-rate", G_TYPE_DOUBLE, rate, NULL)));
+}
+
 static GstFlowReturn
 gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
 {
@@ -2159,6 +2365,10 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
 
     ret = gst_mpd_client_advance_segment (dashdemux->client,
         dashstream->active_stream, stream->demux->segment.rate > 0.0);
+
+    if (ret == GST_FLOW_OK && gst_mpd_client_is_live (dashdemux->client)
+        && stream->demux->segment.rate == 1.0)
+      gst_dash_demux_stream_check_live_latency (dashdemux, stream);
   }
   return ret;
 }
@@ -2410,7 +2620,10 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
   new_client->mpd_base_uri = g_strdup (demux->manifest_base_uri);
   gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
 
-  if (gst_mpd_client_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
+  /* Periods that did not change since the last refresh are shared with
+   * the current client instead of being parsed again */
+  if (gst_mpd_client_parse_update (new_client, (gchar *) mapinfo.data,
+          mapinfo.size, dashdemux->client)) {
     const gchar *period_id;
     guint period_idx;
     GList *iter;
@@ -2517,6 +2730,8 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
     if (dashdemux->clock_drift) {
       gst_dash_demux_poll_clock_drift (dashdemux);
     }
+
+    gst_dash_demux_check_max_latency (dashdemux);
   } else {
     /* In most cases, this will happen if we set a wrong url in the
      * source element and we have received the 404 HTML response instead of
@@ -2995,6 +3210,13 @@ gst_dash_demux_parse_isobmff (GstAdaptiveDemux * demux,
         dash_stream->isobmff_parser.current_start_offset,
         dash_stream->isobmff_parser.current_size);
 
+    if (dash_stream->isobmff_parser.current_size == -1)
+      dash_stream->isobmff_parser.mdat_end_offset = -1;
+    else
+      dash_stream->isobmff_parser.mdat_end_offset =
+          dash_stream->isobmff_parser.current_start_offset +
+          dash_stream->isobmff_parser.current_size;
+
     /* At mdat. Move the start of the mdat to the adapter and have everything
      * else be pushed. We parsed all header boxes at this point and are not
      * supposed to be called again until the next moof */
@@ -3265,6 +3487,48 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
 }
 
 
+/* Whether the segments of this stream are delivered in several CMAF chunks
+ * (low-latency DASH) that we want to parse one by one */
+static gboolean
+gst_dash_demux_stream_is_chunked (GstDashDemuxStream * dash_stream)
+{
+  GstAdaptiveDemuxStream *stream = (GstAdaptiveDemuxStream *) dash_stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
+
+  if (stream->downloading_index || stream->downloading_header)
+    return FALSE;
+
+  /* Key-unit trick mode handles a single moof per request on its own */
+  if (GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (stream->demux))
+    return FALSE;
+
+  if (dash_stream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED)
+    return FALSE;
+
+  return gst_mpd_client_get_availability_time_offset (dashdemux->client,
+      dash_stream->active_stream) != 0
+      || !gst_mpd_client_is_availability_time_complete (dashdemux->client,
+      dash_stream->active_stream);
+}
+
+/* The mdat of a chunk is over, go back to box parsing for the next moof */
+static void
+gst_dash_demux_stream_finish_chunk (GstDashDemuxStream * dash_stream)
+{
+  dash_stream->isobmff_parser.current_fourcc = 0;
+  dash_stream->isobmff_parser.current_start_offset =
+      dash_stream->current_offset;
+  dash_stream->isobmff_parser.current_size = 0;
+
+  if (dash_stream->moof)
+    gst_isoff_moof_box_free (dash_stream->moof);
+  dash_stream->moof = NULL;
+  if (dash_stream->moof_sync_samples)
+    g_array_free (dash_stream->moof_sync_samples, TRUE);
+  dash_stream->moof_sync_samples = NULL;
+  dash_stream->current_sync_sample = -1;
+}
+
 static GstFlowReturn
 gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
@@ -3273,6 +3537,7 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
   GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *buffer;
   gboolean sidx_advance = FALSE;
+  gboolean mdat_finished = FALSE;
 
   /* We parse all ISOBMFF boxes of a (sub)fragment until the mdat. This covers
    * at least moov, moof and sidx boxes. Once mdat is received we just output
@@ -3369,6 +3634,36 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
         }
       }
     }
+  } else if (gst_dash_demux_stream_is_chunked (dash_stream)
+      && dash_stream->isobmff_parser.mdat_end_offset != -1) {
+    gsize available = gst_adapter_available (dash_stream->adapter);
+    guint64 remaining = 0;
+
+    /* Low-latency segments are made of several moof/mdat chunks. Only take
+     * what is left of the current mdat and parse the following boxes once
+     * it is over */
+    if (dash_stream->isobmff_parser.mdat_end_offset >
+        dash_stream->current_offset)
+      remaining =
+          dash_stream->isobmff_parser.mdat_end_offset -
+          dash_stream->current_offset;
+
+    if (available >= remaining) {
+      available = remaining;
+      mdat_finished = TRUE;
+    }
+
+    if (available == 0) {
+      if (!mdat_finished)
+        return ret;
+
+      gst_dash_demux_stream_finish_chunk (dash_stream);
+      if (gst_adapter_available (dash_stream->adapter) > 0)
+        return gst_dash_demux_handle_isobmff (demux, stream);
+      return ret;
+    }
+
+    buffer = gst_adapter_take_buffer (dash_stream->adapter, available);
   } else {
     /* Take it all and handle it further below */
     buffer =
@@ -3432,6 +3727,16 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
       return gst_dash_demux_handle_isobmff (demux, stream);
   }
 
+  if (mdat_finished) {
+    GST_LOG_OBJECT (stream->pad, "chunk finished at offset %" G_GUINT64_FORMAT,
+        dash_stream->current_offset);
+    gst_dash_demux_stream_finish_chunk (dash_stream);
+
+    /* Parse the next chunk's moof if we already have it */
+    if (gst_adapter_available (dash_stream->adapter) > 0)
+      return gst_dash_demux_handle_isobmff (demux, stream);
+  }
+
   return ret;
 }
 
@@ -87,6 +87,8 @@ struct _GstDashDemuxStream
     guint32 current_fourcc;
     guint64 current_start_offset;
     guint64 current_size;
+    /* end offset of the current mdat, -1 if it extends until the end */
+    guint64 mdat_end_offset;
   } isobmff_parser;
 
   GstMoofBox *moof;
@@ -21,6 +21,7 @@
 
 #include "gstmpdclient.h"
 #include "gstmpdparser.h"
+#include <math.h>
 
 GST_DEBUG_CATEGORY_STATIC (gst_dash_mpd_client_debug);
 #undef GST_CAT_DEFAULT
@@ -490,6 +491,35 @@ gst_mpd_client_parse (GstMPDClient * client, const gchar * data, gint size)
   return ret;
 }
 
+/**
+ * gst_mpd_client_parse_update:
+ * @client: the client to fill in
+ * @data: the manifest
+ * @size: the size of @data
+ * @previous: (nullable): the client holding the previous version of the
+ *   manifest
+ *
+ * Like gst_mpd_client_parse() but reads the manifest with a streaming
+ * parser and shares the Periods that did not change since @previous
+ * instead of parsing them again.
+ */
+gboolean
+gst_mpd_client_parse_update (GstMPDClient * client, const gchar * data,
+    gint size, GstMPDClient * previous)
+{
+  gboolean ret;
+
+  ret = gst_mpdparser_read_mpd_root_node (&client->mpd_root_node, data, size,
+      previous ? previous->mpd_root_node : NULL);
+
+  if (ret) {
+    gst_mpd_client_check_profiles (client);
+    gst_mpd_client_fetch_on_load_external_resources (client);
+  }
+
+  return ret;
+}
+
 
 gboolean
 gst_mpd_client_get_xml_content (GstMPDClient * client, gchar ** data,
@@ -806,22 +836,26 @@ gst_mpd_client_add_media_segment (GstActiveStream * stream,
   return TRUE;
 }
 
+static GstMPDSegmentBaseNode *
+gst_mpd_client_stream_get_segment_base (GstActiveStream * stream)
+{
+  if (stream->cur_segment_list)
+    return
+        GST_MPD_MULT_SEGMENT_BASE_NODE (stream->cur_segment_list)->SegmentBase;
+  else if (stream->cur_seg_template)
+    return
+        GST_MPD_MULT_SEGMENT_BASE_NODE (stream->cur_seg_template)->SegmentBase;
+  return stream->cur_segment_base;
+}
+
 static void
 gst_mpd_client_stream_update_presentation_time_offset (GstMPDClient * client,
     GstActiveStream * stream)
 {
-  GstMPDSegmentBaseNode *segbase = NULL;
+  GstMPDSegmentBaseNode *segbase;
 
   /* Find the used segbase */
-  if (stream->cur_segment_list) {
-    segbase =
-        GST_MPD_MULT_SEGMENT_BASE_NODE (stream->cur_segment_list)->SegmentBase;
-  } else if (stream->cur_seg_template) {
-    segbase =
-        GST_MPD_MULT_SEGMENT_BASE_NODE (stream->cur_seg_template)->SegmentBase;
-  } else if (stream->cur_segment_base) {
-    segbase = stream->cur_segment_base;
-  }
+  segbase = gst_mpd_client_stream_get_segment_base (stream);
 
   if (segbase) {
     /* Avoid overflows */
@@ -1670,17 +1704,20 @@ gst_mpd_client_stream_seek (GstMPDClient * client, GstActiveStream * stream,
   g_return_val_if_fail (stream != NULL, 0);
 
   if (stream->segments) {
-    for (index = 0; index < stream->segments->len; index++) {
-      gboolean in_segment = FALSE;
-      GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
+    guint low = 0, high = stream->segments->len;
+
+    /* The segments are sorted and each entry covers a whole run of repeated
+     * segments, so look up the run containing ts with a binary search on
+     * the run end times instead of walking the timeline */
+    while (low < high) {
+      guint mid = low + (high - low) / 2;
+      GstMediaSegment *segment = g_ptr_array_index (stream->segments, mid);
       GstClockTime end_time;
-
-      GST_DEBUG ("Looking at fragment sequence chunk %d / %d", index,
-          stream->segments->len);
+      gboolean in_segment;
 
       end_time =
           gst_mpd_client_get_segment_end_time (client, stream->segments,
-          segment, index);
+          segment, mid);
 
       /* avoid downloading another fragment just for 1ns in reverse mode */
       if (forward)
@@ -1688,49 +1725,58 @@ gst_mpd_client_stream_seek (GstMPDClient * client, GstActiveStream * stream,
       else
         in_segment = ts <= end_time;
 
-      if (in_segment) {
-        GstClockTime chunk_time;
+      if (in_segment)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+    index = low;
 
-        selectedChunk = segment;
-        repeat_index = (ts - segment->start) / segment->duration;
+    GST_DEBUG ("Found fragment sequence chunk %d / %d", index,
+        stream->segments->len);
 
-        chunk_time = segment->start + segment->duration * repeat_index;
+    if (index < stream->segments->len) {
+      GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
+      GstClockTime chunk_time;
 
-        /* At the end of a segment in reverse mode, start from the previous fragment */
-        if (!forward && repeat_index > 0
-            && ((ts - segment->start) % segment->duration == 0))
-          repeat_index--;
+      selectedChunk = segment;
+      repeat_index = (ts - segment->start) / segment->duration;
 
-        if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
-          if (repeat_index + 1 < segment->repeat) {
-            if (ts - chunk_time > chunk_time + segment->duration - ts)
-              repeat_index++;
-          } else if (index + 1 < stream->segments->len) {
-            GstMediaSegment *next_segment =
-                g_ptr_array_index (stream->segments, index + 1);
+      chunk_time = segment->start + segment->duration * repeat_index;
 
-            if (ts - chunk_time > next_segment->start - ts) {
-              repeat_index = 0;
-              selectedChunk = next_segment;
-              index++;
-            }
-          }
-        } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
-                (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
-            ts != chunk_time) {
+      /* At the end of a segment in reverse mode, start from the previous fragment */
+      if (!forward && repeat_index > 0
+          && ((ts - segment->start) % segment->duration == 0))
+        repeat_index--;
 
-          if (repeat_index + 1 < segment->repeat) {
+      if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
+        if (repeat_index + 1 < segment->repeat) {
+          if (ts - chunk_time > chunk_time + segment->duration - ts)
             repeat_index++;
-          } else {
+        } else if (index + 1 < stream->segments->len) {
+          GstMediaSegment *next_segment =
+              g_ptr_array_index (stream->segments, index + 1);
+
+          if (ts - chunk_time > next_segment->start - ts) {
             repeat_index = 0;
-            if (index + 1 >= stream->segments->len) {
-              selectedChunk = NULL;
-            } else {
-              selectedChunk = g_ptr_array_index (stream->segments, ++index);
-            }
+            selectedChunk = next_segment;
+            index++;
+          }
+        }
+      } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
+              (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
+          ts != chunk_time) {
+
+        if (repeat_index + 1 < segment->repeat) {
+          repeat_index++;
+        } else {
+          repeat_index = 0;
+          if (index + 1 >= stream->segments->len) {
+            selectedChunk = NULL;
+          } else {
+            selectedChunk = g_ptr_array_index (stream->segments, ++index);
           }
         }
-        break;
       }
     }
 
@@ -1976,27 +2022,21 @@ gst_mpd_client_get_utc_timing_sources (GstMPDClient * client,
 }
 
 
-gboolean
-gst_mpd_client_get_next_fragment (GstMPDClient * client,
-    guint indexStream, GstMediaFragmentInfo * fragment)
+/* Fills @fragment with the fragment at @segment_index and @repeat_index of
+ * @stream */
+static gboolean
+gst_mpd_client_get_fragment (GstMPDClient * client, GstActiveStream * stream,
+    gint segment_index, guint repeat_index, GstMediaFragmentInfo * fragment)
 {
-  GstActiveStream *stream = NULL;
   GstMediaSegment *currentChunk;
   gchar *mediaURL = NULL;
   gchar *indexURL = NULL;
   GstUri *base_url, *frag_url;
 
-  /* select stream */
-  g_return_val_if_fail (client != NULL, FALSE);
-  g_return_val_if_fail (client->active_streams != NULL, FALSE);
-  stream = g_list_nth_data (client->active_streams, indexStream);
-  g_return_val_if_fail (stream != NULL, FALSE);
-  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
-
   if (stream->segments) {
     GST_DEBUG ("Looking for fragment sequence chunk %d / %d",
-        stream->segment_index, stream->segments->len);
-    if (stream->segment_index >= stream->segments->len)
+        segment_index, stream->segments->len);
+    if (segment_index >= stream->segments->len)
       return FALSE;
   } else {
     GstClockTime duration = gst_mpd_client_get_segment_duration (client,
@@ -2006,7 +2046,7 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
     g_return_val_if_fail (GST_MPD_MULT_SEGMENT_BASE_NODE
         (stream->cur_seg_template)->SegmentTimeline == NULL, FALSE);
     if (!GST_CLOCK_TIME_IS_VALID (duration) || (segments_count > 0
-            && stream->segment_index >= segments_count)) {
+            && segment_index >= segments_count)) {
       return FALSE;
     }
     fragment->duration = duration;
@@ -2021,7 +2061,7 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
   fragment->index_range_end = -1;
 
   if (stream->segments) {
-    currentChunk = g_ptr_array_index (stream->segments, stream->segment_index);
+    currentChunk = g_ptr_array_index (stream->segments, segment_index);
 
     GST_DEBUG ("currentChunk->SegmentURL = %p", currentChunk->SegmentURL);
     if (currentChunk->SegmentURL != NULL) {
@@ -2033,18 +2073,18 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
       mediaURL =
           gst_mpdparser_build_URL_from_template (stream->cur_seg_template->
           media, stream->cur_representation->id,
-          currentChunk->number + stream->segment_repeat_index,
+          currentChunk->number + repeat_index,
           stream->cur_representation->bandwidth,
           currentChunk->scale_start +
-          stream->segment_repeat_index * currentChunk->scale_duration);
+          repeat_index * currentChunk->scale_duration);
       if (stream->cur_seg_template->index) {
         indexURL =
             gst_mpdparser_build_URL_from_template (stream->cur_seg_template->
             index, stream->cur_representation->id,
-            currentChunk->number + stream->segment_repeat_index,
+            currentChunk->number + repeat_index,
             stream->cur_representation->bandwidth,
             currentChunk->scale_start +
-            stream->segment_repeat_index * currentChunk->scale_duration);
+            repeat_index * currentChunk->scale_duration);
       }
     }
     GST_DEBUG ("mediaURL = %s", mediaURL);
@@ -2052,7 +2092,7 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
 
     fragment->timestamp =
         currentChunk->start +
-        stream->segment_repeat_index * currentChunk->duration;
+        repeat_index * currentChunk->duration;
     fragment->duration = currentChunk->duration;
     if (currentChunk->SegmentURL) {
       if (currentChunk->SegmentURL->mediaRange) {
@@ -2073,20 +2113,20 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
       mediaURL =
           gst_mpdparser_build_URL_from_template (stream->cur_seg_template->
           media, stream->cur_representation->id,
-          stream->segment_index +
+          segment_index +
           GST_MPD_MULT_SEGMENT_BASE_NODE (stream->
               cur_seg_template)->startNumber,
           stream->cur_representation->bandwidth,
-          stream->segment_index * fragment->duration);
+          segment_index * fragment->duration);
       if (stream->cur_seg_template->index) {
         indexURL =
             gst_mpdparser_build_URL_from_template (stream->cur_seg_template->
             index, stream->cur_representation->id,
-            stream->segment_index +
+            segment_index +
             GST_MPD_MULT_SEGMENT_BASE_NODE (stream->
                 cur_seg_template)->startNumber,
             stream->cur_representation->bandwidth,
-            stream->segment_index * fragment->duration);
+            segment_index * fragment->duration);
       }
     } else {
       return FALSE;
@@ -2095,7 +2135,7 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
     GST_DEBUG ("mediaURL = %s", mediaURL);
     GST_DEBUG ("indexURL = %s", indexURL);
 
-    fragment->timestamp = stream->segment_index * fragment->duration;
+    fragment->timestamp = segment_index * fragment->duration;
   }
 
   base_url = gst_uri_from_string (stream->baseURL);
@@ -2136,6 +2176,95 @@ gst_mpd_client_get_next_fragment (GstMPDClient * client,
   return TRUE;
 }
 
+gboolean
+gst_mpd_client_get_next_fragment (GstMPDClient * client,
+    guint indexStream, GstMediaFragmentInfo * fragment)
+{
+  GstActiveStream *stream = NULL;
+
+  /* select stream */
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->active_streams != NULL, FALSE);
+  stream = g_list_nth_data (client->active_streams, indexStream);
+  g_return_val_if_fail (stream != NULL, FALSE);
+  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
+
+  return gst_mpd_client_get_fragment (client, stream, stream->segment_index,
+      stream->segment_repeat_index, fragment);
+}
+
+/**
+ * gst_mpd_client_peek_fragment:
+ * @client: the #GstMPDClient
+ * @indexStream: index of the active stream
+ * @n: how many fragments after the next one to look
+ * @fragment: (out): the #GstMediaFragmentInfo to fill
+ *
+ * Like gst_mpd_client_get_next_fragment(), for the @n-th fragment after the
+ * next one in forward playback, without changing the position of the
+ * stream.
+ *
+ * Returns: %TRUE if the fragment is known
+ */
+gboolean
+gst_mpd_client_peek_fragment (GstMPDClient * client, guint indexStream,
+    guint n, GstMediaFragmentInfo * fragment)
+{
+  GstActiveStream *stream = NULL;
+  GstMediaSegment *segment;
+  GstClockTime end;
+  guint segments_count;
+  gint segment_index;
+  guint repeat_index;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->active_streams != NULL, FALSE);
+  stream = g_list_nth_data (client->active_streams, indexStream);
+  g_return_val_if_fail (stream != NULL, FALSE);
+  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
+
+  segments_count = gst_mpd_client_get_segments_counts (client, stream);
+  segment_index = MAX (stream->segment_index, 0);
+  repeat_index = stream->segment_repeat_index;
+
+  /* same steps as gst_mpd_client_advance_segment() going forward */
+  while (n-- > 0) {
+    if (stream->segments == NULL) {
+      segment_index++;
+    } else {
+      if (segment_index >= stream->segments->len)
+        return FALSE;
+
+      segment = g_ptr_array_index (stream->segments, segment_index);
+      if (segment->repeat >= 0) {
+        if (repeat_index >= segment->repeat) {
+          repeat_index = 0;
+          segment_index++;
+        } else {
+          repeat_index++;
+        }
+      } else {
+        /* open ended repetitions last until the next segment, or the end of
+         * the period */
+        end = gst_mpd_client_get_segment_end_time (client, stream->segments,
+            segment, segment_index);
+        repeat_index++;
+        if (GST_CLOCK_TIME_IS_VALID (end)
+            && segment->start + (repeat_index + 1) * segment->duration > end) {
+          repeat_index = 0;
+          segment_index++;
+        }
+      }
+    }
+
+    if (segments_count > 0 && segment_index >= segments_count)
+      return FALSE;
+  }
+
+  return gst_mpd_client_get_fragment (client, stream, segment_index,
+      repeat_index, fragment);
+}
+
 gboolean
 gst_mpd_client_has_next_segment (GstMPDClient * client,
     GstActiveStream * stream, gboolean forward)
@@ -2905,20 +3034,18 @@ gst_mpd_client_get_list_and_nb_of_audio_language (GstMPDClient * client,
 }
 
 
-GstDateTime *
-gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client,
-    GstActiveStream * stream)
+/* Start and end time of the next segment of @stream, relative to the
+ * availabilityStartTime of the MPD */
+static gboolean
+gst_mpd_client_get_next_segment_times (GstMPDClient * client,
+    GstActiveStream * stream, GstClockTime * start, GstClockTime * end)
 {
-  GstDateTime *availability_start_time, *rv;
   gint seg_idx;
   GstMediaSegment *segment;
-  GstClockTime segmentEndTime;
+  GstClockTime segmentStartTime, segmentEndTime;
   const GstStreamPeriod *stream_period;
   GstClockTime period_start = 0;
 
-  g_return_val_if_fail (client != NULL, NULL);
-  g_return_val_if_fail (stream != NULL, NULL);
-
   stream_period = gst_mpd_client_get_stream_period (client);
   if (stream_period && stream_period->period) {
     period_start = stream_period->start;
@@ -2929,25 +3056,38 @@ gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client,
   if (stream->segments) {
     segment = g_ptr_array_index (stream->segments, seg_idx);
 
+    segmentStartTime = segment->start;
     if (segment->repeat >= 0) {
-      segmentEndTime = segment->start + (stream->segment_repeat_index + 1) *
-          segment->duration;
+      segmentStartTime += stream->segment_repeat_index * segment->duration;
+      segmentEndTime = segmentStartTime + segment->duration;
     } else if (seg_idx < stream->segments->len - 1) {
       const GstMediaSegment *next_segment =
           g_ptr_array_index (stream->segments, seg_idx + 1);
       segmentEndTime = next_segment->start;
     } else {
-      g_return_val_if_fail (stream_period != NULL, NULL);
+      g_return_val_if_fail (stream_period != NULL, FALSE);
       segmentEndTime = period_start + stream_period->duration;
     }
   } else {
     GstClockTime seg_duration;
     seg_duration = gst_mpd_client_get_segment_duration (client, stream, NULL);
     if (seg_duration == 0)
-      return NULL;
-    segmentEndTime = period_start + (1 + seg_idx) * seg_duration;
+      return FALSE;
+    segmentStartTime = period_start + seg_idx * seg_duration;
+    segmentEndTime = segmentStartTime + seg_duration;
   }
 
+  *start = segmentStartTime;
+  *end = segmentEndTime;
+  return TRUE;
+}
+
+static GstDateTime *
+gst_mpd_client_offset_availability_start_time (GstMPDClient * client,
+    GstClockTime offset)
+{
+  GstDateTime *availability_start_time, *rv;
+
   availability_start_time = gst_mpd_client_get_availability_start_time (client);
   if (availability_start_time == NULL) {
     GST_WARNING_OBJECT (client, "Failed to get availability_start_time");
@@ -2955,7 +3095,7 @@ gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client,
   }
 
   rv = gst_mpd_client_add_time_difference (availability_start_time,
-      segmentEndTime / GST_USECOND);
+      offset / GST_USECOND);
   gst_date_time_unref (availability_start_time);
   if (rv == NULL) {
     GST_WARNING_OBJECT (client, "Failed to offset availability_start_time");
@@ -2965,6 +3105,131 @@ gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client,
   return rv;
 }
 
+GstDateTime *
+gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client,
+    GstActiveStream * stream)
+{
+  GstClockTime segmentStartTime, segmentEndTime;
+  GstClockTime availability_time_offset;
+
+  g_return_val_if_fail (client != NULL, NULL);
+  g_return_val_if_fail (stream != NULL, NULL);
+
+  if (!gst_mpd_client_get_next_segment_times (client, stream,
+          &segmentStartTime, &segmentEndTime))
+    return NULL;
+
+  /* With an availabilityTimeOffset the segment can be requested before it is
+   * complete, its chunks will then be delivered while they are produced
+   * (chunked transfer). It can never be available before it starts though */
+  availability_time_offset =
+      gst_mpd_client_get_availability_time_offset (client, stream);
+  if (availability_time_offset != 0) {
+    if (GST_CLOCK_TIME_IS_VALID (availability_time_offset)
+        && segmentEndTime - segmentStartTime > availability_time_offset)
+      segmentEndTime -= availability_time_offset;
+    else
+      segmentEndTime = segmentStartTime;
+  }
+
+  return gst_mpd_client_offset_availability_start_time (client,
+      segmentEndTime);
+}
+
+/**
+ * gst_mpd_client_get_next_segment_start_time:
+ * @client: #GstMPDClient that has a parsed manifest
+ * @stream: the #GstActiveStream
+ *
+ * Returns: the wall-clock time at which the media of the next segment of
+ * @stream started to be produced, used to measure the live latency
+ */
+GstDateTime *
+gst_mpd_client_get_next_segment_start_time (GstMPDClient * client,
+    GstActiveStream * stream)
+{
+  GstClockTime segmentStartTime, segmentEndTime;
+
+  g_return_val_if_fail (client != NULL, NULL);
+  g_return_val_if_fail (stream != NULL, NULL);
+
+  if (!gst_mpd_client_get_next_segment_times (client, stream,
+          &segmentStartTime, &segmentEndTime))
+    return NULL;
+
+  return gst_mpd_client_offset_availability_start_time (client,
+      segmentStartTime);
+}
+
+/**
+ * gst_mpd_client_get_availability_time_offset:
+ * @client: #GstMPDClient that has a parsed manifest
+ * @stream: the #GstActiveStream
+ *
+ * Returns: the availabilityTimeOffset that applies to the segments of
+ * @stream, 0 if there is none or %GST_CLOCK_TIME_NONE if segments are
+ * available as soon as they start ("INF")
+ */
+GstClockTime
+gst_mpd_client_get_availability_time_offset (GstMPDClient * client,
+    GstActiveStream * stream)
+{
+  GstMPDSegmentBaseNode *segbase;
+
+  g_return_val_if_fail (stream != NULL, 0);
+
+  segbase = gst_mpd_client_stream_get_segment_base (stream);
+  if (segbase == NULL || segbase->availabilityTimeOffset <= 0.0)
+    return 0;
+
+  if (isinf (segbase->availabilityTimeOffset))
+    return GST_CLOCK_TIME_NONE;
+
+  return (GstClockTime) (segbase->availabilityTimeOffset * GST_SECOND);
+}
+
+/**
+ * gst_mpd_client_is_availability_time_complete:
+ * @client: #GstMPDClient that has a parsed manifest
+ * @stream: the #GstActiveStream
+ *
+ * Returns: %FALSE if the segments of @stream are announced as incomplete at
+ * their (early) availability time, i.e. they are delivered in chunks
+ */
+gboolean
+gst_mpd_client_is_availability_time_complete (GstMPDClient * client,
+    GstActiveStream * stream)
+{
+  GstMPDSegmentBaseNode *segbase;
+
+  g_return_val_if_fail (stream != NULL, TRUE);
+
+  segbase = gst_mpd_client_stream_get_segment_base (stream);
+  if (segbase == NULL)
+    return TRUE;
+
+  return segbase->availabilityTimeComplete;
+}
+
+/**
+ * gst_mpd_client_get_service_description:
+ * @client: #GstMPDClient that has a parsed manifest
+ *
+ * Returns: (transfer none) (nullable): the first ServiceDescription of the
+ * manifest
+ */
+GstMPDServiceDescriptionNode *
+gst_mpd_client_get_service_description (GstMPDClient * client)
+{
+  g_return_val_if_fail (client != NULL, NULL);
+  g_return_val_if_fail (client->mpd_root_node != NULL, NULL);
+
+  if (client->mpd_root_node->ServiceDescriptions == NULL)
+    return NULL;
+
+  return client->mpd_root_node->ServiceDescriptions->data;
+}
+
 gboolean
 gst_mpd_client_seek_to_time (GstMPDClient * client, GDateTime * time)
 {
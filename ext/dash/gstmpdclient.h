@@ -59,6 +59,7 @@ void gst_mpd_client_free (GstMPDClient * client);
 
 /* main mpd parsing methods from xml data */
 gboolean gst_mpd_client_parse (GstMPDClient * client, const gchar * data, gint size);
+gboolean gst_mpd_client_parse_update (GstMPDClient * client, const gchar * data, gint size, GstMPDClient * previous);
 
 /* xml generator */
 gboolean gst_mpd_client_get_xml_content (GstMPDClient * client, gchar ** data, gint * size);
@@ -78,6 +79,7 @@ GstClockTime gst_mpd_client_get_maximum_segment_duration (GstMPDClient * client)
 gboolean gst_mpd_client_get_last_fragment_timestamp_end (GstMPDClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment_timestamp (GstMPDClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment (GstMPDClient *client, guint indexStream, GstMediaFragmentInfo * fragment);
+gboolean gst_mpd_client_peek_fragment (GstMPDClient * client, guint indexStream, guint n, GstMediaFragmentInfo * fragment);
 gboolean gst_mpd_client_get_next_header (GstMPDClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_get_next_header_index (GstMPDClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_is_live (GstMPDClient * client);
@@ -121,6 +123,10 @@ gboolean gst_mpd_client_has_next_segment (GstMPDClient * client, GstActiveStream
 GstFlowReturn gst_mpd_client_advance_segment (GstMPDClient * client, GstActiveStream * stream, gboolean forward);
 void gst_mpd_client_seek_to_first_segment (GstMPDClient * client);
 GstDateTime *gst_mpd_client_get_next_segment_availability_start_time (GstMPDClient * client, GstActiveStream * stream);
+GstDateTime *gst_mpd_client_get_next_segment_start_time (GstMPDClient * client, GstActiveStream * stream);
+GstClockTime gst_mpd_client_get_availability_time_offset (GstMPDClient * client, GstActiveStream * stream);
+gboolean gst_mpd_client_is_availability_time_complete (GstMPDClient * client, GstActiveStream * stream);
+GstMPDServiceDescriptionNode *gst_mpd_client_get_service_description (GstMPDClient * client);
 
 /* Get audio/video stream parameters (caps, width, height, rate, number of channels) */
 GstCaps * gst_mpd_client_get_stream_caps (GstActiveStream * stream);
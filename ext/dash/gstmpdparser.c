@@ -25,6 +25,7 @@
  */
 
 #include <string.h>
+#include <libxml/xmlreader.h>
 
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
@@ -76,6 +77,8 @@ static void gst_mpdparser_parse_metrics_range_node (GList ** list,
 static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
 static gboolean gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer,
     xmlNode * a_node);
+static void gst_mpdparser_parse_service_description_node (GList ** list,
+    xmlNode * a_node);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
     xmlNode * a_node);
 
@@ -253,6 +256,7 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
   GstMPDSegmentBaseNode *seg_base_type;
   guint intval;
   guint64 int64val;
+  gdouble doubleval;
   gboolean boolval;
   GstXMLRange *rangeval;
 
@@ -269,6 +273,8 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
     seg_base_type->presentationTimeOffset = parent->presentationTimeOffset;
     seg_base_type->indexRange = gst_xml_helper_clone_range (parent->indexRange);
     seg_base_type->indexRangeExact = parent->indexRangeExact;
+    seg_base_type->availabilityTimeOffset = parent->availabilityTimeOffset;
+    seg_base_type->availabilityTimeComplete = parent->availabilityTimeComplete;
     seg_base_type->Initialization =
         gst_mpd_url_type_node_clone (parent->Initialization);
     seg_base_type->RepresentationIndex =
@@ -296,6 +302,19 @@ gst_mpdparser_parse_seg_base_type_ext (GstMPDSegmentBaseNode ** pointer,
           FALSE, &boolval)) {
     seg_base_type->indexRangeExact = boolval;
   }
+  /* Low-latency DASH: segments may be requested up to this many seconds
+   * before they are complete. "INF" is accepted and handled by sscanf() */
+  if (gst_xml_helper_get_prop_double (a_node, "availabilityTimeOffset",
+          &doubleval)) {
+    if (doubleval >= 0.0)
+      seg_base_type->availabilityTimeOffset = doubleval;
+    else
+      GST_WARNING ("ignoring negative availabilityTimeOffset %lf", doubleval);
+  }
+  if (gst_xml_helper_get_prop_boolean (a_node, "availabilityTimeComplete",
+          TRUE, &boolval)) {
+    seg_base_type->availabilityTimeComplete = boolval;
+  }
 
   /* explore children nodes */
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
@@ -1031,16 +1050,54 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
   }
 }
 
-static gboolean
-gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
+/* The ServiceDescription element is defined in
+ * ISO/IEC 23009-1:2019 Annex K, we only care about the Latency and
+ * PlaybackRate children used for low-latency playback
+ */
+static void
+gst_mpdparser_parse_service_description_node (GList ** list, xmlNode * a_node)
 {
+  GstMPDServiceDescriptionNode *new_service_description;
   xmlNode *cur_node;
-  GstMPDRootNode *new_mpd_root;
+  guint64 int64val;
 
-  gst_mpd_root_node_free (*pointer);
-  *pointer = NULL;
-  new_mpd_root = gst_mpd_root_node_new ();
+  new_service_description = gst_mpd_service_description_node_new ();
+  *list = g_list_append (*list, new_service_description);
 
+  GST_LOG ("attributes of ServiceDescription node:");
+  gst_xml_helper_get_prop_unsigned_integer (a_node, "id", 0,
+      &new_service_description->id);
+
+  /* explore children nodes */
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (cur_node->type != XML_ELEMENT_NODE)
+      continue;
+
+    if (xmlStrcmp (cur_node->name, (xmlChar *) "Latency") == 0) {
+      GST_LOG ("attributes of Latency node:");
+      if (gst_xml_helper_get_prop_unsigned_integer_64 (cur_node, "target", 0,
+              &int64val))
+        new_service_description->latency_target = int64val;
+      if (gst_xml_helper_get_prop_unsigned_integer_64 (cur_node, "min", 0,
+              &int64val))
+        new_service_description->latency_min = int64val;
+      if (gst_xml_helper_get_prop_unsigned_integer_64 (cur_node, "max", 0,
+              &int64val))
+        new_service_description->latency_max = int64val;
+    } else if (xmlStrcmp (cur_node->name, (xmlChar *) "PlaybackRate") == 0) {
+      GST_LOG ("attributes of PlaybackRate node:");
+      gst_xml_helper_get_prop_double (cur_node, "min",
+          &new_service_description->playback_rate_min);
+      gst_xml_helper_get_prop_double (cur_node, "max",
+          &new_service_description->playback_rate_max);
+    }
+  }
+}
+
+static void
+gst_mpdparser_parse_root_node_attributes (GstMPDRootNode * new_mpd_root,
+    xmlNode * a_node)
+{
   GST_LOG ("namespaces of root MPD node:");
   new_mpd_root->default_namespace =
       gst_xml_helper_get_node_namespace (a_node, NULL);
@@ -1073,27 +1130,54 @@ gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
       GST_MPD_DURATION_NONE, &new_mpd_root->maxSegmentDuration);
   gst_xml_helper_get_prop_duration (a_node, "maxSubsegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd_root->maxSubsegmentDuration);
+}
+
+/* parses one child of the root MPD node, returns FALSE on a fatal error */
+static gboolean
+gst_mpdparser_parse_root_child_node (GstMPDRootNode * new_mpd_root,
+    xmlNode * cur_node)
+{
+  if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
+    if (!gst_mpdparser_parse_period_node (&new_mpd_root->Periods, cur_node))
+      return FALSE;
+  } else if (xmlStrcmp (cur_node->name,
+          (xmlChar *) "ProgramInformation") == 0) {
+    gst_mpdparser_parse_program_info_node (&new_mpd_root->ProgramInfos,
+        cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
+    gst_mpdparser_parse_baseURL_node (&new_mpd_root->BaseURLs, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
+    gst_mpdparser_parse_location_node (&new_mpd_root->Locations, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
+    gst_mpdparser_parse_metrics_node (&new_mpd_root->Metrics, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
+    gst_mpdparser_parse_utctiming_node (&new_mpd_root->UTCTimings, cur_node);
+  } else if (xmlStrcmp (cur_node->name,
+          (xmlChar *) "ServiceDescription") == 0) {
+    gst_mpdparser_parse_service_description_node
+        (&new_mpd_root->ServiceDescriptions, cur_node);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_mpdparser_parse_root_node (GstMPDRootNode ** pointer, xmlNode * a_node)
+{
+  xmlNode *cur_node;
+  GstMPDRootNode *new_mpd_root;
+
+  gst_mpd_root_node_free (*pointer);
+  *pointer = NULL;
+  new_mpd_root = gst_mpd_root_node_new ();
 
-  /* explore children Period nodes */
+  gst_mpdparser_parse_root_node_attributes (new_mpd_root, a_node);
+
+  /* explore children nodes */
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd_root->Periods, cur_node))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ProgramInformation") == 0) {
-        gst_mpdparser_parse_program_info_node (&new_mpd_root->ProgramInfos,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_mpd_root->BaseURLs, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
-        gst_mpdparser_parse_location_node (&new_mpd_root->Locations, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
-        gst_mpdparser_parse_metrics_node (&new_mpd_root->Metrics, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
-        gst_mpdparser_parse_utctiming_node (&new_mpd_root->UTCTimings,
-            cur_node);
-      }
+      if (!gst_mpdparser_parse_root_child_node (new_mpd_root, cur_node))
+        goto error;
     }
   }
 
@@ -1252,6 +1336,168 @@ gst_mpdparser_get_mpd_root_node (GstMPDRootNode ** mpd_root_node,
   return ret;
 }
 
+/* looks for a Period of the previous manifest with the same id and the
+ * same markup, which can be shared as is with the new manifest */
+static GstMPDPeriodNode *
+gst_mpdparser_find_reusable_period (GstMPDRootNode * previous,
+    const gchar * id, const gchar * checksum)
+{
+  GList *list;
+
+  if (previous == NULL || id == NULL)
+    return NULL;
+
+  for (list = previous->Periods; list; list = g_list_next (list)) {
+    GstMPDPeriodNode *period = list->data;
+
+    if (period->id && period->xml_checksum
+        && strcmp (period->id, id) == 0
+        && strcmp (period->xml_checksum, checksum) == 0)
+      return period;
+  }
+
+  return NULL;
+}
+
+static gboolean
+gst_mpdparser_read_period_node (GstMPDRootNode * new_mpd_root,
+    xmlTextReaderPtr reader, GstMPDRootNode * previous)
+{
+  GstMPDPeriodNode *period = NULL;
+  xmlChar *markup;
+  xmlChar *id;
+  gchar *checksum = NULL;
+  xmlNode *cur_node;
+
+  markup = xmlTextReaderReadOuterXml (reader);
+  if (markup == NULL)
+    return FALSE;
+
+  /* Periods pulling in remote content get modified when the xlink is
+   * resolved, so they are never shared between manifests */
+  if (strstr ((const gchar *) markup, ":href") == NULL) {
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1,
+        (const gchar *) markup, -1);
+    id = xmlTextReaderGetAttribute (reader, (xmlChar *) "id");
+    period = gst_mpdparser_find_reusable_period (previous,
+        (const gchar *) id, checksum);
+    if (id)
+      xmlFree (id);
+  }
+  xmlFree (markup);
+
+  if (period) {
+    GST_LOG ("reusing unchanged Period %s", period->id);
+    new_mpd_root->Periods =
+        g_list_append (new_mpd_root->Periods, gst_object_ref (period));
+    g_free (checksum);
+    return TRUE;
+  }
+
+  cur_node = xmlTextReaderExpand (reader);
+  if (cur_node == NULL
+      || !gst_mpdparser_parse_period_node (&new_mpd_root->Periods, cur_node)) {
+    g_free (checksum);
+    return FALSE;
+  }
+
+  period = g_list_last (new_mpd_root->Periods)->data;
+  period->xml_checksum = checksum;
+
+  return TRUE;
+}
+
+/*
+ * Streaming variant of gst_mpdparser_get_mpd_root_node(): the manifest is
+ * read with an xmlTextReader and only one child of the MPD element is
+ * expanded in memory at a time. Periods of @previous whose id and markup
+ * did not change are reused instead of being parsed again, which keeps
+ * refreshes of long live manifests cheap.
+ */
+gboolean
+gst_mpdparser_read_mpd_root_node (GstMPDRootNode ** mpd_root_node,
+    const gchar * data, gint size, GstMPDRootNode * previous)
+{
+  xmlTextReaderPtr reader;
+  GstMPDRootNode *new_mpd_root = NULL;
+  int ret;
+
+  if (data == NULL)
+    return FALSE;
+
+  GST_DEBUG ("MPD file fully buffered, start streaming parse...");
+
+  LIBXML_TEST_VERSION;
+
+  reader = xmlReaderForMemory (data, size, "noname.xml", NULL,
+      XML_PARSE_NONET);
+  if (reader == NULL) {
+    GST_ERROR ("failed to create a reader for the MPD file");
+    return FALSE;
+  }
+
+  /* skip to the root element */
+  do {
+    ret = xmlTextReaderRead (reader);
+  } while (ret == 1
+      && xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+  if (ret != 1
+      || xmlStrcmp (xmlTextReaderConstLocalName (reader),
+          (xmlChar *) "MPD") != 0) {
+    GST_ERROR
+        ("can not find the root element MPD, failed to parse the MPD file");
+    goto error;
+  }
+
+  new_mpd_root = gst_mpd_root_node_new ();
+  gst_mpdparser_parse_root_node_attributes (new_mpd_root,
+      xmlTextReaderCurrentNode (reader));
+
+  if (xmlTextReaderIsEmptyElement (reader))
+    goto done;
+
+  /* walk the children of the root node, skipping over each subtree once
+   * it has been handled */
+  ret = xmlTextReaderRead (reader);
+  while (ret == 1 && xmlTextReaderDepth (reader) > 0) {
+    if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT) {
+      ret = xmlTextReaderRead (reader);
+      continue;
+    }
+
+    if (xmlStrcmp (xmlTextReaderConstLocalName (reader),
+            (xmlChar *) "Period") == 0) {
+      if (!gst_mpdparser_read_period_node (new_mpd_root, reader, previous))
+        goto error;
+    } else {
+      xmlNode *cur_node = xmlTextReaderExpand (reader);
+
+      if (cur_node == NULL
+          || !gst_mpdparser_parse_root_child_node (new_mpd_root, cur_node))
+        goto error;
+    }
+
+    ret = xmlTextReaderNext (reader);
+  }
+
+  if (ret < 0) {
+    GST_ERROR ("failed to parse the MPD file");
+    goto error;
+  }
+
+done:
+  xmlFreeTextReader (reader);
+  gst_mpd_root_node_free (*mpd_root_node);
+  *mpd_root_node = new_mpd_root;
+  return TRUE;
+
+error:
+  xmlFreeTextReader (reader);
+  gst_mpd_root_node_free (new_mpd_root);
+  return FALSE;
+}
+
 GstMPDSegmentListNode *
 gst_mpdparser_get_external_segment_list (const gchar * data, gint size,
     GstMPDSegmentListNode * parent)
@@ -99,6 +99,7 @@ gst_mpd_period_node_finalize (GObject * object)
   g_list_free_full (self->BaseURLs, (GDestroyNotify) gst_mpd_baseurl_node_free);
   if (self->xlink_href)
     xmlFree (self->xlink_href);
+  g_free (self->xml_checksum);
 
   G_OBJECT_CLASS (gst_mpd_period_node_parent_class)->finalize (object);
 }
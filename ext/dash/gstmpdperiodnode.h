@@ -55,6 +55,9 @@ struct _GstMPDPeriodNode
 
   gchar *xlink_href;
   int actuate;
+
+  /* checksum of the Period markup, used to reuse the node on refresh */
+  gchar *xml_checksum;
 };
 
 GstMPDPeriodNode * gst_mpd_period_node_new (void);
@@ -195,6 +195,8 @@ gst_mpd_root_node_finalize (GObject * object)
   g_list_free_full (self->Metrics, (GDestroyNotify) gst_mpd_metrics_node_free);
   g_list_free_full (self->UTCTimings,
       (GDestroyNotify) gst_mpd_utctiming_node_free);
+  g_list_free_full (self->ServiceDescriptions,
+      (GDestroyNotify) gst_mpd_service_description_node_free);
 
 
   G_OBJECT_CLASS (gst_mpd_root_node_parent_class)->finalize (object);
@@ -264,6 +266,8 @@ gst_mpd_root_get_xml_node (GstMPDNode * node)
   g_list_foreach (self->Periods, gst_mpd_node_get_list_item, root_xml_node);
   g_list_foreach (self->Metrics, gst_mpd_node_get_list_item, root_xml_node);
   g_list_foreach (self->UTCTimings, gst_mpd_node_get_list_item, root_xml_node);
+  g_list_foreach (self->ServiceDescriptions, gst_mpd_node_get_list_item,
+      root_xml_node);
 
   return root_xml_node;
 }
@@ -400,6 +404,7 @@ gst_mpd_root_node_init (GstMPDRootNode * self)
   self->Metrics = NULL;
   /* list of GstUTCTimingNode nodes */
   self->UTCTimings = NULL;
+  self->ServiceDescriptions = NULL;
 }
 
 GstMPDRootNode *
@@ -37,6 +37,9 @@ struct _GstMPDSegmentBaseNode
   guint64 presentationTimeOffset;
   GstXMLRange *indexRange;
   gboolean indexRangeExact;
+  /* in seconds, may be INFINITY */
+  gdouble availabilityTimeOffset;
+  gboolean availabilityTimeComplete;
   /* Initialization node */
   GstMPDURLTypeNode *Initialization;
   /* RepresentationIndex node */
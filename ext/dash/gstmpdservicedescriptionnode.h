@@ -0,0 +1,50 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library (COPYING); if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef __GSTMPDSERVICEDESCRIPTIONNODE_H__
+#define __GSTMPDSERVICEDESCRIPTIONNODE_H__
+
+#include <gst/gst.h>
+#include "gstmpdnode.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MPD_SERVICE_DESCRIPTION_NODE gst_mpd_service_description_node_get_type ()
+G_DECLARE_FINAL_TYPE (GstMPDServiceDescriptionNode, gst_mpd_service_description_node, GST, MPD_SERVICE_DESCRIPTION_NODE, GstMPDNode)
+
+/* ServiceDescription element as defined in ISO/IEC 23009-1:2019 Annex K,
+ * only the Latency and PlaybackRate children are handled */
+struct _GstMPDServiceDescriptionNode
+{
+  GstObject parent_instance;
+  guint id;
+  /* Latency node, -1 if not set */
+  gint64 latency_target;      /* [ms] */
+  gint64 latency_min;         /* [ms] */
+  gint64 latency_max;         /* [ms] */
+  /* PlaybackRate node, 0.0 if not set */
+  gdouble playback_rate_min;
+  gdouble playback_rate_max;
+};
+
+GstMPDServiceDescriptionNode * gst_mpd_service_description_node_new (void);
+void gst_mpd_service_description_node_free (GstMPDServiceDescriptionNode* self);
+
+G_END_DECLS
+
+#endif /* __GSTMPDSERVICEDESCRIPTIONNODE_H__ */
@@ -0,0 +1,459 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * gsthlsdecrypt.c: AES-128 decryption of HLS fragments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A GstHLSDecryptor decrypts the AES-128-CBC data of one fragment, chunk
+ * by chunk, as it is downloaded.
+ *
+ * Unlike encryption, CBC decryption of a block only depends on the
+ * previous ciphertext block, so the chunks, and slices of big chunks, are
+ * decrypted independently by a process wide pool of workers. The newest
+ * chunk is always kept back until the next one is pushed: meanwhile the
+ * caller processes the previous one, and the last chunk of the fragment
+ * can be unpadded on finish.
+ *
+ * All crypto libraries supported here pick hardware accelerated AES
+ * implementations (AES-NI and the like) at runtime where available.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+
+#if defined(HAVE_OPENSSL)
+#include <openssl/evp.h>
+#elif defined(HAVE_NETTLE)
+#include <nettle/aes.h>
+#include <nettle/cbc.h>
+#elif defined(HAVE_LIBGCRYPT)
+#include <gcrypt.h>
+#endif
+
+#include "gsthlsdecrypt.h"
+
+GST_DEBUG_CATEGORY_EXTERN (gst_hls_demux_debug);
+#define GST_CAT_DEFAULT gst_hls_demux_debug
+
+#define HLS_AES_BLOCK_SIZE 16
+
+/* chunks smaller than this are decrypted on the calling thread, handing
+ * them over to a worker costs more than it saves */
+#define ASYNC_MIN_SIZE (32 * 1024)
+/* smallest part of a chunk decrypted by one worker */
+#define SLICE_MIN_SIZE (64 * 1024)
+
+typedef struct
+{
+  GstBuffer *encrypted;
+  GstBuffer *decrypted;
+  GstMapInfo encrypted_map;
+  GstMapInfo decrypted_map;
+
+  /* slices still being decrypted, protected by the decryptor lock */
+  guint pending;
+  gboolean failed;
+} DecryptChunk;
+
+typedef struct
+{
+  GstHLSDecryptor *decryptor;
+  DecryptChunk *chunk;
+  gsize offset;
+  gsize length;
+  guint8 iv[HLS_AES_BLOCK_SIZE];
+} DecryptSlice;
+
+struct _GstHLSDecryptor
+{
+  guint8 key[HLS_AES_BLOCK_SIZE];
+  /* IV of the next chunk, the last ciphertext block of the previous one */
+  guint8 iv[HLS_AES_BLOCK_SIZE];
+
+  GMutex lock;
+  GCond cond;
+  /* DecryptChunk, in stream order */
+  GQueue chunks;
+};
+
+static GThreadPool *decrypt_pool;
+static guint n_decrypt_workers;
+
+#if defined(HAVE_OPENSSL)
+gboolean
+gst_hls_aes128_cbc_decrypt (const guint8 * key, const guint8 * iv,
+    const guint8 * encrypted_data, guint8 * decrypted_data, gsize length)
+{
+  EVP_CIPHER_CTX *ctx;
+  gboolean ret = FALSE;
+  int len, flen = 0;
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  EVP_CIPHER_CTX ctx_data;
+
+  EVP_CIPHER_CTX_init (&ctx_data);
+  ctx = &ctx_data;
+#else
+  ctx = EVP_CIPHER_CTX_new ();
+  if (ctx == NULL)
+    return FALSE;
+#endif
+
+  if (G_UNLIKELY (length > G_MAXINT || length % HLS_AES_BLOCK_SIZE != 0))
+    goto out;
+
+  if (!EVP_DecryptInit_ex (ctx, EVP_aes_128_cbc (), NULL, key, iv))
+    goto out;
+  EVP_CIPHER_CTX_set_padding (ctx, 0);
+
+  len = (int) length;
+  if (!EVP_DecryptUpdate (ctx, decrypted_data, &len, encrypted_data, len))
+    goto out;
+  EVP_DecryptFinal_ex (ctx, decrypted_data + len, &flen);
+  ret = (len + flen == length);
+
+out:
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  EVP_CIPHER_CTX_cleanup (ctx);
+#else
+  EVP_CIPHER_CTX_free (ctx);
+#endif
+  return ret;
+}
+
+#elif defined(HAVE_NETTLE)
+gboolean
+gst_hls_aes128_cbc_decrypt (const guint8 * key, const guint8 * iv,
+    const guint8 * encrypted_data, guint8 * decrypted_data, gsize length)
+{
+  struct CBC_CTX (struct aes128_ctx, AES_BLOCK_SIZE) ctx;
+
+  if (length % HLS_AES_BLOCK_SIZE != 0)
+    return FALSE;
+
+  aes128_set_decrypt_key (&ctx.ctx, key);
+  CBC_SET_IV (&ctx, iv);
+  CBC_DECRYPT (&ctx, aes128_decrypt, length, decrypted_data, encrypted_data);
+
+  return TRUE;
+}
+
+#elif defined(HAVE_LIBGCRYPT)
+gboolean
+gst_hls_aes128_cbc_decrypt (const guint8 * key, const guint8 * iv,
+    const guint8 * encrypted_data, guint8 * decrypted_data, gsize length)
+{
+  gcry_cipher_hd_t ctx;
+  gcry_error_t err;
+
+  err = gcry_cipher_open (&ctx, GCRY_CIPHER_AES128, GCRY_CIPHER_MODE_CBC, 0);
+  if (err)
+    return FALSE;
+
+  err = gcry_cipher_setkey (ctx, key, HLS_AES_BLOCK_SIZE);
+  if (!err)
+    err = gcry_cipher_setiv (ctx, iv, HLS_AES_BLOCK_SIZE);
+  if (!err)
+    err = gcry_cipher_decrypt (ctx, decrypted_data, length, encrypted_data,
+        length);
+
+  gcry_cipher_close (ctx);
+
+  return err == 0;
+}
+
+#else
+/* NO crypto available */
+gboolean
+gst_hls_aes128_cbc_decrypt (const guint8 * key, const guint8 * iv,
+    const guint8 * encrypted_data, guint8 * decrypted_data, gsize length)
+{
+  GST_ERROR ("Cannot decrypt fragment, no crypto available");
+  return FALSE;
+}
+#endif
+
+static void
+decrypt_slice_func (gpointer data, gpointer user_data)
+{
+  DecryptSlice *slice = data;
+  DecryptChunk *chunk = slice->chunk;
+  GstHLSDecryptor *decryptor = slice->decryptor;
+  gboolean ok;
+
+  ok = gst_hls_aes128_cbc_decrypt (decryptor->key, slice->iv,
+      chunk->encrypted_map.data + slice->offset,
+      chunk->decrypted_map.data + slice->offset, slice->length);
+
+  g_mutex_lock (&decryptor->lock);
+  if (!ok)
+    chunk->failed = TRUE;
+  if (--chunk->pending == 0)
+    g_cond_broadcast (&decryptor->cond);
+  g_mutex_unlock (&decryptor->lock);
+
+  g_slice_free (DecryptSlice, slice);
+}
+
+static gpointer
+create_decrypt_pool (gpointer data)
+{
+  n_decrypt_workers = g_get_num_processors ();
+
+  /* a single core can't overlap decryption with anything */
+  if (n_decrypt_workers > 1) {
+    decrypt_pool = g_thread_pool_new (decrypt_slice_func, NULL,
+        n_decrypt_workers, FALSE, NULL);
+  }
+
+  return NULL;
+}
+
+static GThreadPool *
+get_decrypt_pool (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, create_decrypt_pool, NULL);
+
+  return decrypt_pool;
+}
+
+/* must be called with the decryptor lock taken */
+static void
+decryptor_wait_chunk (GstHLSDecryptor * decryptor, DecryptChunk * chunk)
+{
+  while (chunk->pending > 0)
+    g_cond_wait (&decryptor->cond, &decryptor->lock);
+}
+
+/* Frees @chunk, returning its decrypted buffer (transfer full) if asked
+ * for, without reporting whether decrypting it failed */
+static GstBuffer *
+decrypt_chunk_release (DecryptChunk * chunk, gboolean keep_decrypted)
+{
+  GstBuffer *decrypted = NULL;
+
+  gst_buffer_unmap (chunk->decrypted, &chunk->decrypted_map);
+  gst_buffer_unmap (chunk->encrypted, &chunk->encrypted_map);
+  gst_buffer_unref (chunk->encrypted);
+
+  if (keep_decrypted)
+    decrypted = chunk->decrypted;
+  else
+    gst_buffer_unref (chunk->decrypted);
+
+  g_slice_free (DecryptChunk, chunk);
+
+  return decrypted;
+}
+
+static gboolean
+decrypt_chunk_free (DecryptChunk * chunk, GstBuffer ** decrypted,
+    GError ** err)
+{
+  gboolean ok = !chunk->failed;
+  GstBuffer *buffer;
+
+  buffer = decrypt_chunk_release (chunk, ok && decrypted);
+  if (buffer)
+    *decrypted = buffer;
+
+  if (!ok) {
+    GST_ERROR ("Failed to decrypt fragment");
+    g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
+        "Failed to decrypt fragment");
+  }
+
+  return ok;
+}
+
+GstHLSDecryptor *
+gst_hls_decryptor_new (const guint8 * key, const guint8 * iv)
+{
+  GstHLSDecryptor *decryptor;
+
+  decryptor = g_slice_new0 (GstHLSDecryptor);
+  memcpy (decryptor->key, key, HLS_AES_BLOCK_SIZE);
+  memcpy (decryptor->iv, iv, HLS_AES_BLOCK_SIZE);
+  g_mutex_init (&decryptor->lock);
+  g_cond_init (&decryptor->cond);
+  g_queue_init (&decryptor->chunks);
+
+  return decryptor;
+}
+
+/**
+ * gst_hls_decryptor_push:
+ * @decryptor: the #GstHLSDecryptor
+ * @encrypted: (transfer full): the next encrypted chunk, its size must be a
+ *   multiple of 16 bytes
+ * @decrypted: (out) (transfer full) (nullable): the previous chunk once
+ *   decrypted, %NULL if there was none
+ * @err: return location for a #GError
+ *
+ * Starts decrypting @encrypted and returns the previously pushed chunk.
+ *
+ * Returns: %FALSE if decrypting the previous chunk failed
+ */
+gboolean
+gst_hls_decryptor_push (GstHLSDecryptor * decryptor, GstBuffer * encrypted,
+    GstBuffer ** decrypted, GError ** err)
+{
+  GThreadPool *pool = get_decrypt_pool ();
+  DecryptChunk *chunk, *previous = NULL;
+  gsize size, n_slices, slice_size, offset;
+  guint i;
+
+  *decrypted = NULL;
+
+  size = gst_buffer_get_size (encrypted);
+  if (size == 0 || size % HLS_AES_BLOCK_SIZE != 0) {
+    gst_buffer_unref (encrypted);
+    if (size == 0)
+      return TRUE;
+    g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
+        "Encrypted data of %" G_GSIZE_FORMAT " bytes is not block aligned",
+        size);
+    return FALSE;
+  }
+
+  chunk = g_slice_new0 (DecryptChunk);
+  chunk->encrypted = encrypted;
+  chunk->decrypted = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (chunk->encrypted, &chunk->encrypted_map, GST_MAP_READ);
+  gst_buffer_map (chunk->decrypted, &chunk->decrypted_map, GST_MAP_WRITE);
+
+  if (pool == NULL || size < ASYNC_MIN_SIZE) {
+    chunk->failed = !gst_hls_aes128_cbc_decrypt (decryptor->key,
+        decryptor->iv, chunk->encrypted_map.data, chunk->decrypted_map.data,
+        size);
+  } else {
+    n_slices = CLAMP (size / SLICE_MIN_SIZE, 1, n_decrypt_workers);
+    slice_size = (size / n_slices) & ~(HLS_AES_BLOCK_SIZE - 1);
+    chunk->pending = n_slices;
+
+    GST_TRACE ("Decrypting %" G_GSIZE_FORMAT " bytes in %" G_GSIZE_FORMAT
+        " slices", size, n_slices);
+
+    for (i = 0, offset = 0; i < n_slices; i++) {
+      DecryptSlice *slice = g_slice_new (DecryptSlice);
+
+      slice->decryptor = decryptor;
+      slice->chunk = chunk;
+      slice->offset = offset;
+      slice->length = (i == n_slices - 1) ? size - offset : slice_size;
+      if (offset == 0) {
+        memcpy (slice->iv, decryptor->iv, HLS_AES_BLOCK_SIZE);
+      } else {
+        memcpy (slice->iv, chunk->encrypted_map.data + offset -
+            HLS_AES_BLOCK_SIZE, HLS_AES_BLOCK_SIZE);
+      }
+      offset += slice->length;
+
+      g_thread_pool_push (pool, slice, NULL);
+    }
+  }
+
+  memcpy (decryptor->iv, chunk->encrypted_map.data + size - HLS_AES_BLOCK_SIZE,
+      HLS_AES_BLOCK_SIZE);
+
+  g_mutex_lock (&decryptor->lock);
+  g_queue_push_tail (&decryptor->chunks, chunk);
+  /* the newest chunk is kept back, it might be the last one */
+  if (g_queue_get_length (&decryptor->chunks) > 1) {
+    previous = g_queue_pop_head (&decryptor->chunks);
+    decryptor_wait_chunk (decryptor, previous);
+  }
+  g_mutex_unlock (&decryptor->lock);
+
+  if (previous == NULL)
+    return TRUE;
+
+  return decrypt_chunk_free (previous, decrypted, err);
+}
+
+/**
+ * gst_hls_decryptor_finish:
+ * @decryptor: the #GstHLSDecryptor
+ * @decrypted: (out) (transfer full) (nullable): the last chunk once
+ *   decrypted and unpadded, %NULL if there was none
+ * @err: return location for a #GError
+ *
+ * Returns: %FALSE if decrypting the last chunk failed
+ */
+gboolean
+gst_hls_decryptor_finish (GstHLSDecryptor * decryptor, GstBuffer ** decrypted,
+    GError ** err)
+{
+  DecryptChunk *chunk;
+  GstMapInfo info;
+  guint8 padding;
+  gsize size;
+
+  *decrypted = NULL;
+
+  g_mutex_lock (&decryptor->lock);
+  chunk = g_queue_pop_head (&decryptor->chunks);
+  if (chunk)
+    decryptor_wait_chunk (decryptor, chunk);
+  g_mutex_unlock (&decryptor->lock);
+
+  if (chunk == NULL)
+    return TRUE;
+
+  if (!decrypt_chunk_free (chunk, decrypted, err))
+    return FALSE;
+
+  /* Handle pkcs7 unpadding here */
+  gst_buffer_map (*decrypted, &info, GST_MAP_READ);
+  size = info.size;
+  padding = info.data[size - 1];
+  gst_buffer_unmap (*decrypted, &info);
+
+  if (padding == 0 || padding > HLS_AES_BLOCK_SIZE || padding > size) {
+    GST_WARNING ("Invalid PKCS#7 padding of %u bytes", padding);
+  } else {
+    gst_buffer_resize (*decrypted, 0, size - padding);
+  }
+
+  return TRUE;
+}
+
+void
+gst_hls_decryptor_free (GstHLSDecryptor * decryptor)
+{
+  DecryptChunk *chunk;
+
+  /* the workers can't be interrupted, wait for the chunks in flight. Their
+   * content is dropped, a failure to decrypt it is not an error on a flush
+   * or stop */
+  g_mutex_lock (&decryptor->lock);
+  while ((chunk = g_queue_pop_head (&decryptor->chunks))) {
+    decryptor_wait_chunk (decryptor, chunk);
+    decrypt_chunk_release (chunk, FALSE);
+  }
+  g_mutex_unlock (&decryptor->lock);
+
+  g_mutex_clear (&decryptor->lock);
+  g_cond_clear (&decryptor->cond);
+  g_slice_free (GstHLSDecryptor, decryptor);
+}
@@ -0,0 +1,53 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * gsthlsdecrypt.h: AES-128 decryption of HLS fragments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_HLS_DECRYPT_H__
+#define __GST_HLS_DECRYPT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstHLSDecryptor GstHLSDecryptor;
+
+gboolean          gst_hls_aes128_cbc_decrypt (const guint8 * key,
+                                              const guint8 * iv,
+                                              const guint8 * encrypted_data,
+                                              guint8 * decrypted_data,
+                                              gsize length);
+
+GstHLSDecryptor * gst_hls_decryptor_new      (const guint8 * key,
+                                              const guint8 * iv);
+
+gboolean          gst_hls_decryptor_push     (GstHLSDecryptor * decryptor,
+                                              GstBuffer * encrypted,
+                                              GstBuffer ** decrypted,
+                                              GError ** err);
+
+gboolean          gst_hls_decryptor_finish   (GstHLSDecryptor * decryptor,
+                                              GstBuffer ** decrypted,
+                                              GError ** err);
+
+void              gst_hls_decryptor_free     (GstHLSDecryptor * decryptor);
+
+G_END_DECLS
+
+#endif /* __GST_HLS_DECRYPT_H__ */
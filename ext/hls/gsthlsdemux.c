@@ -70,14 +70,12 @@ gst_hls_demux_change_state (GstElement * element, GstStateChange transition);
 
 /* GstHLSDemux */
 static gboolean gst_hls_demux_update_playlist (GstHLSDemux * demux,
-    gboolean update, GError ** err);
+    gboolean update, gboolean blocking, GError ** err);
 static gchar *gst_hls_src_buf_to_utf8_playlist (GstBuffer * buf);
 
 /* FIXME: the return value is never used? */
 static gboolean gst_hls_demux_change_playlist (GstHLSDemux * demux,
     guint max_bitrate, gboolean * changed);
-static GstBuffer *gst_hls_demux_decrypt_fragment (GstHLSDemux * demux,
-    GstHLSDemuxStream * stream, GstBuffer * encrypted_buffer, GError ** err);
 static gboolean
 gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
     const guint8 * key_data, const guint8 * iv_data);
@@ -108,6 +106,8 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_peek_fragment (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
@@ -175,6 +175,7 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment = gst_hls_demux_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
@@ -259,7 +260,6 @@ gst_hls_demux_stream_clear_pending_data (GstHLSDemuxStream * hls_stream)
 {
   if (hls_stream->pending_encrypted_data)
     gst_adapter_clear (hls_stream->pending_encrypted_data);
-  gst_buffer_replace (&hls_stream->pending_decrypted_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_typefind_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_pcr_buffer, NULL);
   hls_stream->current_offset = -1;
@@ -286,7 +286,7 @@ gst_hls_demux_set_current (GstHLSDemux * self, GstM3U8 * m3u8)
   if (m3u8 != self->current) {
     self->current = m3u8;
     self->current->duration = GST_CLOCK_TIME_NONE;
-    self->current->current_file = NULL;
+    self->current->current_file = -1;
 
 #if 0
     // FIXME: this makes no sense after we just set self->current=m3u8 above (tpm)
@@ -347,7 +347,7 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
     gst_hls_demux_set_current_variant (hlsdemux,
         hlsdemux->master->iframe_variants->data);
     gst_uri_downloader_reset (demux->downloader);
-    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, &err)) {
+    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, FALSE, &err)) {
       GST_ELEMENT_ERROR_FROM_ERROR (hlsdemux, "Could not switch playlist", err);
       return FALSE;
     }
@@ -360,7 +360,7 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
     gst_hls_demux_set_current_variant (hlsdemux,
         hlsdemux->master->variants->data);
     gst_uri_downloader_reset (demux->downloader);
-    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, &err)) {
+    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, FALSE, &err)) {
       GST_ELEMENT_ERROR_FROM_ERROR (hlsdemux, "Could not switch playlist", err);
       return FALSE;
     }
@@ -406,7 +406,8 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     GstSeekFlags flags, GstClockTime ts, GstClockTime * final_ts)
 {
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
-  GList *walk;
+  GPtrArray *files;
+  guint i;
   GstClockTime current_pos;
   gint64 current_sequence;
   gboolean snap_after, snap_nearest;
@@ -423,8 +424,9 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
 
   GST_M3U8_CLIENT_LOCK (hlsdemux->client);
   /* FIXME: Here we need proper discont handling */
-  for (walk = hls_stream->playlist->files; walk; walk = walk->next) {
-    file = walk->data;
+  files = hls_stream->playlist->files;
+  for (i = 0; i < files->len; i++) {
+    file = g_ptr_array_index (files, i);
 
     current_sequence = file->sequence;
     if ((forward && snap_after) || snap_nearest) {
@@ -446,7 +448,7 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     current_pos += file->duration;
   }
 
-  if (walk == NULL) {
+  if (i == files->len) {
     GST_DEBUG_OBJECT (stream->pad, "seeking further than track duration");
     current_sequence++;
   }
@@ -455,7 +457,8 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
       (guint) current_sequence);
   hls_stream->reset_pts = TRUE;
   hls_stream->playlist->sequence = current_sequence;
-  hls_stream->playlist->current_file = walk;
+  hls_stream->playlist->current_file = i < files->len ? i : -1;
+  hls_stream->playlist->part = -1;
   hls_stream->playlist->sequence_position = current_pos;
   GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
 
@@ -478,8 +481,13 @@ static GstFlowReturn
 gst_hls_demux_update_manifest (GstAdaptiveDemux * demux)
 {
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
-  if (!gst_hls_demux_update_playlist (hlsdemux, TRUE, NULL))
+  /* Live playlists are only reloaded from the manifest update task, where
+   * the manifest lock can be released during blocking reloads */
+  if (!gst_hls_demux_update_playlist (hlsdemux, TRUE, TRUE, NULL)) {
+    if (hlsdemux->current_variant)
+      gst_m3u8_reload_failed (hlsdemux->current_variant->m3u8);
     return GST_FLOW_ERROR;
+  }
 
   return GST_FLOW_OK;
 }
@@ -714,11 +722,12 @@ gst_hls_demux_set_current_variant (GstHLSDemux * hlsdemux,
     variant->m3u8->sequence_position =
         hlsdemux->current_variant->m3u8->sequence_position;
     variant->m3u8->sequence = hlsdemux->current_variant->m3u8->sequence;
+    variant->m3u8->part = hlsdemux->current_variant->m3u8->part;
 
     GST_DEBUG_OBJECT (hlsdemux,
         "Switching Variant. Copying over sequence %" G_GINT64_FORMAT
-        " and sequence_pos %" GST_TIME_FORMAT, variant->m3u8->sequence,
-        GST_TIME_ARGS (variant->m3u8->sequence_position));
+        " part %d and sequence_pos %" GST_TIME_FORMAT, variant->m3u8->sequence,
+        variant->m3u8->part, GST_TIME_ARGS (variant->m3u8->sequence_position));
 
     for (i = 0; i < GST_HLS_N_MEDIA_TYPES; ++i) {
       GList *mlist = hlsdemux->current_variant->media[i];
@@ -735,6 +744,7 @@ gst_hls_demux_set_current_variant (GstHLSDemux * hlsdemux,
           GST_LOG_OBJECT (hlsdemux, "new_media '%s' '%s'", new_media->name,
               new_media->uri);
           new_media->playlist->sequence = old_media->playlist->sequence;
+          new_media->playlist->part = old_media->playlist->part;
           new_media->playlist->sequence_position =
               old_media->playlist->sequence_position;
         } else {
@@ -804,7 +814,7 @@ gst_hls_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
   if (!hlsdemux->master->is_simple) {
     GError *err = NULL;
 
-    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, &err)) {
+    if (!gst_hls_demux_update_playlist (hlsdemux, FALSE, FALSE, &err)) {
       GST_ELEMENT_ERROR_FROM_ERROR (demux, "Could not fetch media playlist",
           err);
       GST_M3U8_CLIENT_UNLOCK (self);
@@ -844,7 +854,6 @@ static const GstHLSKey *
 gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
     const gchar * referer, gboolean allow_cache)
 {
-  GstFragment *key_fragment;
   GstBuffer *key_buffer;
   GstHLSKey *key;
   GError *err = NULL;
@@ -862,19 +871,18 @@ gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
 
   GST_INFO_OBJECT (demux, "Fetching key %s", key_url);
 
-  key_fragment =
-      gst_uri_downloader_fetch_uri (GST_ADAPTIVE_DEMUX (demux)->downloader,
-      key_url, referer, FALSE, FALSE, allow_cache, &err);
+  /* goes through the shared fragment cache if there is one, so that
+   * several demuxers playing the same content only download the key once */
+  key_buffer = gst_adaptive_demux_fetch_uri (GST_ADAPTIVE_DEMUX (demux),
+      key_url, referer, allow_cache, &err);
 
-  if (key_fragment == NULL) {
+  if (key_buffer == NULL) {
     GST_WARNING_OBJECT (demux, "Failed to download key to decrypt data: %s",
         err ? err->message : "error");
     g_clear_error (&err);
     goto out;
   }
 
-  key_buffer = gst_fragment_get_buffer (key_fragment);
-
   key = g_new0 (GstHLSKey, 1);
   if (gst_buffer_extract (key_buffer, 0, key->data, 16) < 16)
     GST_WARNING_OBJECT (demux, "Download decryption key is too short!");
@@ -882,7 +890,6 @@ gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
   g_hash_table_insert (demux->keys, g_strdup (key_url), key);
 
   gst_buffer_unref (key_buffer);
-  g_object_unref (key_fragment);
 
 out:
 
@@ -1061,29 +1068,21 @@ gst_hls_demux_finish_fragment (GstAdaptiveDemux * demux,
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);   // FIXME: pass HlsStream into function
   GstFlowReturn ret = GST_FLOW_OK;
 
-  if (hls_stream->current_key)
-    gst_hls_demux_stream_decrypt_end (hls_stream);
-
   if (stream->last_ret == GST_FLOW_OK) {
-    if (hls_stream->pending_decrypted_buffer) {
-      if (hls_stream->current_key) {
-        GstMapInfo info;
-        gssize unpadded_size;
-
-        /* Handle pkcs7 unpadding here */
-        gst_buffer_map (hls_stream->pending_decrypted_buffer, &info,
-            GST_MAP_READ);
-        unpadded_size = info.size - info.data[info.size - 1];
-        gst_buffer_unmap (hls_stream->pending_decrypted_buffer, &info);
-
-        gst_buffer_resize (hls_stream->pending_decrypted_buffer, 0,
-            unpadded_size);
+    if (hls_stream->decryptor) {
+      GstBuffer *buffer;
+      GError *err = NULL;
+
+      /* waits for the last chunk of the fragment and unpads it */
+      if (!gst_hls_decryptor_finish (hls_stream->decryptor, &buffer, &err)) {
+        GST_ELEMENT_ERROR (demux, STREAM, DECODE,
+            ("Failed to decrypt buffer"), ("decryption failed %s",
+                err->message));
+        g_error_free (err);
+        ret = GST_FLOW_ERROR;
+      } else if (buffer) {
+        ret = gst_hls_demux_handle_buffer (demux, stream, buffer, TRUE);
       }
-
-      ret =
-          gst_hls_demux_handle_buffer (demux, stream,
-          hls_stream->pending_decrypted_buffer, TRUE);
-      hls_stream->pending_decrypted_buffer = NULL;
     }
 
     if (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED) {
@@ -1108,6 +1107,8 @@ gst_hls_demux_finish_fragment (GstAdaptiveDemux * demux,
     }
   }
 
+  gst_hls_demux_stream_decrypt_end (hls_stream);
+
   if (G_UNLIKELY (stream->downloading_header || stream->downloading_index))
     return GST_FLOW_OK;
 
@@ -1124,7 +1125,6 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstBuffer * buffer)
 {
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
-  GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
 
   if (hls_stream->current_offset == -1)
     hls_stream->current_offset = 0;
@@ -1133,7 +1133,6 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
   if (hls_stream->current_key) {
     GError *err = NULL;
     gsize size;
-    GstBuffer *tmp_buffer;
 
     if (hls_stream->pending_encrypted_data == NULL)
       hls_stream->pending_encrypted_data = gst_adapter_new ();
@@ -1149,18 +1148,16 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
     }
 
     buffer = gst_adapter_take_buffer (hls_stream->pending_encrypted_data, size);
-    buffer =
-        gst_hls_demux_decrypt_fragment (hlsdemux, hls_stream, buffer, &err);
-    if (buffer == NULL) {
+
+    /* The chunk is decrypted by a worker while we process the previous one,
+     * the last one is only known at EOS and kept back for pkcs7 unpadding */
+    if (!gst_hls_decryptor_push (hls_stream->decryptor, buffer, &buffer,
+            &err)) {
       GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Failed to decrypt buffer"),
           ("decryption failed %s", err->message));
       g_error_free (err);
       return GST_FLOW_ERROR;
     }
-
-    tmp_buffer = hls_stream->pending_decrypted_buffer;
-    hls_stream->pending_decrypted_buffer = buffer;
-    buffer = tmp_buffer;
   }
 
   return gst_hls_demux_handle_buffer (demux, stream, buffer, FALSE);
@@ -1179,7 +1176,6 @@ gst_hls_demux_stream_free (GstAdaptiveDemuxStream * stream)
   if (hls_stream->pending_encrypted_data)
     g_object_unref (hls_stream->pending_encrypted_data);
 
-  gst_buffer_replace (&hls_stream->pending_decrypted_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_typefind_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_pcr_buffer, NULL);
 
@@ -1300,6 +1296,32 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_peek_fragment (GstAdaptiveDemuxStream * stream, guint n,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (GST_HLS_DEMUX_STREAM_CAST (stream));
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0, n);
+  if (file == NULL)
+    return FALSE;
+
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1448,6 +1470,7 @@ gst_hls_demux_update_variant_playlist (GstHLSDemux * hlsdemux, gchar * data,
       /* FIXME: Deal with losing position due to missing an update */
       variant->m3u8->sequence_position = old->m3u8->sequence_position;
       variant->m3u8->sequence = old->m3u8->sequence;
+      variant->m3u8->part = old->m3u8->part;
     }
   }
 
@@ -1491,9 +1514,25 @@ out:
   return ret;
 }
 
+/* Blocking reloads are held back by the server until the playlist changes,
+ * don't keep the manifest lock meanwhile */
+static GstFragment *
+gst_hls_demux_fetch_playlist (GstHLSDemux * demux, const gchar * uri,
+    const gchar * referer, gboolean blocking, GError ** err)
+{
+  GstAdaptiveDemux *adaptive_demux = GST_ADAPTIVE_DEMUX (demux);
+
+  if (blocking)
+    return gst_adaptive_demux_fetch_uri_unlocked (adaptive_demux, uri,
+        referer, err);
+
+  return gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri,
+      referer, TRUE, TRUE, TRUE, err);
+}
+
 static gboolean
 gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
-    GstHLSMedia * media, GError ** err)
+    GstHLSMedia * media, gboolean blocking, GError ** err)
 {
   GstAdaptiveDemux *adaptive_demux = GST_ADAPTIVE_DEMUX (demux);
   GstFragment *download;
@@ -1502,23 +1541,32 @@ gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
   const gchar *main_uri;
   GstM3U8 *m3u8;
   gchar *uri = media->uri;
+  gchar *reload_uri;
+
+  m3u8 = media->playlist;
 
   main_uri = gst_adaptive_demux_get_manifest_ref_uri (adaptive_demux);
-  download =
-      gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri, main_uri,
-      TRUE, TRUE, TRUE, err);
+  reload_uri = blocking ? gst_m3u8_get_blocking_reload_uri (m3u8) : NULL;
+  download = gst_hls_demux_fetch_playlist (demux, reload_uri ? reload_uri : uri,
+      main_uri, reload_uri != NULL, err);
 
-  if (download == NULL)
+  if (download == NULL) {
+    g_free (reload_uri);
     return FALSE;
+  }
 
-  m3u8 = media->playlist;
-
-  /* Set the base URI of the playlist to the redirect target if any */
-  if (download->redirect_permanent && download->redirect_uri) {
-    gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL, media->name);
-  } else {
-    gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri, media->name);
+  /* Set the base URI of the playlist to the redirect target if any. The URI
+   * of a blocking reload has its own query parameters, keep the previous one
+   * in that case */
+  if (reload_uri == NULL) {
+    if (download->redirect_permanent && download->redirect_uri) {
+      gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL, media->name);
+    } else {
+      gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri,
+          media->name);
+    }
   }
+  g_free (reload_uri);
 
   buf = gst_fragment_get_buffer (download);
   playlist = gst_hls_src_buf_to_utf8_playlist (buf);
@@ -1544,27 +1592,45 @@ gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
 
 static gboolean
 gst_hls_demux_update_playlist (GstHLSDemux * demux, gboolean update,
-    GError ** err)
+    gboolean blocking, GError ** err)
 {
   GstAdaptiveDemux *adaptive_demux = GST_ADAPTIVE_DEMUX (demux);
+  GstHLSVariantStream *variant;
+  gboolean variant_changed;
   GstFragment *download;
   GstBuffer *buf;
   gchar *playlist;
   gboolean main_checked = FALSE;
   const gchar *main_uri;
   GstM3U8 *m3u8;
-  gchar *uri;
+  gchar *uri, *reload_uri;
   gint i;
 
 retry:
   uri = gst_m3u8_get_uri (demux->current_variant->m3u8);
   main_uri = gst_adaptive_demux_get_manifest_ref_uri (adaptive_demux);
-  download =
-      gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri, main_uri,
-      TRUE, TRUE, TRUE, err);
+  /* Low-latency playlists are requested to be sent back once they changed */
+  reload_uri = update && blocking ?
+      gst_m3u8_get_blocking_reload_uri (demux->current_variant->m3u8) : NULL;
+  variant = gst_hls_variant_stream_ref (demux->current_variant);
+  download = gst_hls_demux_fetch_playlist (demux, reload_uri ? reload_uri : uri,
+      main_uri, reload_uri != NULL, err);
+  /* The variant may have been switched while the manifest lock was released,
+   * the playlist is outdated then */
+  variant_changed = demux->current_variant != variant;
+  gst_hls_variant_stream_unref (variant);
+  if (download != NULL && variant_changed) {
+    GST_DEBUG_OBJECT (demux, "Variant changed during the reload of %s", uri);
+    g_object_unref (download);
+    g_free (reload_uri);
+    g_free (uri);
+    return TRUE;
+  }
   if (download == NULL) {
     gchar *base_uri;
 
+    g_free (reload_uri);
+
     if (!update || main_checked || demux->master->is_simple
         || !gst_adaptive_demux_is_running (GST_ADAPTIVE_DEMUX_CAST (demux))) {
       g_free (uri);
@@ -1622,14 +1688,19 @@ retry:
 
   m3u8 = demux->current_variant->m3u8;
 
-  /* Set the base URI of the playlist to the redirect target if any */
-  if (download->redirect_permanent && download->redirect_uri) {
-    gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL,
-        demux->current_variant->name);
-  } else {
-    gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri,
-        demux->current_variant->name);
+  /* Set the base URI of the playlist to the redirect target if any. The URI
+   * of a blocking reload has its own query parameters, keep the previous one
+   * in that case */
+  if (reload_uri == NULL) {
+    if (download->redirect_permanent && download->redirect_uri) {
+      gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL,
+          demux->current_variant->name);
+    } else {
+      gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri,
+          demux->current_variant->name);
+    }
   }
+  g_free (reload_uri);
 
   buf = gst_fragment_get_buffer (download);
   playlist = gst_hls_src_buf_to_utf8_playlist (buf);
@@ -1650,10 +1721,13 @@ retry:
     return FALSE;
   }
 
+  /* Keep the media lists alive if the variant gets switched during a
+   * blocking reload */
+  variant = gst_hls_variant_stream_ref (demux->current_variant);
   for (i = 0; i < GST_HLS_N_MEDIA_TYPES; ++i) {
-    GList *mlist = demux->current_variant->media[i];
+    GList *mlist = variant->media[i];
 
-    while (mlist != NULL) {
+    while (mlist != NULL && demux->current_variant == variant) {
       GstHLSMedia *media = mlist->data;
 
       if (media->uri == NULL) {
@@ -1666,23 +1740,33 @@ retry:
           "Updating playlist for media of type %d - %s, uri: %s", i,
           media->name, media->uri);
 
-      if (!gst_hls_demux_update_rendition_manifest (demux, media, err))
+      if (!gst_hls_demux_update_rendition_manifest (demux, media,
+              update && blocking, err)) {
+        gst_hls_variant_stream_unref (variant);
         return FALSE;
+      }
 
       mlist = mlist->next;
     }
   }
+  variant_changed = demux->current_variant != variant;
+  gst_hls_variant_stream_unref (variant);
+  if (variant_changed) {
+    GST_DEBUG_OBJECT (demux, "Variant changed during the rendition reloads");
+    return TRUE;
+  }
 
   /* If it's a live source, do not let the sequence number go beyond
-   * three fragments before the end of the list */
-  if (update == FALSE && gst_m3u8_is_live (m3u8)) {
+   * three fragments before the end of the list, unless it starts from a
+   * part close to the live edge */
+  if (update == FALSE && gst_m3u8_is_live (m3u8) && m3u8->part == -1) {
     gint64 last_sequence, first_sequence;
 
     GST_M3U8_CLIENT_LOCK (demux->client);
-    last_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence;
+    last_sequence = GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+            m3u8->files->len - 1))->sequence;
     first_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_first (m3u8->files)->data)->sequence;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, 0))->sequence;
 
     GST_DEBUG_OBJECT (demux,
         "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
@@ -1700,7 +1784,6 @@ retry:
   } else if (!gst_m3u8_is_live (m3u8)) {
     GstClockTime current_pos, target_pos;
     guint sequence = 0;
-    GList *walk;
 
     /* Sequence numbers are not guaranteed to be the same in different
      * playlists, so get the correct fragment here based on the current
@@ -1724,8 +1807,8 @@ retry:
         GST_TIME_FORMAT " in updated playlist", GST_TIME_ARGS (target_pos));
 
     current_pos = 0;
-    for (walk = m3u8->files; walk; walk = walk->next) {
-      GstM3U8MediaFile *file = walk->data;
+    for (i = 0; i < (gint) m3u8->files->len; i++) {
+      GstM3U8MediaFile *file = g_ptr_array_index (m3u8->files, i);
 
       sequence = file->sequence;
       if (current_pos <= target_pos
@@ -1735,7 +1818,7 @@ retry:
       current_pos += file->duration;
     }
     /* End of playlist */
-    if (!walk)
+    if (i == (gint) m3u8->files->len)
       sequence++;
     m3u8->sequence = sequence;
     m3u8->sequence_position = current_pos;
@@ -1785,7 +1868,7 @@ retry_failover_protection:
   GST_INFO_OBJECT (demux, "Client was on %dbps, max allowed is %dbps, switching"
       " to bitrate %dbps", old_bandwidth, max_bitrate, new_bandwidth);
 
-  if (gst_hls_demux_update_playlist (demux, TRUE, NULL)) {
+  if (gst_hls_demux_update_playlist (demux, TRUE, FALSE, NULL)) {
     const gchar *main_uri;
     gchar *uri;
 
@@ -1840,218 +1923,43 @@ retry_failover_protection:
   return TRUE;
 }
 
-#if defined(HAVE_OPENSSL)
-static gboolean
-gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
-    const guint8 * key_data, const guint8 * iv_data)
-{
-  EVP_CIPHER_CTX *ctx;
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-  EVP_CIPHER_CTX_init (&stream->aes_ctx);
-  ctx = &stream->aes_ctx;
-#else
-  stream->aes_ctx = EVP_CIPHER_CTX_new ();
-  ctx = stream->aes_ctx;
-#endif
-  if (!EVP_DecryptInit_ex (ctx, EVP_aes_128_cbc (), NULL, key_data, iv_data))
-    return FALSE;
-  EVP_CIPHER_CTX_set_padding (ctx, 0);
-  return TRUE;
-}
-
-static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
-{
-  int len, flen = 0;
-  EVP_CIPHER_CTX *ctx;
-
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-  ctx = &stream->aes_ctx;
-#else
-  ctx = stream->aes_ctx;
-#endif
-
-  if (G_UNLIKELY (length > G_MAXINT || length % 16 != 0))
-    return FALSE;
-
-  len = (int) length;
-  if (!EVP_DecryptUpdate (ctx, decrypted_data, &len, encrypted_data, len))
-    return FALSE;
-  EVP_DecryptFinal_ex (ctx, decrypted_data + len, &flen);
-  g_return_val_if_fail (len + flen == length, FALSE);
-  return TRUE;
-}
-
-static void
-gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
-{
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-  EVP_CIPHER_CTX_cleanup (&stream->aes_ctx);
-#else
-  EVP_CIPHER_CTX_free (stream->aes_ctx);
-  stream->aes_ctx = NULL;
-#endif
-}
-
-#elif defined(HAVE_NETTLE)
 static gboolean
 gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
     const guint8 * key_data, const guint8 * iv_data)
 {
-  aes128_set_decrypt_key (&stream->aes_ctx.ctx, key_data);
-  CBC_SET_IV (&stream->aes_ctx, iv_data);
-
-  return TRUE;
-}
-
-static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
-{
-  if (length % 16 != 0)
-    return FALSE;
-
-  CBC_DECRYPT (&stream->aes_ctx, aes128_decrypt, length, decrypted_data,
-      encrypted_data);
+#if defined(HAVE_OPENSSL) || defined(HAVE_NETTLE) || defined(HAVE_LIBGCRYPT)
+  gst_hls_demux_stream_decrypt_end (stream);
+  stream->decryptor = gst_hls_decryptor_new (key_data, iv_data);
 
   return TRUE;
-}
-
-static void
-gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
-{
-  /* NOP */
-}
-
-#elif defined(HAVE_LIBGCRYPT)
-static gboolean
-gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
-    const guint8 * key_data, const guint8 * iv_data)
-{
-  gcry_error_t err = 0;
-  gboolean ret = FALSE;
-
-  err =
-      gcry_cipher_open (&stream->aes_ctx, GCRY_CIPHER_AES128,
-      GCRY_CIPHER_MODE_CBC, 0);
-  if (err)
-    goto out;
-  err = gcry_cipher_setkey (stream->aes_ctx, key_data, 16);
-  if (err)
-    goto out;
-  err = gcry_cipher_setiv (stream->aes_ctx, iv_data, 16);
-  if (!err)
-    ret = TRUE;
-
-out:
-  if (!ret)
-    if (stream->aes_ctx)
-      gcry_cipher_close (stream->aes_ctx);
-
-  return ret;
-}
-
-static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
-{
-  gcry_error_t err = 0;
-
-  err = gcry_cipher_decrypt (stream->aes_ctx, decrypted_data, length,
-      encrypted_data, length);
-
-  return err == 0;
-}
-
-static void
-gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
-{
-  if (stream->aes_ctx) {
-    gcry_cipher_close (stream->aes_ctx);
-    stream->aes_ctx = NULL;
-  }
-}
-
 #else
-/* NO crypto available */
-static gboolean
-gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
-    const guint8 * key_data, const guint8 * iv_data)
-{
   GST_ERROR ("No crypto available");
   return FALSE;
-}
-
-static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
-{
-  GST_ERROR ("Cannot decrypt fragment, no crypto available");
-  return FALSE;
+#endif
 }
 
 static void
 gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
 {
-  return;
-}
-#endif
-
-static GstBuffer *
-gst_hls_demux_decrypt_fragment (GstHLSDemux * demux, GstHLSDemuxStream * stream,
-    GstBuffer * encrypted_buffer, GError ** err)
-{
-  GstBuffer *decrypted_buffer = NULL;
-  GstMapInfo encrypted_info, decrypted_info;
-
-  decrypted_buffer =
-      gst_buffer_new_allocate (NULL, gst_buffer_get_size (encrypted_buffer),
-      NULL);
-
-  gst_buffer_map (encrypted_buffer, &encrypted_info, GST_MAP_READ);
-  gst_buffer_map (decrypted_buffer, &decrypted_info, GST_MAP_WRITE);
-
-  if (!decrypt_fragment (stream, encrypted_info.size,
-          encrypted_info.data, decrypted_info.data))
-    goto decrypt_error;
-
-
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-
-  return decrypted_buffer;
-
-decrypt_error:
-  GST_ERROR_OBJECT (demux, "Failed to decrypt fragment");
-  g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
-      "Failed to decrypt fragment");
-
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-  gst_buffer_unref (decrypted_buffer);
-
-  return NULL;
+  if (stream->decryptor) {
+    gst_hls_decryptor_free (stream->decryptor);
+    stream->decryptor = NULL;
+  }
 }
 
 static gint64
 gst_hls_demux_get_manifest_update_interval (GstAdaptiveDemux * demux)
 {
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
-  GstClockTime target_duration;
+  GstClockTime interval;
 
   if (hlsdemux->current_variant) {
-    target_duration =
-        gst_m3u8_get_target_duration (hlsdemux->current_variant->m3u8);
+    interval = gst_m3u8_get_reload_interval (hlsdemux->current_variant->m3u8);
   } else {
-    target_duration = 5 * GST_SECOND;
+    interval = 5 * GST_SECOND;
   }
 
-  return gst_util_uint64_scale (target_duration, G_USEC_PER_SEC, GST_SECOND);
+  return gst_util_uint64_scale (interval, G_USEC_PER_SEC, GST_SECOND);
 }
 
 static gboolean
@@ -34,10 +34,25 @@
  * Just point an external webserver to the directory with the playlist and
  * fragment files.
  *
+ * Segments are MPEG-TS by default. With #GstHlsSink2:muxer-type set to CMAF,
+ * they are fragmented MP4 instead, with the ftyp and moov boxes written once
+ * to an init segment referenced with EXT-X-MAP. Setting
+ * #GstHlsSink2:part-duration additionally cuts the segments into partial
+ * segments, each written to its own file and listed with EXT-X-PART, for
+ * low-latency HLS.
+ *
+ * The default handlers of the get-playlist-stream and get-fragment-stream
+ * signals write to a temporary file that is only renamed to its final
+ * location once complete, so that a web server never serves a file while
+ * it is being written.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! h264parse ! hlssink2 max-files=5
  * ]|
+ * |[
+ * gst-launch-1.0 videotestsrc is-live=true ! x264enc key-int-max=30 ! h264parse ! hlssink2 muxer-type=cmaf part-duration=200000000 location=segment%05d.m4s target-duration=2
+ * ]|
  *
  */
 #ifdef HAVE_CONFIG_H
@@ -49,6 +64,7 @@
 #include <gst/video/video.h>
 #include <glib/gstdio.h>
 #include <memory.h>
+#include <errno.h>
 
 
 GST_DEBUG_CATEGORY_STATIC (gst_hls_sink2_debug);
@@ -61,8 +77,22 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink2_debug);
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
 #define DEFAULT_SEND_KEYFRAME_REQUESTS TRUE
+#define DEFAULT_MUXER_TYPE GST_HLS_SINK2_MUXER_TYPE_MPEGTS
+#define DEFAULT_INIT_LOCATION "init%05d.mp4"
+#define DEFAULT_PART_LOCATION "segment%05d.%d.m4s"
+#define DEFAULT_PART_DURATION 0
 
 #define GST_M3U8_PLAYLIST_VERSION 3
+/* for EXT-X-MAP without EXT-X-I-FRAMES-ONLY */
+#define GST_M3U8_PLAYLIST_CMAF_VERSION 6
+
+/* Suffix of the temporary files written by the default handlers, and key of
+ * the location they are renamed to once complete */
+#define TMP_LOCATION_SUFFIX ".tmp"
+#define FINAL_LOCATION_KEY "hlssink2-location"
+
+#define IS_INIT_BOX(type) ((type) == GST_MAKE_FOURCC ('f', 't', 'y', 'p') || \
+    (type) == GST_MAKE_FOURCC ('m', 'o', 'o', 'v'))
 
 enum
 {
@@ -74,6 +104,10 @@ enum
   PROP_TARGET_DURATION,
   PROP_PLAYLIST_LENGTH,
   PROP_SEND_KEYFRAME_REQUESTS,
+  PROP_MUXER_TYPE,
+  PROP_INIT_LOCATION,
+  PROP_PART_LOCATION,
+  PROP_PART_DURATION,
 };
 
 enum
@@ -95,6 +129,28 @@ static GstStaticPadTemplate audio_template = GST_STATIC_PAD_TEMPLATE ("audio",
     GST_PAD_REQUEST,
     GST_STATIC_CAPS_ANY);
 
+#define GST_TYPE_HLS_SINK2_MUXER_TYPE (gst_hls_sink2_muxer_type_get_type())
+static GType
+gst_hls_sink2_muxer_type_get_type (void)
+{
+  static const GEnumValue muxer_types[] = {
+    {GST_HLS_SINK2_MUXER_TYPE_MPEGTS, "MPEG-TS segments", "mpegts"},
+    {GST_HLS_SINK2_MUXER_TYPE_CMAF, "CMAF (fragmented MP4) segments", "cmaf"},
+    {0, NULL, NULL},
+  };
+  static gsize id = 0;
+
+  if (g_once_init_enter (&id)) {
+    GType new_type;
+
+    new_type = g_enum_register_static ("GstHlsSink2MuxerType", muxer_types);
+
+    g_once_init_leave (&id, (gsize) new_type);
+  }
+
+  return (GType) id;
+}
+
 #define gst_hls_sink2_parent_class parent_class
 G_DEFINE_TYPE (GstHlsSink2, gst_hls_sink2, GST_TYPE_BIN);
 
@@ -109,6 +165,11 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans);
 static GstPad *gst_hls_sink2_request_new_pad (GstElement * element,
     GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
 static void gst_hls_sink2_release_pad (GstElement * element, GstPad * pad);
+static void gst_hls_sink2_close_stream (GstHlsSink2 * sink,
+    GOutputStream * stream, gboolean commit);
+static void gst_hls_sink2_cmaf_reset (GstHlsSink2 * sink);
+static GstPadProbeReturn gst_hls_sink2_cmaf_probe (GstPad * pad,
+    GstPadProbeInfo * info, GstHlsSink2 * sink);
 
 static void
 gst_hls_sink2_dispose (GObject * object)
@@ -126,21 +187,38 @@ gst_hls_sink2_finalize (GObject * object)
   g_free (sink->location);
   g_free (sink->playlist_location);
   g_free (sink->playlist_root);
+  g_free (sink->init_location);
+  g_free (sink->part_location);
   g_free (sink->current_location);
+  if (sink->current_stream)
+    gst_hls_sink2_close_stream (sink, sink->current_stream, FALSE);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
+  g_queue_foreach (&sink->old_part_locations, (GFunc) g_strfreev, NULL);
+  g_queue_clear (&sink->old_part_locations);
+  g_queue_foreach (&sink->old_init_locations, (GFunc) g_free, NULL);
+  g_queue_clear (&sink->old_init_locations);
+
+  gst_hls_sink2_cmaf_reset (sink);
+  g_clear_pointer (&sink->init_masked, g_bytes_unref);
+  g_free (sink->init_current_location);
+  g_ptr_array_unref (sink->part_locations);
+  g_object_unref (sink->cmaf_adapter);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
 
-/* Default implementations for the signal handlers */
+/* Writes to a temporary file next to @location, which
+ * gst_hls_sink2_close_stream() renames to @location once complete */
 static GOutputStream *
-gst_hls_sink2_get_playlist_stream (GstHlsSink2 * sink, const gchar * location)
+gst_hls_sink2_create_stream (GstHlsSink2 * sink, const gchar * location,
+    const gchar * type)
 {
-  GFile *file = g_file_new_for_path (location);
+  gchar *tmp_location = g_strconcat (location, TMP_LOCATION_SUFFIX, NULL);
+  GFile *file = g_file_new_for_path (tmp_location);
   GOutputStream *ostream;
   GError *err = NULL;
 
@@ -149,36 +227,66 @@ gst_hls_sink2_get_playlist_stream (GstHlsSink2 * sink, const gchar * location)
           G_FILE_CREATE_REPLACE_DESTINATION, NULL, &err));
   if (!ostream) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
-        (("Got no output stream for playlist '%s': %s."), location,
+        (("Got no output stream for %s '%s': %s."), type, location,
             err->message), (NULL));
     g_clear_error (&err);
+  } else {
+    g_object_set_data_full (G_OBJECT (ostream), FINAL_LOCATION_KEY,
+        g_strdup (location), g_free);
   }
 
   g_object_unref (file);
+  g_free (tmp_location);
 
   return ostream;
 }
 
-static GOutputStream *
-gst_hls_sink2_get_fragment_stream (GstHlsSink2 * sink, const gchar * location)
+/* Closes and releases a stream returned by the get-playlist-stream or
+ * get-fragment-stream signals, moving the temporary file of the default
+ * handlers to its location if @commit is %TRUE */
+static void
+gst_hls_sink2_close_stream (GstHlsSink2 * sink, GOutputStream * stream,
+    gboolean commit)
 {
-  GFile *file = g_file_new_for_path (location);
-  GOutputStream *ostream;
+  const gchar *location =
+      g_object_get_data (G_OBJECT (stream), FINAL_LOCATION_KEY);
   GError *err = NULL;
 
-  ostream =
-      G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
-          G_FILE_CREATE_REPLACE_DESTINATION, NULL, &err));
-  if (!ostream) {
-    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
-        (("Got no output stream for fragment '%s': %s."), location,
+  if (!g_output_stream_close (stream, NULL, &err)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to close '%s': %s."), location ? location : "stream",
             err->message), (NULL));
     g_clear_error (&err);
+    commit = FALSE;
   }
 
-  g_object_unref (file);
+  if (location) {
+    gchar *tmp_location = g_strconcat (location, TMP_LOCATION_SUFFIX, NULL);
 
-  return ostream;
+    if (!commit) {
+      g_unlink (tmp_location);
+    } else if (g_rename (tmp_location, location) != 0) {
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+          (("Failed to rename '%s' to '%s': %s."), tmp_location, location,
+              g_strerror (errno)), (NULL));
+    }
+    g_free (tmp_location);
+  }
+
+  g_object_unref (stream);
+}
+
+/* Default implementations for the signal handlers */
+static GOutputStream *
+gst_hls_sink2_get_playlist_stream (GstHlsSink2 * sink, const gchar * location)
+{
+  return gst_hls_sink2_create_stream (sink, location, "playlist");
+}
+
+static GOutputStream *
+gst_hls_sink2_get_fragment_stream (GstHlsSink2 * sink, const gchar * location)
+{
+  return gst_hls_sink2_create_stream (sink, location, "fragment");
 }
 
 static void
@@ -251,6 +359,63 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
           DEFAULT_SEND_KEYFRAME_REQUESTS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstHlsSink2:muxer-type:
+   *
+   * The format of the segments. CMAF segments are fragmented MP4 that
+   * share an init segment written to #GstHlsSink2:init-location.
+   * #GstHlsSink2:location should be changed to use a matching extension.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MUXER_TYPE,
+      g_param_spec_enum ("muxer-type", "Muxer Type",
+          "The format of the segments", GST_TYPE_HLS_SINK2_MUXER_TYPE,
+          DEFAULT_MUXER_TYPE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstHlsSink2:init-location:
+   *
+   * Location of the init segments of CMAF segments. A new init segment is
+   * only written when the streams change.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_INIT_LOCATION,
+      g_param_spec_string ("init-location", "Init Segment Location",
+          "Location of the init segments to write in CMAF mode",
+          DEFAULT_INIT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink2:part-location:
+   *
+   * Location of the partial segments, formatted with the index of the
+   * segment and the index of the part in it.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PART_LOCATION,
+      g_param_spec_string ("part-location", "Part Location",
+          "Location of the partial segments to write in CMAF mode",
+          DEFAULT_PART_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink2:part-duration:
+   *
+   * Duration of the partial segments of low-latency HLS, in nanoseconds. The
+   * muxer cuts a fragment at each part duration and each fragment is also
+   * written as a partial segment. Only used with CMAF segments.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint64 ("part-duration", "Part duration",
+          "The target duration in nanoseconds of a partial segment "
+          "(0 - disabled)", 0, G_MAXUINT64, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   /**
    * GstHlsSink2::get-playlist-stream:
    * @sink: the #GstHlsSink2
@@ -298,6 +463,44 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
 
   klass->get_playlist_stream = gst_hls_sink2_get_playlist_stream;
   klass->get_fragment_stream = gst_hls_sink2_get_fragment_stream;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_HLS_SINK2_MUXER_TYPE, 0);
+}
+
+static gchar *
+gst_hls_sink2_get_entry_location (GstHlsSink2 * sink, const gchar * location)
+{
+  gchar *name = g_path_get_basename (location);
+  gchar *entry_location;
+
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+
+  return entry_location;
+}
+
+static void
+gst_hls_sink2_delete_fragment (GstHlsSink2 * sink, const gchar * location)
+{
+  if (g_signal_has_handler_pending (sink,
+          signals[SIGNAL_DELETE_FRAGMENT], 0, FALSE)) {
+    g_signal_emit (sink, signals[SIGNAL_DELETE_FRAGMENT], 0, location);
+  } else {
+    GFile *file = g_file_new_for_path (location);
+    GError *err = NULL;
+
+    if (!g_file_delete (file, NULL, &err)) {
+      GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+          (("Failed to delete fragment file '%s': %s."),
+              location, err->message), (NULL));
+      g_clear_error (&err);
+    }
+
+    g_object_unref (file);
+  }
 }
 
 static gchar *
@@ -322,8 +525,12 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
   }
   g_object_set (sink->giostreamsink, "stream", stream, NULL);
 
-  if (stream)
-    g_object_unref (stream);
+  /* kept to be closed once the fragment is complete */
+  if (sink->current_stream)
+    gst_hls_sink2_close_stream (sink, sink->current_stream, FALSE);
+  sink->current_stream = stream;
+  sink->current_fragment_id = fragment_id;
+  gst_hls_sink2_cmaf_reset (sink);
 
   g_free (location);
 
@@ -333,7 +540,7 @@ on_format_location (GstElement * splitmuxsink, guint fragment_id,
 static void
 gst_hls_sink2_init (GstHlsSink2 * sink)
 {
-  GstElement *mux;
+  GstPad *pad;
 
   sink->location = g_strdup (DEFAULT_LOCATION);
   sink->playlist_location = g_strdup (DEFAULT_PLAYLIST_LOCATION);
@@ -342,18 +549,31 @@ gst_hls_sink2_init (GstHlsSink2 * sink)
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
   sink->send_keyframe_requests = DEFAULT_SEND_KEYFRAME_REQUESTS;
+  sink->muxer_type = DEFAULT_MUXER_TYPE;
+  sink->init_location = g_strdup (DEFAULT_INIT_LOCATION);
+  sink->part_location = g_strdup (DEFAULT_PART_LOCATION);
+  sink->part_duration = DEFAULT_PART_DURATION;
   g_queue_init (&sink->old_locations);
+  g_queue_init (&sink->old_part_locations);
+  g_queue_init (&sink->old_init_locations);
+  sink->cmaf_adapter = gst_adapter_new ();
+  sink->part_locations = g_ptr_array_new_with_free_func (g_free);
 
   sink->splitmuxsink = gst_element_factory_make ("splitmuxsink", NULL);
   gst_bin_add (GST_BIN (sink), sink->splitmuxsink);
 
   sink->giostreamsink = gst_element_factory_make ("giostreamsink", NULL);
 
-  mux = gst_element_factory_make ("mpegtsmux", NULL);
+  /* the muxer is created when starting, depending on the muxer type */
   g_object_set (sink->splitmuxsink, "location", NULL, "max-size-time",
       ((GstClockTime) sink->target_duration * GST_SECOND),
-      "send-keyframe-requests", TRUE, "muxer", mux, "sink", sink->giostreamsink,
-      "reset-muxer", FALSE, NULL);
+      "send-keyframe-requests", TRUE, "sink", sink->giostreamsink, NULL);
+
+  pad = gst_element_get_static_pad (sink->giostreamsink, "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) gst_hls_sink2_cmaf_probe, sink, NULL);
+  gst_object_unref (pad);
 
   g_signal_connect (sink->splitmuxsink, "format-location",
       G_CALLBACK (on_format_location), sink);
@@ -363,19 +583,72 @@ gst_hls_sink2_init (GstHlsSink2 * sink)
   gst_hls_sink2_reset (sink);
 }
 
+static gboolean
+gst_hls_sink2_setup_muxer (GstHlsSink2 * sink)
+{
+  gboolean cmaf = sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF;
+  GstElement *mux;
+
+  mux = gst_element_factory_make (cmaf ? "mp4mux" : "mpegtsmux", NULL);
+  if (!mux) {
+    GST_ELEMENT_ERROR (sink, CORE, MISSING_PLUGIN,
+        ("Missing element '%s'", cmaf ? "mp4mux" : "mpegtsmux"), (NULL));
+    return FALSE;
+  }
+
+  if (cmaf) {
+    guint fragment_duration;
+
+    /* Each fragment is a part, or the whole segment without parts */
+    if (sink->part_duration > 0)
+      fragment_duration = MAX (sink->part_duration / GST_MSECOND, 1);
+    else if (sink->target_duration > 0)
+      fragment_duration = sink->target_duration * 1000;
+    else
+      fragment_duration = 1000;
+
+    g_object_set (mux, "fragment-duration", fragment_duration,
+        "streamable", TRUE, NULL);
+  }
+
+  /* The MP4 muxer starts each segment with a moov, which is moved to the
+   * init segment */
+  g_object_set (sink->splitmuxsink, "muxer", mux, "reset-muxer", cmaf, NULL);
+
+  return TRUE;
+}
+
 static void
 gst_hls_sink2_reset (GstHlsSink2 * sink)
 {
+  gboolean cmaf = sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF;
+
   sink->index = 0;
 
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
-      gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length,
-      FALSE);
+      gst_m3u8_playlist_new (cmaf ? GST_M3U8_PLAYLIST_CMAF_VERSION :
+      GST_M3U8_PLAYLIST_VERSION, sink->playlist_length, FALSE);
+  sink->playlist->part_target = cmaf ? sink->part_duration : 0;
+
+  if (sink->current_stream) {
+    gst_hls_sink2_close_stream (sink, sink->current_stream, FALSE);
+    sink->current_stream = NULL;
+  }
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
+  g_queue_foreach (&sink->old_part_locations, (GFunc) g_strfreev, NULL);
+  g_queue_clear (&sink->old_part_locations);
+  g_queue_foreach (&sink->old_init_locations, (GFunc) g_free, NULL);
+  g_queue_clear (&sink->old_init_locations);
+
+  gst_hls_sink2_cmaf_reset (sink);
+  g_ptr_array_set_size (sink->part_locations, 0);
+  g_clear_pointer (&sink->init_masked, g_bytes_unref);
+  g_clear_pointer (&sink->init_current_location, g_free);
+  sink->init_index = 0;
 
   sink->state = GST_M3U8_PLAYLIST_RENDER_INIT;
 }
@@ -406,10 +679,354 @@ gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
         (("Failed to write playlist '%s'."), error->message), (NULL));
     g_error_free (error);
     error = NULL;
+    gst_hls_sink2_close_stream (sink, stream, FALSE);
+  } else {
+    gst_hls_sink2_close_stream (sink, stream, TRUE);
   }
 
   g_free (playlist_content);
-  g_object_unref (stream);
+}
+
+/* Drops the state of the fragment being split, called before each new
+ * fragment */
+static void
+gst_hls_sink2_cmaf_reset (GstHlsSink2 * sink)
+{
+  gst_adapter_clear (sink->cmaf_adapter);
+  sink->box_type = 0;
+  sink->box_remaining = 0;
+  gst_buffer_replace (&sink->init_buffer, NULL);
+  if (sink->part_stream) {
+    gst_hls_sink2_close_stream (sink, sink->part_stream, FALSE);
+    sink->part_stream = NULL;
+  }
+  sink->part_index = 0;
+}
+
+/* Clears the creation and modification times and the durations of the
+ * boxes in @data, which the muxer updates for each segment */
+static void
+gst_hls_sink2_cmaf_mask_times (guint8 * data, gsize size)
+{
+  while (size >= 8) {
+    guint64 box_size = GST_READ_UINT32_BE (data);
+    guint32 type = GST_READ_UINT32_LE (data + 4);
+    gsize header = 8;
+
+    if (box_size == 1) {
+      if (size < 16)
+        return;
+      box_size = GST_READ_UINT64_BE (data + 8);
+      header = 16;
+    } else if (box_size == 0) {
+      box_size = size;
+    }
+    if (box_size < header || box_size > size)
+      return;
+
+    switch (type) {
+      case GST_MAKE_FOURCC ('m', 'o', 'o', 'v'):
+      case GST_MAKE_FOURCC ('t', 'r', 'a', 'k'):
+      case GST_MAKE_FOURCC ('m', 'd', 'i', 'a'):
+      case GST_MAKE_FOURCC ('m', 'v', 'e', 'x'):
+        gst_hls_sink2_cmaf_mask_times (data + header, box_size - header);
+        break;
+      case GST_MAKE_FOURCC ('m', 'v', 'h', 'd'):
+      case GST_MAKE_FOURCC ('t', 'k', 'h', 'd'):
+      case GST_MAKE_FOURCC ('m', 'd', 'h', 'd'):
+      case GST_MAKE_FOURCC ('m', 'e', 'h', 'd'):{
+        guint8 *box = data + header;
+        gsize len = box_size - header;
+        gboolean v1 = len > 0 && box[0] == 1;
+        gsize times_size = 0, duration_offset, duration_size = v1 ? 8 : 4;
+
+        /* after the version and flags */
+        if (type == GST_MAKE_FOURCC ('m', 'e', 'h', 'd')) {
+          duration_offset = 4;
+        } else {
+          times_size = v1 ? 16 : 8;
+          /* timescale, or track ID and a reserved field for tkhd */
+          duration_offset = 4 + times_size +
+              (type == GST_MAKE_FOURCC ('t', 'k', 'h', 'd') ? 8 : 4);
+        }
+
+        if (len >= duration_offset + duration_size) {
+          memset (box + 4, 0, times_size);
+          memset (box + duration_offset, 0, duration_size);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+
+    data += box_size;
+    size -= box_size;
+  }
+}
+
+/* Writes the ftyp and moov boxes the muxer started the segment with. They
+ * only differ by their times from one segment to the next unless the
+ * streams changed, so a new init segment is only written when the rest of
+ * their content changes */
+static void
+gst_hls_sink2_cmaf_write_init (GstHlsSink2 * sink)
+{
+  GstBuffer *init = g_steal_pointer (&sink->init_buffer);
+  GOutputStream *stream = NULL;
+  gchar *location, *entry_location;
+  GError *err = NULL;
+  GstMapInfo map;
+  GBytes *masked;
+  gpointer masked_data;
+  gsize masked_size;
+  gboolean ret;
+
+  gst_buffer_extract_dup (init, 0, -1, &masked_data, &masked_size);
+  gst_hls_sink2_cmaf_mask_times (masked_data, masked_size);
+  masked = g_bytes_new_take (masked_data, masked_size);
+
+  if (sink->init_masked && g_bytes_equal (masked, sink->init_masked)) {
+    g_bytes_unref (masked);
+    gst_buffer_unref (init);
+    return;
+  }
+
+  location = g_strdup_printf (sink->init_location, sink->init_index);
+  g_signal_emit (sink, signals[SIGNAL_GET_FRAGMENT_STREAM], 0, location,
+      &stream);
+  if (!stream) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Got no output stream for init segment '%s'."), location), (NULL));
+    goto out;
+  }
+
+  gst_buffer_map (init, &map, GST_MAP_READ);
+  ret = g_output_stream_write_all (stream, map.data, map.size, NULL, NULL,
+      &err);
+  gst_buffer_unmap (init, &map);
+  if (!ret) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to write init segment '%s': %s."), location, err->message),
+        (NULL));
+    g_clear_error (&err);
+  }
+  gst_hls_sink2_close_stream (sink, stream, ret);
+  if (!ret)
+    goto out;
+
+  GST_INFO_OBJECT (sink, "Wrote init segment %s", location);
+  g_clear_pointer (&sink->init_masked, g_bytes_unref);
+  sink->init_masked = g_bytes_ref (masked);
+  g_free (sink->init_current_location);
+  sink->init_current_location = g_strdup (location);
+  sink->init_index++;
+
+  entry_location = gst_hls_sink2_get_entry_location (sink, location);
+  gst_m3u8_playlist_set_map (sink->playlist, entry_location);
+  g_free (entry_location);
+
+out:
+  g_free (location);
+  g_bytes_unref (masked);
+  gst_buffer_unref (init);
+}
+
+static void
+gst_hls_sink2_cmaf_finish_part (GstHlsSink2 * sink, gboolean write_playlist)
+{
+  GstClockTime duration = sink->part_duration;
+  gchar *entry_location;
+
+  if (sink->part_stream == NULL)
+    return;
+
+  gst_hls_sink2_close_stream (sink, sink->part_stream, TRUE);
+  sink->part_stream = NULL;
+
+  if (GST_CLOCK_TIME_IS_VALID (sink->part_start) &&
+      GST_CLOCK_TIME_IS_VALID (sink->part_end) &&
+      sink->part_end > sink->part_start)
+    duration = sink->part_end - sink->part_start;
+
+  entry_location = gst_hls_sink2_get_entry_location (sink,
+      g_ptr_array_index (sink->part_locations,
+          sink->part_locations->len - 1));
+  gst_m3u8_playlist_add_part (sink->playlist, entry_location, duration,
+      sink->part_independent);
+  g_free (entry_location);
+  sink->part_index++;
+
+  if (write_playlist) {
+    gst_hls_sink2_write_playlist (sink);
+    sink->state |= GST_M3U8_PLAYLIST_RENDER_STARTED;
+  }
+}
+
+/* Each moof starts a new part */
+static void
+gst_hls_sink2_cmaf_start_part (GstHlsSink2 * sink)
+{
+  gchar *location;
+
+  gst_hls_sink2_cmaf_finish_part (sink, TRUE);
+
+  if (sink->part_duration == 0)
+    return;
+
+  location = g_strdup_printf (sink->part_location, sink->current_fragment_id,
+      sink->part_index);
+  g_signal_emit (sink, signals[SIGNAL_GET_FRAGMENT_STREAM], 0, location,
+      &sink->part_stream);
+  if (!sink->part_stream) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Got no output stream for part '%s'."), location), (NULL));
+    g_free (location);
+    return;
+  }
+
+  g_ptr_array_add (sink->part_locations, location);
+  sink->part_start = sink->part_end = GST_CLOCK_TIME_NONE;
+  /* splitmuxsink starts the segments with a keyframe */
+  sink->part_independent = sink->part_index == 0;
+}
+
+static void
+gst_hls_sink2_cmaf_write_part (GstHlsSink2 * sink, GstBuffer * buffer)
+{
+  GError *err = NULL;
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return;
+
+  if (!g_output_stream_write_all (sink->part_stream, map.data, map.size,
+          NULL, NULL, &err)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to write part: %s."), err->message), (NULL));
+    g_clear_error (&err);
+  }
+
+  gst_buffer_unmap (buffer, &map);
+}
+
+/* Splits the fragmented MP4 written by the muxer along its top-level boxes:
+ * ftyp and moov go to the init segment and the rest to the segment, and to
+ * the current part. Returns the data to write to the segment, or %NULL */
+static GstBuffer *
+gst_hls_sink2_cmaf_process (GstHlsSink2 * sink, GstBuffer * buffer)
+{
+  GstBuffer *media = NULL;
+
+  gst_adapter_push (sink->cmaf_adapter, gst_buffer_ref (buffer));
+
+  while (TRUE) {
+    gsize available = gst_adapter_available (sink->cmaf_adapter);
+    GstBuffer *box;
+    gsize size;
+
+    if (sink->box_remaining == 0) {
+      guint8 header[16];
+      guint64 box_size;
+
+      if (available < 8)
+        break;
+
+      gst_adapter_copy (sink->cmaf_adapter, header, 0, 8);
+      box_size = GST_READ_UINT32_BE (header);
+      if (box_size == 1) {
+        if (available < 16)
+          break;
+        gst_adapter_copy (sink->cmaf_adapter, header, 0, 16);
+        box_size = GST_READ_UINT64_BE (header + 8);
+      }
+      /* 0 means up to the end of the file */
+      if (box_size < 8)
+        box_size = G_MAXUINT64;
+
+      sink->box_type = GST_READ_UINT32_LE (header + 4);
+      sink->box_remaining = box_size;
+      GST_LOG_OBJECT (sink, "%" GST_FOURCC_FORMAT " box of %" G_GUINT64_FORMAT
+          " bytes", GST_FOURCC_ARGS (sink->box_type), box_size);
+
+      if (sink->init_buffer && !IS_INIT_BOX (sink->box_type))
+        gst_hls_sink2_cmaf_write_init (sink);
+      if (sink->box_type == GST_MAKE_FOURCC ('m', 'o', 'o', 'f'))
+        gst_hls_sink2_cmaf_start_part (sink);
+    }
+
+    size = MIN (available, sink->box_remaining);
+    if (size == 0)
+      break;
+
+    box = gst_adapter_take_buffer (sink->cmaf_adapter, size);
+    sink->box_remaining -= size;
+
+    if (IS_INIT_BOX (sink->box_type)) {
+      sink->init_buffer = sink->init_buffer ?
+          gst_buffer_append (sink->init_buffer, box) : box;
+    } else if (sink->box_type == GST_MAKE_FOURCC ('m', 'f', 'r', 'a')) {
+      /* index of the whole file, which isn't used in segments */
+      gst_buffer_unref (box);
+    } else {
+      if (sink->part_stream)
+        gst_hls_sink2_cmaf_write_part (sink, box);
+      media = media ? gst_buffer_append (media, box) : box;
+    }
+  }
+
+  /* the samples of a fragment come after its moof */
+  if (sink->part_stream && GST_BUFFER_DTS_OR_PTS (buffer) != GST_CLOCK_TIME_NONE) {
+    GstClockTime start = GST_BUFFER_DTS_OR_PTS (buffer);
+    GstClockTime end = start;
+
+    if (GST_BUFFER_DURATION_IS_VALID (buffer))
+      end += GST_BUFFER_DURATION (buffer);
+    if (!GST_CLOCK_TIME_IS_VALID (sink->part_start) || start < sink->part_start)
+      sink->part_start = start;
+    if (!GST_CLOCK_TIME_IS_VALID (sink->part_end) || end > sink->part_end)
+      sink->part_end = end;
+  }
+
+  return media;
+}
+
+static GstPadProbeReturn
+gst_hls_sink2_cmaf_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstHlsSink2 * sink)
+{
+  if (sink->muxer_type != GST_HLS_SINK2_MUXER_TYPE_CMAF)
+    return GST_PAD_PROBE_OK;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstBuffer *media = gst_hls_sink2_cmaf_process (sink, buffer);
+
+    if (media == NULL)
+      return GST_PAD_PROBE_DROP;
+
+    gst_buffer_unref (buffer);
+    GST_PAD_PROBE_INFO_DATA (info) = media;
+  } else {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    GstBufferList *media_list = gst_buffer_list_new ();
+    guint i;
+
+    for (i = 0; i < gst_buffer_list_length (list); i++) {
+      GstBuffer *media =
+          gst_hls_sink2_cmaf_process (sink, gst_buffer_list_get (list, i));
+
+      if (media)
+        gst_buffer_list_add (media_list, media);
+    }
+
+    gst_buffer_list_unref (list);
+    GST_PAD_PROBE_INFO_DATA (info) = media_list;
+    if (gst_buffer_list_length (media_list) == 0)
+      return GST_PAD_PROBE_DROP;
+  }
+
+  return GST_PAD_PROBE_OK;
 }
 
 static void
@@ -441,15 +1058,18 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
 
           gst_structure_get_clock_time (s, "running-time", &running_time);
 
-          GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-          if (sink->playlist_root == NULL) {
-            entry_location = g_path_get_basename (sink->current_location);
-          } else {
-            gchar *name = g_path_get_basename (sink->current_location);
-            entry_location = g_build_filename (sink->playlist_root, name, NULL);
-            g_free (name);
+          /* the last part of the segment, listed with it */
+          gst_hls_sink2_cmaf_finish_part (sink, FALSE);
+
+          if (sink->current_stream) {
+            gst_hls_sink2_close_stream (sink, sink->current_stream, TRUE);
+            sink->current_stream = NULL;
           }
 
+          GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
+          entry_location =
+              gst_hls_sink2_get_entry_location (sink, sink->current_location);
+
           gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
               NULL, sink->current_segment_start,
               running_time - sink->current_running_time_start,
@@ -461,30 +1081,36 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
 
           g_queue_push_tail (&sink->old_locations,
               g_strdup (sink->current_location));
+          /* the parts are deleted along with their segment */
+          g_ptr_array_add (sink->part_locations, NULL);
+          g_queue_push_tail (&sink->old_part_locations,
+              g_ptr_array_free (sink->part_locations, FALSE));
+          sink->part_locations = g_ptr_array_new_with_free_func (g_free);
+          g_queue_push_tail (&sink->old_init_locations,
+              g_strdup (sink->init_current_location));
 
           if (sink->max_files > 0) {
             while (g_queue_get_length (&sink->old_locations) > sink->max_files) {
               gchar *old_location = g_queue_pop_head (&sink->old_locations);
+              gchar **old_parts = g_queue_pop_head (&sink->old_part_locations);
+              gchar *old_init = g_queue_pop_head (&sink->old_init_locations);
+              const gchar *next_init;
+              gchar **part;
+
+              gst_hls_sink2_delete_fragment (sink, old_location);
+              for (part = old_parts; *part; part++)
+                gst_hls_sink2_delete_fragment (sink, *part);
+
+              /* the init segment goes once no segment refers to it */
+              next_init = g_queue_peek_head (&sink->old_init_locations);
+              if (!next_init)
+                next_init = sink->init_current_location;
+              if (old_init && g_strcmp0 (old_init, next_init) != 0)
+                gst_hls_sink2_delete_fragment (sink, old_init);
 
-
-              if (g_signal_has_handler_pending (sink,
-                      signals[SIGNAL_DELETE_FRAGMENT], 0, FALSE)) {
-                g_signal_emit (sink, signals[SIGNAL_DELETE_FRAGMENT], 0,
-                    old_location);
-              } else {
-                GFile *file = g_file_new_for_path (old_location);
-                GError *err = NULL;
-
-                if (!g_file_delete (file, NULL, &err)) {
-                  GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
-                      (("Failed to delete fragment file '%s': %s."),
-                          old_location, err->message), (NULL));
-                  g_clear_error (&err);
-                }
-
-                g_object_unref (file);
-              }
               g_free (old_location);
+              g_strfreev (old_parts);
+              g_free (old_init);
             }
           }
 
@@ -582,6 +1208,10 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans)
       if (!sink->splitmuxsink) {
         return GST_STATE_CHANGE_FAILURE;
       }
+      if (!gst_hls_sink2_setup_muxer (sink))
+        return GST_STATE_CHANGE_FAILURE;
+      /* for the playlist version and part target of the muxer type */
+      gst_hls_sink2_reset (sink);
       break;
     default:
       break;
@@ -652,6 +1282,20 @@ gst_hls_sink2_set_property (GObject * object, guint prop_id,
             sink->send_keyframe_requests, NULL);
       }
       break;
+    case PROP_MUXER_TYPE:
+      sink->muxer_type = g_value_get_enum (value);
+      break;
+    case PROP_INIT_LOCATION:
+      g_free (sink->init_location);
+      sink->init_location = g_value_dup_string (value);
+      break;
+    case PROP_PART_LOCATION:
+      g_free (sink->part_location);
+      sink->part_location = g_value_dup_string (value);
+      break;
+    case PROP_PART_DURATION:
+      sink->part_duration = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -686,6 +1330,18 @@ gst_hls_sink2_get_property (GObject * object, guint prop_id,
     case PROP_SEND_KEYFRAME_REQUESTS:
       g_value_set_boolean (value, sink->send_keyframe_requests);
       break;
+    case PROP_MUXER_TYPE:
+      g_value_set_enum (value, sink->muxer_type);
+      break;
+    case PROP_INIT_LOCATION:
+      g_value_set_string (value, sink->init_location);
+      break;
+    case PROP_PART_LOCATION:
+      g_value_set_string (value, sink->part_location);
+      break;
+    case PROP_PART_DURATION:
+      g_value_set_uint64 (value, sink->part_duration);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
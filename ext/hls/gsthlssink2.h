@@ -21,6 +21,7 @@
 
 #include "gstm3u8playlist.h"
 #include <gst/gst.h>
+#include <gst/base/base.h>
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
@@ -35,6 +36,12 @@ G_BEGIN_DECLS
 typedef struct _GstHlsSink2 GstHlsSink2;
 typedef struct _GstHlsSink2Class GstHlsSink2Class;
 
+typedef enum
+{
+  GST_HLS_SINK2_MUXER_TYPE_MPEGTS,
+  GST_HLS_SINK2_MUXER_TYPE_CMAF,
+} GstHlsSink2MuxerType;
+
 struct _GstHlsSink2
 {
   GstBin bin;
@@ -50,15 +57,38 @@ struct _GstHlsSink2
   gint max_files;
   gint target_duration;
   gboolean send_keyframe_requests;
+  GstHlsSink2MuxerType muxer_type;
+  gchar *init_location;
+  gchar *part_location;
+  GstClockTime part_duration;
 
   GstM3U8Playlist *playlist;
   guint index;
 
   gchar *current_location;
+  guint current_fragment_id;
+  GOutputStream *current_stream;
   GstClockTime current_running_time_start;
   GstDateTime  *current_segment_start;
   GQueue old_locations;
+  GQueue old_part_locations;
   GstM3U8PlaylistRenderState state;
+
+  /* CMAF: splitting of the muxer output into init segment and parts */
+  GstAdapter *cmaf_adapter;
+  guint32 box_type;
+  guint64 box_remaining;
+  GstBuffer *init_buffer;
+  GBytes *init_masked;
+  gchar *init_current_location;
+  guint init_index;
+  /* the init segment of each of the old_locations */
+  GQueue old_init_locations;
+  GOutputStream *part_stream;
+  GPtrArray *part_locations;
+  guint part_index;
+  GstClockTime part_start, part_end;
+  gboolean part_independent;
 };
 
 struct _GstHlsSink2Class
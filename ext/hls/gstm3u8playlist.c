@@ -32,7 +32,12 @@ enum
   GST_M3U8_PLAYLIST_TYPE_VOD,
 };
 
+/* Partial segments are listed for the segments starting less than this many
+ * target durations from the end of the playlist */
+#define PART_WINDOW_TARGET_DURATIONS 3
+
 typedef struct _GstM3U8Entry GstM3U8Entry;
+typedef struct _GstM3U8Part GstM3U8Part;
 
 struct _GstM3U8Entry
 {
@@ -41,8 +46,37 @@ struct _GstM3U8Entry
   gchar *url;
   gboolean discontinuous;
   gchar *time;
+  gchar *map_url;
+  GQueue *parts;
+};
+
+struct _GstM3U8Part
+{
+  GstClockTime duration;
+  gchar *url;
+  gboolean independent;
 };
 
+static GstM3U8Part *
+gst_m3u8_part_new (const gchar * url, GstClockTime duration,
+    gboolean independent)
+{
+  GstM3U8Part *part;
+
+  part = g_new0 (GstM3U8Part, 1);
+  part->url = g_strdup (url);
+  part->duration = duration;
+  part->independent = independent;
+  return part;
+}
+
+static void
+gst_m3u8_part_free (GstM3U8Part * part)
+{
+  g_free (part->url);
+  g_free (part);
+}
+
 static GstM3U8Entry *
 gst_m3u8_entry_new (const gchar * url, const gchar * title,
     const gchar * time, gfloat duration, gboolean discontinuous)
@@ -57,6 +91,7 @@ gst_m3u8_entry_new (const gchar * url, const gchar * title,
   entry->time = g_strdup (time);
   entry->duration = duration;
   entry->discontinuous = discontinuous;
+  entry->parts = g_queue_new ();
   return entry;
 }
 
@@ -68,6 +103,8 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
   g_free (entry->url);
   g_free (entry->title);
   g_free (entry->time);
+  g_free (entry->map_url);
+  g_queue_free_full (entry->parts, (GDestroyNotify) gst_m3u8_part_free);
   g_free (entry);
 }
 
@@ -83,6 +120,7 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->parts = g_queue_new ();
 
   return playlist;
 }
@@ -94,6 +132,8 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_queue_free_full (playlist->parts, (GDestroyNotify) gst_m3u8_part_free);
+  g_free (playlist->map_url);
   g_free (playlist);
 }
 
@@ -113,6 +153,12 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     return FALSE;
 
   entry = gst_m3u8_entry_new (url, title, start_time, duration, discontinuous);
+  entry->map_url = g_strdup (playlist->map_url);
+
+  /* The parts added so far make up this segment */
+  g_queue_free (entry->parts);
+  entry->parts = playlist->parts;
+  playlist->parts = g_queue_new ();
 
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
@@ -130,6 +176,35 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   return TRUE;
 }
 
+/* Adds a partial segment of the segment being written, which is listed at
+ * the end of the playlist until the segment is added with
+ * gst_m3u8_playlist_add_entry() */
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist, const gchar * url,
+    GstClockTime duration, gboolean independent)
+{
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
+
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  g_queue_push_tail (playlist->parts,
+      gst_m3u8_part_new (url, duration, independent));
+
+  return TRUE;
+}
+
+/* Sets the Media Initialization Section of the segments added from now on */
+void
+gst_m3u8_playlist_set_map (GstM3U8Playlist * playlist, const gchar * url)
+{
+  g_return_if_fail (playlist != NULL);
+
+  g_free (playlist->map_url);
+  playlist->map_url = g_strdup (url);
+}
+
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
@@ -146,10 +221,61 @@ gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
   return (guint) ((target_duration + 500 * GST_MSECOND) / GST_SECOND);
 }
 
+/* Parts can't be longer than PART-TARGET, which is raised if the muxer
+ * produced longer ones than requested */
+static GstClockTime
+gst_m3u8_playlist_part_target (GstM3U8Playlist * playlist)
+{
+  GstClockTime part_target = playlist->part_target;
+  GList *l, *p;
+
+  for (l = playlist->entries->head; l != NULL; l = l->next) {
+    GstM3U8Entry *entry = l->data;
+
+    for (p = entry->parts->head; p != NULL; p = p->next)
+      part_target = MAX (part_target, ((GstM3U8Part *) p->data)->duration);
+  }
+  for (p = playlist->parts->head; p != NULL; p = p->next)
+    part_target = MAX (part_target, ((GstM3U8Part *) p->data)->duration);
+
+  return part_target;
+}
+
+static void
+gst_m3u8_playlist_render_map (GString * playlist_str, const gchar ** map_url,
+    const gchar * url)
+{
+  if (url == NULL || g_strcmp0 (*map_url, url) == 0)
+    return;
+
+  g_string_append_printf (playlist_str, "#EXT-X-MAP:URI=\"%s\"\n", url);
+  *map_url = url;
+}
+
+static void
+gst_m3u8_playlist_render_parts (GString * playlist_str, GQueue * parts)
+{
+  GList *l;
+
+  for (l = parts->head; l != NULL; l = l->next) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    GstM3U8Part *part = l->data;
+
+    g_string_append_printf (playlist_str,
+        "#EXT-X-PART:DURATION=%s,URI=\"%s\"%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            (gdouble) part->duration / GST_SECOND), part->url,
+        part->independent ? ",INDEPENDENT=YES" : "");
+  }
+}
+
 gchar *
 gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
   GString *playlist_str;
+  const gchar *map_url = NULL;
+  GstClockTime part_window = 0, remaining = 0;
+  guint target_duration;
   GList *l;
 
   g_return_val_if_fail (playlist != NULL, NULL);
@@ -165,8 +291,26 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
   g_string_append_printf (playlist_str, "#EXT-X-MEDIA-SEQUENCE:%d\n",
       playlist->sequence_number - playlist->entries->length);
 
+  target_duration = gst_m3u8_playlist_target_duration (playlist);
   g_string_append_printf (playlist_str, "#EXT-X-TARGETDURATION:%u\n",
-      gst_m3u8_playlist_target_duration (playlist));
+      target_duration);
+
+  if (playlist->part_target > 0) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    GstClockTime part_target = gst_m3u8_playlist_part_target (playlist);
+
+    /* the spec recommends holding back at least 3 part target durations */
+    g_string_append_printf (playlist_str,
+        "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            (gdouble) 3 * part_target / GST_SECOND));
+    g_string_append_printf (playlist_str, "#EXT-X-PART-INF:PART-TARGET=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), (gdouble) part_target / GST_SECOND));
+
+    part_window = PART_WINDOW_TARGET_DURATIONS * target_duration * GST_SECOND;
+    for (l = playlist->entries->head; l != NULL; l = l->next)
+      remaining += ((GstM3U8Entry *) l->data)->duration;
+  }
   g_string_append (playlist_str, "\n");
 
   /* Entries */
@@ -177,6 +321,14 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
     if (entry->discontinuous)
       g_string_append (playlist_str, "#EXT-X-DISCONTINUITY\n");
 
+    gst_m3u8_playlist_render_map (playlist_str, &map_url, entry->map_url);
+
+    if (playlist->part_target > 0) {
+      if (remaining <= part_window)
+        gst_m3u8_playlist_render_parts (playlist_str, entry->parts);
+      remaining -= MIN (remaining, (GstClockTime) entry->duration);
+    }
+
     if (playlist->version < 3) {
       g_string_append_printf (playlist_str, "#EXTINF:%d,%s\n",
           (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
@@ -194,6 +346,12 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
     g_string_append_printf (playlist_str, "%s\n", entry->url);
   }
 
+  /* The segment being written */
+  if (playlist->parts->length > 0) {
+    gst_m3u8_playlist_render_map (playlist_str, &map_url, playlist->map_url);
+    gst_m3u8_playlist_render_parts (playlist_str, playlist->parts);
+  }
+
   if (playlist->end_list)
     g_string_append (playlist_str, "#EXT-X-ENDLIST");
 
@@ -22,7 +22,7 @@
 #ifndef __GST_M3U8_PLAYLIST_H__
 #define __GST_M3U8_PLAYLIST_H__
 
-#include <glib.h>
+#include <gst/gst.h>
 
 G_BEGIN_DECLS
 
@@ -36,9 +36,12 @@ struct _GstM3U8Playlist
   gint type;
   gboolean end_list;
   guint sequence_number;
+  GstClockTime part_target;     /* 0 without partial segments */
 
   /*< Private >*/
   GQueue *entries;
+  GQueue *parts;                /* parts of the segment being written */
+  gchar *map_url;
 };
 
 typedef enum
@@ -63,6 +66,14 @@ gboolean          gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
                                                guint             index,
                                                gboolean          discontinuous);
 
+gboolean          gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                              const gchar     * url,
+                                              GstClockTime      duration,
+                                              gboolean          independent);
+
+void              gst_m3u8_playlist_set_map (GstM3U8Playlist * playlist,
+                                             const gchar     * url);
+
 gchar *           gst_m3u8_playlist_render (GstM3U8Playlist * playlist);
 
 G_END_DECLS
@@ -43,12 +43,18 @@ gst_m3u8_new (void)
 
   m3u8 = g_new0 (GstM3U8, 1);
 
-  m3u8->current_file = NULL;
+  m3u8->files =
+      g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_m3u8_media_file_unref);
+  m3u8->current_file = -1;
+  m3u8->part = -1;
   m3u8->current_file_duration = GST_CLOCK_TIME_NONE;
   m3u8->sequence = -1;
   m3u8->sequence_position = 0;
   m3u8->highest_sequence_number = -1;
   m3u8->duration = GST_CLOCK_TIME_NONE;
+  m3u8->part_hold_back = GST_CLOCK_TIME_NONE;
+  m3u8->part_target = GST_CLOCK_TIME_NONE;
 
   g_mutex_init (&m3u8->lock);
   m3u8->ref_count = 1;
@@ -105,8 +111,11 @@ gst_m3u8_unref (GstM3U8 * self)
     g_free (self->base_uri);
     g_free (self->name);
 
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (self->files);
+    g_ptr_array_unref (self->files);
+    if (self->partial_file)
+      gst_m3u8_media_file_unref (self->partial_file);
+    if (self->preload_hint)
+      gst_m3u8_media_file_unref (self->preload_hint);
 
     g_free (self->last_data);
     g_mutex_clear (&self->lock);
@@ -147,6 +156,8 @@ gst_m3u8_media_file_unref (GstM3U8MediaFile * self)
   if (g_atomic_int_dec_and_test (&self->ref_count)) {
     if (self->init_file)
       gst_m3u8_init_file_unref (self->init_file);
+    if (self->partial_segments)
+      g_ptr_array_unref (self->partial_segments);
     g_free (self->title);
     g_free (self->uri);
     g_free (self->key);
@@ -154,6 +165,34 @@ gst_m3u8_media_file_unref (GstM3U8MediaFile * self)
   }
 }
 
+static void
+gst_m3u8_media_file_set_key (GstM3U8MediaFile * file, const gchar * key,
+    gboolean have_iv, const guint8 * iv)
+{
+  file->key = g_strdup (key);
+  if (file->key) {
+    if (have_iv) {
+      memcpy (file->iv, iv, sizeof (file->iv));
+    } else {
+      guint8 *iv = file->iv + 12;
+      GST_WRITE_UINT32_BE (iv, file->sequence);
+    }
+  }
+}
+
+static void
+gst_m3u8_media_file_set_sequence (GstM3U8MediaFile * file, gint64 sequence)
+{
+  guint i;
+
+  file->sequence = sequence;
+  if (file->partial_segments) {
+    for (i = 0; i < file->partial_segments->len; i++)
+      GST_M3U8_MEDIA_FILE (g_ptr_array_index (file->partial_segments,
+              i))->sequence = sequence;
+  }
+}
+
 static GstM3U8InitFile *
 gst_m3u8_init_file_new (gchar * uri)
 {
@@ -342,69 +381,196 @@ gst_hls_variant_stream_compare_by_bitrate (gconstpointer a, gconstpointer b)
   return vs_a->bandwidth - vs_b->bandwidth;
 }
 
-/* If we have MEDIA-SEQUENCE, ensure that it's consistent. If it is not,
- * the client SHOULD halt playback (6.3.4), which is what we do then. */
-static gboolean
-check_media_seqnums (GstM3U8 * self, GList * previous_files)
+/* Returns the index of the file with the given sequence in @files, or -1.
+ * Sequence numbers are contiguous, so this doesn't need to look at more than
+ * the first file */
+static gint
+m3u8_files_find (GPtrArray * files, gint64 sequence)
 {
-  GList *l, *m;
-  GstM3U8MediaFile *f1 = NULL, *f2 = NULL;
+  GstM3U8MediaFile *first;
 
-  g_return_val_if_fail (previous_files, FALSE);
+  if (files->len == 0)
+    return -1;
 
-  if (!self->files) {
-    /* Empty playlists are trivially consistent */
-    return TRUE;
+  first = g_ptr_array_index (files, 0);
+  if (sequence < first->sequence || sequence - first->sequence >= files->len)
+    return -1;
+
+  return sequence - first->sequence;
+}
+
+/* call with M3U8_LOCK held. Returns the file with @sequence, including the
+ * one whose parts are still being produced */
+static GstM3U8MediaFile *
+m3u8_get_segment (GstM3U8 * m3u8, gint64 sequence)
+{
+  gint index = m3u8_files_find (m3u8->files, sequence);
+
+  if (index != -1)
+    return g_ptr_array_index (m3u8->files, index);
+
+  if (m3u8->partial_file && m3u8->partial_file->sequence == sequence)
+    return m3u8->partial_file;
+
+  return NULL;
+}
+
+/* call with M3U8_LOCK held. Returns part @part of file @sequence, if it is
+ * in the playlist */
+static GstM3U8MediaFile *
+m3u8_get_part (GstM3U8 * m3u8, gint64 sequence, gint part)
+{
+  GstM3U8MediaFile *segment = m3u8_get_segment (m3u8, sequence);
+
+  if (segment == NULL || segment->partial_segments == NULL || part < 0
+      || part >= segment->partial_segments->len)
+    return NULL;
+
+  return g_ptr_array_index (segment->partial_segments, part);
+}
+
+/* call with M3U8_LOCK held. Moves @sequence and @part to the following
+ * part, which is the first one of the next file after the last part of a
+ * complete file */
+static void
+m3u8_next_part_position (GstM3U8 * m3u8, gint64 * sequence, gint * part)
+{
+  GstM3U8MediaFile *segment = m3u8_get_segment (m3u8, *sequence);
+
+  *part += 1;
+  if (segment && segment != m3u8->partial_file && segment->partial_segments
+      && *part >= segment->partial_segments->len) {
+    *sequence += 1;
+    *part = 0;
   }
+}
 
-  /* Find first case of higher/equal sequence number in new playlist.
-   * From there on we can linearly step ahead */
-  for (l = self->files; l; l = l->next) {
-    gboolean match = FALSE;
+/* Parts of an AES-128 encrypted file can't be decrypted on their own, the IV
+ * applies to the whole file and the padding is only at its end. Whole files
+ * are played then */
+static gboolean
+m3u8_parts_are_encrypted (GstM3U8MediaFile * segment)
+{
+  GstM3U8MediaFile *part;
+
+  if (segment->partial_segments == NULL || segment->partial_segments->len == 0)
+    return segment->key != NULL;
+
+  part = g_ptr_array_index (segment->partial_segments, 0);
+
+  return part->key != NULL;
+}
+
+/* For low-latency playlists, starts PART-HOLD-BACK from the end of the
+ * playlist, at a part that can be decoded on its own.
+ * Call with M3U8_LOCK held */
+static gboolean
+m3u8_seek_live_edge_part (GstM3U8 * self)
+{
+  GstM3U8MediaFile *segment, *part;
+  GstClockTime hold_back, live_edge, distance = 0;
+  gint64 sequence;
+  gint index = -1;
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->part_target))
+    return FALSE;
+
+  /* the lowest PART-HOLD-BACK a server can use */
+  hold_back = self->part_hold_back;
+  if (!GST_CLOCK_TIME_IS_VALID (hold_back))
+    hold_back = 3 * self->part_target;
+
+  live_edge = self->last_file_end;
+  if (self->partial_file) {
+    segment = self->partial_file;
+    live_edge += segment->duration;
+  } else {
+    segment = g_ptr_array_index (self->files, self->files->len - 1);
+  }
+  sequence = segment->sequence;
 
-    f1 = l->data;
-    for (m = previous_files; m; m = m->next) {
-      f2 = m->data;
+  if (m3u8_parts_are_encrypted (segment)) {
+    GST_DEBUG ("Parts are encrypted, starting from whole files");
+    return FALSE;
+  }
 
-      if (f1->sequence >= f2->sequence) {
-        match = TRUE;
+  while (segment && segment->partial_segments) {
+    for (index = segment->partial_segments->len - 1; index >= 0; index--) {
+      part = g_ptr_array_index (segment->partial_segments, index);
+      distance += part->duration;
+      if (distance >= hold_back && (part->independent || index == 0))
         break;
-      }
     }
-    if (match)
+    if (index >= 0)
       break;
-  }
 
-  /* We must have seen at least one entry on each list */
-  g_assert (f1 != NULL);
-  g_assert (f2 != NULL);
+    segment = m3u8_get_segment (self, --sequence);
+  }
 
-  if (!l) {
-    /* No match, no sequence in the new playlist was higher than
-     * any in the old. This is bad! */
-    GST_ERROR ("Media sequence doesn't continue: last new %" G_GINT64_FORMAT
-        " < last old %" G_GINT64_FORMAT, f1->sequence, f2->sequence);
+  if (index < 0 || distance > live_edge) {
+    GST_DEBUG ("Not enough parts to start %" GST_TIME_FORMAT
+        " from the live edge", GST_TIME_ARGS (hold_back));
     return FALSE;
   }
 
-  for (; l && m; l = l->next, m = m->next) {
-    f1 = l->data;
-    f2 = m->data;
-
-    if (f1->sequence == f2->sequence && !g_str_equal (f1->uri, f2->uri)) {
-      /* Same sequence, different URI. This is bad! */
-      GST_ERROR ("Media URIs inconsistent (sequence %" G_GINT64_FORMAT
-          "): had '%s', got '%s'", f1->sequence, f2->uri, f1->uri);
-      return FALSE;
-    } else if (f1->sequence < f2->sequence) {
-      /* Not same sequence but by construction sequence must be higher in the
-       * new one. All good in that case, if it isn't then this means that
-       * sequence numbers are decreasing or files were inserted */
-      GST_ERROR ("Media sequences inconsistent: %" G_GINT64_FORMAT " < %"
-          G_GINT64_FORMAT ": URIs new '%s' old '%s'", f1->sequence,
-          f2->sequence, f1->uri, f2->uri);
-      return FALSE;
-    }
+  self->sequence = sequence;
+  self->part = index;
+  self->sequence_position = live_edge - distance;
+
+  return TRUE;
+}
+
+/* call with M3U8_LOCK held. Returns the part to download at the current
+ * position, going back to whole files if the parts of the current one were
+ * already removed from the playlist */
+static GstM3U8MediaFile *
+m3u8_find_next_part (GstM3U8 * m3u8)
+{
+  GstM3U8MediaFile *segment = m3u8_get_segment (m3u8, m3u8->sequence);
+
+  if (segment && segment != m3u8->partial_file && segment->partial_segments
+      && m3u8->part >= segment->partial_segments->len) {
+    /* the file that was being produced is complete now */
+    m3u8->sequence++;
+    m3u8->part = 0;
+    segment = m3u8_get_segment (m3u8, m3u8->sequence);
+  }
+
+  if (segment && segment->partial_segments == NULL) {
+    GST_DEBUG ("No parts for sequence %" G_GINT64_FORMAT
+        ", going on with whole files", m3u8->sequence);
+    if (m3u8->part > 0)
+      m3u8->sequence++;
+    m3u8->part = -1;
+    return NULL;
+  }
+
+  return m3u8_get_part (m3u8, m3u8->sequence, m3u8->part);
+}
+
+/* If we have MEDIA-SEQUENCE, the files that were in the previous playlist
+ * were checked against it while parsing. Make sure that the new playlist
+ * doesn't go back in time. If it does, the client SHOULD halt playback
+ * (6.3.4), which is what we do then. */
+static gboolean
+check_media_seqnums (GstM3U8 * self, GPtrArray * previous_files)
+{
+  GstM3U8MediaFile *f1, *f2;
+
+  if (self->files->len == 0 || previous_files->len == 0) {
+    /* Empty playlists are trivially consistent */
+    return TRUE;
+  }
+
+  f1 = g_ptr_array_index (self->files, self->files->len - 1);
+  f2 = g_ptr_array_index (previous_files, 0);
+
+  if (f1->sequence < f2->sequence) {
+    /* No sequence in the new playlist was higher than any in the old.
+     * This is bad! */
+    GST_ERROR ("Media sequence doesn't continue: last new %" G_GINT64_FORMAT
+        " < first old %" G_GINT64_FORMAT, f1->sequence, f2->sequence);
+    return FALSE;
   }
 
   /* All good if we're getting here */
@@ -416,44 +582,54 @@ check_media_seqnums (GstM3U8 * self, GList * previous_files)
  * playlist in relation to the old. That is, same URIs get the same number
  * and later URIs get higher numbers */
 static void
-generate_media_seqnums (GstM3U8 * self, GList * previous_files)
+generate_media_seqnums (GstM3U8 * self, GPtrArray * previous_files)
 {
-  GList *l, *m;
-  GstM3U8MediaFile *f1 = NULL, *f2 = NULL;
+  GHashTable *previous_uris;
+  GstM3U8MediaFile *f1, *f2;
   gint64 mediasequence;
+  guint i, j = 0;
 
-  g_return_if_fail (previous_files);
+  if (previous_files->len == 0)
+    return;
+
+  previous_uris = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < previous_files->len; i++) {
+    f2 = g_ptr_array_index (previous_files, i);
+    if (!g_hash_table_contains (previous_uris, f2->uri))
+      g_hash_table_insert (previous_uris, f2->uri, GUINT_TO_POINTER (i + 1));
+  }
 
   /* Find first case of same URI in new playlist.
    * From there on we can linearly step ahead */
-  for (l = self->files; l; l = l->next) {
-    gboolean match = FALSE;
-
-    f1 = l->data;
-    for (m = previous_files; m; m = m->next) {
-      f2 = m->data;
-
-      if (g_str_equal (f1->uri, f2->uri)) {
-        match = TRUE;
-        break;
-      }
-    }
-
-    if (match)
+  for (i = 0; i < self->files->len; i++) {
+    f1 = g_ptr_array_index (self->files, i);
+    j = GPOINTER_TO_UINT (g_hash_table_lookup (previous_uris, f1->uri));
+    if (j > 0)
       break;
   }
 
-  if (l) {
-    /* Match, check that all following ones are matching too and continue
-     * sequence numbers from there on */
+  g_hash_table_unref (previous_uris);
+
+  if (j > 0) {
+    guint k;
 
-    mediasequence = f2->sequence;
+    /* Match, check that all following ones are matching too and continue
+     * sequence numbers from there on. Files inserted before the match are
+     * numbered backwards so that sequence numbers stay contiguous */
+    j--;
+    f2 = g_ptr_array_index (previous_files, j);
+    mediasequence = f2->sequence - i;
+
+    for (k = 0; k < i; k++) {
+      f1 = g_ptr_array_index (self->files, k);
+      gst_m3u8_media_file_set_sequence (f1, mediasequence++);
+    }
 
-    for (; l && m; l = l->next, m = m->next) {
-      f1 = l->data;
-      f2 = m->data;
+    for (; i < self->files->len && j < previous_files->len; i++, j++) {
+      f1 = g_ptr_array_index (self->files, i);
+      f2 = g_ptr_array_index (previous_files, j);
 
-      f1->sequence = mediasequence;
+      gst_m3u8_media_file_set_sequence (f1, mediasequence);
       mediasequence++;
 
       if (!g_str_equal (f1->uri, f2->uri)) {
@@ -462,23 +638,45 @@ generate_media_seqnums (GstM3U8 * self, GList * previous_files)
       }
     }
   } else {
-    /* No match, this means f2 is the last item in the previous playlist
-     * and we have to start our new playlist at that sequence */
+    /* No match, we have to start our new playlist after the last item in
+     * the previous playlist */
+    f2 = g_ptr_array_index (previous_files, previous_files->len - 1);
     mediasequence = f2->sequence + 1;
-    l = self->files;
+    i = 0;
   }
 
-  for (; l; l = l->next) {
-    f1 = l->data;
+  for (; i < self->files->len; i++) {
+    f1 = g_ptr_array_index (self->files, i);
 
-    f1->sequence = mediasequence;
+    gst_m3u8_media_file_set_sequence (f1, mediasequence);
     mediasequence++;
   }
+
+  if (self->partial_file)
+    gst_m3u8_media_file_set_sequence (self->partial_file, mediasequence);
 }
 
 /*
  * @data: a m3u8 playlist text data, taking ownership
  */
+/* The sequence number of the file following the last complete one, and the
+ * number of parts of that file already known. Called with the lock held */
+static void
+gst_m3u8_get_live_edge (GstM3U8 * self, gint64 * msn, guint * part)
+{
+  *msn = -1;
+  *part = 0;
+
+  if (self->files->len > 0) {
+    GstM3U8MediaFile *last =
+        g_ptr_array_index (self->files, self->files->len - 1);
+
+    *msn = last->sequence + 1;
+  }
+  if (self->partial_file)
+    *part = self->partial_file->partial_segments->len;
+}
+
 gboolean
 gst_m3u8_update (GstM3U8 * self, gchar * data)
 {
@@ -491,15 +689,23 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   guint8 iv[16] = { 0, };
   gint64 size = -1, offset = -1;
   gint64 mediasequence;
-  GList *previous_files = NULL;
+  GPtrArray *previous_files;
   gboolean have_mediasequence = FALSE;
+  gboolean consistent = TRUE;
   GstM3U8InitFile *last_init_file = NULL;
+  GPtrArray *parts = NULL;
+  gint64 previous_msn, msn;
+  guint previous_part, part;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
 
   GST_M3U8_LOCK (self);
 
+  /* only set again once the playlist was parsed successfully */
+  gst_m3u8_get_live_edge (self, &previous_msn, &previous_part);
+  self->reload_advanced = FALSE;
+
   /* check if the data changed since last update */
   if (self->last_data && g_str_equal (self->last_data, data)) {
     GST_DEBUG ("Playlist is the same as previous one");
@@ -526,15 +732,31 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   g_free (self->last_data);
   self->last_data = data;
 
-  self->current_file = NULL;
+  /* Files that were already in the previous update of a playlist with
+   * MEDIA-SEQUENCE are taken from it instead of being created again */
+  self->current_file = -1;
   previous_files = self->files;
-  self->files = NULL;
+  self->files =
+      g_ptr_array_new_full (previous_files->len,
+      (GDestroyNotify) gst_m3u8_media_file_unref);
   self->duration = GST_CLOCK_TIME_NONE;
   mediasequence = 0;
 
   /* By default, allow caching */
   self->allowcache = TRUE;
 
+  self->can_block_reload = FALSE;
+  self->part_hold_back = GST_CLOCK_TIME_NONE;
+  self->part_target = GST_CLOCK_TIME_NONE;
+  if (self->partial_file) {
+    gst_m3u8_media_file_unref (self->partial_file);
+    self->partial_file = NULL;
+  }
+  if (self->preload_hint) {
+    gst_m3u8_media_file_unref (self->preload_hint);
+    self->preload_hint = NULL;
+  }
+
   duration = 0;
   title = NULL;
   data += 7;
@@ -550,33 +772,53 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
       *r = '\0';
 
     if (data[0] != '#' && data[0] != '\0') {
+      GstM3U8MediaFile *file;
+      gchar *uri;
+      gint index = -1;
+
       if (duration <= 0) {
         GST_LOG ("%s: got line without EXTINF, dropping", data);
         goto next_line;
       }
 
-      data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
-      if (data != NULL) {
-        GstM3U8MediaFile *file;
-        file = gst_m3u8_media_file_new (data, title, duration, mediasequence++);
+      uri = uri_join (self->base_uri ? self->base_uri : self->uri, data);
+      if (uri == NULL)
+        goto next_line;
 
-        /* set encryption params */
-        file->key = current_key ? g_strdup (current_key) : NULL;
-        if (file->key) {
-          if (have_iv) {
-            memcpy (file->iv, iv, sizeof (iv));
-          } else {
-            guint8 *iv = file->iv + 12;
-            GST_WRITE_UINT32_BE (iv, file->sequence);
-          }
+      if (have_mediasequence)
+        index = m3u8_files_find (previous_files, mediasequence);
+
+      if (index != -1) {
+        file = g_ptr_array_index (previous_files, index);
+
+        if (!g_str_equal (file->uri, uri)) {
+          /* Same sequence, different URI. This is bad! */
+          GST_ERROR ("Media URIs inconsistent (sequence %" G_GINT64_FORMAT
+              "): had '%s', got '%s'", file->sequence, file->uri, uri);
+          g_free (uri);
+          consistent = FALSE;
+          break;
         }
+        g_free (uri);
+
+        g_ptr_array_add (self->files, gst_m3u8_media_file_ref (file));
+        mediasequence++;
+        g_free (title);
+        if (parts)
+          g_ptr_array_unref (parts);
+      } else {
+        file = gst_m3u8_media_file_new (uri, title, duration, mediasequence++);
+
+        /* set encryption params */
+        gst_m3u8_media_file_set_key (file, current_key, have_iv, iv);
 
         if (size != -1) {
           file->size = size;
           if (offset != -1) {
             file->offset = offset;
           } else {
-            GstM3U8MediaFile *prev = self->files ? self->files->data : NULL;
+            GstM3U8MediaFile *prev = self->files->len > 0 ?
+                g_ptr_array_index (self->files, self->files->len - 1) : NULL;
 
             if (!prev) {
               offset = 0;
@@ -593,14 +835,17 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         file->discont = discontinuity;
         if (last_init_file)
           file->init_file = gst_m3u8_init_file_ref (last_init_file);
+        file->partial_segments = parts;
 
-        duration = 0;
-        title = NULL;
-        discontinuity = FALSE;
-        size = offset = -1;
-        self->files = g_list_prepend (self->files, file);
+        g_ptr_array_add (self->files, file);
       }
 
+      duration = 0;
+      title = NULL;
+      discontinuity = FALSE;
+      size = offset = -1;
+      parts = NULL;
+
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
       gdouble fval;
       if (!double_from_string (data + 8, &data, &fval)) {
@@ -701,6 +946,139 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
             }
           }
         }
+      } else if (g_str_has_prefix (data_ext_x, "SERVER-CONTROL:")) {
+        gchar *v, *a;
+
+        data = data + 22;
+
+        while (data != NULL && parse_attributes (&data, &a, &v)) {
+          if (strcmp (a, "CAN-BLOCK-RELOAD") == 0) {
+            self->can_block_reload = g_ascii_strcasecmp (v, "YES") == 0;
+          } else if (strcmp (a, "PART-HOLD-BACK") == 0) {
+            gdouble fval;
+
+            if (double_from_string (v, NULL, &fval))
+              self->part_hold_back = fval * (gdouble) GST_SECOND;
+          }
+        }
+      } else if (g_str_has_prefix (data_ext_x, "PART-INF:")) {
+        gchar *v, *a;
+
+        data = data + 16;
+
+        while (data != NULL && parse_attributes (&data, &a, &v)) {
+          if (strcmp (a, "PART-TARGET") == 0) {
+            gdouble fval;
+
+            if (double_from_string (v, NULL, &fval))
+              self->part_target = fval * (gdouble) GST_SECOND;
+          }
+        }
+      } else if (g_str_has_prefix (data_ext_x, "PART:")) {
+        GstM3U8MediaFile *part;
+        GstClockTime part_duration = GST_CLOCK_TIME_NONE;
+        gchar *v, *a, *part_uri = NULL;
+        gint64 part_size = -1, part_offset = -1;
+        gboolean independent = FALSE;
+
+        data = data + 12;
+
+        while (data != NULL && parse_attributes (&data, &a, &v)) {
+          if (strcmp (a, "URI") == 0) {
+            g_free (part_uri);
+            part_uri =
+                uri_join (self->base_uri ? self->base_uri : self->uri, v);
+          } else if (strcmp (a, "DURATION") == 0) {
+            gdouble fval;
+
+            if (double_from_string (v, NULL, &fval))
+              part_duration = fval * (gdouble) GST_SECOND;
+          } else if (strcmp (a, "INDEPENDENT") == 0) {
+            independent = g_ascii_strcasecmp (v, "YES") == 0;
+          } else if (strcmp (a, "BYTERANGE") == 0) {
+            if (int64_from_string (v, &v, &part_size) && *v == '@')
+              int64_from_string (v + 1, NULL, &part_offset);
+          }
+        }
+
+        if (part_uri == NULL || !GST_CLOCK_TIME_IS_VALID (part_duration)) {
+          GST_WARNING ("Ignoring part without URI or DURATION");
+          g_free (part_uri);
+          goto next_line;
+        }
+
+        /* Parts come before the file they belong to */
+        part = gst_m3u8_media_file_new (part_uri, NULL, part_duration,
+            mediasequence);
+        gst_m3u8_media_file_set_key (part, current_key, have_iv, iv);
+        part->independent = independent;
+
+        if (part_size != -1) {
+          part->size = part_size;
+          if (part_offset == -1) {
+            GstM3U8MediaFile *prev = parts ?
+                g_ptr_array_index (parts, parts->len - 1) : NULL;
+
+            /* continues the range of the previous part */
+            if (prev && prev->size != -1 && g_str_equal (prev->uri, part_uri))
+              part_offset = prev->offset + prev->size;
+            else
+              part_offset = 0;
+          }
+          part->offset = part_offset;
+        } else {
+          part->size = -1;
+          part->offset = 0;
+        }
+
+        part->discont = discontinuity && parts == NULL;
+        if (last_init_file)
+          part->init_file = gst_m3u8_init_file_ref (last_init_file);
+
+        if (parts == NULL) {
+          parts =
+              g_ptr_array_new_with_free_func ((GDestroyNotify)
+              gst_m3u8_media_file_unref);
+        }
+        g_ptr_array_add (parts, part);
+      } else if (g_str_has_prefix (data_ext_x, "PRELOAD-HINT:")) {
+        gchar *v, *a, *hint_uri = NULL;
+        gint64 hint_offset = 0, hint_size = -1;
+        gboolean is_part = FALSE;
+
+        data = data + 20;
+
+        while (data != NULL && parse_attributes (&data, &a, &v)) {
+          if (strcmp (a, "TYPE") == 0) {
+            is_part = strcmp (v, "PART") == 0;
+          } else if (strcmp (a, "URI") == 0) {
+            g_free (hint_uri);
+            hint_uri =
+                uri_join (self->base_uri ? self->base_uri : self->uri, v);
+          } else if (strcmp (a, "BYTERANGE-START") == 0) {
+            int64_from_string (v, NULL, &hint_offset);
+          } else if (strcmp (a, "BYTERANGE-LENGTH") == 0) {
+            int64_from_string (v, NULL, &hint_size);
+          }
+        }
+
+        /* Only the hints of parts are used, to request them ahead */
+        if (is_part && hint_uri) {
+          if (self->preload_hint)
+            gst_m3u8_media_file_unref (self->preload_hint);
+          self->preload_hint = gst_m3u8_media_file_new (hint_uri, NULL,
+              self->part_target, mediasequence);
+          gst_m3u8_media_file_set_key (self->preload_hint, current_key,
+              have_iv, iv);
+          self->preload_hint->offset = hint_offset;
+          self->preload_hint->size = hint_size;
+          if (last_init_file) {
+            self->preload_hint->init_file =
+                gst_m3u8_init_file_ref (last_init_file);
+          }
+        } else {
+          g_free (hint_uri);
+        }
       } else if (g_str_has_prefix (data_ext_x, "BYTERANGE:")) {
         gchar *v = data + 17;
 
@@ -766,33 +1144,47 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 
   g_free (current_key);
   current_key = NULL;
-
-  self->files = g_list_reverse (self->files);
+  g_free (title);
+
+  /* The parts after the last file belong to the one being produced */
+  if (parts && consistent) {
+    guint i;
+
+    self->partial_file =
+        gst_m3u8_media_file_new (NULL, NULL, 0, mediasequence);
+    self->partial_file->partial_segments = parts;
+    self->partial_file->discont =
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (parts, 0))->discont;
+    for (i = 0; i < parts->len; i++) {
+      self->partial_file->duration +=
+          GST_M3U8_MEDIA_FILE (g_ptr_array_index (parts, i))->duration;
+    }
+  } else if (parts) {
+    g_ptr_array_unref (parts);
+  }
+  parts = NULL;
 
   if (last_init_file)
     gst_m3u8_init_file_unref (last_init_file);
 
-  if (previous_files) {
-    gboolean consistent = TRUE;
-
+  if (consistent) {
     if (have_mediasequence) {
       consistent = check_media_seqnums (self, previous_files);
     } else {
       generate_media_seqnums (self, previous_files);
     }
+  }
 
-    g_list_foreach (previous_files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (previous_files);
-    previous_files = NULL;
+  g_ptr_array_unref (previous_files);
+  previous_files = NULL;
 
-    /* error was reported above already */
-    if (!consistent) {
-      GST_M3U8_UNLOCK (self);
-      return FALSE;
-    }
+  /* error was reported above already */
+  if (!consistent) {
+    GST_M3U8_UNLOCK (self);
+    return FALSE;
   }
 
-  if (self->files == NULL) {
+  if (self->files->len == 0) {
     GST_ERROR ("Invalid media playlist, it does not contain any media files");
     GST_M3U8_UNLOCK (self);
     return FALSE;
@@ -800,14 +1192,14 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 
   /* calculate the start and end times of this media playlist. */
   {
-    GList *walk;
     GstM3U8MediaFile *file;
     GstClockTime duration = 0;
+    guint i;
 
     mediasequence = -1;
 
-    for (walk = self->files; walk; walk = walk->next) {
-      file = walk->data;
+    for (i = 0; i < self->files->len; i++) {
+      file = g_ptr_array_index (self->files, i);
 
       if (mediasequence == -1) {
         mediasequence = file->sequence;
@@ -845,40 +1237,49 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   }
 
   /* first-time setup */
-  if (self->files && self->sequence == -1) {
-    GList *file;
+  if (self->sequence == -1 && GST_M3U8_IS_LIVE (self) &&
+      m3u8_seek_live_edge_part (self)) {
+    GST_DEBUG ("first sequence: %u, part %d", (guint) self->sequence,
+        self->part);
+  } else if (self->sequence == -1) {
+    gint index;
 
     if (GST_M3U8_IS_LIVE (self)) {
       gint i;
       GstClockTime sequence_pos = 0;
+      GstM3U8MediaFile *file;
 
-      file = g_list_last (self->files);
+      index = self->files->len - 1;
+      file = g_ptr_array_index (self->files, index);
 
-      if (self->last_file_end >= GST_M3U8_MEDIA_FILE (file->data)->duration) {
-        sequence_pos =
-            self->last_file_end - GST_M3U8_MEDIA_FILE (file->data)->duration;
-      }
+      if (self->last_file_end >= file->duration)
+        sequence_pos = self->last_file_end - file->duration;
 
       /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
        * the end of the playlist. See section 6.3.3 of HLS draft */
-      for (i = 0; i < GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE && file->prev &&
-          GST_M3U8_MEDIA_FILE (file->prev->data)->duration <= sequence_pos;
-          ++i) {
-        file = file->prev;
-        sequence_pos -= GST_M3U8_MEDIA_FILE (file->data)->duration;
+      for (i = 0; i < GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE && index > 0 &&
+          GST_M3U8_MEDIA_FILE (g_ptr_array_index (self->files,
+                  index - 1))->duration <= sequence_pos; ++i) {
+        index--;
+        file = g_ptr_array_index (self->files, index);
+        sequence_pos -= file->duration;
       }
       self->sequence_position = sequence_pos;
     } else {
-      file = g_list_first (self->files);
+      index = 0;
       self->sequence_position = 0;
     }
-    self->current_file = file;
-    self->sequence = GST_M3U8_MEDIA_FILE (file->data)->sequence;
+    self->current_file = index;
+    self->sequence =
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (self->files, index))->sequence;
     GST_DEBUG ("first sequence: %u", (guint) self->sequence);
   }
 
+  gst_m3u8_get_live_edge (self, &msn, &part);
+  self->reload_advanced = msn != previous_msn || part != previous_part;
+
   GST_LOG ("processed media playlist %s, %u fragments", self->name,
-      g_list_length (self->files));
+      self->files->len);
 
   GST_M3U8_UNLOCK (self);
 
@@ -886,35 +1287,27 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 }
 
 /* call with M3U8_LOCK held */
-static GList *
+static gint
 m3u8_find_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
-  GstM3U8MediaFile *file;
-  GList *l = m3u8->files;
+  GstM3U8MediaFile *first;
+  gint64 index;
 
-  if (forward) {
-    while (l) {
-      file = l->data;
+  if (m3u8->files->len == 0)
+    return -1;
 
-      if (file->sequence >= m3u8->sequence)
-        break;
+  first = g_ptr_array_index (m3u8->files, 0);
+  index = m3u8->sequence - first->sequence;
 
-      l = l->next;
-    }
+  if (forward) {
+    if (index >= (gint64) m3u8->files->len)
+      return -1;
+    return MAX (index, 0);
   } else {
-    l = g_list_last (l);
-
-    while (l) {
-      file = l->data;
-
-      if (file->sequence <= m3u8->sequence)
-        break;
-
-      l = l->prev;
-    }
+    if (index < 0)
+      return -1;
+    return MIN (index, (gint64) m3u8->files->len - 1);
   }
-
-  return l;
 }
 
 GstM3U8MediaFile *
@@ -932,13 +1325,44 @@ gst_m3u8_get_next_fragment (GstM3U8 * m3u8, gboolean forward,
   if (m3u8->sequence < 0)       /* can't happen really */
     goto out;
 
-  if (m3u8->current_file == NULL)
+  /* Past the last complete file, go on with the parts of the one being
+   * produced */
+  if (forward && m3u8->part == -1 && m3u8->partial_file &&
+      m3u8->sequence == m3u8->partial_file->sequence &&
+      !m3u8_parts_are_encrypted (m3u8->partial_file))
+    m3u8->part = 0;
+
+  if (forward && m3u8->part >= 0) {
+    file = m3u8_find_next_part (m3u8);
+
+    if (file) {
+      file = gst_m3u8_media_file_ref (file);
+
+      GST_DEBUG ("Got part %d of sequence %u", m3u8->part,
+          (guint) file->sequence);
+
+      if (sequence_position)
+        *sequence_position = m3u8->sequence_position;
+      if (discont)
+        *discont = file->discont;
+
+      m3u8->current_file_duration = file->duration;
+      goto out;
+    }
+
+    /* waiting for the next part */
+    if (m3u8->part >= 0)
+      goto out;
+  }
+
+  if (m3u8->current_file == -1)
     m3u8->current_file = m3u8_find_next_fragment (m3u8, forward);
 
-  if (m3u8->current_file == NULL)
+  if (m3u8->current_file == -1)
     goto out;
 
-  file = gst_m3u8_media_file_ref (m3u8->current_file->data);
+  file = gst_m3u8_media_file_ref (g_ptr_array_index (m3u8->files,
+          m3u8->current_file));
 
   GST_DEBUG ("Got fragment with sequence %u (current sequence %u)",
       (guint) file->sequence, (guint) m3u8->sequence);
@@ -958,11 +1382,63 @@ out:
   return file;
 }
 
+/* Returns the @n-th fragment after the current one, without advancing */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint n)
+{
+  GstM3U8MediaFile *file = NULL;
+  gint64 index;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (forward && m3u8->part >= 0) {
+    gint64 sequence = m3u8->sequence;
+    gint part = m3u8->part;
+
+    while (n-- > 0)
+      m3u8_next_part_position (m3u8, &sequence, &part);
+
+    file = m3u8_get_part (m3u8, sequence, part);
+
+    /* The preload hint is the part after the last one of the playlist */
+    if (file == NULL && m3u8->preload_hint && m3u8->files->len > 0) {
+      gint64 hint_sequence;
+      gint hint_part = 0;
+
+      if (m3u8->partial_file) {
+        hint_sequence = m3u8->partial_file->sequence;
+        hint_part = m3u8->partial_file->partial_segments->len;
+      } else {
+        hint_sequence = GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+                m3u8->files->len - 1))->sequence + 1;
+      }
+
+      if (sequence == hint_sequence && part == hint_part)
+        file = m3u8->preload_hint;
+    }
+
+    if (file)
+      file = gst_m3u8_media_file_ref (file);
+  } else if (m3u8->current_file != -1) {
+    index = forward ? (gint64) m3u8->current_file + n :
+        (gint64) m3u8->current_file - n;
+
+    if (index >= 0 && index < m3u8->files->len)
+      file = gst_m3u8_media_file_ref (g_ptr_array_index (m3u8->files, index));
+  }
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 gboolean
 gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
   gboolean have_next;
-  GList *cur;
+  gint cur;
 
   g_return_val_if_fail (m3u8 != NULL, FALSE);
 
@@ -971,14 +1447,26 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   GST_DEBUG ("Checking next fragment %" G_GINT64_FORMAT,
       m3u8->sequence + (forward ? 1 : -1));
 
-  if (m3u8->current_file) {
+  if (forward && m3u8->part >= 0) {
+    gint64 sequence = m3u8->sequence;
+    gint part = m3u8->part;
+
+    m3u8_next_part_position (m3u8, &sequence, &part);
+    have_next = m3u8_get_part (m3u8, sequence, part) != NULL ||
+        m3u8_files_find (m3u8->files, sequence) != -1;
+    goto out;
+  }
+
+  if (m3u8->current_file != -1) {
     cur = m3u8->current_file;
   } else {
     cur = m3u8_find_next_fragment (m3u8, forward);
   }
 
-  have_next = cur && ((forward && cur->next) || (!forward && cur->prev));
+  have_next = cur != -1 && ((forward && (guint) cur + 1 < m3u8->files->len)
+      || (!forward && cur > 0));
 
+out:
   GST_M3U8_UNLOCK (m3u8);
 
   return have_next;
@@ -988,9 +1476,8 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
 {
-  gint targetnum = m3u8->sequence;
-  GList *tmp;
-  GstM3U8MediaFile *mf;
+  gint64 targetnum = m3u8->sequence;
+  gint index;
 
   /* figure out the target seqnum */
   if (forward)
@@ -998,18 +1485,15 @@ m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
   else
     targetnum -= 1;
 
-  for (tmp = m3u8->files; tmp; tmp = tmp->next) {
-    mf = (GstM3U8MediaFile *) tmp->data;
-    if (mf->sequence == targetnum)
-      break;
-  }
-  if (tmp == NULL) {
+  index = m3u8_files_find (m3u8->files, targetnum);
+  if (index == -1) {
     GST_WARNING ("Can't find next fragment");
     return;
   }
-  m3u8->current_file = tmp;
+  m3u8->current_file = index;
   m3u8->sequence = targetnum;
-  m3u8->current_file_duration = GST_M3U8_MEDIA_FILE (tmp->data)->duration;
+  m3u8->current_file_duration =
+      GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, index))->duration;
 }
 
 void
@@ -1035,30 +1519,31 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
     GST_DEBUG ("Sequence position now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (m3u8->sequence_position));
   }
-  if (!m3u8->current_file) {
-    GList *l;
-
+  if (forward && m3u8->part >= 0) {
+    m3u8_next_part_position (m3u8, &m3u8->sequence, &m3u8->part);
+    m3u8->current_file = -1;
+    GST_DEBUG ("Advanced to part %d of sequence %" G_GINT64_FORMAT,
+        m3u8->part, m3u8->sequence);
+    goto out;
+  }
+  if (m3u8->current_file == -1) {
     GST_DEBUG ("Looking for fragment %" G_GINT64_FORMAT, m3u8->sequence);
-    for (l = m3u8->files; l != NULL; l = l->next) {
-      if (GST_M3U8_MEDIA_FILE (l->data)->sequence == m3u8->sequence) {
-        m3u8->current_file = l;
-        break;
-      }
-    }
-    if (m3u8->current_file == NULL) {
+    m3u8->current_file = m3u8_files_find (m3u8->files, m3u8->sequence);
+    if (m3u8->current_file == -1) {
       GST_DEBUG
           ("Could not find current fragment, trying next fragment directly");
       m3u8_alternate_advance (m3u8, forward);
 
       /* Resync sequence number if the above has failed for live streams */
-      if (m3u8->current_file == NULL && GST_M3U8_IS_LIVE (m3u8)) {
+      if (m3u8->current_file == -1 && GST_M3U8_IS_LIVE (m3u8) &&
+          m3u8->files->len > 0) {
         /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
            the end of the playlist. See section 6.3.3 of HLS draft */
-        gint pos =
-            g_list_length (m3u8->files) - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-        m3u8->current_file = g_list_nth (m3u8->files, pos >= 0 ? pos : 0);
+        gint pos = m3u8->files->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+        m3u8->current_file = MAX (pos, 0);
         m3u8->current_file_duration =
-            GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
+            GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+                m3u8->current_file))->duration;
 
         GST_WARNING ("Resyncing live playlist");
       }
@@ -1066,28 +1551,24 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
     }
   }
 
-  file = GST_M3U8_MEDIA_FILE (m3u8->current_file->data);
+  file = g_ptr_array_index (m3u8->files, m3u8->current_file);
   GST_DEBUG ("Advancing from sequence %u", (guint) file->sequence);
   if (forward) {
-    m3u8->current_file = m3u8->current_file->next;
-    if (m3u8->current_file) {
-      m3u8->sequence = GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->sequence;
-    } else {
-      m3u8->sequence = file->sequence + 1;
-    }
+    if ((guint) m3u8->current_file + 1 < m3u8->files->len)
+      m3u8->current_file++;
+    else
+      m3u8->current_file = -1;
+    m3u8->sequence = file->sequence + 1;
   } else {
-    m3u8->current_file = m3u8->current_file->prev;
-    if (m3u8->current_file) {
-      m3u8->sequence = GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->sequence;
-    } else {
-      m3u8->sequence = file->sequence - 1;
-    }
+    m3u8->current_file--;
+    m3u8->sequence = file->sequence - 1;
   }
-  if (m3u8->current_file) {
+  if (m3u8->current_file != -1) {
     /* Store duration of the fragment we're using to update the position 
      * the next time we advance */
     m3u8->current_file_duration =
-        GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+            m3u8->current_file))->duration;
   }
 
 out:
@@ -1108,12 +1589,13 @@ gst_m3u8_get_duration (GstM3U8 * m3u8)
   if (!m3u8->endlist)
     goto out;
 
-  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files != NULL) {
-    GList *f;
+  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files->len > 0) {
+    guint i;
 
     m3u8->duration = 0;
-    for (f = m3u8->files; f != NULL; f = f->next)
-      m3u8->duration += GST_M3U8_MEDIA_FILE (f)->duration;
+    for (i = 0; i < m3u8->files->len; i++)
+      m3u8->duration +=
+          GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, i))->duration;
   }
   duration = m3u8->duration;
 
@@ -1164,6 +1646,88 @@ gst_m3u8_is_live (GstM3U8 * m3u8)
   return is_live;
 }
 
+/* Returns the URI to reload a live playlist with, asking the server to hold
+ * the request until the playlist has the file or part following the last
+ * one we know about, or %NULL if the server doesn't support that */
+gchar *
+gst_m3u8_get_blocking_reload_uri (GstM3U8 * m3u8)
+{
+  GstM3U8MediaFile *last;
+  gchar *uri = NULL;
+  gint64 msn;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (!m3u8->can_block_reload || !GST_M3U8_IS_LIVE (m3u8)
+      || m3u8->uri == NULL || m3u8->files->len == 0)
+    goto out;
+
+  last = g_ptr_array_index (m3u8->files, m3u8->files->len - 1);
+  msn = last->sequence + 1;
+
+  /* Whole files are played when the parts are encrypted, only wait for the
+   * next complete file then */
+  if (GST_CLOCK_TIME_IS_VALID (m3u8->part_target)
+      && !m3u8_parts_are_encrypted (m3u8->partial_file ? m3u8->partial_file :
+          last)) {
+    guint part = 0;
+
+    if (m3u8->partial_file)
+      part = m3u8->partial_file->partial_segments->len;
+
+    uri = g_strdup_printf ("%s%c_HLS_msn=%" G_GINT64_FORMAT "&_HLS_part=%u",
+        m3u8->uri, strchr (m3u8->uri, '?') ? '&' : '?', msn, part);
+  } else {
+    uri = g_strdup_printf ("%s%c_HLS_msn=%" G_GINT64_FORMAT, m3u8->uri,
+        strchr (m3u8->uri, '?') ? '&' : '?', msn);
+  }
+
+out:
+  GST_M3U8_UNLOCK (m3u8);
+
+  return uri;
+}
+
+/* Returns how long to wait before reloading a live playlist */
+GstClockTime
+gst_m3u8_get_reload_interval (GstM3U8 * m3u8)
+{
+  GstClockTime interval;
+
+  g_return_val_if_fail (m3u8 != NULL, GST_CLOCK_TIME_NONE);
+
+  GST_M3U8_LOCK (m3u8);
+  if (m3u8->can_block_reload && GST_M3U8_IS_LIVE (m3u8)
+      && m3u8->files->len > 0 && m3u8->reload_advanced) {
+    /* the server answers once there is something new, see
+     * gst_m3u8_get_blocking_reload_uri(). After a failed reload, or if the
+     * server answered without waiting for anything new, wait as for a
+     * regular reload not to poll it in a loop */
+    interval = 0;
+  } else if (GST_CLOCK_TIME_IS_VALID (m3u8->part_target)) {
+    interval = m3u8->part_target;
+  } else {
+    interval = m3u8->targetduration;
+  }
+  GST_M3U8_UNLOCK (m3u8);
+
+  return interval;
+}
+
+/* Called when reloading the playlist failed, the next reload is not sent
+ * right away then */
+void
+gst_m3u8_reload_failed (GstM3U8 * m3u8)
+{
+  g_return_if_fail (m3u8 != NULL);
+
+  GST_M3U8_LOCK (m3u8);
+  m3u8->reload_advanced = FALSE;
+  GST_M3U8_UNLOCK (m3u8);
+}
+
 gchar *
 uri_join (const gchar * uri1, const gchar * uri2)
 {
@@ -1224,16 +1788,15 @@ gboolean
 gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
 {
   GstClockTime duration = 0;
-  GList *walk;
   GstM3U8MediaFile *file;
-  guint count;
+  guint i;
   guint min_distance = 0;
 
   g_return_val_if_fail (m3u8 != NULL, FALSE);
 
   GST_M3U8_LOCK (m3u8);
 
-  if (m3u8->files == NULL)
+  if (m3u8->files->len == 0)
     goto out;
 
   if (GST_M3U8_IS_LIVE (m3u8)) {
@@ -1242,11 +1805,9 @@ gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
        playlist - see 6.3.3. "Playing the Playlist file" of the HLS draft */
     min_distance = GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
   }
-  count = g_list_length (m3u8->files);
 
-  for (walk = m3u8->files; walk && count > min_distance; walk = walk->next) {
-    file = walk->data;
-    --count;
+  for (i = 0; i + min_distance < m3u8->files->len; i++) {
+    file = g_ptr_array_index (m3u8->files, i);
     duration += file->duration;
   }
 
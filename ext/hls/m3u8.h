@@ -64,10 +64,22 @@ struct _GstM3U8
   GstClockTime targetduration;  /* last EXT-X-TARGETDURATION */
   gboolean allowcache;          /* last EXT-X-ALLOWCACHE */
 
-  GList *files;
+  /* low-latency */
+  gboolean can_block_reload;    /* EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD */
+  GstClockTime part_hold_back;  /* EXT-X-SERVER-CONTROL:PART-HOLD-BACK */
+  GstClockTime part_target;     /* EXT-X-PART-INF:PART-TARGET */
+  GstM3U8MediaFile *partial_file; /* parts of the segment being produced after
+                                   * the last file, which has no URI yet */
+  GstM3U8MediaFile *preload_hint; /* EXT-X-PRELOAD-HINT of the next part */
+  gboolean reload_advanced;     /* the last reload got a new file or part */
+
+  /* GstM3U8MediaFile, with contiguous increasing sequence numbers so that
+   * the file with sequence N is at index N - first sequence */
+  GPtrArray *files;
 
   /* state */
-  GList *current_file;
+  gint current_file;                  /* index in files, or -1 */
+  gint part;                          /* part of the current sequence, or -1 for the whole file */
   GstClockTime current_file_duration; /* Duration of current fragment */
   gint64 sequence;                    /* the next sequence for this client */
   GstClockTime sequence_position;     /* position of this sequence */
@@ -101,6 +113,8 @@ struct _GstM3U8MediaFile
   gint64 offset, size;
   gint ref_count;               /* ATOMIC */
   GstM3U8InitFile *init_file;   /* Media Initialization (hold ref) */
+  GPtrArray *partial_segments;  /* EXT-X-PART of this file, as GstM3U8MediaFile */
+  gboolean independent;         /* this part starts with an independent frame */
 };
 
 struct _GstM3U8InitFile
@@ -129,6 +143,10 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
                                                   GstClockTime * sequence_position,
                                                   gboolean     * discont);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8      * m3u8,
+                                                  gboolean       forward,
+                                                  guint          n);
+
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
@@ -143,6 +161,12 @@ gchar *            gst_m3u8_get_uri              (GstM3U8 * m3u8);
 
 gboolean           gst_m3u8_is_live              (GstM3U8 * m3u8);
 
+gchar *            gst_m3u8_get_blocking_reload_uri (GstM3U8 * m3u8);
+
+GstClockTime       gst_m3u8_get_reload_interval  (GstM3U8 * m3u8);
+
+void               gst_m3u8_reload_failed        (GstM3U8 * m3u8);
+
 gboolean           gst_m3u8_get_seek_range       (GstM3U8 * m3u8,
                                                   gint64  * start,
                                                   gint64  * stop);
@@ -61,6 +61,7 @@ enum
   PROP_GST_SCTP_ASSOCIATION_ID,
   PROP_REMOTE_SCTP_PORT,
   PROP_USE_SOCK_STREAM,
+  PROP_STATS,
 
   NUM_PROPERTIES
 };
@@ -75,6 +76,11 @@ static GParamSpec *properties[NUM_PROPERTIES];
 
 #define BUFFER_FULL_SLEEP_TIME 100000
 
+/* period over which the send rate of a stream is measured */
+#define SEND_RATE_WINDOW G_USEC_PER_SEC
+/* maximum number of packets pushed downstream in one buffer list */
+#define MAX_PACKETS_PER_LIST 64
+
 GType gst_sctp_enc_pad_get_type (void);
 
 #define GST_TYPE_SCTP_ENC_PAD (gst_sctp_enc_pad_get_type())
@@ -98,6 +104,16 @@ struct _GstSctpEncPad
 
   guint64 bytes_sent;
 
+  /* statistics, protected by the lock */
+  guint64 messages_sent;
+  guint64 messages_dropped;
+  guint64 bytes_dropped;
+  /* part of the current message waiting for room in the SCTP send buffer */
+  guint64 bytes_queued;
+  gint64 rate_window_start;
+  guint64 rate_window_bytes;
+  gdouble send_rate;
+
   GMutex lock;
   GCond cond;
   gboolean flushing;
@@ -132,6 +148,35 @@ gst_sctp_enc_pad_init (GstSctpEncPad * self)
   self->flushing = FALSE;
 }
 
+/* Called with the pad lock */
+static void
+gst_sctp_enc_pad_account_sent (GstSctpEncPad * self, guint32 bytes)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  self->bytes_sent += bytes;
+
+  if (self->rate_window_start == 0)
+    self->rate_window_start = now;
+
+  if (now - self->rate_window_start >= SEND_RATE_WINDOW) {
+    self->send_rate = (gdouble) self->rate_window_bytes * G_USEC_PER_SEC /
+        (now - self->rate_window_start);
+    self->rate_window_start = now;
+    self->rate_window_bytes = 0;
+  }
+  self->rate_window_bytes += bytes;
+}
+
+/* Called with the pad lock, @bytes is the size of the whole message even if
+ * a part of it was sent already */
+static void
+gst_sctp_enc_pad_account_dropped (GstSctpEncPad * self, gsize bytes)
+{
+  self->messages_dropped++;
+  self->bytes_dropped += bytes;
+}
+
 static void gst_sctp_enc_finalize (GObject * object);
 static void gst_sctp_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -145,6 +190,8 @@ static void gst_sctp_enc_release_pad (GstElement * element, GstPad * pad);
 static void gst_sctp_enc_srcpad_loop (GstPad * pad);
 static GstFlowReturn gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer);
+static GstFlowReturn gst_sctp_enc_sink_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static gboolean gst_sctp_enc_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static gboolean gst_sctp_enc_src_event (GstPad * pad, GstObject * parent,
@@ -161,6 +208,7 @@ static void get_config_from_caps (const GstCaps * caps, gboolean * ordered,
     GstSctpAssociationPartialReliability * reliability,
     guint32 * reliability_param, guint32 * ppid, gboolean * ppid_available);
 static guint64 on_get_stream_bytes_sent (GstSctpEnc * self, guint stream_id);
+static GstStructure *gst_sctp_enc_create_stats (GstSctpEnc * self);
 
 static void
 gst_sctp_enc_class_init (GstSctpEncClass * klass)
@@ -211,6 +259,31 @@ gst_sctp_enc_class_init (GstSctpEncClass * klass)
       "When TRUE the partial reliability parameters of the channel are ignored.",
       DEFAULT_USE_SOCK_STREAM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSctpEnc:stats:
+   *
+   * Statistics of the streams in a GstStructure named
+   * "application/x-sctp-enc-stats". Its "streams" field is an array with one
+   * "application/x-sctp-enc-stream-stats" structure per sink pad, holding:
+   *
+   * * "stream-id" G_TYPE_UINT
+   * * "messages-sent" G_TYPE_UINT64
+   * * "bytes-sent" G_TYPE_UINT64
+   * * "bytes-queued" G_TYPE_UINT64: bytes of the current message waiting
+   *   for room in the SCTP send buffer
+   * * "send-rate" G_TYPE_DOUBLE: in bytes per second, over the last second
+   * * "messages-dropped" G_TYPE_UINT64: messages abandoned by SCTP because
+   *   of their partial reliability parameters, discarded when flushing or
+   *   because pushing on the source pad failed
+   * * "bytes-dropped" G_TYPE_UINT64
+   *
+   * Since: 1.20
+   */
+  properties[PROP_STATS] =
+      g_param_spec_boxed ("stats", "Statistics",
+      "Statistics of the streams", GST_TYPE_STRUCTURE,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   signals[SIGNAL_SCTP_ASSOCIATION_ESTABLISHED] =
@@ -321,6 +394,9 @@ gst_sctp_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_USE_SOCK_STREAM:
       g_value_set_boolean (value, self->use_sock_stream);
       break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_sctp_enc_create_stats (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -425,6 +501,8 @@ gst_sctp_enc_request_new_pad (GstElement * element, GstPadTemplate * template,
       template->direction, "template", template, NULL);
   gst_pad_set_chain_function (new_pad,
       GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_chain));
+  gst_pad_set_chain_list_function (new_pad,
+      GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_chain_list));
   gst_pad_set_event_function (new_pad,
       GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_event));
 
@@ -516,11 +594,37 @@ gst_sctp_enc_srcpad_loop (GstPad * pad)
 
   if (gst_data_queue_pop (self->outbound_sctp_packet_queue, &item)) {
     GstBuffer *buffer = GST_BUFFER (item->object);
+    GstBufferList *list = NULL;
 
-    GST_DEBUG_OBJECT (self, "Forwarding buffer %" GST_PTR_FORMAT, buffer);
-
-    flow_ret = gst_pad_push (self->src_pad, buffer);
     item->object = NULL;
+    item->destroy (item);
+
+    /* Packets that were queued while pushing the previous ones, e.g. the
+     * packets of a batch of messages, are pushed together. This is the only
+     * thread popping from the queue, so it can't become empty meanwhile. */
+    while (!gst_data_queue_is_empty (self->outbound_sctp_packet_queue)
+        && (!list || gst_buffer_list_length (list) < MAX_PACKETS_PER_LIST)) {
+      if (!gst_data_queue_pop (self->outbound_sctp_packet_queue, &item))
+        break;
+
+      if (!list) {
+        list = gst_buffer_list_new_sized (MAX_PACKETS_PER_LIST);
+        gst_buffer_list_add (list, buffer);
+        buffer = NULL;
+      }
+      gst_buffer_list_add (list, GST_BUFFER (item->object));
+      item->object = NULL;
+      item->destroy (item);
+    }
+
+    if (list) {
+      GST_DEBUG_OBJECT (self, "Forwarding %u buffers",
+          gst_buffer_list_length (list));
+      flow_ret = gst_pad_push_list (self->src_pad, list);
+    } else {
+      GST_DEBUG_OBJECT (self, "Forwarding buffer %" GST_PTR_FORMAT, buffer);
+      flow_ret = gst_pad_push (self->src_pad, buffer);
+    }
 
     GST_OBJECT_LOCK (self);
     self->src_ret = flow_ret;
@@ -541,8 +645,6 @@ gst_sctp_enc_srcpad_loop (GstPad * pad)
       gst_data_queue_flush (self->outbound_sctp_packet_queue);
       gst_pad_pause_task (pad);
     }
-
-    item->destroy (item);
   } else {
     GST_OBJECT_LOCK (self);
     self->src_ret = GST_FLOW_FLUSHING;
@@ -569,6 +671,7 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   GstFlowReturn flow_ret = GST_FLOW_ERROR;
   const guint8 *data;
   guint32 length;
+  gboolean sent = FALSE;
 
   GST_OBJECT_LOCK (self);
   if (self->src_ret != GST_FLOW_OK) {
@@ -576,6 +679,12 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         gst_flow_get_name (self->src_ret));
     flow_ret = self->src_ret;
     GST_OBJECT_UNLOCK (self);
+
+    g_mutex_lock (&sctpenc_pad->lock);
+    gst_sctp_enc_pad_account_dropped (sctpenc_pad,
+        gst_buffer_get_size (buffer));
+    g_mutex_unlock (&sctpenc_pad->lock);
+
     gst_buffer_unref (buffer);
     return flow_ret;
   }
@@ -648,9 +757,10 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       GST_TRACE_OBJECT (pad, "Sent only %u of %u remaining bytes, waiting",
           bytes_sent, length);
 
-      sctpenc_pad->bytes_sent += bytes_sent;
+      gst_sctp_enc_pad_account_sent (sctpenc_pad, bytes_sent);
       data += bytes_sent;
       length -= bytes_sent;
+      sctpenc_pad->bytes_queued = length;
 
       /* The buffer was probably full. Retry in a while */
       GST_OBJECT_LOCK (self);
@@ -664,13 +774,18 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       GST_OBJECT_UNLOCK (self);
     } else if (bytes_sent == length) {
       GST_DEBUG_OBJECT (pad, "Successfully sent buffer");
-      sctpenc_pad->bytes_sent += bytes_sent;
+      gst_sctp_enc_pad_account_sent (sctpenc_pad, bytes_sent);
+      sctpenc_pad->messages_sent++;
+      sent = TRUE;
       break;
     }
   }
   flow_ret = sctpenc_pad->flushing ? GST_FLOW_FLUSHING : GST_FLOW_OK;
 
 out:
+  sctpenc_pad->bytes_queued = 0;
+  if (!sent)
+    gst_sctp_enc_pad_account_dropped (sctpenc_pad, map.size);
   g_mutex_unlock (&sctpenc_pad->lock);
 
   gst_buffer_unmap (buffer, &map);
@@ -679,6 +794,52 @@ error:
   return flow_ret;
 }
 
+/* Sends all the messages of the list as one SCTP batch, so that small
+ * messages are bundled in as few SCTP packets as possible */
+static GstFlowReturn
+gst_sctp_enc_sink_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstSctpEnc *self = GST_SCTP_ENC (parent);
+  GstSctpEncPad *sctpenc_pad = GST_SCTP_ENC_PAD (pad);
+  GstFlowReturn flow_ret = GST_FLOW_OK;
+  gboolean batching;
+  guint i, n;
+
+  n = gst_buffer_list_length (list);
+  batching = n > 1;
+
+  if (batching)
+    gst_sctp_association_begin_batch (self->sctp_association);
+
+  for (i = 0; i < n && flow_ret == GST_FLOW_OK; i++) {
+    /* the last message flushes the ones SCTP held back */
+    if (batching && i == n - 1) {
+      gst_sctp_association_end_batch (self->sctp_association);
+      batching = FALSE;
+    }
+
+    flow_ret = gst_sctp_enc_sink_chain (pad, parent,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+  }
+
+  if (batching)
+    gst_sctp_association_end_batch (self->sctp_association);
+
+  /* the rest of the list is lost */
+  if (i < n) {
+    g_mutex_lock (&sctpenc_pad->lock);
+    for (; i < n; i++)
+      gst_sctp_enc_pad_account_dropped (sctpenc_pad,
+          gst_buffer_get_size (gst_buffer_list_get (list, i)));
+    g_mutex_unlock (&sctpenc_pad->lock);
+  }
+
+  gst_buffer_list_unref (list);
+
+  return flow_ret;
+}
+
 static gboolean
 gst_sctp_enc_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -1033,3 +1194,75 @@ on_get_stream_bytes_sent (GstSctpEnc * self, guint stream_id)
 
   return bytes_sent;
 }
+
+static void
+add_stream_stats (const GValue * item, gpointer user_data)
+{
+  GstSctpEncPad *sctpenc_pad = g_value_get_object (item);
+  GstSctpEnc *self =
+      GST_SCTP_ENC (gst_object_get_parent (GST_OBJECT (sctpenc_pad)));
+  GValue *streams = user_data;
+  GValue value = G_VALUE_INIT;
+  GstStructure *stats;
+  guint64 sctp_messages_dropped = 0, sctp_bytes_dropped = 0;
+  gint64 now = g_get_monotonic_time ();
+  gdouble send_rate;
+
+  if (!self)
+    return;
+
+  if (self->sctp_association)
+    gst_sctp_association_get_stream_drops (self->sctp_association,
+        sctpenc_pad->stream_id, &sctp_messages_dropped, &sctp_bytes_dropped);
+
+  g_mutex_lock (&sctpenc_pad->lock);
+  /* nothing sent for a whole window, measure over the time since */
+  if (sctpenc_pad->rate_window_start != 0
+      && now - sctpenc_pad->rate_window_start > SEND_RATE_WINDOW)
+    send_rate = (gdouble) sctpenc_pad->rate_window_bytes * G_USEC_PER_SEC /
+        (now - sctpenc_pad->rate_window_start);
+  else
+    send_rate = sctpenc_pad->send_rate;
+
+  stats = gst_structure_new ("application/x-sctp-enc-stream-stats",
+      "stream-id", G_TYPE_UINT, (guint) sctpenc_pad->stream_id,
+      "messages-sent", G_TYPE_UINT64, sctpenc_pad->messages_sent,
+      "bytes-sent", G_TYPE_UINT64, sctpenc_pad->bytes_sent,
+      "bytes-queued", G_TYPE_UINT64, sctpenc_pad->bytes_queued,
+      "send-rate", G_TYPE_DOUBLE, send_rate,
+      "messages-dropped", G_TYPE_UINT64,
+      sctpenc_pad->messages_dropped + sctp_messages_dropped,
+      "bytes-dropped", G_TYPE_UINT64,
+      sctpenc_pad->bytes_dropped + sctp_bytes_dropped, NULL);
+  g_mutex_unlock (&sctpenc_pad->lock);
+
+  g_value_init (&value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&value, stats);
+  gst_value_array_append_and_take_value (streams, &value);
+
+  gst_object_unref (self);
+}
+
+static GstStructure *
+gst_sctp_enc_create_stats (GstSctpEnc * self)
+{
+  GstStructure *stats;
+  GValue streams = G_VALUE_INIT;
+  GstIterator *it;
+
+  g_value_init (&streams, GST_TYPE_ARRAY);
+
+  it = gst_element_iterate_sink_pads (GST_ELEMENT (self));
+  while (gst_iterator_foreach (it, add_stream_stats,
+          &streams) == GST_ITERATOR_RESYNC) {
+    gst_iterator_resync (it);
+    g_value_unset (&streams);
+    g_value_init (&streams, GST_TYPE_ARRAY);
+  }
+  gst_iterator_free (it);
+
+  stats = gst_structure_new_empty ("application/x-sctp-enc-stats");
+  gst_structure_take_value (stats, "streams", &streams);
+
+  return stats;
+}
@@ -101,6 +101,12 @@ static GHashTable *associations = NULL;
 G_LOCK_DEFINE_STATIC (associations_lock);
 static guint32 number_of_associations = 0;
 
+typedef struct
+{
+  guint64 messages;
+  guint64 bytes;
+} StreamDrops;
+
 /* Interface implementations */
 static void gst_sctp_association_finalize (GObject * object);
 static void gst_sctp_association_set_property (GObject * object, guint prop_id,
@@ -124,6 +130,8 @@ static void handle_association_changed (GstSctpAssociation * self,
     const struct sctp_assoc_change *sac);
 static void handle_stream_reset_event (GstSctpAssociation * self,
     const struct sctp_stream_reset_event *ssr);
+static void handle_send_failed_event (GstSctpAssociation * self,
+    const struct sctp_send_failed_event *ssfe);
 static void handle_message (GstSctpAssociation * self, guint8 * data,
     guint32 datalen, guint16 stream_id, guint32 ppid);
 
@@ -234,6 +242,9 @@ gst_sctp_association_init (GstSctpAssociation * self)
 
   self->state = GST_SCTP_ASSOCIATION_STATE_NEW;
 
+  self->stream_drops =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
   self->use_sock_stream = FALSE;
 
   usrsctp_register_address ((void *) self);
@@ -255,6 +266,8 @@ gst_sctp_association_finalize (GObject * object)
   }
   G_UNLOCK (associations_lock);
 
+  g_hash_table_unref (self->stream_drops);
+
   G_OBJECT_CLASS (gst_sctp_association_parent_class)->finalize (object);
 }
 
@@ -538,6 +551,63 @@ end:
   return flow_ret;
 }
 
+/* Called with the association mutex */
+static void
+set_nodelay (GstSctpAssociation * self, gboolean nodelay)
+{
+  int value = nodelay ? 1 : 0;
+
+  if (!self->sctp_ass_sock)
+    return;
+
+  if (usrsctp_setsockopt (self->sctp_ass_sock, IPPROTO_SCTP, SCTP_NODELAY,
+          &value, sizeof (int))) {
+    GST_WARNING_OBJECT (self, "Could not set SCTP_NODELAY to %d: (%u) %s",
+        value, errno, g_strerror (errno));
+  }
+}
+
+/* Messages sent between gst_sctp_association_begin_batch() and
+ * gst_sctp_association_end_batch() may be held back by SCTP while some data
+ * is in flight, so that several of them are bundled in one SCTP packet. The
+ * last message of the batch must be sent after
+ * gst_sctp_association_end_batch() so that everything held back goes out
+ * with it. Batches from several streams can overlap. */
+void
+gst_sctp_association_begin_batch (GstSctpAssociation * self)
+{
+  g_mutex_lock (&self->association_mutex);
+  if (self->batches++ == 0)
+    set_nodelay (self, FALSE);
+  g_mutex_unlock (&self->association_mutex);
+}
+
+void
+gst_sctp_association_end_batch (GstSctpAssociation * self)
+{
+  g_mutex_lock (&self->association_mutex);
+  g_assert (self->batches > 0);
+  if (--self->batches == 0)
+    set_nodelay (self, TRUE);
+  g_mutex_unlock (&self->association_mutex);
+}
+
+/* Returns the number and size of the messages of @stream_id that SCTP gave
+ * up sending, e.g. because of their partial reliability parameters */
+void
+gst_sctp_association_get_stream_drops (GstSctpAssociation * self,
+    guint16 stream_id, guint64 * messages_dropped, guint64 * bytes_dropped)
+{
+  StreamDrops *drops;
+
+  g_mutex_lock (&self->association_mutex);
+  drops = g_hash_table_lookup (self->stream_drops,
+      GUINT_TO_POINTER (stream_id));
+  *messages_dropped = drops ? drops->messages : 0;
+  *bytes_dropped = drops ? drops->bytes : 0;
+  g_mutex_unlock (&self->association_mutex);
+}
+
 void
 gst_sctp_association_reset_stream (GstSctpAssociation * self, guint16 stream_id)
 {
@@ -866,6 +936,7 @@ handle_notification (GstSctpAssociation * self,
     case SCTP_SEND_FAILED_EVENT:
       GST_ERROR_OBJECT (self, "Event: SCTP_SEND_FAILED_EVENT (%u)",
           notification->sn_send_failed_event.ssfe_error);
+      handle_send_failed_event (self, &notification->sn_send_failed_event);
       break;
     default:
       break;
@@ -936,6 +1007,28 @@ handle_stream_reset_event (GstSctpAssociation * self,
   }
 }
 
+static void
+handle_send_failed_event (GstSctpAssociation * self,
+    const struct sctp_send_failed_event *ssfe)
+{
+  guint16 stream_id = ssfe->ssfe_info.snd_sid;
+  StreamDrops *drops;
+
+  g_mutex_lock (&self->association_mutex);
+  drops = g_hash_table_lookup (self->stream_drops,
+      GUINT_TO_POINTER (stream_id));
+  if (!drops) {
+    drops = g_new0 (StreamDrops, 1);
+    g_hash_table_insert (self->stream_drops, GUINT_TO_POINTER (stream_id),
+        drops);
+  }
+  drops->messages++;
+  /* the notification carries the undelivered data */
+  if (ssfe->ssfe_length > sizeof (struct sctp_send_failed_event))
+    drops->bytes += ssfe->ssfe_length - sizeof (struct sctp_send_failed_event);
+  g_mutex_unlock (&self->association_mutex);
+}
+
 static void
 handle_message (GstSctpAssociation * self, guint8 * data, guint32 datalen,
     guint16 stream_id, guint32 ppid)
@@ -90,6 +90,11 @@ struct _GstSctpAssociation
   GstSctpAssociationPacketOutCb packet_out_cb;
   gpointer packet_out_user_data;
   GDestroyNotify packet_out_destroy_notify;
+
+  /* number of batches being sent, Nagle is enabled while not 0 */
+  guint batches;
+  /* stream id -> messages abandoned by SCTP */
+  GHashTable *stream_drops;
 };
 
 struct _GstSctpAssociationClass
@@ -115,6 +120,10 @@ GstFlowReturn gst_sctp_association_send_data (GstSctpAssociation * self,
     const guint8 * buf, guint32 length, guint16 stream_id, guint32 ppid,
     gboolean ordered, GstSctpAssociationPartialReliability pr,
     guint32 reliability_param, guint32 *bytes_sent);
+void gst_sctp_association_begin_batch (GstSctpAssociation * self);
+void gst_sctp_association_end_batch (GstSctpAssociation * self);
+void gst_sctp_association_get_stream_drops (GstSctpAssociation * self,
+    guint16 stream_id, guint64 * messages_dropped, guint64 * bytes_dropped);
 void gst_sctp_association_reset_stream (GstSctpAssociation * self,
     guint16 stream_id);
 void gst_sctp_association_force_close (GstSctpAssociation * self);
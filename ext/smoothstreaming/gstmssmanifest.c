@@ -1050,34 +1050,70 @@ gst_mss_stream_get_caps (GstMssStream * stream)
   return caps;
 }
 
-GstFlowReturn
-gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+static gchar *
+gst_mss_stream_build_fragment_url (GstMssStream * stream,
+    GstMssStreamFragment * fragment, guint repetition_index)
 {
-  gchar *tmp;
+  gchar *tmp, *url;
   gchar *start_time_str;
   guint64 time;
-  GstMssStreamFragment *fragment;
   GstMssStreamQuality *quality = stream->current_quality->data;
 
-  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
-
-  if (stream->current_fragment == NULL) /* stream is over */
-    return GST_FLOW_EOS;
-
-  fragment = stream->current_fragment->data;
-
-  time =
-      fragment->time + fragment->duration * stream->fragment_repetition_index;
+  time = fragment->time + fragment->duration * repetition_index;
   start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
 
   tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
       strlen (stream->url), 0, quality->bitrate_str, 0, NULL);
-  *url = g_regex_replace_literal (stream->regex_position, tmp,
+  url = g_regex_replace_literal (stream->regex_position, tmp,
       strlen (tmp), 0, start_time_str, 0, NULL);
 
   g_free (tmp);
   g_free (start_time_str);
 
+  return url;
+}
+
+GstFlowReturn
+gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+{
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  if (stream->current_fragment == NULL) /* stream is over */
+    return GST_FLOW_EOS;
+
+  *url = gst_mss_stream_build_fragment_url (stream,
+      stream->current_fragment->data, stream->fragment_repetition_index);
+  if (*url == NULL)
+    return GST_FLOW_ERROR;
+
+  return GST_FLOW_OK;
+}
+
+/* Like gst_mss_stream_get_fragment_url(), for the @n-th fragment after the
+ * current one, without advancing */
+GstFlowReturn
+gst_mss_stream_peek_fragment_url (GstMssStream * stream, guint n, gchar ** url)
+{
+  GList *iter = stream->current_fragment;
+  guint repetition_index = stream->fragment_repetition_index;
+  GstMssStreamFragment *fragment;
+
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  /* same steps as gst_mss_stream_advance_fragment() */
+  while (iter && n-- > 0) {
+    fragment = iter->data;
+    if (++repetition_index >= fragment->repetitions) {
+      repetition_index = 0;
+      iter = g_list_next (iter);
+    }
+  }
+
+  if (iter == NULL)
+    return GST_FLOW_EOS;
+
+  *url = gst_mss_stream_build_fragment_url (stream, iter->data,
+      repetition_index);
   if (*url == NULL)
     return GST_FLOW_ERROR;
 
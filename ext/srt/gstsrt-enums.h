@@ -62,6 +62,22 @@ typedef enum
   GST_SRT_KEY_LENGTH_32 = 32,
 } GstSRTKeyLength;
 
+/**
+ * GstSRTCallerBacklogAction:
+ * @GST_SRT_CALLER_BACKLOG_ACTION_SKIP: skip buffers for the caller until it
+ *   caught up
+ * @GST_SRT_CALLER_BACKLOG_ACTION_DISCONNECT: disconnect the caller
+ *
+ * What to do with a caller that is too far behind the stream.
+ *
+ * Since: 1.20
+ */
+typedef enum
+{
+  GST_SRT_CALLER_BACKLOG_ACTION_SKIP,
+  GST_SRT_CALLER_BACKLOG_ACTION_DISCONNECT,
+} GstSRTCallerBacklogAction;
+
 G_END_DECLS
 
 #endif // __GST_SRT_ENUM_H__
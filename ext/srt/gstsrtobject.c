@@ -56,6 +56,12 @@ GST_DEBUG_CATEGORY_EXTERN (gst_debug_srtobject);
   GST_ELEMENT_WARNING (srtobject->element, RESOURCE, code, \
   ("Error on SRT socket. Trying to reconnect."), SRTSOCK_ERROR_DEBUG)
 
+/* How long to wait for the queued data to be sent out on EOS */
+#define DRAIN_TIMEOUT (2 * G_TIME_SPAN_SECOND)
+/* SRT doesn't tell when its send buffer is empty, it is checked again after
+ * this interval while it still holds data */
+#define DRAIN_SRT_BUFFER_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
 enum
 {
   PROP_URI = 1,
@@ -71,15 +77,38 @@ enum
   PROP_WAIT_FOR_CONNECTION,
   PROP_STREAMID,
   PROP_AUTHENTICATION,
+  PROP_CALLER_BACKLOG,
+  PROP_CALLER_BACKLOG_ACTION,
   PROP_LAST
 };
 
 typedef struct
 {
+  /* Written with both the sock_lock and the caller lock held once the send
+   * thread runs, which reads it with the caller lock */
   SRTSOCKET sock;
   gint poll_id;
   GSocketAddress *sockaddr;
   gboolean sent_headers;
+
+  /* In listener mode, each caller of a sink is written to from its own
+   * thread so that a slow caller doesn't hold back the others */
+  GstSRTObject *srtobject;
+  GThread *thread;
+  gint payload_size;
+
+  /* Protects the fields below */
+  GMutex lock;
+  GCond cond;
+  /* GBytes waiting to be sent */
+  GQueue queue;
+  gsize queued_bytes;
+  gboolean stopping;
+  /* a message has been popped from the queue but not handed to SRT yet */
+  gboolean sending;
+  gboolean failed;
+  guint64 buffers_dropped;
+  guint64 bytes_dropped;
 } SRTCaller;
 
 static GstStructure *gst_srt_object_accumulate_stats (GstSRTObject * srtobject,
@@ -93,14 +122,138 @@ srt_caller_new (void)
   caller->poll_id = SRT_ERROR;
   caller->sent_headers = FALSE;
 
+  g_mutex_init (&caller->lock);
+  g_cond_init (&caller->cond);
+  g_queue_init (&caller->queue);
+
   return caller;
 }
 
+/* Wakes up gst_srt_object_drain(), called without any other lock */
+static void
+gst_srt_object_notify_drain (GstSRTObject * srtobject)
+{
+  g_mutex_lock (&srtobject->drain_lock);
+  srtobject->drain_cookie++;
+  g_cond_broadcast (&srtobject->drain_cond);
+  g_mutex_unlock (&srtobject->drain_lock);
+}
+
+static gpointer
+srt_caller_send_func (SRTCaller * caller)
+{
+  g_mutex_lock (&caller->lock);
+  for (;;) {
+    GBytes *bytes;
+    const guint8 *msg;
+    gsize size, len = 0;
+    SRTSOCKET sock;
+
+    while (!caller->stopping && g_queue_is_empty (&caller->queue))
+      g_cond_wait (&caller->cond, &caller->lock);
+
+    if (caller->stopping)
+      break;
+
+    bytes = g_queue_pop_head (&caller->queue);
+    caller->queued_bytes -= g_bytes_get_size (bytes);
+    caller->sending = TRUE;
+    sock = caller->sock;
+    g_mutex_unlock (&caller->lock);
+
+    msg = g_bytes_get_data (bytes, &size);
+    while (len < size) {
+      gint rest = MIN (size - len, caller->payload_size);
+      gint sent = srt_sendmsg2 (sock, (char *) (msg + len), rest, 0);
+
+      if (sent < 0) {
+        GST_WARNING_OBJECT (caller->srtobject->element,
+            "Dropping caller %d: %s", sock, srt_getlasterror_str ());
+        g_bytes_unref (bytes);
+        g_mutex_lock (&caller->lock);
+        caller->sending = FALSE;
+        caller->failed = TRUE;
+        goto done;
+      }
+      len += sent;
+    }
+
+    g_bytes_unref (bytes);
+    g_mutex_lock (&caller->lock);
+    caller->sending = FALSE;
+
+    if (g_queue_is_empty (&caller->queue)) {
+      g_mutex_unlock (&caller->lock);
+      gst_srt_object_notify_drain (caller->srtobject);
+      g_mutex_lock (&caller->lock);
+    }
+  }
+
+done:
+  g_mutex_unlock (&caller->lock);
+
+  /* a drain doesn't wait for a failed caller */
+  gst_srt_object_notify_drain (caller->srtobject);
+
+  return NULL;
+}
+
+static gboolean
+srt_caller_start (SRTCaller * caller, GstSRTObject * srtobject)
+{
+  gint optlen = 1;
+  GError *error = NULL;
+
+  if (srt_getsockflag (caller->sock, SRTO_PAYLOADSIZE, &caller->payload_size,
+          &optlen)) {
+    GST_WARNING_OBJECT (srtobject->element, "%s", srt_getlasterror_str ());
+    return FALSE;
+  }
+
+  caller->srtobject = srtobject;
+  caller->thread = g_thread_try_new ("GstSRTObjectCaller",
+      (GThreadFunc) srt_caller_send_func, caller, &error);
+  if (!caller->thread) {
+    GST_WARNING_OBJECT (srtobject->element,
+        "Failed to start the thread for caller %d: %s", caller->sock,
+        error->message);
+    g_clear_error (&error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 static void
 srt_caller_free (SRTCaller * caller)
 {
+  GBytes *bytes;
+
   g_return_if_fail (caller != NULL);
 
+  if (caller->thread) {
+    SRTSOCKET sock;
+
+    g_mutex_lock (&caller->lock);
+    caller->stopping = TRUE;
+    sock = caller->sock;
+    caller->sock = SRT_INVALID_SOCK;
+    g_cond_signal (&caller->cond);
+    g_mutex_unlock (&caller->lock);
+
+    /* wakes up the thread if it's blocked sending */
+    srt_close (sock);
+
+    g_thread_join (caller->thread);
+    caller->thread = NULL;
+  }
+
+  while ((bytes = g_queue_pop_head (&caller->queue)))
+    g_bytes_unref (bytes);
+
+  g_mutex_clear (&caller->lock);
+  g_cond_clear (&caller->cond);
+
   g_clear_object (&caller->sockaddr);
 
   if (caller->sock != SRT_INVALID_SOCK) {
@@ -366,8 +519,12 @@ gst_srt_object_new (GstElement * element)
   srtobject->listener_poll_id = SRT_ERROR;
   srtobject->sent_headers = FALSE;
   srtobject->wait_for_connection = GST_SRT_DEFAULT_WAIT_FOR_CONNECTION;
+  srtobject->caller_backlog = GST_SRT_DEFAULT_CALLER_BACKLOG;
+  srtobject->caller_backlog_action = GST_SRT_DEFAULT_CALLER_BACKLOG_ACTION;
 
   g_cond_init (&srtobject->sock_cond);
+  g_mutex_init (&srtobject->drain_lock);
+  g_cond_init (&srtobject->drain_cond);
   return srtobject;
 }
 
@@ -382,6 +539,8 @@ gst_srt_object_destroy (GstSRTObject * srtobject)
   }
 
   g_cond_clear (&srtobject->sock_cond);
+  g_mutex_clear (&srtobject->drain_lock);
+  g_cond_clear (&srtobject->drain_cond);
 
   GST_DEBUG_OBJECT (srtobject->element, "Destroying srtobject");
   gst_structure_free (srtobject->parameters);
@@ -437,6 +596,14 @@ gst_srt_object_set_property_helper (GstSRTObject * srtobject,
     case PROP_AUTHENTICATION:
       srtobject->authentication = g_value_get_boolean (value);
       break;
+    case PROP_CALLER_BACKLOG:
+      /* read by gst_srt_object_write_to_callers() under the object lock,
+       * which is held for the whole switch */
+      srtobject->caller_backlog = g_value_get_uint (value);
+      break;
+    case PROP_CALLER_BACKLOG_ACTION:
+      srtobject->caller_backlog_action = g_value_get_enum (value);
+      break;
     default:
       goto err;
   }
@@ -544,6 +711,16 @@ gst_srt_object_get_property_helper (GstSRTObject * srtobject,
     case PROP_AUTHENTICATION:
       g_value_set_boolean (value, srtobject->authentication);
       break;
+    case PROP_CALLER_BACKLOG:
+      GST_OBJECT_LOCK (srtobject->element);
+      g_value_set_uint (value, srtobject->caller_backlog);
+      GST_OBJECT_UNLOCK (srtobject->element);
+      break;
+    case PROP_CALLER_BACKLOG_ACTION:
+      GST_OBJECT_LOCK (srtobject->element);
+      g_value_set_enum (value, srtobject->caller_backlog_action);
+      GST_OBJECT_UNLOCK (srtobject->element);
+      break;
     default:
       return FALSE;
   }
@@ -596,6 +773,8 @@ gst_srt_object_install_properties_helper (GObjectClass * gobject_class)
    * GstSRTSrc:localport:
    *
    * The local port to bind when #GstSRTSrc:mode is listener or rendezvous.
+   * When 0, a listener binds to a port picked by the system, which is
+   * reported by this property once the socket is opened.
    * This property can be set by URI parameters.
    */
   g_object_class_install_property (gobject_class, PROP_LOCALPORT,
@@ -659,6 +838,10 @@ gst_srt_object_install_properties_helper (GObjectClass * gobject_class)
    * GstSRTSrc:stats:
    *
    * The statistics from SRT.
+   *
+   * In listener mode, the "callers" field holds the statistics of each
+   * caller. For a sink, they include the backlog of the caller and the
+   * buffers skipped because of #GstSRTSink:caller-backlog.
    */
   g_object_class_install_property (gobject_class, PROP_STATS,
       g_param_spec_boxed ("stats", "Statistics",
@@ -706,6 +889,42 @@ gst_srt_object_install_properties_helper (GObjectClass * gobject_class)
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
+/* The properties that only apply to sending */
+void
+gst_srt_object_install_sink_properties_helper (GObjectClass * gobject_class)
+{
+  /**
+   * GstSRTSink:caller-backlog:
+   *
+   * In listener mode, the maximum number of buffers waiting to be sent to a
+   * caller. Each caller is sent to at its own pace, and
+   * #GstSRTSink:caller-backlog-action is applied to the callers that are
+   * further behind. 0 for unlimited.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_CALLER_BACKLOG,
+      g_param_spec_uint ("caller-backlog", "Caller backlog",
+          "Maximum number of buffers waiting to be sent to a caller "
+          "(0 = unlimited)", 0, G_MAXUINT, GST_SRT_DEFAULT_CALLER_BACKLOG,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSRTSink:caller-backlog-action:
+   *
+   * What to do with a caller whose backlog is full.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_CALLER_BACKLOG_ACTION,
+      g_param_spec_enum ("caller-backlog-action", "Caller backlog action",
+          "What to do with a caller whose backlog is full",
+          GST_TYPE_SRT_CALLER_BACKLOG_ACTION,
+          GST_SRT_DEFAULT_CALLER_BACKLOG_ACTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  gst_type_mark_as_plugin_api (GST_TYPE_SRT_CALLER_BACKLOG_ACTION, 0);
+}
+
 static void
 gst_srt_object_set_enum_value (GstStructure * s, GType enum_type,
     gconstpointer key, gconstpointer value)
@@ -1117,6 +1336,33 @@ gst_srt_object_wait_connect (GstSRTObject * srtobject,
     goto failed;
   }
 
+  /* Report the port picked by the system through the localport property */
+  if (local_port == 0) {
+    union
+    {
+      struct sockaddr_storage ss;
+      struct sockaddr sa;
+    } local_sa;
+    int local_sa_len = sizeof (local_sa);
+
+    if (srt_getsockname (sock, &local_sa.sa, &local_sa_len) != SRT_ERROR) {
+      GSocketAddress *local_addr =
+          g_socket_address_new_from_native (&local_sa.sa, local_sa_len);
+
+      if (G_IS_INET_SOCKET_ADDRESS (local_addr)) {
+        local_port =
+            g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local_addr));
+        GST_DEBUG_OBJECT (srtobject->element, "Bound to port %d", local_port);
+
+        GST_OBJECT_LOCK (srtobject->element);
+        gst_structure_set (srtobject->parameters, "localport", G_TYPE_UINT,
+            local_port, NULL);
+        GST_OBJECT_UNLOCK (srtobject->element);
+      }
+      g_clear_object (&local_addr);
+    }
+  }
+
   if (srt_epoll_add_usock (srtobject->listener_poll_id, sock, &sock_flags)) {
     g_set_error (error, GST_LIBRARY_ERROR, GST_LIBRARY_ERROR_SETTINGS, "%s",
         srt_getlasterror_str ());
@@ -1610,6 +1856,115 @@ gst_srt_object_wakeup (GstSRTObject * srtobject, GCancellable * cancellable)
   g_cancellable_cancel (cancellable);
   g_cond_signal (&srtobject->sock_cond);
   g_mutex_unlock (&srtobject->sock_lock);
+
+  gst_srt_object_notify_drain (srtobject);
+}
+
+static gboolean
+srt_sock_is_sending (SRTSOCKET sock)
+{
+  size_t blocks = 0, bytes = 0;
+
+  if (sock == SRT_INVALID_SOCK)
+    return FALSE;
+
+  if (srt_getsndbuffer (sock, &blocks, &bytes) < 0)
+    return FALSE;
+
+  return bytes > 0;
+}
+
+/* called with sock_lock, @queued is set if the send thread of a caller
+ * still has data to hand to SRT */
+static gboolean
+gst_srt_object_is_sending (GstSRTObject * srtobject, gboolean * queued)
+{
+  GList *callers;
+
+  *queued = FALSE;
+
+  if (srt_sock_is_sending (srtobject->sock))
+    return TRUE;
+
+  for (callers = srtobject->callers; callers; callers = callers->next) {
+    SRTCaller *caller = callers->data;
+    gboolean sending;
+
+    if (!caller->thread)
+      continue;
+
+    g_mutex_lock (&caller->lock);
+    /* a failed caller will never drain, don't wait for it */
+    sending = !caller->failed && (caller->sending ||
+        !g_queue_is_empty (&caller->queue));
+    g_mutex_unlock (&caller->lock);
+
+    if (sending) {
+      *queued = TRUE;
+      return TRUE;
+    }
+
+    if (!caller->failed && srt_sock_is_sending (caller->sock))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Waits until the data queued for the peers has been sent out, the
+ * cancellable is cancelled or DRAIN_TIMEOUT has passed. Returns TRUE
+ * if everything was sent. */
+gboolean
+gst_srt_object_drain (GstSRTObject * srtobject, GCancellable * cancellable)
+{
+  gint64 end_time = g_get_monotonic_time () + DRAIN_TIMEOUT;
+
+  GST_DEBUG_OBJECT (srtobject->element, "draining");
+
+  for (;;) {
+    gboolean sending, queued;
+    gint64 wait_end_time;
+    guint cookie;
+
+    /* anything happening after this is noticed by the wait below */
+    g_mutex_lock (&srtobject->drain_lock);
+    cookie = srtobject->drain_cookie;
+    g_mutex_unlock (&srtobject->drain_lock);
+
+    g_mutex_lock (&srtobject->sock_lock);
+    sending = gst_srt_object_is_sending (srtobject, &queued);
+    g_mutex_unlock (&srtobject->sock_lock);
+
+    if (!sending) {
+      GST_DEBUG_OBJECT (srtobject->element, "drained");
+      return TRUE;
+    }
+
+    if (g_cancellable_is_cancelled (cancellable)) {
+      GST_DEBUG_OBJECT (srtobject->element, "flushing, not draining");
+      return FALSE;
+    }
+
+    if (g_get_monotonic_time () >= end_time) {
+      GST_WARNING_OBJECT (srtobject->element,
+          "Timed out waiting for the queued data to be sent");
+      return FALSE;
+    }
+
+    /* woken up when a caller emptied its queue or failed, or by unlock().
+     * The sock_lock is not held so that the listener can keep accepting
+     * callers meanwhile */
+    wait_end_time = end_time;
+    if (!queued)
+      wait_end_time = MIN (end_time,
+          g_get_monotonic_time () + DRAIN_SRT_BUFFER_INTERVAL);
+
+    g_mutex_lock (&srtobject->drain_lock);
+    if (srtobject->drain_cookie == cookie)
+      g_cond_wait_until (&srtobject->drain_cond, &srtobject->drain_lock,
+          wait_end_time);
+    g_mutex_unlock (&srtobject->drain_lock);
+  }
 }
 
 static gboolean
@@ -1665,21 +2020,50 @@ gst_srt_object_send_headers (GstSRTObject * srtobject, SRTSOCKET sock,
   return TRUE;
 }
 
+/* Queues a copy of @headers to be sent to @caller, called with the caller
+ * lock */
+static void
+srt_caller_queue_headers (SRTCaller * caller, GstBufferList * headers)
+{
+  guint size, i;
+
+  if (!headers)
+    return;
+
+  size = gst_buffer_list_length (headers);
+
+  GST_DEBUG_OBJECT (caller->srtobject->element,
+      "Queueing %u stream headers for caller %d", size, caller->sock);
+
+  for (i = 0; i < size; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (headers, i);
+    gsize len = gst_buffer_get_size (buffer);
+    gpointer data = g_malloc (len);
+
+    gst_buffer_extract (buffer, 0, data, len);
+    g_queue_push_tail (&caller->queue, g_bytes_new_take (data, len));
+    caller->queued_bytes += len;
+  }
+}
+
 static gssize
 gst_srt_object_write_to_callers (GstSRTObject * srtobject,
     GstBufferList * headers,
     const GstMapInfo * mapinfo, GCancellable * cancellable, GError ** error)
 {
   GList *callers;
+  GBytes *bytes = NULL;
+  guint backlog;
+  GstSRTCallerBacklogAction backlog_action;
+
+  GST_OBJECT_LOCK (srtobject->element);
+  backlog = srtobject->caller_backlog;
+  backlog_action = srtobject->caller_backlog_action;
+  GST_OBJECT_UNLOCK (srtobject->element);
 
   g_mutex_lock (&srtobject->sock_lock);
   callers = srtobject->callers;
   while (callers != NULL) {
-    gssize len = 0;
-    const guint8 *msg = mapinfo->data;
-    gint sent;
-    gint payload_size, optlen = 1;
-
     SRTCaller *caller = callers->data;
     callers = callers->next;
 
@@ -1687,31 +2071,48 @@ gst_srt_object_write_to_callers (GstSRTObject * srtobject,
       goto cancelled;
     }
 
-    if (!caller->sent_headers) {
-      if (!gst_srt_object_send_headers (srtobject, caller->sock, -1,
-              -1, headers, cancellable)) {
-        goto err;
-      }
-      caller->sent_headers = TRUE;
+    if (!caller->thread && !srt_caller_start (caller, srtobject)) {
+      goto err;
     }
 
-    if (srt_getsockflag (caller->sock, SRTO_PAYLOADSIZE, &payload_size,
-            &optlen)) {
-      GST_WARNING_OBJECT (srtobject->element, "%s", srt_getlasterror_str ());
+    g_mutex_lock (&caller->lock);
+
+    if (caller->failed) {
+      g_mutex_unlock (&caller->lock);
       goto err;
     }
 
-    while (len < mapinfo->size) {
-      gint rest = MIN (mapinfo->size - len, payload_size);
-      sent = srt_sendmsg2 (caller->sock, (char *) (msg + len), rest, 0);
-      if (sent < 0) {
-        GST_WARNING_OBJECT (srtobject->element, "Dropping caller %d: %s",
-            caller->sock, srt_getlasterror_str ());
+    if (!caller->sent_headers) {
+      srt_caller_queue_headers (caller, headers);
+      caller->sent_headers = TRUE;
+    }
+
+    if (backlog > 0 && g_queue_get_length (&caller->queue) >= backlog) {
+      if (backlog_action == GST_SRT_CALLER_BACKLOG_ACTION_DISCONNECT) {
+        GST_WARNING_OBJECT (srtobject->element,
+            "Dropping caller %d: %u buffers behind", caller->sock, backlog);
+        g_mutex_unlock (&caller->lock);
         goto err;
       }
-      len += sent;
+
+      GST_LOG_OBJECT (srtobject->element,
+          "Skipping buffer for caller %d: %u buffers behind", caller->sock,
+          backlog);
+      caller->buffers_dropped++;
+      caller->bytes_dropped += mapinfo->size;
+      g_mutex_unlock (&caller->lock);
+      continue;
     }
 
+    /* the same copy of the data is shared by all the callers */
+    if (!bytes)
+      bytes = g_bytes_new (mapinfo->data, mapinfo->size);
+
+    g_queue_push_tail (&caller->queue, g_bytes_ref (bytes));
+    caller->queued_bytes += mapinfo->size;
+    g_cond_signal (&caller->cond);
+    g_mutex_unlock (&caller->lock);
+
     continue;
 
   err:
@@ -1721,10 +2122,18 @@ gst_srt_object_write_to_callers (GstSRTObject * srtobject,
   }
 
   g_mutex_unlock (&srtobject->sock_lock);
+
+  if (bytes)
+    g_bytes_unref (bytes);
+
   return mapinfo->size;
 
 cancelled:
   g_mutex_unlock (&srtobject->sock_lock);
+
+  if (bytes)
+    g_bytes_unref (bytes);
+
   return -1;
 }
 
@@ -1889,7 +2298,11 @@ get_stats_for_srtsock (SRTSOCKET srtsock, gboolean is_sender, guint64 * bytes)
           "send-rate-mbps", G_TYPE_DOUBLE, stats.mbpsSendRate,
           /* busy sending time (i.e., idle time exclusive) */
           "send-duration-us", G_TYPE_UINT64, stats.usSndDuration,
-          "negotiated-latency-ms", G_TYPE_INT, stats.msSndTsbPdDelay, NULL);
+          "negotiated-latency-ms", G_TYPE_INT, stats.msSndTsbPdDelay,
+          /* occupancy of the send buffer */
+          "send-buffer-packets", G_TYPE_INT, stats.pktSndBuf,
+          "send-buffer-bytes", G_TYPE_INT, stats.byteSndBuf,
+          "send-buffer-ms", G_TYPE_INT, stats.msSndBuf, NULL);
       *bytes += stats.byteSent;
     } else {
       gst_structure_set (s,
@@ -1949,6 +2362,18 @@ gst_srt_object_get_stats (GstSRTObject * srtobject)
       gst_structure_set (tmp, "caller-address", G_TYPE_SOCKET_ADDRESS,
           caller->sockaddr, NULL);
 
+      if (is_sender) {
+        g_mutex_lock (&caller->lock);
+        gst_structure_set (tmp,
+            /* buffers waiting to be handed to the SRT socket */
+            "backlog-buffers", G_TYPE_UINT, g_queue_get_length (&caller->queue),
+            "backlog-bytes", G_TYPE_UINT64, (guint64) caller->queued_bytes,
+            /* buffers skipped because the backlog was full */
+            "buffers-dropped", G_TYPE_UINT64, caller->buffers_dropped,
+            "bytes-dropped", G_TYPE_UINT64, caller->bytes_dropped, NULL);
+        g_mutex_unlock (&caller->lock);
+      }
+
       g_value_array_append (callers_stats, NULL);
       v = g_value_array_get_nth (callers_stats, callers_stats->n_values - 1);
       g_value_init (v, GST_TYPE_STRUCTURE);
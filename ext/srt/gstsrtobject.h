@@ -42,6 +42,8 @@ G_BEGIN_DECLS
 #define GST_SRT_DEFAULT_LATENCY 125
 #define GST_SRT_DEFAULT_MSG_SIZE 1316
 #define GST_SRT_DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define GST_SRT_DEFAULT_CALLER_BACKLOG 1000
+#define GST_SRT_DEFAULT_CALLER_BACKLOG_ACTION GST_SRT_CALLER_BACKLOG_ACTION_SKIP
 
 typedef struct _GstSRTObject GstSRTObject;
 
@@ -68,10 +70,20 @@ struct _GstSRTObject
 
   GList                        *callers;
 
+  /* Signalled when the send threads of the callers made progress, or on
+   * unlock(), drain_cookie is incremented each time */
+  GMutex                        drain_lock;
+  GCond                         drain_cond;
+  guint                         drain_cookie;
+
   gboolean                     wait_for_connection;
 
   gboolean                     authentication;
 
+  /* Protected by the element's object lock */
+  guint                        caller_backlog;
+  GstSRTCallerBacklogAction    caller_backlog_action;
+
   guint64                      previous_bytes;
 };
 
@@ -95,6 +107,8 @@ gboolean        gst_srt_object_get_property_helper (GstSRTObject *srtobject,
 
 void            gst_srt_object_install_properties_helper (GObjectClass *gobject_class);
 
+void            gst_srt_object_install_sink_properties_helper (GObjectClass *gobject_class);
+
 gboolean        gst_srt_object_set_uri (GstSRTObject * srtobject, const gchar *uri, GError ** err);
 
 gssize          gst_srt_object_read     (GstSRTObject * srtobject,
@@ -112,6 +126,9 @@ gssize          gst_srt_object_write    (GstSRTObject * srtobject,
 void            gst_srt_object_wakeup   (GstSRTObject * srtobject,
                                          GCancellable *cancellable);
 
+gboolean        gst_srt_object_drain    (GstSRTObject * srtobject,
+                                         GCancellable *cancellable);
+
 GstStructure   *gst_srt_object_get_stats        (GstSRTObject * srtobject);
 
 G_END_DECLS
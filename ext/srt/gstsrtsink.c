@@ -240,6 +240,24 @@ gst_srt_sink_unlock_stop (GstBaseSink * bsink)
   return TRUE;
 }
 
+static gboolean
+gst_srt_sink_event (GstBaseSink * bsink, GstEvent * event)
+{
+  GstSRTSink *self = GST_SRT_SINK (bsink);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      /* give the queued data a chance to reach the peers before they
+       * are closed, unless we're flushing */
+      gst_srt_object_drain (self->srtobject, self->cancellable);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
+}
+
 static gboolean
 gst_srt_sink_set_caps (GstBaseSink * bsink, GstCaps * caps)
 {
@@ -365,6 +383,7 @@ gst_srt_sink_class_init (GstSRTSinkClass * klass)
       2, G_TYPE_SOCKET_ADDRESS, G_TYPE_STRING);
 
   gst_srt_object_install_properties_helper (gobject_class);
+  gst_srt_object_install_sink_properties_helper (gobject_class);
 
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
   gst_element_class_set_metadata (gstelement_class,
@@ -378,6 +397,7 @@ gst_srt_sink_class_init (GstSRTSinkClass * klass)
   gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_sink_unlock);
   gstbasesink_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_srt_sink_unlock_stop);
   gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_srt_sink_set_caps);
+  gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_srt_sink_event);
 
 }
 
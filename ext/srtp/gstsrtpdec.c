@@ -207,6 +207,10 @@ static GstFlowReturn gst_srtp_dec_chain_rtp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
 static GstFlowReturn gst_srtp_dec_chain_rtcp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static GstFlowReturn gst_srtp_dec_chain_list_rtp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
+static GstFlowReturn gst_srtp_dec_chain_list_rtcp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
 
 static GstStateChangeReturn gst_srtp_dec_change_state (GstElement * element,
     GstStateChange transition);
@@ -379,6 +383,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtp));
   gst_pad_set_chain_function (filter->rtp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtp));
+  gst_pad_set_chain_list_function (filter->rtp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtp));
 
   filter->rtp_srcpad =
       gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
@@ -402,6 +408,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtcp));
   gst_pad_set_chain_function (filter->rtcp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtcp));
+  gst_pad_set_chain_list_function (filter->rtcp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtcp));
 
   filter->rtcp_srcpad =
       gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
@@ -513,6 +521,8 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
   stream = g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
 
   if (stream) {
+    if (filter->last_stream == stream)
+      filter->last_stream = NULL;
     srtp_remove_stream (filter->session, ssrc);
     g_hash_table_remove (filter->streams, GUINT_TO_POINTER (ssrc));
   }
@@ -521,7 +531,16 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
 static GstSrtpDecSsrcStream *
 find_stream_by_ssrc (GstSrtpDec * filter, guint32 ssrc)
 {
-  return g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
+  GstSrtpDecSsrcStream *stream;
+
+  if (filter->last_stream && filter->last_stream->ssrc == ssrc)
+    return filter->last_stream;
+
+  stream = g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
+  if (stream)
+    filter->last_stream = stream;
+
+  return stream;
 }
 
 #ifdef HAVE_SRTP2
@@ -963,6 +982,7 @@ gst_srtp_dec_clear_streams (GstSrtpDec * filter)
     filter->session = NULL;
   }
 
+  filter->last_stream = NULL;
   if (filter->streams)
     nb = g_hash_table_foreach_remove (filter->streams, remove_yes, NULL);
 
@@ -1315,9 +1335,10 @@ gst_srtp_dec_push_early_events (GstSrtpDec * filter, GstPad * pad,
  * This function should be called while holding the filter lock
  */
 static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
-    gboolean is_rtcp, guint32 ssrc)
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad,
+    GstBuffer ** buf_ptr, gboolean is_rtcp, guint32 ssrc)
 {
+  GstBuffer *buf = *buf_ptr;
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
@@ -1327,7 +1348,7 @@ gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
       ssrc);
 
   /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
+  buf = *buf_ptr = gst_buffer_make_writable (buf);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   size = map.size;
@@ -1443,6 +1464,24 @@ err:
   return FALSE;
 }
 
+/* Returns the source pad for RTP or RTCP packets, after pushing the events
+ * it needs before the first one */
+static GstPad *
+gst_srtp_dec_get_src_pad (GstSrtpDec * filter, gboolean is_rtcp)
+{
+  if (is_rtcp) {
+    if (!filter->rtcp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
+          filter->rtp_srcpad, TRUE);
+    return filter->rtcp_srcpad;
+  } else {
+    if (!filter->rtp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
+          filter->rtcp_srcpad, FALSE);
+    return filter->rtp_srcpad;
+  }
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     gboolean is_rtcp)
@@ -1468,7 +1507,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     goto push_out;
   }
 
-  if (!gst_srtp_dec_decode_buffer (filter, pad, buf, is_rtcp, ssrc)) {
+  if (!gst_srtp_dec_decode_buffer (filter, pad, &buf, is_rtcp, ssrc)) {
     GST_OBJECT_UNLOCK (filter);
     goto drop_buffer;
   }
@@ -1481,17 +1520,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
 push_out:
   /* Push buffer to source pad */
-  if (is_rtcp) {
-    otherpad = filter->rtcp_srcpad;
-    if (!filter->rtcp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
-          filter->rtp_srcpad, TRUE);
-  } else {
-    otherpad = filter->rtp_srcpad;
-    if (!filter->rtp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
-          filter->rtcp_srcpad, FALSE);
-  }
+  otherpad = gst_srtp_dec_get_src_pad (filter, is_rtcp);
   ret = gst_pad_push (otherpad, buf);
 
   return ret;
@@ -1504,6 +1533,154 @@ drop_buffer:
   return ret;
 }
 
+/* Consecutive decoded packets of the same type, pushed as one list */
+typedef struct
+{
+  GstBufferList *list;
+  gboolean is_rtcp;
+} DecodedRun;
+
+typedef struct
+{
+  GstSrtpDec *filter;
+  GstPad *pad;
+  gboolean is_rtcp;
+  guint length;
+  /* array of DecodedRun, in input order */
+  GArray *runs;
+  /* set of the SSRCs whose key reached the soft limit */
+  GHashTable *soft_limit_ssrcs;
+} DecodeBufferItData;
+
+/* Called with the filter lock held, moves the buffers out of the input list
+ * into runs of RTP and RTCP packets, keeping their order */
+static gboolean
+decode_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  DecodeBufferItData *data = user_data;
+  GstSrtpDec *filter = data->filter;
+  GstSrtpDecSsrcStream *stream;
+  DecodedRun *run = NULL;
+  GstBuffer *buf = *buffer;
+  gboolean is_rtcp = data->is_rtcp;
+  guint32 ssrc = 0;
+
+  /* we own it now, so that decoding can happen in place */
+  *buffer = NULL;
+
+  if (!(stream = validate_buffer (filter, buf, &ssrc, &is_rtcp))) {
+    GST_WARNING_OBJECT (filter, "Invalid buffer, dropping");
+    gst_buffer_unref (buf);
+    return TRUE;
+  }
+
+  if (STREAM_HAS_CRYPTO (stream)) {
+    if (!gst_srtp_dec_decode_buffer (filter, data->pad, &buf, is_rtcp, ssrc)) {
+      gst_buffer_unref (buf);
+      return TRUE;
+    }
+
+    if (gst_srtp_get_soft_limit_reached ()) {
+      if (data->soft_limit_ssrcs == NULL)
+        data->soft_limit_ssrcs = g_hash_table_new (NULL, NULL);
+      g_hash_table_add (data->soft_limit_ssrcs, GUINT_TO_POINTER (ssrc));
+    }
+  }
+
+  if (data->runs->len > 0)
+    run = &g_array_index (data->runs, DecodedRun, data->runs->len - 1);
+  if (run == NULL || run->is_rtcp != is_rtcp) {
+    DecodedRun new_run;
+
+    new_run.list = gst_buffer_list_new_sized (data->length - index);
+    new_run.is_rtcp = is_rtcp;
+    g_array_append_val (data->runs, new_run);
+    run = &g_array_index (data->runs, DecodedRun, data->runs->len - 1);
+  }
+  gst_buffer_list_add (run->list, buf);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_srtp_dec_push_list (GstSrtpDec * filter, gboolean is_rtcp,
+    GstBufferList * buf_list)
+{
+  GstPad *otherpad;
+
+  otherpad = gst_srtp_dec_get_src_pad (filter, is_rtcp);
+  GST_LOG_OBJECT (otherpad, "Pushing buffer chain of %d",
+      gst_buffer_list_length (buf_list));
+
+  return gst_pad_push_list (otherpad, buf_list);
+}
+
+/* Decodes the whole list in one pass with the filter lock taken once, then
+ * pushes each run of packets of the same type to its source pad. With
+ * rtcp-mux the RTP sink pad can also receive RTCP packets, which stay in
+ * order with the RTP packets. */
+static GstFlowReturn
+gst_srtp_dec_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list, gboolean is_rtcp)
+{
+  GstSrtpDec *filter = GST_SRTP_DEC (parent);
+  GstFlowReturn ret = GST_FLOW_OK, rtcp_ret = GST_FLOW_OK;
+  DecodeBufferItData data;
+  guint i;
+
+  data.length = gst_buffer_list_length (buf_list);
+
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %u", data.length);
+
+  if (data.length == 0) {
+    gst_buffer_list_unref (buf_list);
+    return GST_FLOW_OK;
+  }
+
+  data.filter = filter;
+  data.pad = pad;
+  data.is_rtcp = is_rtcp;
+  data.runs = g_array_sized_new (FALSE, FALSE, sizeof (DecodedRun), 1);
+  data.soft_limit_ssrcs = NULL;
+
+  buf_list = gst_buffer_list_make_writable (buf_list);
+
+  GST_OBJECT_LOCK (filter);
+  gst_buffer_list_foreach (buf_list, decode_buffer_it, &data);
+  GST_OBJECT_UNLOCK (filter);
+
+  gst_buffer_list_unref (buf_list);
+
+  /* If all is well, we may have reached soft limit */
+  if (data.soft_limit_ssrcs) {
+    GHashTableIter iter;
+    gpointer ssrc;
+
+    g_hash_table_iter_init (&iter, data.soft_limit_ssrcs);
+    while (g_hash_table_iter_next (&iter, &ssrc, NULL))
+      request_key_with_signal (filter, GPOINTER_TO_UINT (ssrc),
+          SIGNAL_SOFT_LIMIT);
+    g_hash_table_unref (data.soft_limit_ssrcs);
+  }
+
+  /* once a source pad failed, the following packets for it are dropped */
+  for (i = 0; i < data.runs->len; i++) {
+    DecodedRun *run = &g_array_index (data.runs, DecodedRun, i);
+    GstFlowReturn *run_ret = run->is_rtcp ? &rtcp_ret : &ret;
+
+    if (*run_ret == GST_FLOW_OK)
+      *run_ret = gst_srtp_dec_push_list (filter, run->is_rtcp, run->list);
+    else
+      gst_buffer_list_unref (run->list);
+  }
+  g_array_free (data.runs, TRUE);
+
+  if (ret == GST_FLOW_OK)
+    ret = rtcp_ret;
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain_rtp (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1516,6 +1693,20 @@ gst_srtp_dec_chain_rtcp (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_srtp_dec_chain (pad, parent, buf, TRUE);
 }
 
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, FALSE);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtcp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, TRUE);
+}
+
 static GstStateChangeReturn
 gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
 {
@@ -79,6 +79,9 @@ struct _GstSrtpDec
   srtp_t session;
   gboolean first_session;
   GHashTable *streams;
+  /* last stream found in streams, packets mostly come in runs of the same
+   * SSRC */
+  GstSrtpDecSsrcStream *last_stream;
 
   gboolean rtp_has_segment;
   gboolean rtcp_has_segment;
@@ -355,6 +355,7 @@ enum
   ON_ICE_CANDIDATE_SIGNAL,
   ON_NEW_TRANSCEIVER_SIGNAL,
   GET_STATS_SIGNAL,
+  GET_STATS_BY_TYPE_SIGNAL,
   ADD_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVERS_SIGNAL,
@@ -5266,6 +5267,8 @@ _on_local_ice_candidate_cb (GstWebRTCICE * ice, guint session_id,
 struct get_stats
 {
   GstPad *pad;
+  gboolean all_types;
+  GstWebRTCStatsType type;
   GstPromise *promise;
 };
 
@@ -5283,24 +5286,29 @@ _free_get_stats (struct get_stats *stats)
 static void
 _get_stats_task (GstWebRTCBin * webrtc, struct get_stats *stats)
 {
+  GstStructure *s;
+
   /* Our selector is the pad,
    * https://www.w3.org/TR/webrtc/#dfn-stats-selection-algorithm
    */
-  gst_promise_reply (stats->promise, gst_webrtc_bin_create_stats (webrtc,
-          stats->pad));
+  if (stats->all_types)
+    s = gst_webrtc_bin_create_stats (webrtc, stats->pad);
+  else
+    s = gst_webrtc_bin_create_stats_by_type (webrtc, stats->pad, stats->type);
+
+  gst_promise_reply (stats->promise, s);
 }
 
 static void
-gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
-    GstPromise * promise)
+_enqueue_get_stats (GstWebRTCBin * webrtc, GstPad * pad, gboolean all_types,
+    GstWebRTCStatsType type, GstPromise * promise)
 {
   struct get_stats *stats;
 
-  g_return_if_fail (promise != NULL);
-  g_return_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad));
-
   stats = g_new0 (struct get_stats, 1);
   stats->promise = gst_promise_ref (promise);
+  stats->all_types = all_types;
+  stats->type = type;
   /* FIXME: check that pad exists in element */
   if (pad)
     stats->pad = gst_object_ref (pad);
@@ -5319,6 +5327,26 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
   }
 }
 
+static void
+gst_webrtc_bin_get_stats_by_type (GstWebRTCBin * webrtc, GstPad * pad,
+    GstWebRTCStatsType type, GstPromise * promise)
+{
+  g_return_if_fail (promise != NULL);
+  g_return_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad));
+
+  _enqueue_get_stats (webrtc, pad, FALSE, type, promise);
+}
+
+static void
+gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    GstPromise * promise)
+{
+  g_return_if_fail (promise != NULL);
+  g_return_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad));
+
+  _enqueue_get_stats (webrtc, pad, TRUE, 0, promise);
+}
+
 static GstWebRTCRTPTransceiver *
 gst_webrtc_bin_add_transceiver (GstWebRTCBin * webrtc,
     GstWebRTCRTPTransceiverDirection direction, GstCaps * caps)
@@ -6785,6 +6813,27 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       G_CALLBACK (gst_webrtc_bin_get_stats), NULL, NULL, NULL,
       G_TYPE_NONE, 2, GST_TYPE_PAD, GST_TYPE_PROMISE);
 
+  /**
+   * GstWebRTCBin::get-stats-by-type:
+   * @object: the #webrtcbin
+   * @pad: (nullable): A #GstPad to get the stats for, or %NULL for all
+   * @type: the #GstWebRTCStatsType of the statistics to retrieve
+   * @promise: a #GstPromise for the result
+   *
+   * Like #GstWebRTCBin::get-stats but the reply only contains the statistics
+   * of type @type, e.g. only the inbound RTP streams of one transceiver.
+   * Only the statistics that are needed are gathered, which makes frequent
+   * polling of a part of the statistics cheaper than retrieving all of them.
+   *
+   * Since: 1.20
+   */
+  gst_webrtc_bin_signals[GET_STATS_BY_TYPE_SIGNAL] =
+      g_signal_new_class_handler ("get-stats-by-type",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_get_stats_by_type), NULL, NULL, NULL,
+      G_TYPE_NONE, 3, GST_TYPE_PAD, GST_TYPE_WEBRTC_STATS_TYPE,
+      GST_TYPE_PROMISE);
+
   /**
    * GstWebRTCBin::on-negotiation-needed:
    * @object: the #webrtcbin
@@ -34,6 +34,21 @@
 #define GST_CAT_DEFAULT gst_webrtc_stats_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+/* The statistics being gathered for one get-stats request */
+typedef struct
+{
+  GstStructure *s;
+  double ts;
+  /* report the statistics of all types, or only those of @type */
+  gboolean all_types;
+  GstWebRTCStatsType type;
+  /* session id -> rtp session stats, retrieved once per report as all the
+   * pads of a bundle share the same session */
+  GHashTable *session_stats;
+} StatsReport;
+
+#define REPORT_WANTS(r,t) ((r)->all_types || (r)->type == (t))
+
 static void
 _init_debug (void)
 {
@@ -69,9 +84,9 @@ _set_base_stats (GstStructure * s, GstWebRTCStatsType type, double ts,
 }
 
 static GstStructure *
-_get_peer_connection_stats (GstWebRTCBin * webrtc)
+_get_peer_connection_stats (GstWebRTCBin * webrtc, const gchar * id)
 {
-  GstStructure *s = gst_structure_new_empty ("unused");
+  GstStructure *s = gst_structure_new_empty (id);
 
   /* FIXME: datachannel */
   gst_structure_set (s, "data-channels-opened", G_TYPE_UINT, 0,
@@ -104,7 +119,7 @@ static gboolean
 _get_stats_from_remote_rtp_source_stats (GstWebRTCBin * webrtc,
     TransportStream * stream, const GstStructure * source_stats,
     guint ssrc, guint clock_rate, const gchar * codec_id,
-    const gchar * transport_id, GstStructure * s)
+    const gchar * transport_id, StatsReport * report)
 {
   gboolean have_rb = FALSE, internal = FALSE;
   int lost;
@@ -112,9 +127,10 @@ _get_stats_from_remote_rtp_source_stats (GstWebRTCBin * webrtc,
   gchar *r_in_id, *out_id;
   guint32 rtt;
   guint fraction_lost, jitter;
-  double ts;
 
-  gst_structure_get_double (s, "timestamp", &ts);
+  if (!REPORT_WANTS (report, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP))
+    return FALSE;
+
   gst_structure_get (source_stats, "internal", G_TYPE_BOOLEAN, &internal,
       "have-rb", G_TYPE_BOOLEAN, &have_rb, NULL);
 
@@ -126,7 +142,8 @@ _get_stats_from_remote_rtp_source_stats (GstWebRTCBin * webrtc,
   out_id = g_strdup_printf ("rtp-outbound-stream-stats_%u", ssrc);
 
   r_in = gst_structure_new_empty (r_in_id);
-  _set_base_stats (r_in, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP, ts, r_in_id);
+  _set_base_stats (r_in, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP, report->ts,
+      r_in_id);
 
   /* RTCRtpStreamStats */
   gst_structure_set (r_in, "local-id", G_TYPE_STRING, out_id, NULL);
@@ -190,7 +207,7 @@ _get_stats_from_remote_rtp_source_stats (GstWebRTCBin * webrtc,
   gst_structure_set (r_in, "gst-rtpsource-stats", GST_TYPE_STRUCTURE,
       source_stats, NULL);
 
-  _gst_structure_take_structure (s, r_in_id, &r_in);
+  _gst_structure_take_structure (report->s, r_in_id, &r_in);
 
   g_free (r_in_id);
   g_free (out_id);
@@ -203,15 +220,14 @@ _get_stats_from_remote_rtp_source_stats (GstWebRTCBin * webrtc,
 static void
 _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     TransportStream * stream, const GstStructure * source_stats,
-    const gchar * codec_id, const gchar * transport_id, GstStructure * s)
+    const gchar * codec_id, const gchar * transport_id,
+    gboolean have_remote_inbound, StatsReport * report)
 {
   guint ssrc, fir, pli, nack, jitter;
   int clock_rate;
   guint64 packets, bytes;
   gboolean internal;
-  double ts;
 
-  gst_structure_get_double (s, "timestamp", &ts);
   gst_structure_get (source_stats, "ssrc", G_TYPE_UINT, &ssrc, "clock-rate",
       G_TYPE_INT, &clock_rate, "internal", G_TYPE_BOOLEAN, &internal, NULL);
 
@@ -219,10 +235,13 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     GstStructure *out;
     gchar *out_id, *r_in_id;
 
+    if (!REPORT_WANTS (report, GST_WEBRTC_STATS_OUTBOUND_RTP))
+      return;
+
     out_id = g_strdup_printf ("rtp-outbound-stream-stats_%u", ssrc);
 
     out = gst_structure_new_empty (out_id);
-    _set_base_stats (out, GST_WEBRTC_STATS_OUTBOUND_RTP, ts, out_id);
+    _set_base_stats (out, GST_WEBRTC_STATS_OUTBOUND_RTP, report->ts, out_id);
 
     /* RTCStreamStats */
     gst_structure_set (out, "ssrc", G_TYPE_UINT, ssrc, NULL);
@@ -247,10 +266,11 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
       gst_structure_set (out, "nack-count", G_TYPE_UINT, nack, NULL);
     /* XXX: mediaType, trackId, sliCount, qpSum */
 
-    r_in_id = g_strdup_printf ("rtp-remote-inbound-stream-stats_%u", ssrc);
-    if (gst_structure_has_field (s, r_in_id))
+    if (have_remote_inbound) {
+      r_in_id = g_strdup_printf ("rtp-remote-inbound-stream-stats_%u", ssrc);
       gst_structure_set (out, "remote-id", G_TYPE_STRING, r_in_id, NULL);
-    g_free (r_in_id);
+      g_free (r_in_id);
+    }
 
     /*  RTCOutboundRTPStreamStats:
 
@@ -304,7 +324,7 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     gst_structure_set (out, "gst-rtpsource-stats", GST_TYPE_STRUCTURE,
         source_stats, NULL);
 
-    _gst_structure_take_structure (s, out_id, &out);
+    _gst_structure_take_structure (report->s, out_id, &out);
 
     g_free (out_id);
   } else {
@@ -314,10 +334,17 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     GstStructure *jb_stats = NULL;
     guint i;
     guint64 jb_lost, duplicates, late, rtx_success;
+    gboolean want_in, want_r_out;
+
+    want_in = REPORT_WANTS (report, GST_WEBRTC_STATS_INBOUND_RTP);
+    want_r_out = REPORT_WANTS (report, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP);
+    if (!want_in && !want_r_out)
+      return;
 
     gst_structure_get (source_stats, "have-sr", G_TYPE_BOOLEAN, &have_sr, NULL);
 
-    for (i = 0; i < stream->remote_ssrcmap->len; i++) {
+    /* the jitterbuffer is only queried for the inbound statistics */
+    for (i = 0; want_in && i < stream->remote_ssrcmap->len; i++) {
       SsrcMapItem *item = g_ptr_array_index (stream->remote_ssrcmap, i);
 
       if (item->ssrc == ssrc) {
@@ -340,8 +367,10 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     in_id = g_strdup_printf ("rtp-inbound-stream-stats_%u", ssrc);
     r_out_id = g_strdup_printf ("rtp-remote-outbound-stream-stats_%u", ssrc);
 
+    /* both are built as they refer to each other, but only the requested
+     * ones are reported */
     in = gst_structure_new_empty (in_id);
-    _set_base_stats (in, GST_WEBRTC_STATS_INBOUND_RTP, ts, in_id);
+    _set_base_stats (in, GST_WEBRTC_STATS_INBOUND_RTP, report->ts, in_id);
 
     /* RTCRtpStreamStats */
     gst_structure_set (in, "ssrc", G_TYPE_UINT, ssrc, NULL);
@@ -452,7 +481,8 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
      */
 
     r_out = gst_structure_new_empty (r_out_id);
-    _set_base_stats (r_out, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP, ts, r_out_id);
+    _set_base_stats (r_out, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP, report->ts,
+        r_out_id);
     /* RTCStreamStats */
     gst_structure_set (r_out, "ssrc", G_TYPE_UINT, ssrc, NULL);
     gst_structure_set (r_out, "codec-id", G_TYPE_STRING, codec_id, NULL);
@@ -546,8 +576,14 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     gst_structure_set (in, "gst-rtpsource-stats", GST_TYPE_STRUCTURE,
         source_stats, NULL);
 
-    _gst_structure_take_structure (s, in_id, &in);
-    _gst_structure_take_structure (s, r_out_id, &r_out);
+    if (want_in)
+      _gst_structure_take_structure (report->s, in_id, &in);
+    else
+      gst_structure_free (in);
+    if (want_r_out)
+      _gst_structure_take_structure (report->s, r_out_id, &r_out);
+    else
+      gst_structure_free (r_out);
 
     g_free (in_id);
     g_free (r_out_id);
@@ -557,17 +593,19 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
 /* https://www.w3.org/TR/webrtc-stats/#candidatepair-dict* */
 static gchar *
 _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
-    GstWebRTCICETransport * transport, GstStructure * s)
+    GstWebRTCICETransport * transport, StatsReport * report)
 {
   GstStructure *stats;
   gchar *id;
-  double ts;
-
-  gst_structure_get_double (s, "timestamp", &ts);
 
   id = g_strdup_printf ("ice-candidate-pair_%s", GST_OBJECT_NAME (transport));
+
+  /* already reported through another stream of the bundle */
+  if (gst_structure_has_field (report->s, id))
+    return id;
+
   stats = gst_structure_new_empty (id);
-  _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, ts, id);
+  _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, report->ts, id);
 
 /* XXX: RTCIceCandidatePairStats
     DOMString                     transportId;
@@ -615,8 +653,7 @@ _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
 };
 */
 
-  gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
-  gst_structure_free (stats);
+  _gst_structure_take_structure (report->s, id, &stats);
 
   return id;
 }
@@ -624,18 +661,21 @@ _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
 /* https://www.w3.org/TR/webrtc-stats/#dom-rtctransportstats */
 static gchar *
 _get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
-    GstWebRTCDTLSTransport * transport, GstStructure * s)
+    GstWebRTCDTLSTransport * transport, StatsReport * report)
 {
   GstStructure *stats;
   gchar *id;
-  double ts;
   gchar *ice_id;
 
-  gst_structure_get_double (s, "timestamp", &ts);
-
   id = g_strdup_printf ("transport-stats_%s", GST_OBJECT_NAME (transport));
+
+  /* the id is still needed by the rtp stream statistics */
+  if (!REPORT_WANTS (report, GST_WEBRTC_STATS_TRANSPORT)
+      || gst_structure_has_field (report->s, id))
+    return id;
+
   stats = gst_structure_new_empty (id);
-  _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, ts, id);
+  _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, report->ts, id);
 
 /* XXX: RTCTransportStats
     unsigned long         packetsSent;
@@ -669,47 +709,105 @@ _get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
     boolean             deleted = false;
 */
 
-  gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
-  gst_structure_free (stats);
+  _gst_structure_take_structure (report->s, id, &stats);
 
-  ice_id = _get_stats_from_ice_transport (webrtc, transport->transport, s);
+  ice_id = _get_stats_from_ice_transport (webrtc, transport->transport,
+      report);
   g_free (ice_id);
 
   return id;
 }
 
+/* Whether the rtp session statistics contain a receiver report about @ssrc,
+ * from which the remote inbound statistics are built */
+static gboolean
+_have_remote_inbound_stats (GValueArray * source_stats, guint ssrc)
+{
+  int i;
+
+  for (i = 0; i < source_stats->n_values; i++) {
+    const GstStructure *stats;
+    gboolean have_rb = FALSE, internal = FALSE;
+    guint stats_ssrc = 0;
+
+    stats = gst_value_get_structure (g_value_array_get_nth (source_stats, i));
+    gst_structure_get (stats, "internal", G_TYPE_BOOLEAN, &internal,
+        "have-rb", G_TYPE_BOOLEAN, &have_rb, NULL);
+
+    if (gst_structure_get_uint (stats, "rb-ssrc", &stats_ssrc) &&
+        ssrc == stats_ssrc && have_rb && !internal)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Returns the rtp session statistics of @stream, retrieving them only once
+ * per report */
+static const GstStructure *
+_get_rtp_session_stats (GstWebRTCBin * webrtc, TransportStream * stream,
+    StatsReport * report)
+{
+  GstStructure *rtp_stats;
+  GObject *rtp_session;
+
+  rtp_stats = g_hash_table_lookup (report->session_stats,
+      GUINT_TO_POINTER (stream->session_id));
+  if (rtp_stats)
+    return rtp_stats;
+
+  g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
+      stream->session_id, &rtp_session);
+  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+  g_object_unref (rtp_session);
+
+  g_hash_table_insert (report->session_stats,
+      GUINT_TO_POINTER (stream->session_id), rtp_stats);
+
+  return rtp_stats;
+}
+
 static void
 _get_stats_from_transport_channel (GstWebRTCBin * webrtc,
     TransportStream * stream, const gchar * codec_id, guint ssrc,
-    guint clock_rate, GstStructure * s)
+    guint clock_rate, StatsReport * report)
 {
   GstWebRTCDTLSTransport *transport;
-  GObject *rtp_session;
-  GstStructure *rtp_stats;
+  const GstStructure *rtp_stats;
+  const GValue *source_stats_value;
   GValueArray *source_stats;
   gchar *transport_id;
-  double ts;
+  gboolean have_remote_inbound;
   int i;
 
-  gst_structure_get_double (s, "timestamp", &ts);
-
   transport = stream->transport;
   if (!transport)
     return;
 
-  g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
-      stream->session_id, &rtp_session);
-  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+  transport_id = _get_stats_from_dtls_transport (webrtc, transport, report);
+
+  /* none of the rtp stream statistics were requested */
+  if (!REPORT_WANTS (report, GST_WEBRTC_STATS_INBOUND_RTP)
+      && !REPORT_WANTS (report, GST_WEBRTC_STATS_OUTBOUND_RTP)
+      && !REPORT_WANTS (report, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP)
+      && !REPORT_WANTS (report, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP))
+    goto out;
 
-  gst_structure_get (rtp_stats, "source-stats", G_TYPE_VALUE_ARRAY,
-      &source_stats, NULL);
+  rtp_stats = _get_rtp_session_stats (webrtc, stream, report);
+
+  source_stats_value = gst_structure_get_value (rtp_stats, "source-stats");
+  if (!source_stats_value)
+    goto out;
+  source_stats = g_value_get_boxed (source_stats_value);
 
   GST_DEBUG_OBJECT (webrtc, "retrieving rtp stream stats from transport %"
-      GST_PTR_FORMAT " rtp session %" GST_PTR_FORMAT " with %u rtp sources, "
-      "transport %" GST_PTR_FORMAT, stream, rtp_session, source_stats->n_values,
-      transport);
+      GST_PTR_FORMAT " rtp session %u with %u rtp sources, "
+      "transport %" GST_PTR_FORMAT, stream, stream->session_id,
+      source_stats->n_values, transport);
 
-  transport_id = _get_stats_from_dtls_transport (webrtc, transport, s);
+  /* decided from the session statistics, as the remote inbound statistics
+   * might not be part of the report */
+  have_remote_inbound = _have_remote_inbound_stats (source_stats, ssrc);
 
   /* construct stats objects */
   for (i = 0; i < source_stats->n_values; i++) {
@@ -720,40 +818,35 @@ _get_stats_from_transport_channel (GstWebRTCBin * webrtc,
     stats = gst_value_get_structure (val);
 
     /* skip foreign sources */
-    gst_structure_get (stats, "ssrc", G_TYPE_UINT, &stats_ssrc, NULL);
     if (gst_structure_get_uint (stats, "ssrc", &stats_ssrc) &&
         ssrc == stats_ssrc)
       _get_stats_from_rtp_source_stats (webrtc, stream, stats, codec_id,
-          transport_id, s);
+          transport_id, have_remote_inbound, report);
     else if (gst_structure_get_uint (stats, "rb-ssrc", &stats_ssrc) &&
         ssrc == stats_ssrc)
       _get_stats_from_remote_rtp_source_stats (webrtc, stream, stats, ssrc,
-          clock_rate, codec_id, transport_id, s);
+          clock_rate, codec_id, transport_id, report);
   }
 
-  g_object_unref (rtp_session);
-  gst_structure_free (rtp_stats);
-  g_value_array_free (source_stats);
+out:
   g_free (transport_id);
 }
 
 /* https://www.w3.org/TR/webrtc-stats/#codec-dict* */
 static void
 _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
-    GstStructure * s, gchar ** out_id, guint * out_ssrc, guint * out_clock_rate)
+    StatsReport * report, gchar ** out_id, guint * out_ssrc,
+    guint * out_clock_rate)
 {
   GstStructure *stats;
   GstCaps *caps;
   gchar *id;
-  double ts;
   guint ssrc = 0;
   gint clock_rate = 0;
 
-  gst_structure_get_double (s, "timestamp", &ts);
-
-  stats = gst_structure_new_empty ("unused");
   id = g_strdup_printf ("codec-stats-%s", GST_OBJECT_NAME (pad));
-  _set_base_stats (stats, GST_WEBRTC_STATS_CODEC, ts, id);
+  stats = gst_structure_new_empty (id);
+  _set_base_stats (stats, GST_WEBRTC_STATS_CODEC, report->ts, id);
 
   caps = gst_pad_get_current_caps (pad);
   if (caps && gst_caps_is_fixed (caps)) {
@@ -775,8 +868,10 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
   if (caps)
     gst_caps_unref (caps);
 
-  gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
-  gst_structure_free (stats);
+  if (REPORT_WANTS (report, GST_WEBRTC_STATS_CODEC))
+    _gst_structure_take_structure (report->s, id, &stats);
+  else
+    gst_structure_free (stats);
 
   if (out_id)
     *out_id = id;
@@ -791,14 +886,15 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
 }
 
 static gboolean
-_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
+_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, StatsReport * report)
 {
   GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (pad);
   TransportStream *stream;
   gchar *codec_id;
   guint ssrc, clock_rate;
 
-  _get_codec_stats_from_pad (webrtc, pad, s, &codec_id, &ssrc, &clock_rate);
+  _get_codec_stats_from_pad (webrtc, pad, report, &codec_id, &ssrc,
+      &clock_rate);
 
   if (!wpad->trans)
     goto out;
@@ -808,44 +904,66 @@ _get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
     goto out;
 
   _get_stats_from_transport_channel (webrtc, stream, codec_id, ssrc,
-      clock_rate, s);
+      clock_rate, report);
 
 out:
   g_free (codec_id);
   return TRUE;
 }
 
-GstStructure *
-gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad)
+static GstStructure *
+_create_stats (GstWebRTCBin * webrtc, GstPad * pad, gboolean all_types,
+    GstWebRTCStatsType type)
 {
-  GstStructure *s = gst_structure_new_empty ("application/x-webrtc-stats");
-  double ts = monotonic_time_as_double_milliseconds ();
+  StatsReport report;
+  const gchar *pc_id = "peer-connection-stats";
   GstStructure *pc_stats;
 
   _init_debug ();
 
-  gst_structure_set (s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
+  report.s = gst_structure_new_empty ("application/x-webrtc-stats");
+  report.ts = monotonic_time_as_double_milliseconds ();
+  report.all_types = all_types;
+  report.type = type;
+  report.session_stats = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_structure_free);
 
   /* FIXME: better unique IDs */
   /* FIXME: rate limitting stat updates? */
-  /* FIXME: all stats need to be kept forever */
-
-  GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", ts);
 
-  if ((pc_stats = _get_peer_connection_stats (webrtc))) {
-    const gchar *id = "peer-connection-stats";
-    _set_base_stats (pc_stats, GST_WEBRTC_STATS_PEER_CONNECTION, ts, id);
-    gst_structure_set (s, id, GST_TYPE_STRUCTURE, pc_stats, NULL);
-    gst_structure_free (pc_stats);
+  if (all_types)
+    GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", report.ts);
+  else
+    GST_DEBUG_OBJECT (webrtc, "updating stats of type %d at time %f", type,
+        report.ts);
+
+  if (REPORT_WANTS (&report, GST_WEBRTC_STATS_PEER_CONNECTION) &&
+      (pc_stats = _get_peer_connection_stats (webrtc, pc_id))) {
+    _set_base_stats (pc_stats, GST_WEBRTC_STATS_PEER_CONNECTION, report.ts,
+        pc_id);
+    _gst_structure_take_structure (report.s, pc_id, &pc_stats);
   }
 
   if (pad)
-    _get_stats_from_pad (webrtc, pad, s);
+    _get_stats_from_pad (webrtc, pad, &report);
   else
     gst_element_foreach_pad (GST_ELEMENT (webrtc),
-        (GstElementForeachPadFunc) _get_stats_from_pad, s);
+        (GstElementForeachPadFunc) _get_stats_from_pad, &report);
 
-  gst_structure_remove_field (s, "timestamp");
+  g_hash_table_unref (report.session_stats);
 
-  return s;
+  return report.s;
+}
+
+GstStructure *
+gst_webrtc_bin_create_stats (GstWebRTCBin * webrtc, GstPad * pad)
+{
+  return _create_stats (webrtc, pad, TRUE, 0);
+}
+
+GstStructure *
+gst_webrtc_bin_create_stats_by_type (GstWebRTCBin * webrtc, GstPad * pad,
+    GstWebRTCStatsType type)
+{
+  return _create_stats (webrtc, pad, FALSE, type);
 }
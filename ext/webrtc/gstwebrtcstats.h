@@ -31,6 +31,11 @@ G_GNUC_INTERNAL
 GstStructure *     gst_webrtc_bin_create_stats         (GstWebRTCBin * webrtc,
                                                         GstPad * pad);
 
+G_GNUC_INTERNAL
+GstStructure *     gst_webrtc_bin_create_stats_by_type (GstWebRTCBin * webrtc,
+                                                        GstPad * pad,
+                                                        GstWebRTCStatsType type);
+
 G_END_DECLS
 
 #endif /* __GST_WEBRTC_STATS_H__ */
@@ -119,6 +119,9 @@ that the demux object and its streams are not changed by anybody else.
 #endif
 
 #include "gstadaptivedemux.h"
+#include "gstadaptivedemuxabr.h"
+#include "gstadaptivedemuxcache.h"
+#include "gstadaptivedemuxprefetch.h"
 #include "gst/gst-i18n-plugin.h"
 #include <gst/base/gstadapter.h>
 
@@ -129,8 +132,13 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_BITRATE_LIMIT 0.8f
+#define DEFAULT_PREFETCH_DEPTH 0
+/* idle source elements kept by the manifest/key downloader, one per host */
+#define DOWNLOADER_POOL_SIZE 4
+#define DEFAULT_ABR_ALGORITHM GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE
+#define DEFAULT_SHARED_CACHE_SIZE 0
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
-#define NUM_LOOKBACK_FRAGMENTS 3
+#define PREFETCH_MAX_BYTES SRC_QUEUE_MAX_BYTES
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -157,6 +165,10 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_DEPTH,
+  PROP_ABR_ALGORITHM,
+  PROP_SHARED_CACHE_SIZE,
+  PROP_SHARED_CACHE_STATS,
   PROP_LAST
 };
 
@@ -207,6 +219,12 @@ struct _GstAdaptiveDemuxPrivate
   GMutex segment_lock;
 
   GstClockTime qos_earliest_time;
+
+  guint prefetch_depth;         /* protected by manifest_lock */
+  GstAdaptiveDemuxAbrAlgorithm abr_algorithm;   /* protected by manifest_lock */
+
+  guint64 shared_cache_size;    /* protected by manifest_lock */
+  GstAdaptiveDemuxCache *cache; /* protected by the object lock */
 };
 
 typedef struct _GstAdaptiveDemuxTimer
@@ -229,6 +247,8 @@ static GstStateChangeReturn gst_adaptive_demux_change_state (GstElement *
     element, GstStateChange transition);
 
 static void gst_adaptive_demux_handle_message (GstBin * bin, GstMessage * msg);
+static void gst_adaptive_demux_set_context (GstElement * element,
+    GstContext * context);
 
 static gboolean gst_adaptive_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
@@ -306,6 +326,32 @@ static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
 static gboolean
 gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
     * demux);
+static guint64
+gst_adaptive_demux_stream_get_target_bitrate_default (GstAdaptiveDemuxStream *
+    stream, GstClockTime buffer_level);
+
+#define GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM \
+  (gst_adaptive_demux_abr_algorithm_get_type ())
+static GType
+gst_adaptive_demux_abr_algorithm_get_type (void)
+{
+  static gsize abr_algorithm_type = 0;
+  static const GEnumValue abr_algorithms[] = {
+    {GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+        "Average bitrate of the last fragments", "moving-average"},
+    {GST_ADAPTIVE_DEMUX_ABR_HYBRID,
+        "Throughput estimate scaled by the downstream buffer level", "hybrid"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&abr_algorithm_type)) {
+    GType _type = g_enum_register_static ("GstAdaptiveDemuxAbrAlgorithm",
+        abr_algorithms);
+    g_once_init_leave (&abr_algorithm_type, _type);
+  }
+
+  return abr_algorithm_type;
+}
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
  * method to get to the padtemplates */
@@ -363,6 +409,15 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->priv->prefetch_depth = g_value_get_uint (value);
+      break;
+    case PROP_ABR_ALGORITHM:
+      demux->priv->abr_algorithm = g_value_get_enum (value);
+      break;
+    case PROP_SHARED_CACHE_SIZE:
+      demux->priv->shared_cache_size = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -387,6 +442,29 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->priv->prefetch_depth);
+      break;
+    case PROP_ABR_ALGORITHM:
+      g_value_set_enum (value, demux->priv->abr_algorithm);
+      break;
+    case PROP_SHARED_CACHE_SIZE:
+      g_value_set_uint64 (value, demux->priv->shared_cache_size);
+      break;
+    case PROP_SHARED_CACHE_STATS:{
+      GstAdaptiveDemuxCache *cache;
+
+      GST_OBJECT_LOCK (demux);
+      cache = demux->priv->cache ? gst_object_ref (demux->priv->cache) : NULL;
+      GST_OBJECT_UNLOCK (demux);
+      if (cache) {
+        g_value_take_boxed (value, gst_adaptive_demux_cache_get_stats (cache));
+        gst_object_unref (cache);
+      } else {
+        g_value_set_boxed (value, NULL);
+      }
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -432,7 +510,82 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-depth:
+   *
+   * Number of fragments of a stream to download concurrently. The upcoming
+   * fragments are downloaded ahead of time into memory and still pushed in
+   * order, which hides the per-request latency of high latency servers.
+   * Only used if the subclass implements
+   * GstAdaptiveDemuxClass::stream_peek_fragment and applies to streams
+   * created after it was set. 0 disables prefetching.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of fragments to download concurrently (0 = disabled)",
+          0, 16, DEFAULT_PREFETCH_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:abr-algorithm:
+   *
+   * Algorithm used to pick the bitrate of the next fragments from the
+   * measured download rates, unless #GstAdaptiveDemux:connection-speed is
+   * set or the subclass overrides
+   * GstAdaptiveDemuxClass::stream_get_target_bitrate.
+   *
+   * The default is the average bitrate of the last fragments, as used so
+   * far. "hybrid" also takes the downstream buffer level into account.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ABR_ALGORITHM,
+      g_param_spec_enum ("abr-algorithm", "ABR algorithm",
+          "Algorithm used to select the bitrate of the fragments",
+          GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM, DEFAULT_ABR_ALGORITHM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:shared-cache-size:
+   *
+   * Maximum size in bytes of the fragment cache shared between demuxers,
+   * 0 disables it. The cache keeps the fragments and keys downloaded in
+   * plain forward playback, keyed by URI and byte range, and concurrent
+   * downloads of the same fragment by different demuxers are merged into
+   * one.
+   *
+   * The cache is shared through a GstContext of type
+   * "gst.adaptivedemux.cache": demuxers of the same pipeline share it
+   * automatically, and the context posted by the first demuxer can be set
+   * on other pipelines to share it with them. The size of the cache is the
+   * one of the demuxer that created it.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_CACHE_SIZE,
+      g_param_spec_uint64 ("shared-cache-size", "Shared cache size",
+          "Maximum size in bytes of the fragment cache shared between "
+          "demuxers (0 = disabled)", 0, G_MAXUINT64, DEFAULT_SHARED_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:shared-cache-stats:
+   *
+   * Statistics of the shared fragment cache used by the demuxer, if any:
+   * "hits", "misses", "coalesced" and "evictions" counters, number of
+   * "entries", "size" and "max-size" in bytes.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_CACHE_STATS,
+      g_param_spec_boxed ("shared-cache-stats", "Shared cache statistics",
+          "Statistics of the shared fragment cache", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
+  gstelement_class->set_context = gst_adaptive_demux_set_context;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
 
@@ -441,6 +594,8 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
   klass->update_manifest = gst_adaptive_demux_update_manifest_default;
   klass->requires_periodical_playlist_update =
       gst_adaptive_demux_requires_periodical_playlist_update_default;
+  klass->stream_get_target_bitrate =
+      gst_adaptive_demux_stream_get_target_bitrate_default;
 
 }
 
@@ -458,6 +613,7 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   demux->priv->input_adapter = gst_adapter_new ();
   demux->downloader = gst_uri_downloader_new ();
   gst_uri_downloader_set_parent (demux->downloader, GST_ELEMENT_CAST (demux));
+  gst_uri_downloader_set_pool_size (demux->downloader, DOWNLOADER_POOL_SIZE);
   demux->stream_struct_size = sizeof (GstAdaptiveDemuxStream);
   demux->priv->segment_seqnum = gst_util_seqnum_next ();
   demux->have_group_id = FALSE;
@@ -522,6 +678,9 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->priv->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+  demux->priv->abr_algorithm = DEFAULT_ABR_ALGORITHM;
+  demux->priv->shared_cache_size = DEFAULT_SHARED_CACHE_SIZE;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -536,6 +695,8 @@ gst_adaptive_demux_finalize (GObject * object)
 
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
+  if (priv->cache)
+    gst_object_unref (priv->cache);
 
   g_mutex_clear (&priv->updates_timed_lock);
   g_cond_clear (&priv->updates_timed_cond);
@@ -557,6 +718,77 @@ gst_adaptive_demux_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_adaptive_demux_set_context (GstElement * element, GstContext * context)
+{
+  GstAdaptiveDemux *demux = GST_ADAPTIVE_DEMUX_CAST (element);
+  GstAdaptiveDemuxCache *cache;
+
+  cache = gst_adaptive_demux_cache_from_context (context);
+  if (cache) {
+    GST_DEBUG_OBJECT (demux, "Using shared fragment cache %" GST_PTR_FORMAT,
+        cache);
+    GST_OBJECT_LOCK (demux);
+    gst_object_replace ((GstObject **) & demux->priv->cache,
+        GST_OBJECT_CAST (cache));
+    GST_OBJECT_UNLOCK (demux);
+    gst_object_unref (cache);
+  }
+
+  GST_ELEMENT_CLASS (parent_class)->set_context (element, context);
+}
+
+/* Returns: (transfer full) (nullable): the shared fragment cache */
+static GstAdaptiveDemuxCache *
+gst_adaptive_demux_get_cache (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxCache *cache = NULL;
+
+  GST_OBJECT_LOCK (demux);
+  if (demux->priv->cache)
+    cache = gst_object_ref (demux->priv->cache);
+  GST_OBJECT_UNLOCK (demux);
+
+  return cache;
+}
+
+/* Asks the application and the other elements of the pipeline for a
+ * shared fragment cache, or creates one and announces it */
+static void
+gst_adaptive_demux_ensure_cache (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstContext *context;
+  guint64 size;
+
+  GST_MANIFEST_LOCK (demux);
+  size = demux->priv->shared_cache_size;
+  GST_MANIFEST_UNLOCK (demux);
+
+  if (size == 0)
+    return;
+
+  cache = gst_adaptive_demux_get_cache (demux);
+  if (cache == NULL) {
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_need_context (GST_OBJECT_CAST (demux),
+            GST_ADAPTIVE_DEMUX_CACHE_CONTEXT_TYPE));
+    cache = gst_adaptive_demux_get_cache (demux);
+  }
+
+  if (cache == NULL) {
+    GST_INFO_OBJECT (demux, "Creating shared fragment cache of %"
+        G_GUINT64_FORMAT " bytes", size);
+    cache = gst_adaptive_demux_cache_new (size);
+    context = gst_adaptive_demux_cache_context_new (cache);
+    gst_element_set_context (GST_ELEMENT_CAST (demux), context);
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_have_context (GST_OBJECT_CAST (demux), context));
+  }
+
+  gst_object_unref (cache);
+}
+
 static GstStateChangeReturn
 gst_adaptive_demux_change_state (GstElement * element,
     GstStateChange transition)
@@ -565,6 +797,9 @@ gst_adaptive_demux_change_state (GstElement * element,
   GstStateChangeReturn result = GST_STATE_CHANGE_FAILURE;
 
   switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_adaptive_demux_ensure_cache (demux);
+      break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       if (g_atomic_int_compare_and_exchange (&demux->running, TRUE, FALSE))
         GST_DEBUG_OBJECT (demux, "demuxer has stopped running");
@@ -1321,8 +1556,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
 
   stream->pad = pad;
   stream->demux = demux;
-  stream->fragment_bitrates =
-      g_malloc0 (sizeof (guint64) * NUM_LOOKBACK_FRAGMENTS);
+  stream->abr = gst_adaptive_demux_abr_new ();
   gst_pad_set_element_private (pad, stream);
   stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
 
@@ -1403,6 +1637,18 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  if (stream->prefetch) {
+    gst_adaptive_demux_prefetch_free (stream->prefetch);
+    stream->prefetch = NULL;
+  }
+
+  if (stream->cache_downloader) {
+    gst_object_unref (stream->cache_downloader);
+    g_object_unref (stream->cache_cancellable);
+    stream->cache_downloader = NULL;
+    stream->cache_cancellable = NULL;
+  }
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -1438,7 +1684,7 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   g_cond_clear (&stream->fragment_download_cond);
   g_mutex_clear (&stream->fragment_download_lock);
-  g_free (stream->fragment_bitrates);
+  gst_adaptive_demux_abr_free (stream->abr);
 
   if (stream->pad) {
     gst_object_unref (stream->pad);
@@ -2145,6 +2391,14 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      /* also wakes up the download loop if waiting for a prefetch */
+      if (stream->prefetch)
+        gst_adaptive_demux_prefetch_flush (stream->prefetch);
+      if (stream->cache_downloader) {
+        gst_uri_downloader_cancel (stream->cache_downloader);
+        g_cancellable_cancel (stream->cache_cancellable);
+      }
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2254,22 +2508,47 @@ gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
   stream->pending_events = g_list_append (stream->pending_events, event);
 }
 
-/* must be called with manifest_lock taken */
-static guint64
-_update_average_bitrate (GstAdaptiveDemux * demux,
-    GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+/* Amount of data pushed by @stream that downstream didn't play yet, or
+ * GST_CLOCK_TIME_NONE if unknown.
+ * must be called with manifest_lock taken */
+static GstClockTime
+gst_adaptive_demux_stream_get_buffer_level (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
 {
-  gint index = stream->moving_index % NUM_LOOKBACK_FRAGMENTS;
+  GstClockTime running_time, pushed_running_time = GST_CLOCK_TIME_NONE;
 
-  stream->moving_bitrate -= stream->fragment_bitrates[index];
-  stream->fragment_bitrates[index] = new_bitrate;
-  stream->moving_bitrate += new_bitrate;
+  if (GST_STATE (demux) != GST_STATE_PLAYING)
+    return GST_CLOCK_TIME_NONE;
 
-  stream->moving_index += 1;
+  running_time =
+      gst_element_get_current_running_time (GST_ELEMENT_CAST (demux));
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return GST_CLOCK_TIME_NONE;
 
-  if (stream->moving_index > NUM_LOOKBACK_FRAGMENTS)
-    return stream->moving_bitrate / NUM_LOOKBACK_FRAGMENTS;
-  return stream->moving_bitrate / stream->moving_index;
+  GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
+  if (demux->segment.rate == 1.0) {
+    pushed_running_time = gst_segment_to_running_time (&stream->segment,
+        GST_FORMAT_TIME, stream->segment.position);
+  }
+  GST_ADAPTIVE_DEMUX_SEGMENT_UNLOCK (demux);
+
+  if (!GST_CLOCK_TIME_IS_VALID (pushed_running_time))
+    return GST_CLOCK_TIME_NONE;
+
+  if (pushed_running_time < running_time)
+    return 0;
+  return pushed_running_time - running_time;
+}
+
+static guint64
+gst_adaptive_demux_stream_get_target_bitrate_default (GstAdaptiveDemuxStream *
+    stream, GstClockTime buffer_level)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+
+  return gst_adaptive_demux_abr_get_bitrate (stream->abr,
+      demux->priv->abr_algorithm, demux->bitrate_limit,
+      stream->fragment.duration, buffer_level);
 }
 
 /* must be called with manifest_lock taken */
@@ -2277,8 +2556,8 @@ static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
 {
-  guint64 average_bitrate;
-  guint64 fragment_bitrate;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstClockTime buffer_level;
 
   if (demux->connection_speed) {
     GST_LOG_OBJECT (demux, "Connection-speed is set to %u kbps, using it",
@@ -2287,36 +2566,22 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
     return demux->connection_speed;
   }
 
-  fragment_bitrate = stream->last_bitrate;
-  GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
-      fragment_bitrate);
-
-  average_bitrate = _update_average_bitrate (demux, stream, fragment_bitrate);
-
-  GST_INFO_OBJECT (GST_ADAPTIVE_DEMUX_STREAM_PAD (stream),
-      "last fragment bitrate was %" G_GUINT64_FORMAT, fragment_bitrate);
   GST_INFO_OBJECT (GST_ADAPTIVE_DEMUX_STREAM_PAD (stream),
-      "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
-      NUM_LOOKBACK_FRAGMENTS, average_bitrate);
+      "last fragment bitrate was %" G_GUINT64_FORMAT ", downloaded in %"
+      GST_TIME_FORMAT " with a latency of %" GST_TIME_FORMAT,
+      stream->last_bitrate, GST_TIME_ARGS (stream->last_download_time),
+      GST_TIME_ARGS (stream->last_latency));
 
-  /* Conservative approach, make sure we don't upgrade too fast */
-  stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  gst_adaptive_demux_abr_add_sample (stream->abr, stream->last_bitrate,
+      stream->last_download_time, stream->last_latency);
 
-  stream->current_download_rate *= demux->bitrate_limit;
-  GST_DEBUG_OBJECT (demux, "Bitrate after bitrate limit (%0.2f): %"
-      G_GUINT64_FORMAT, demux->bitrate_limit, stream->current_download_rate);
+  buffer_level = gst_adaptive_demux_stream_get_buffer_level (demux, stream);
+  stream->current_download_rate =
+      klass->stream_get_target_bitrate (stream, buffer_level);
 
-#if 0
-  /* Debugging code, modulate the bitrate every few fragments */
-  {
-    static guint ctr = 0;
-    if (ctr % 3 == 0) {
-      GST_INFO_OBJECT (demux, "Halving reported bitrate for debugging");
-      stream->current_download_rate /= 2;
-    }
-    ctr++;
-  }
-#endif
+  GST_DEBUG_OBJECT (demux, "Target bitrate with %" GST_TIME_FORMAT
+      " buffered: %" G_GUINT64_FORMAT, GST_TIME_ARGS (buffer_level),
+      stream->current_download_rate);
 
   return stream->current_download_rate;
 }
@@ -2578,18 +2843,16 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* Handles a downloaded buffer, either from the source element or
+ * prefetched */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_chain (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
   GST_MANIFEST_LOCK (demux);
 
   /* do not make any changes if the stream is cancelled */
@@ -2740,6 +3003,14 @@ error:
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstAdaptiveDemuxStream *stream = gst_pad_get_element_private (pad);
+
+  return gst_adaptive_demux_stream_chain (stream, buffer);
+}
+
 /* must be called with manifest_lock taken */
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
@@ -3385,6 +3656,263 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_stream_prefetch_fragments (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  guint n;
+
+  for (n = 1; n <= demux->priv->prefetch_depth &&
+      gst_adaptive_demux_prefetch_can_request (stream->prefetch); n++) {
+    GstAdaptiveDemuxStreamFragment fragment = { 0, };
+    gboolean known;
+
+    fragment.range_end = -1;
+    known = klass->stream_peek_fragment (stream, n, &fragment);
+    if (known && fragment.uri) {
+      gst_adaptive_demux_prefetch_request (stream->prefetch, fragment.uri,
+          fragment.range_start, fragment.range_end);
+    }
+    gst_adaptive_demux_stream_fragment_clear (&fragment);
+
+    if (!known)
+      break;
+  }
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Pushes a whole fragment that was downloaded into memory as if it came
+ * from the source element
+ */
+static void
+gst_adaptive_demux_stream_push_downloaded (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstBuffer * buffer,
+    GstClockTime download_time, GstFlowReturn * ret)
+{
+  GstClockTime now;
+  gboolean finished, cancelled;
+  gsize size;
+
+  /* Fill in what _uri_handler_probe() measures for the source element, so
+   * that bitrate selection keeps working on in-memory downloads */
+  size = gst_buffer_get_size (buffer);
+  download_time = MAX (download_time, 1);
+  now = gst_adaptive_demux_get_monotonic_time (demux);
+  stream->download_start_time =
+      GST_TIME_AS_USECONDS (now - MIN (now, download_time));
+  stream->fragment_bytes_downloaded = size;
+  stream->last_download_time = download_time;
+  stream->last_latency = GST_CLOCK_TIME_NONE;
+  stream->last_bitrate =
+      gst_util_uint64_scale (size, 8 * GST_SECOND, download_time);
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0 &&
+      GST_CLOCK_TIME_IS_VALID (stream->fragment.duration)) {
+    stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+            8 * GST_SECOND, stream->fragment.duration));
+  }
+
+  GST_DEBUG_OBJECT (stream->pad, "Pushing downloaded fragment of %"
+      G_GSIZE_FORMAT " bytes, downloaded in %" GST_TIME_FORMAT " (%"
+      G_GUINT64_FORMAT " bps)", size, GST_TIME_ARGS (download_time),
+      stream->last_bitrate);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  *ret = gst_adaptive_demux_stream_chain (stream, buffer);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  finished = stream->download_finished;
+  cancelled = stream->cancelled;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (G_UNLIKELY (cancelled)) {
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return;
+  }
+
+  /* the whole fragment was pushed, behave like an EOS from the source */
+  if (*ret == GST_FLOW_OK && !finished)
+    gst_adaptive_demux_eos_handling (stream);
+  else if (!finished && stream->last_ret == GST_FLOW_OK)
+    stream->last_ret = *ret;
+
+  *ret = stream->last_ret;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Pushes the current fragment if it was prefetched and queues the download
+ * of the upcoming ones. Returns %FALSE if the current fragment needs to be
+ * downloaded through the source element instead.
+ */
+static gboolean
+gst_adaptive_demux_stream_download_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstFlowReturn * ret)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+  GstBuffer *buffer;
+  gboolean have_fragment;
+
+  /* fragments are only prefetched in plain forward playback */
+  if (klass->stream_peek_fragment == NULL || demux->priv->prefetch_depth == 0
+      || demux->segment.rate <= 0
+      || GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (demux)) {
+    if (stream->prefetch)
+      gst_adaptive_demux_prefetch_flush (stream->prefetch);
+    return FALSE;
+  }
+
+  if (stream->prefetch == NULL) {
+    GstAdaptiveDemuxCache *cache = gst_adaptive_demux_get_cache (demux);
+
+    stream->prefetch =
+        gst_adaptive_demux_prefetch_new (GST_ELEMENT_CAST (demux),
+        demux->priv->prefetch_depth, PREFETCH_MAX_BYTES, cache);
+    if (cache)
+      gst_object_unref (cache);
+  }
+
+  have_fragment = gst_adaptive_demux_prefetch_skip_to (stream->prefetch,
+      stream->fragment.uri, stream->fragment.range_start,
+      stream->fragment.range_end);
+
+  gst_adaptive_demux_stream_prefetch_fragments (demux, stream);
+
+  if (!have_fragment)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (stream->pad, "Waiting for prefetched fragment %s",
+      stream->fragment.uri);
+
+  GST_MANIFEST_UNLOCK (demux);
+  buffer = gst_adaptive_demux_prefetch_take (stream->prefetch, &download_time);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    if (buffer)
+      gst_buffer_unref (buffer);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetching failed, downloading again");
+    return FALSE;
+  }
+
+  gst_adaptive_demux_stream_push_downloaded (demux, stream, buffer,
+      download_time, ret);
+
+  return TRUE;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Downloads the current fragment through the shared fragment cache, so
+ * that other demuxers of the pipeline fetching the same fragment reuse this
+ * download. Returns %FALSE if the current fragment needs to be downloaded
+ * through the source element instead.
+ *
+ * Fragments go through the cache whole before being pushed, which would add
+ * a fragment of latency at the live edge, so live streams don't use it.
+ */
+static gboolean
+gst_adaptive_demux_stream_download_cached (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstFlowReturn * ret)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+  GstBuffer *buffer;
+  GError *err = NULL;
+  gchar *uri;
+  gint64 range_start, range_end;
+  gboolean cancelled;
+
+  if (demux->segment.rate <= 0
+      || GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (demux)
+      || gst_adaptive_demux_is_live (demux))
+    return FALSE;
+
+  cache = gst_adaptive_demux_get_cache (demux);
+  if (cache == NULL)
+    return FALSE;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_object_unref (cache);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  if (stream->cache_downloader == NULL) {
+    stream->cache_downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (stream->cache_downloader,
+        GST_ELEMENT_CAST (demux));
+    gst_uri_downloader_set_pool_size (stream->cache_downloader, 2);
+    stream->cache_cancellable = g_cancellable_new ();
+  }
+  gst_uri_downloader_reset (stream->cache_downloader);
+  g_cancellable_reset (stream->cache_cancellable);
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  uri = g_strdup (stream->fragment.uri);
+  range_start = stream->fragment.range_start;
+  range_end = stream->fragment.range_end;
+
+  GST_MANIFEST_UNLOCK (demux);
+  buffer = gst_adaptive_demux_cache_fetch (cache, stream->cache_downloader,
+      uri, NULL, range_start, range_end, stream->cache_cancellable,
+      &download_time, &err);
+  GST_MANIFEST_LOCK (demux);
+
+  gst_object_unref (cache);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  cancelled = stream->cancelled;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (G_UNLIKELY (cancelled)) {
+    if (buffer)
+      gst_buffer_unref (buffer);
+    g_clear_error (&err);
+    g_free (uri);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+
+  g_free (uri);
+
+  if (buffer == NULL) {
+    /* error, but ask to retry, like a failed download of the source
+     * element. The HTTP status is not known here */
+    GST_DEBUG_OBJECT (stream->pad, "Failed to fetch through the cache: %s",
+        err->message);
+    stream->last_status_code = 0;
+    g_clear_error (&stream->last_error);
+    stream->last_error = err;
+    *ret = stream->last_ret = GST_FLOW_CUSTOM_ERROR;
+    return TRUE;
+  }
+
+  gst_adaptive_demux_stream_push_downloaded (demux, stream, buffer,
+      download_time, ret);
+
+  return TRUE;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3502,7 +4030,9 @@ again:
       if (range_end != -1)
         chunk_end = MIN (chunk_end, range_end);
     }
-  } else {
+  } else if (!gst_adaptive_demux_stream_download_prefetched (demux, stream,
+          &ret) && !gst_adaptive_demux_stream_download_cached (demux, stream,
+          &ret)) {
     ret =
         gst_adaptive_demux_stream_download_uri (demux, stream, url,
         stream->fragment.range_start, stream->fragment.range_end, &http_status);
@@ -4404,6 +4934,24 @@ gst_adaptive_demux_update_manifest_default (GstAdaptiveDemux * demux)
   download = gst_uri_downloader_fetch_uri (demux->downloader,
       demux->manifest_uri, NULL, TRUE, TRUE, TRUE, &error);
   if (download) {
+    GstStructure *stats, *timing;
+
+    stats = gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
+        "manifest-uri", G_TYPE_STRING, demux->manifest_uri,
+        "uri", G_TYPE_STRING, demux->manifest_uri,
+        "manifest-download-start", GST_TYPE_CLOCK_TIME,
+        download->download_start_time,
+        "manifest-download-stop", GST_TYPE_CLOCK_TIME,
+        download->download_stop_time, NULL);
+    timing = gst_fragment_get_timing (download);
+    if (timing) {
+      gst_structure_set (stats, "manifest-download-timing", GST_TYPE_STRUCTURE,
+          timing, NULL);
+      gst_structure_free (timing);
+    }
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_element (GST_OBJECT_CAST (demux), stats));
+
     g_free (demux->manifest_uri);
     g_free (demux->manifest_base_uri);
     if (download->redirect_permanent && download->redirect_uri) {
@@ -4518,6 +5066,112 @@ gst_adaptive_demux_advance_period (GstAdaptiveDemux * demux)
   gst_adaptive_demux_start_tasks (demux, TRUE);
 }
 
+/**
+ * gst_adaptive_demux_fetch_uri:
+ * @demux: #GstAdaptiveDemux
+ * @uri: the URI to download
+ * @referer: (nullable): the referer to use for the download
+ * @allow_cache: whether the response may come from a cache
+ * @err: (nullable): return location for a #GError
+ *
+ * Downloads a small resource, such as a decryption key, with the demuxer's
+ * downloader. If @allow_cache is %TRUE and the demuxer uses a shared
+ * fragment cache, the resource is looked up in and added to that cache.
+ *
+ * Returns: (transfer full) (nullable): the downloaded data
+ *
+ * Since: 1.20
+ */
+GstBuffer *
+gst_adaptive_demux_fetch_uri (GstAdaptiveDemux * demux, const gchar * uri,
+    const gchar * referer, gboolean allow_cache, GError ** err)
+{
+  GstAdaptiveDemuxCache *cache = NULL;
+  GstFragment *download;
+  GstBuffer *buffer = NULL;
+
+  g_return_val_if_fail (GST_IS_ADAPTIVE_DEMUX (demux), NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+
+  if (allow_cache)
+    cache = gst_adaptive_demux_get_cache (demux);
+
+  if (cache) {
+    buffer = gst_adaptive_demux_cache_fetch (cache, demux->downloader, uri,
+        referer, -1, -1, NULL, NULL, err);
+    gst_object_unref (cache);
+    return buffer;
+  }
+
+  download = gst_uri_downloader_fetch_uri (demux->downloader, uri, referer,
+      FALSE, FALSE, allow_cache, err);
+  if (download) {
+    buffer = gst_fragment_get_buffer (download);
+    g_object_unref (download);
+  }
+
+  return buffer;
+}
+
+/**
+ * gst_adaptive_demux_fetch_uri_unlocked:
+ * @demux: #GstAdaptiveDemux
+ * @uri: the URI to download
+ * @referer: (nullable): the referer to use for the download
+ * @err: (nullable): return location for a #GError
+ *
+ * Downloads @uri with the demuxer's downloader, releasing the manifest lock
+ * while waiting for the response so that the streams keep going meanwhile.
+ * Meant for requests that the server may hold back, such as blocking
+ * playlist reloads.
+ *
+ * Must be called with the manifest lock taken, from the manifest update
+ * task. Anything may have changed while the lock was released, the caller
+ * has to validate its state again if this returns a download.
+ *
+ * Returns: (transfer full) (nullable): the download, or %NULL if it failed
+ *   or the update task was stopped meanwhile
+ *
+ * Since: 1.20
+ */
+GstFragment *
+gst_adaptive_demux_fetch_uri_unlocked (GstAdaptiveDemux * demux,
+    const gchar * uri, const gchar * referer, GError ** err)
+{
+  GstFragment *download;
+  gchar *uri_copy, *referer_copy;
+  gboolean stopped;
+
+  g_return_val_if_fail (GST_IS_ADAPTIVE_DEMUX (demux), NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+
+  /* the strings may belong to the manifest */
+  uri_copy = g_strdup (uri);
+  referer_copy = g_strdup (referer);
+
+  GST_MANIFEST_UNLOCK (demux);
+  download = gst_uri_downloader_fetch_uri (demux->downloader, uri_copy,
+      referer_copy, TRUE, TRUE, TRUE, err);
+  GST_MANIFEST_LOCK (demux);
+
+  g_free (referer_copy);
+
+  g_mutex_lock (&demux->priv->updates_timed_lock);
+  stopped = demux->priv->stop_updates_task;
+  g_mutex_unlock (&demux->priv->updates_timed_lock);
+
+  if (download && (stopped || !gst_adaptive_demux_is_running (demux))) {
+    GST_DEBUG_OBJECT (demux, "Stopped while downloading %s", uri_copy);
+    g_object_unref (download);
+    download = NULL;
+    g_set_error (err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+        "Download of %s interrupted", uri_copy);
+  }
+  g_free (uri_copy);
+
+  return download;
+}
+
 /**
  * gst_adaptive_demux_get_monotonic_time:
  * Returns: a monotonically increasing time, using the system realtime clock
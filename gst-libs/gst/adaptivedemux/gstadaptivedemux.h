@@ -22,6 +22,7 @@
 #ifndef _GST_ADAPTIVE_DEMUX_H_
 #define _GST_ADAPTIVE_DEMUX_H_
 
+#include <gio/gio.h>
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
 #include <gst/uridownloader/gsturidownloader.h>
@@ -92,6 +93,8 @@ typedef struct _GstAdaptiveDemuxStream GstAdaptiveDemuxStream;
 typedef struct _GstAdaptiveDemux GstAdaptiveDemux;
 typedef struct _GstAdaptiveDemuxClass GstAdaptiveDemuxClass;
 typedef struct _GstAdaptiveDemuxPrivate GstAdaptiveDemuxPrivate;
+typedef struct _GstAdaptiveDemuxPrefetch GstAdaptiveDemuxPrefetch;
+typedef struct _GstAdaptiveDemuxAbr GstAdaptiveDemuxAbr;
 
 struct _GstAdaptiveDemuxStreamFragment
 {
@@ -179,10 +182,8 @@ struct _GstAdaptiveDemuxStream
   GstClockTime last_latency;
   GstClockTime last_download_time;
 
-  /* Average for the last fragments */
-  guint64 moving_bitrate;
-  guint moving_index;
-  guint64 *fragment_bitrates;
+  /* bitrate adaptation state, fed with the measurements above */
+  GstAdaptiveDemuxAbr *abr;
 
   /* QoS data : UNUSED !!! */
   GstClockTime qos_earliest_time;
@@ -195,6 +196,13 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* downloads of the upcoming fragments, if enabled */
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  /* downloads through the shared fragment cache, if enabled */
+  GstUriDownloader *cache_downloader;
+  GCancellable *cache_cancellable;
 };
 
 /**
@@ -371,6 +379,22 @@ struct _GstAdaptiveDemuxClass
    *          if there is no fragment.
    */
   GstFlowReturn (*stream_update_fragment_info) (GstAdaptiveDemuxStream * stream);
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @n: how many fragments ahead of the current one to look
+   * @fragment: the #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Sets the uri and range of the @n-th fragment after the current
+   * one in @fragment, without changing the state of @stream. Used to
+   * download the upcoming fragments ahead of time when the
+   * #GstAdaptiveDemux:prefetch-depth property is set.
+   *
+   * Returns: %TRUE if the fragment is known
+   *
+   * Since: 1.20
+   */
+  gboolean      (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
   /**
    * stream_select_bitrate:
    * @stream: #GstAdaptiveDemuxStream
@@ -385,6 +409,23 @@ struct _GstAdaptiveDemuxClass
    * Returns: %TRUE if the stream changed bitrate, %FALSE otherwise
    */
   gboolean      (*stream_select_bitrate) (GstAdaptiveDemuxStream * stream, guint64 bitrate);
+  /**
+   * stream_get_target_bitrate:
+   * @stream: #GstAdaptiveDemuxStream
+   * @buffer_level: the duration of the data pushed by @stream that wasn't
+   *   played yet, or %GST_CLOCK_TIME_NONE if unknown
+   *
+   * Computes the bitrate passed to stream_select_bitrate() once a fragment
+   * was downloaded, from the download measurements of @stream. The default
+   * implementation uses the algorithm selected by the
+   * #GstAdaptiveDemux:abr-algorithm property. Not called if the
+   * #GstAdaptiveDemux:connection-speed property is set.
+   *
+   * Returns: the target bitrate in bits per second
+   *
+   * Since: 1.20
+   */
+  guint64       (*stream_get_target_bitrate) (GstAdaptiveDemuxStream * stream, GstClockTime buffer_level);
   /**
    * stream_get_fragment_waiting_time:
    * @stream: #GstAdaptiveDemuxStream
@@ -523,6 +564,15 @@ GST_ADAPTIVE_DEMUX_API
 void gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
     GstEvent * event);
 
+GST_ADAPTIVE_DEMUX_API
+GstBuffer * gst_adaptive_demux_fetch_uri (GstAdaptiveDemux * demux,
+    const gchar * uri, const gchar * referer, gboolean allow_cache,
+    GError ** err);
+
+GST_ADAPTIVE_DEMUX_API
+GstFragment * gst_adaptive_demux_fetch_uri_unlocked (GstAdaptiveDemux * demux,
+    const gchar * uri, const gchar * referer, GError ** err);
+
 GST_ADAPTIVE_DEMUX_API
 GstClockTime gst_adaptive_demux_get_monotonic_time (GstAdaptiveDemux * demux);
 
@@ -0,0 +1,263 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Bitrate adaptation for GstAdaptiveDemux streams.
+ *
+ * The hybrid algorithm keeps two exponentially weighted moving averages of
+ * the throughput, weighted by the time spent transferring each fragment: a
+ * fast one that reacts to drops within a couple of seconds and a slow one
+ * that filters out short bursts. The smallest of the two is used, reduced
+ * by the share of a fragment duration lost in request latency.
+ *
+ * How much of that estimate is used depends on the amount of data queued
+ * downstream of the stream. With less than a fragment buffered, playback is
+ * about to stall and the estimate is scaled down further. With at least two
+ * fragments buffered, the estimation errors can be absorbed and more of the
+ * estimate is used. Switching up needs a clear margin over the previous
+ * target and switching down is delayed while the buffer is full, so that
+ * an estimate hovering around a representation bitrate doesn't make the
+ * stream go back and forth between two representations.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstadaptivedemuxabr.h"
+
+GST_DEBUG_CATEGORY_EXTERN (adaptivedemux_debug);
+#define GST_CAT_DEFAULT adaptivedemux_debug
+
+#define NUM_LOOKBACK_FRAGMENTS 3
+
+/* in seconds */
+#define FAST_HALF_LIFE 2.0
+#define SLOW_HALF_LIFE 5.0
+/* target increase needed to switch up */
+#define SWITCH_UP_MARGIN 1.15
+/* lowest share of the throughput kept when correcting for the latency */
+#define MIN_LATENCY_FACTOR 0.1
+
+typedef struct
+{
+  gdouble half_life;
+  gdouble estimate;
+  gdouble total_weight;
+} GstAdaptiveDemuxAbrEwma;
+
+struct _GstAdaptiveDemuxAbr
+{
+  /* moving average */
+  guint64 fragment_bitrates[NUM_LOOKBACK_FRAGMENTS];
+  guint64 moving_bitrate;
+  guint moving_index;
+  guint64 last_bitrate;
+
+  /* hybrid, in bits per second and seconds */
+  GstAdaptiveDemuxAbrEwma fast;
+  GstAdaptiveDemuxAbrEwma slow;
+  GstAdaptiveDemuxAbrEwma latency;
+  gdouble target;
+};
+
+static void
+ewma_init (GstAdaptiveDemuxAbrEwma * ewma, gdouble half_life)
+{
+  ewma->half_life = half_life;
+  ewma->estimate = 0;
+  ewma->total_weight = 0;
+}
+
+static void
+ewma_add (GstAdaptiveDemuxAbrEwma * ewma, gdouble weight, gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / ewma->half_life);
+
+  ewma->estimate = value * (1 - alpha) + alpha * ewma->estimate;
+  ewma->total_weight += weight;
+}
+
+static gdouble
+ewma_get (const GstAdaptiveDemuxAbrEwma * ewma)
+{
+  /* the estimate starts from 0, correct for it until enough samples were
+   * accumulated */
+  gdouble zero_factor = 1 - pow (0.5, ewma->total_weight / ewma->half_life);
+
+  if (zero_factor <= 0)
+    return 0;
+
+  return ewma->estimate / zero_factor;
+}
+
+GstAdaptiveDemuxAbr *
+gst_adaptive_demux_abr_new (void)
+{
+  GstAdaptiveDemuxAbr *abr = g_slice_new0 (GstAdaptiveDemuxAbr);
+
+  ewma_init (&abr->fast, FAST_HALF_LIFE);
+  ewma_init (&abr->slow, SLOW_HALF_LIFE);
+  ewma_init (&abr->latency, FAST_HALF_LIFE);
+
+  return abr;
+}
+
+void
+gst_adaptive_demux_abr_free (GstAdaptiveDemuxAbr * abr)
+{
+  g_slice_free (GstAdaptiveDemuxAbr, abr);
+}
+
+/* Adds the measurements of a fragment download. @bitrate is the size of the
+ * fragment over @download_time, which includes the @latency before the first
+ * byte was received */
+void
+gst_adaptive_demux_abr_add_sample (GstAdaptiveDemuxAbr * abr, guint64 bitrate,
+    GstClockTime download_time, GstClockTime latency)
+{
+  gint index = abr->moving_index % NUM_LOOKBACK_FRAGMENTS;
+  GstClockTime transfer_time;
+  gdouble throughput;
+
+  abr->moving_bitrate -= abr->fragment_bitrates[index];
+  abr->fragment_bitrates[index] = bitrate;
+  abr->moving_bitrate += bitrate;
+  abr->moving_index += 1;
+  abr->last_bitrate = bitrate;
+
+  if (!GST_CLOCK_TIME_IS_VALID (download_time) || download_time == 0)
+    return;
+
+  transfer_time = download_time;
+  if (GST_CLOCK_TIME_IS_VALID (latency) && latency < download_time)
+    transfer_time -= latency;
+
+  throughput = gst_util_uint64_scale (bitrate, download_time, transfer_time);
+  ewma_add (&abr->fast, (gdouble) transfer_time / GST_SECOND, throughput);
+  ewma_add (&abr->slow, (gdouble) transfer_time / GST_SECOND, throughput);
+  if (GST_CLOCK_TIME_IS_VALID (latency))
+    ewma_add (&abr->latency, 1, (gdouble) latency / GST_SECOND);
+
+  GST_LOG ("throughput %" G_GUINT64_FORMAT " bps over %" GST_TIME_FORMAT
+      ", fast estimate %.0f, slow estimate %.0f", (guint64) throughput,
+      GST_TIME_ARGS (transfer_time), ewma_get (&abr->fast),
+      ewma_get (&abr->slow));
+}
+
+static guint64
+gst_adaptive_demux_abr_get_moving_average_bitrate (GstAdaptiveDemuxAbr * abr,
+    gdouble bitrate_limit)
+{
+  guint64 average_bitrate;
+
+  if (abr->moving_index == 0)
+    return 0;
+
+  if (abr->moving_index > NUM_LOOKBACK_FRAGMENTS)
+    average_bitrate = abr->moving_bitrate / NUM_LOOKBACK_FRAGMENTS;
+  else
+    average_bitrate = abr->moving_bitrate / abr->moving_index;
+
+  GST_DEBUG ("Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
+      NUM_LOOKBACK_FRAGMENTS, average_bitrate);
+
+  /* Conservative approach, make sure we don't upgrade too fast */
+  return MIN (average_bitrate, abr->last_bitrate) * bitrate_limit;
+}
+
+static guint64
+gst_adaptive_demux_abr_get_hybrid_bitrate (GstAdaptiveDemuxAbr * abr,
+    gdouble bitrate_limit, GstClockTime fragment_duration,
+    GstClockTime buffer_level)
+{
+  gdouble throughput, duration = 0, level = -1, low, high;
+  gdouble factor = bitrate_limit;
+  gdouble target;
+
+  if (abr->fast.total_weight == 0)
+    return gst_adaptive_demux_abr_get_moving_average_bitrate (abr,
+        bitrate_limit);
+
+  throughput = MIN (ewma_get (&abr->fast), ewma_get (&abr->slow));
+
+  if (GST_CLOCK_TIME_IS_VALID (fragment_duration) && fragment_duration > 0)
+    duration = (gdouble) fragment_duration / GST_SECOND;
+  if (GST_CLOCK_TIME_IS_VALID (buffer_level))
+    level = (gdouble) buffer_level / GST_SECOND;
+
+  /* A fragment has to be downloaded within its duration, of which the
+   * request latency is lost */
+  if (duration > 0) {
+    throughput *= MAX (1 - ewma_get (&abr->latency) / duration,
+        MIN_LATENCY_FACTOR);
+  }
+
+  low = duration;
+  high = 2 * duration;
+  if (level >= 0 && duration > 0) {
+    gdouble full_factor = (1 + bitrate_limit) / 2;
+
+    if (level < low)
+      factor = bitrate_limit * (0.5 + 0.5 * level / low);
+    else if (level >= high)
+      factor = full_factor;
+    else
+      factor = bitrate_limit + (full_factor - bitrate_limit) *
+          (level - low) / (high - low);
+  }
+
+  target = throughput * factor;
+
+  if (abr->target > 0) {
+    if (target > abr->target) {
+      if ((level >= 0 && level < low) || target < abr->target * SWITCH_UP_MARGIN)
+        target = abr->target;
+    } else if (level >= high && throughput >= abr->target * bitrate_limit) {
+      target = abr->target;
+    }
+  }
+
+  GST_DEBUG ("throughput %.0f bps, buffer level %.3f s, factor %.2f: "
+      "target %.0f bps", throughput, level, factor, target);
+
+  abr->target = target;
+
+  return target;
+}
+
+/* Returns the bitrate the next fragments should be selected for.
+ * @buffer_level is the amount of data queued downstream, if known */
+guint64
+gst_adaptive_demux_abr_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    GstAdaptiveDemuxAbrAlgorithm algorithm, gdouble bitrate_limit,
+    GstClockTime fragment_duration, GstClockTime buffer_level)
+{
+  switch (algorithm) {
+    case GST_ADAPTIVE_DEMUX_ABR_HYBRID:
+      return gst_adaptive_demux_abr_get_hybrid_bitrate (abr, bitrate_limit,
+          fragment_duration, buffer_level);
+    case GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE:
+    default:
+      return gst_adaptive_demux_abr_get_moving_average_bitrate (abr,
+          bitrate_limit);
+  }
+}
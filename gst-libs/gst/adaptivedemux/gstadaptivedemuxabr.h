@@ -0,0 +1,60 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_ADAPTIVE_DEMUX_ABR_H__
+#define __GST_ADAPTIVE_DEMUX_ABR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  /* MIN of the last fragment bitrate and of the average of the last few
+   * fragments, scaled by the bitrate limit */
+  GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+  /* EWMA throughput estimate, corrected for the request latency and scaled
+   * depending on how much data is buffered downstream */
+  GST_ADAPTIVE_DEMUX_ABR_HYBRID,
+} GstAdaptiveDemuxAbrAlgorithm;
+
+typedef struct _GstAdaptiveDemuxAbr GstAdaptiveDemuxAbr;
+
+G_GNUC_INTERNAL
+GstAdaptiveDemuxAbr * gst_adaptive_demux_abr_new   (void);
+
+G_GNUC_INTERNAL
+void       gst_adaptive_demux_abr_free             (GstAdaptiveDemuxAbr * abr);
+
+G_GNUC_INTERNAL
+void       gst_adaptive_demux_abr_add_sample       (GstAdaptiveDemuxAbr * abr,
+                                                    guint64 bitrate,
+                                                    GstClockTime download_time,
+                                                    GstClockTime latency);
+
+G_GNUC_INTERNAL
+guint64    gst_adaptive_demux_abr_get_bitrate      (GstAdaptiveDemuxAbr * abr,
+                                                    GstAdaptiveDemuxAbrAlgorithm algorithm,
+                                                    gdouble bitrate_limit,
+                                                    GstClockTime fragment_duration,
+                                                    GstClockTime buffer_level);
+
+G_END_DECLS
+
+#endif /* __GST_ADAPTIVE_DEMUX_ABR_H__ */
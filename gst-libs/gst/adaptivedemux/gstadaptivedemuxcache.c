@@ -0,0 +1,384 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * gstadaptivedemuxcache.c: fragment cache shared between demuxers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Size bounded LRU cache of downloaded fragments and keys, keyed by URI
+ * and byte range, that several demuxers of the same process can share
+ * through a GstContext.
+ *
+ * A fetch of something that is not cached yet inserts a pending entry and
+ * downloads it with the caller's GstUriDownloader. Concurrent fetches of
+ * the same entry wait for that download instead of starting their own.
+ * If it fails, the entry is dropped and one of the waiters downloads it
+ * again.
+ *
+ * Only completed entries are accounted in the size and can be evicted,
+ * least recently used first. Entries bigger than the whole cache are
+ * handed to the waiters but not kept.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstadaptivedemuxcache.h"
+
+GST_DEBUG_CATEGORY_EXTERN (adaptivedemux_debug);
+#define GST_CAT_DEFAULT adaptivedemux_debug
+
+/* how often waiters check their GCancellable */
+#define WAIT_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+
+enum
+{
+  PROP_0,
+  PROP_MAX_SIZE,
+  PROP_STATS,
+};
+
+typedef struct
+{
+  gint ref_count;
+
+  gchar *key;
+  /* protected by the cache lock */
+  gboolean pending;
+  GstBuffer *buffer;
+  GstClockTime download_time;
+  GList *lru_link;              /* in lru, once completed and kept */
+} GstAdaptiveDemuxCacheEntry;
+
+struct _GstAdaptiveDemuxCache
+{
+  GstObject parent;
+
+  guint64 max_size;
+
+  GMutex lock;
+  GCond cond;
+  /* key -> GstAdaptiveDemuxCacheEntry */
+  GHashTable *entries;
+  /* completed entries, most recently used first */
+  GQueue lru;
+  guint64 size;
+
+  guint64 hits;
+  guint64 misses;
+  guint64 coalesced;
+  guint64 evictions;
+};
+
+G_DEFINE_TYPE (GstAdaptiveDemuxCache, gst_adaptive_demux_cache,
+    GST_TYPE_OBJECT);
+
+static GstAdaptiveDemuxCacheEntry *
+cache_entry_ref (GstAdaptiveDemuxCacheEntry * entry)
+{
+  g_atomic_int_inc (&entry->ref_count);
+  return entry;
+}
+
+static void
+cache_entry_unref (GstAdaptiveDemuxCacheEntry * entry)
+{
+  if (g_atomic_int_dec_and_test (&entry->ref_count)) {
+    g_free (entry->key);
+    if (entry->buffer)
+      gst_buffer_unref (entry->buffer);
+    g_slice_free (GstAdaptiveDemuxCacheEntry, entry);
+  }
+}
+
+static void
+gst_adaptive_demux_cache_finalize (GObject * object)
+{
+  GstAdaptiveDemuxCache *cache = GST_ADAPTIVE_DEMUX_CACHE (object);
+
+  g_queue_clear (&cache->lru);
+  g_hash_table_destroy (cache->entries);
+  g_mutex_clear (&cache->lock);
+  g_cond_clear (&cache->cond);
+
+  G_OBJECT_CLASS (gst_adaptive_demux_cache_parent_class)->finalize (object);
+}
+
+static void
+gst_adaptive_demux_cache_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstAdaptiveDemuxCache *cache = GST_ADAPTIVE_DEMUX_CACHE (object);
+
+  switch (prop_id) {
+    case PROP_MAX_SIZE:
+      g_value_set_uint64 (value, cache->max_size);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_adaptive_demux_cache_get_stats (cache));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_adaptive_demux_cache_class_init (GstAdaptiveDemuxCacheClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_adaptive_demux_cache_finalize;
+  gobject_class->get_property = gst_adaptive_demux_cache_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE,
+      g_param_spec_uint64 ("max-size", "Maximum size",
+          "Maximum size of the cached fragments in bytes", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Hit and miss statistics of the cache", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_adaptive_demux_cache_init (GstAdaptiveDemuxCache * cache)
+{
+  g_mutex_init (&cache->lock);
+  g_cond_init (&cache->cond);
+  cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) cache_entry_unref);
+  g_queue_init (&cache->lru);
+}
+
+GstAdaptiveDemuxCache *
+gst_adaptive_demux_cache_new (guint64 max_size)
+{
+  GstAdaptiveDemuxCache *cache;
+
+  cache = g_object_new (GST_TYPE_ADAPTIVE_DEMUX_CACHE, NULL);
+  gst_object_ref_sink (cache);
+  cache->max_size = max_size;
+
+  return cache;
+}
+
+/* must be called with the cache lock taken */
+static void
+gst_adaptive_demux_cache_remove (GstAdaptiveDemuxCache * cache,
+    GstAdaptiveDemuxCacheEntry * entry)
+{
+  if (entry->lru_link) {
+    g_queue_delete_link (&cache->lru, entry->lru_link);
+    entry->lru_link = NULL;
+    cache->size -= gst_buffer_get_size (entry->buffer);
+  }
+  g_hash_table_remove (cache->entries, entry->key);
+}
+
+/* must be called with the cache lock taken */
+static void
+gst_adaptive_demux_cache_complete (GstAdaptiveDemuxCache * cache,
+    GstAdaptiveDemuxCacheEntry * entry, GstBuffer * buffer,
+    GstClockTime download_time)
+{
+  gsize size;
+
+  entry->pending = FALSE;
+  g_cond_broadcast (&cache->cond);
+
+  if (buffer == NULL) {
+    gst_adaptive_demux_cache_remove (cache, entry);
+    return;
+  }
+
+  /* the demuxers set timestamps and flags on the buffers they get, keep a
+   * buffer of our own. The memory is shared. */
+  entry->buffer = gst_buffer_copy (buffer);
+  entry->download_time = download_time;
+
+  size = gst_buffer_get_size (buffer);
+  if (size > cache->max_size) {
+    GST_DEBUG_OBJECT (cache, "Not keeping %s of %" G_GSIZE_FORMAT " bytes",
+        entry->key, size);
+    gst_adaptive_demux_cache_remove (cache, entry);
+    return;
+  }
+
+  g_queue_push_head (&cache->lru, entry);
+  entry->lru_link = cache->lru.head;
+  cache->size += size;
+
+  while (cache->size > cache->max_size) {
+    GstAdaptiveDemuxCacheEntry *oldest = g_queue_peek_tail (&cache->lru);
+
+    GST_LOG_OBJECT (cache, "Evicting %s", oldest->key);
+    gst_adaptive_demux_cache_remove (cache, oldest);
+    cache->evictions++;
+  }
+}
+
+/**
+ * gst_adaptive_demux_cache_fetch:
+ * @cache: the #GstAdaptiveDemuxCache
+ * @downloader: downloader used if the fragment is not cached yet
+ * @uri: the URI to fetch
+ * @referer: (nullable): the referer of the request
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, use -1 for unspecified
+ * @cancellable: (nullable): to stop waiting for the download of another
+ *   demuxer. The own downloads are cancelled through @downloader.
+ * @download_time: (out): how long the download took
+ * @err: return location for a #GError
+ *
+ * Returns: (transfer full) (nullable): the content of @uri, in a buffer that
+ *   only shares its memory with the cache and the other demuxers
+ */
+GstBuffer *
+gst_adaptive_demux_cache_fetch (GstAdaptiveDemuxCache * cache,
+    GstUriDownloader * downloader, const gchar * uri, const gchar * referer,
+    gint64 range_start, gint64 range_end, GCancellable * cancellable,
+    GstClockTime * download_time, GError ** err)
+{
+  GstAdaptiveDemuxCacheEntry *entry;
+  GstFragment *download;
+  GstBuffer *buffer = NULL;
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  gchar *key;
+
+  key = g_strdup_printf ("%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT " %s",
+      range_start, range_end, uri);
+
+  g_mutex_lock (&cache->lock);
+  while ((entry = g_hash_table_lookup (cache->entries, key))) {
+    if (!entry->pending) {
+      GST_LOG_OBJECT (cache, "Hit for %s", key);
+      cache->hits++;
+      g_queue_unlink (&cache->lru, entry->lru_link);
+      g_queue_push_head_link (&cache->lru, entry->lru_link);
+      buffer = gst_buffer_copy (entry->buffer);
+      time = entry->download_time;
+      goto done;
+    }
+
+    GST_LOG_OBJECT (cache, "Waiting for the pending download of %s", key);
+    cache->coalesced++;
+    cache_entry_ref (entry);
+    while (entry->pending && !g_cancellable_is_cancelled (cancellable)) {
+      g_cond_wait_until (&cache->cond, &cache->lock,
+          g_get_monotonic_time () + WAIT_INTERVAL);
+    }
+
+    if (entry->buffer) {
+      buffer = gst_buffer_copy (entry->buffer);
+      time = entry->download_time;
+    }
+    cache_entry_unref (entry);
+
+    if (buffer || g_cancellable_is_cancelled (cancellable))
+      goto done;
+
+    /* the download failed, try it ourselves */
+  }
+
+  cache->misses++;
+  entry = g_slice_new0 (GstAdaptiveDemuxCacheEntry);
+  entry->ref_count = 1;
+  entry->key = key;
+  entry->pending = TRUE;
+  key = NULL;
+  g_hash_table_insert (cache->entries, entry->key, entry);
+  cache_entry_ref (entry);
+  g_mutex_unlock (&cache->lock);
+
+  GST_DEBUG_OBJECT (cache, "Downloading %s", entry->key);
+  download = gst_uri_downloader_fetch_uri_with_range (downloader, uri, referer,
+      FALSE, FALSE, TRUE, range_start, range_end, err);
+  if (download) {
+    buffer = gst_fragment_get_buffer (download);
+    time = download->download_stop_time - download->download_start_time;
+    g_object_unref (download);
+  }
+
+  g_mutex_lock (&cache->lock);
+  gst_adaptive_demux_cache_complete (cache, entry, buffer, time);
+  cache_entry_unref (entry);
+
+done:
+  g_mutex_unlock (&cache->lock);
+  g_free (key);
+
+  if (buffer == NULL && err && *err == NULL) {
+    g_set_error (err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+        "Failed to download '%s'", uri);
+  }
+
+  if (download_time)
+    *download_time = time;
+
+  return buffer;
+}
+
+GstStructure *
+gst_adaptive_demux_cache_get_stats (GstAdaptiveDemuxCache * cache)
+{
+  GstStructure *stats;
+
+  g_mutex_lock (&cache->lock);
+  stats = gst_structure_new ("adaptive-demux-cache-stats",
+      "hits", G_TYPE_UINT64, cache->hits,
+      "misses", G_TYPE_UINT64, cache->misses,
+      "coalesced", G_TYPE_UINT64, cache->coalesced,
+      "evictions", G_TYPE_UINT64, cache->evictions,
+      "entries", G_TYPE_UINT, g_queue_get_length (&cache->lru),
+      "size", G_TYPE_UINT64, cache->size,
+      "max-size", G_TYPE_UINT64, cache->max_size, NULL);
+  g_mutex_unlock (&cache->lock);
+
+  return stats;
+}
+
+GstContext *
+gst_adaptive_demux_cache_context_new (GstAdaptiveDemuxCache * cache)
+{
+  GstContext *context;
+
+  context = gst_context_new (GST_ADAPTIVE_DEMUX_CACHE_CONTEXT_TYPE, TRUE);
+  gst_structure_set (gst_context_writable_structure (context),
+      "cache", GST_TYPE_ADAPTIVE_DEMUX_CACHE, cache, NULL);
+
+  return context;
+}
+
+/* Returns: (transfer full) (nullable): the cache of @context */
+GstAdaptiveDemuxCache *
+gst_adaptive_demux_cache_from_context (GstContext * context)
+{
+  GstAdaptiveDemuxCache *cache = NULL;
+
+  if (g_strcmp0 (gst_context_get_context_type (context),
+          GST_ADAPTIVE_DEMUX_CACHE_CONTEXT_TYPE) != 0)
+    return NULL;
+
+  gst_structure_get (gst_context_get_structure (context), "cache",
+      GST_TYPE_ADAPTIVE_DEMUX_CACHE, &cache, NULL);
+
+  return cache;
+}
@@ -0,0 +1,64 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * gstadaptivedemuxcache.h: fragment cache shared between demuxers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_ADAPTIVE_DEMUX_CACHE_H__
+#define __GST_ADAPTIVE_DEMUX_CACHE_H__
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <gst/uridownloader/gsturidownloader.h>
+
+G_BEGIN_DECLS
+
+/* Type of the GstContext used to share a cache between demuxers. Its
+ * structure has a "cache" field holding the GstAdaptiveDemuxCache */
+#define GST_ADAPTIVE_DEMUX_CACHE_CONTEXT_TYPE "gst.adaptivedemux.cache"
+
+#define GST_TYPE_ADAPTIVE_DEMUX_CACHE (gst_adaptive_demux_cache_get_type ())
+G_DECLARE_FINAL_TYPE (GstAdaptiveDemuxCache, gst_adaptive_demux_cache, GST,
+    ADAPTIVE_DEMUX_CACHE, GstObject)
+
+G_GNUC_INTERNAL
+GstAdaptiveDemuxCache * gst_adaptive_demux_cache_new (guint64 max_size);
+
+G_GNUC_INTERNAL
+GstBuffer *    gst_adaptive_demux_cache_fetch        (GstAdaptiveDemuxCache * cache,
+                                                      GstUriDownloader * downloader,
+                                                      const gchar * uri,
+                                                      const gchar * referer,
+                                                      gint64 range_start,
+                                                      gint64 range_end,
+                                                      GCancellable * cancellable,
+                                                      GstClockTime * download_time,
+                                                      GError ** err);
+
+G_GNUC_INTERNAL
+GstStructure * gst_adaptive_demux_cache_get_stats    (GstAdaptiveDemuxCache * cache);
+
+G_GNUC_INTERNAL
+GstContext *   gst_adaptive_demux_cache_context_new  (GstAdaptiveDemuxCache * cache);
+
+G_GNUC_INTERNAL
+GstAdaptiveDemuxCache * gst_adaptive_demux_cache_from_context (GstContext * context);
+
+G_END_DECLS
+
+#endif /* __GST_ADAPTIVE_DEMUX_CACHE_H__ */
@@ -0,0 +1,369 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Fragment prefetching for GstAdaptiveDemux streams.
+ *
+ * The download loop of a stream fetches one fragment at a time through its
+ * source element, so with high latency servers most of the time is spent
+ * waiting for the first byte of each request. The prefetcher downloads the
+ * following fragments concurrently, each with its own GstUriDownloader,
+ * into a bounded in-memory cache. The download loop then takes them out in
+ * order and pushes them as if they came from its source element.
+ *
+ * Requests are kept in fragment order. Skipping to a fragment drops all the
+ * requests queued before it, and skipping to a fragment that was never
+ * requested (after a seek or a bitrate switch) drops them all.
+ *
+ * If the demuxer has a shared fragment cache, the downloads go through it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/uridownloader/gsturidownloader.h>
+
+#include "gstadaptivedemuxprefetch.h"
+#include "gstadaptivedemuxcache.h"
+
+GST_DEBUG_CATEGORY_EXTERN (adaptivedemux_debug);
+#define GST_CAT_DEFAULT adaptivedemux_debug
+
+typedef struct
+{
+  gint ref_count;
+
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  GCancellable *cancellable;
+
+  /* protected by the prefetch lock */
+  GstUriDownloader *downloader;
+  gboolean done;
+  gboolean cancelled;
+  GstBuffer *buffer;
+  GstClockTime download_time;
+} GstAdaptiveDemuxPrefetchRequest;
+
+struct _GstAdaptiveDemuxPrefetch
+{
+  GstElement *parent;
+  guint depth;
+  gsize max_bytes;
+  GstAdaptiveDemuxCache *cache;
+
+  GThreadPool *pool;
+
+  GMutex lock;
+  GCond cond;
+  /* GstAdaptiveDemuxPrefetchRequest, in fragment order */
+  GQueue requests;
+  /* idle GstUriDownloader, kept around for connection reuse */
+  GQueue downloaders;
+  /* size of the completed downloads in @requests */
+  gsize cached_bytes;
+};
+
+static GstAdaptiveDemuxPrefetchRequest *
+prefetch_request_ref (GstAdaptiveDemuxPrefetchRequest * request)
+{
+  g_atomic_int_inc (&request->ref_count);
+  return request;
+}
+
+static void
+prefetch_request_unref (GstAdaptiveDemuxPrefetchRequest * request)
+{
+  if (g_atomic_int_dec_and_test (&request->ref_count)) {
+    g_free (request->uri);
+    g_object_unref (request->cancellable);
+    if (request->buffer)
+      gst_buffer_unref (request->buffer);
+    g_slice_free (GstAdaptiveDemuxPrefetchRequest, request);
+  }
+}
+
+static gboolean
+prefetch_request_matches (GstAdaptiveDemuxPrefetchRequest * request,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return request->range_start == range_start &&
+      request->range_end == range_end && g_str_equal (request->uri, uri);
+}
+
+/* must be called with the prefetch lock taken */
+static void
+prefetch_request_cancel (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemuxPrefetchRequest * request)
+{
+  request->cancelled = TRUE;
+  g_cancellable_cancel (request->cancellable);
+  if (request->downloader)
+    gst_uri_downloader_cancel (request->downloader);
+  if (request->done && request->buffer)
+    prefetch->cached_bytes -= gst_buffer_get_size (request->buffer);
+  g_cond_broadcast (&prefetch->cond);
+  prefetch_request_unref (request);
+}
+
+static void
+prefetch_download (GstAdaptiveDemuxPrefetchRequest * request,
+    GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GstUriDownloader *downloader;
+  GstFragment *download = NULL;
+  GstBuffer *buffer = NULL;
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+  GError *err = NULL;
+
+  g_mutex_lock (&prefetch->lock);
+  if (request->cancelled) {
+    g_mutex_unlock (&prefetch->lock);
+    prefetch_request_unref (request);
+    return;
+  }
+
+  downloader = g_queue_pop_head (&prefetch->downloaders);
+  if (downloader == NULL) {
+    downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (downloader, prefetch->parent);
+    /* segments usually all come from the same few hosts */
+    gst_uri_downloader_set_pool_size (downloader, 2);
+  }
+  gst_uri_downloader_reset (downloader);
+  request->downloader = downloader;
+  g_mutex_unlock (&prefetch->lock);
+
+  GST_DEBUG_OBJECT (prefetch->parent, "Prefetching %s %" G_GINT64_FORMAT "-%"
+      G_GINT64_FORMAT, request->uri, request->range_start, request->range_end);
+
+  if (prefetch->cache) {
+    buffer = gst_adaptive_demux_cache_fetch (prefetch->cache, downloader,
+        request->uri, NULL, request->range_start, request->range_end,
+        request->cancellable, &download_time, &err);
+  } else {
+    download = gst_uri_downloader_fetch_uri_with_range (downloader,
+        request->uri, NULL, FALSE, FALSE, TRUE, request->range_start,
+        request->range_end, &err);
+    if (download && download->completed) {
+      buffer = gst_fragment_get_buffer (download);
+      download_time =
+          download->download_stop_time - download->download_start_time;
+    }
+  }
+
+  g_mutex_lock (&prefetch->lock);
+  request->downloader = NULL;
+  g_queue_push_head (&prefetch->downloaders, downloader);
+
+  if (buffer && !request->cancelled) {
+    request->buffer = buffer;
+    request->download_time = download_time;
+    prefetch->cached_bytes += gst_buffer_get_size (request->buffer);
+    buffer = NULL;
+  } else if (!request->cancelled) {
+    GST_INFO_OBJECT (prefetch->parent, "Failed to prefetch %s: %s",
+        request->uri, err ? err->message : "unknown error");
+  }
+  request->done = TRUE;
+  g_cond_broadcast (&prefetch->cond);
+  g_mutex_unlock (&prefetch->lock);
+
+  if (download)
+    g_object_unref (download);
+  if (buffer)
+    gst_buffer_unref (buffer);
+  g_clear_error (&err);
+  prefetch_request_unref (request);
+}
+
+/* @cache: (nullable): shared cache to download through */
+GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_new (GstElement * parent, guint depth,
+    gsize max_bytes, GstAdaptiveDemuxCache * cache)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  g_return_val_if_fail (depth > 0, NULL);
+
+  prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+  prefetch->parent = parent;
+  prefetch->depth = depth;
+  prefetch->max_bytes = max_bytes;
+  if (cache)
+    prefetch->cache = gst_object_ref (cache);
+  prefetch->pool = g_thread_pool_new ((GFunc) prefetch_download, prefetch,
+      depth, FALSE, NULL);
+  g_mutex_init (&prefetch->lock);
+  g_cond_init (&prefetch->cond);
+  g_queue_init (&prefetch->requests);
+  g_queue_init (&prefetch->downloaders);
+
+  return prefetch;
+}
+
+void
+gst_adaptive_demux_prefetch_free (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GstUriDownloader *downloader;
+
+  gst_adaptive_demux_prefetch_flush (prefetch);
+
+  /* the cancelled requests return right away */
+  g_thread_pool_free (prefetch->pool, FALSE, TRUE);
+
+  while ((downloader = g_queue_pop_head (&prefetch->downloaders)))
+    gst_object_unref (downloader);
+  if (prefetch->cache)
+    gst_object_unref (prefetch->cache);
+  g_mutex_clear (&prefetch->lock);
+  g_cond_clear (&prefetch->cond);
+  g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+}
+
+/* Cancels all requests and wakes up gst_adaptive_demux_prefetch_take() */
+void
+gst_adaptive_demux_prefetch_flush (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GstAdaptiveDemuxPrefetchRequest *request;
+
+  g_mutex_lock (&prefetch->lock);
+  while ((request = g_queue_pop_head (&prefetch->requests)))
+    prefetch_request_cancel (prefetch, request);
+  g_mutex_unlock (&prefetch->lock);
+}
+
+gboolean
+gst_adaptive_demux_prefetch_can_request (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  gboolean ret;
+
+  g_mutex_lock (&prefetch->lock);
+  ret = prefetch->requests.length < prefetch->depth &&
+      prefetch->cached_bytes < prefetch->max_bytes;
+  g_mutex_unlock (&prefetch->lock);
+
+  return ret;
+}
+
+/* must be called with the prefetch lock taken */
+static gboolean
+prefetch_has_request (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  gboolean ret = FALSE;
+  GList *l;
+
+  for (l = prefetch->requests.head; l && !ret; l = l->next)
+    ret = prefetch_request_matches (l->data, uri, range_start, range_end);
+
+  return ret;
+}
+
+/* Queues the download of a fragment, unless it is already queued */
+void
+gst_adaptive_demux_prefetch_request (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetchRequest *request;
+
+  g_mutex_lock (&prefetch->lock);
+  if (prefetch_has_request (prefetch, uri, range_start, range_end)) {
+    g_mutex_unlock (&prefetch->lock);
+    return;
+  }
+
+  request = g_slice_new0 (GstAdaptiveDemuxPrefetchRequest);
+  request->ref_count = 1;
+  request->uri = g_strdup (uri);
+  request->range_start = range_start;
+  request->range_end = range_end;
+  request->download_time = GST_CLOCK_TIME_NONE;
+  request->cancellable = g_cancellable_new ();
+  g_queue_push_tail (&prefetch->requests, request);
+  g_mutex_unlock (&prefetch->lock);
+
+  g_thread_pool_push (prefetch->pool, prefetch_request_ref (request), NULL);
+}
+
+/* Drops the requests queued before the given fragment, or all of them if it
+ * wasn't requested. Returns %TRUE if the fragment was requested */
+gboolean
+gst_adaptive_demux_prefetch_skip_to (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetchRequest *request;
+
+  g_mutex_lock (&prefetch->lock);
+  while ((request = g_queue_peek_head (&prefetch->requests))) {
+    if (prefetch_request_matches (request, uri, range_start, range_end))
+      break;
+
+    GST_DEBUG_OBJECT (prefetch->parent, "Dropping prefetched %s",
+        request->uri);
+    g_queue_pop_head (&prefetch->requests);
+    prefetch_request_cancel (prefetch, request);
+  }
+  g_mutex_unlock (&prefetch->lock);
+
+  return request != NULL;
+}
+
+/* Takes the first queued fragment out of the cache, waiting for its
+ * download to finish if needed. Returns %NULL if its download failed or if
+ * the prefetcher was flushed in the meantime */
+GstBuffer *
+gst_adaptive_demux_prefetch_take (GstAdaptiveDemuxPrefetch * prefetch,
+    GstClockTime * download_time)
+{
+  GstAdaptiveDemuxPrefetchRequest *request;
+  GstBuffer *buffer = NULL;
+
+  g_mutex_lock (&prefetch->lock);
+
+  request = g_queue_peek_head (&prefetch->requests);
+  if (request == NULL) {
+    g_mutex_unlock (&prefetch->lock);
+    return NULL;
+  }
+
+  /* it stays queued while waiting, so that a flush can cancel it */
+  prefetch_request_ref (request);
+  while (!request->done && !request->cancelled)
+    g_cond_wait (&prefetch->cond, &prefetch->lock);
+
+  if (!request->cancelled) {
+    g_queue_remove (&prefetch->requests, request);
+    if (request->buffer) {
+      prefetch->cached_bytes -= gst_buffer_get_size (request->buffer);
+      buffer = request->buffer;
+      request->buffer = NULL;
+      *download_time = request->download_time;
+    }
+    prefetch_request_unref (request);
+  }
+  g_mutex_unlock (&prefetch->lock);
+
+  prefetch_request_unref (request);
+
+  return buffer;
+}
@@ -0,0 +1,132 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsth264meta.h"
+
+GST_DEBUG_CATEGORY_STATIC (h264_meta_debug);
+#define GST_CAT_DEFAULT h264_meta_debug
+
+static gboolean
+gst_h264_nal_meta_init (GstH264NalMeta * h264_meta, gpointer params,
+    GstBuffer * buffer)
+{
+  h264_meta->units = NULL;
+  h264_meta->n_units = 0;
+
+  return TRUE;
+}
+
+static void
+gst_h264_nal_meta_free (GstH264NalMeta * h264_meta, GstBuffer * buffer)
+{
+  g_free (h264_meta->units);
+}
+
+static gboolean
+gst_h264_nal_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstH264NalMeta *smeta = (GstH264NalMeta *) meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    /* only copy if the complete data is copied as well, the offsets
+     * don't apply to anything else */
+    if (!copy->region) {
+      if (!gst_buffer_add_h264_nal_meta (dest, smeta->units, smeta->n_units))
+        return FALSE;
+    }
+  } else {
+    /* return FALSE, if transform type is not supported */
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+GType
+gst_h264_nal_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { "memory", NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstH264NalMetaAPI", tags);
+    GST_DEBUG_CATEGORY_INIT (h264_meta_debug, "h264meta", 0,
+        "H.264 NAL units GstMeta");
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_h264_nal_meta_get_info (void)
+{
+  static const GstMetaInfo *h264_nal_meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & h264_nal_meta_info)) {
+    const GstMetaInfo *meta = gst_meta_register (GST_H264_NAL_META_API_TYPE,
+        "GstH264NalMeta", sizeof (GstH264NalMeta),
+        (GstMetaInitFunction) gst_h264_nal_meta_init,
+        (GstMetaFreeFunction) gst_h264_nal_meta_free,
+        (GstMetaTransformFunction) gst_h264_nal_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & h264_nal_meta_info,
+        (GstMetaInfo *) meta);
+  }
+
+  return h264_nal_meta_info;
+}
+
+/**
+ * gst_buffer_add_h264_nal_meta:
+ * @buffer: a #GstBuffer
+ * @units: (array length=n_units): the #GstH264NalMetaUnit to describe
+ * @n_units: the number of @units
+ *
+ * Creates and adds a #GstH264NalMeta to a @buffer. The @units are copied.
+ *
+ * Returns: (transfer none): a newly created #GstH264NalMeta
+ *
+ * Since: 1.20
+ */
+GstH264NalMeta *
+gst_buffer_add_h264_nal_meta (GstBuffer * buffer,
+    const GstH264NalMetaUnit * units, guint n_units)
+{
+  GstH264NalMeta *h264_meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (units != NULL || n_units == 0, NULL);
+
+  h264_meta = (GstH264NalMeta *) gst_buffer_add_meta (buffer,
+      GST_H264_NAL_META_INFO, NULL);
+
+  GST_TRACE ("adding %u NAL units to buffer %p", n_units, buffer);
+
+  h264_meta->units = g_memdup (units, n_units * sizeof (GstH264NalMetaUnit));
+  h264_meta->n_units = n_units;
+
+  return h264_meta;
+}
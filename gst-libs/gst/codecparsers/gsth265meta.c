@@ -0,0 +1,151 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsth265meta.h"
+
+GST_DEBUG_CATEGORY_STATIC (h265_meta_debug);
+#define GST_CAT_DEFAULT h265_meta_debug
+
+static gboolean
+gst_h265_nal_meta_init (GstH265NalMeta * h265_meta, gpointer params,
+    GstBuffer * buffer)
+{
+  h265_meta->units = NULL;
+  h265_meta->n_units = 0;
+
+  return TRUE;
+}
+
+static void
+gst_h265_nal_meta_free (GstH265NalMeta * h265_meta, GstBuffer * buffer)
+{
+  guint i;
+
+  for (i = 0; i < h265_meta->n_units; i++) {
+    if (h265_meta->units[i].has_slice_hdr)
+      gst_h265_slice_hdr_free (&h265_meta->units[i].slice_hdr);
+  }
+  g_free (h265_meta->units);
+}
+
+static gboolean
+gst_h265_nal_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstH265NalMeta *smeta = (GstH265NalMeta *) meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    /* only copy if the complete data is copied as well, the offsets
+     * don't apply to anything else */
+    if (!copy->region) {
+      if (!gst_buffer_add_h265_nal_meta (dest, smeta->units, smeta->n_units))
+        return FALSE;
+    }
+  } else {
+    /* return FALSE, if transform type is not supported */
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+GType
+gst_h265_nal_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { "memory", NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstH265NalMetaAPI", tags);
+    GST_DEBUG_CATEGORY_INIT (h265_meta_debug, "h265meta", 0,
+        "H.265 NAL units GstMeta");
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_h265_nal_meta_get_info (void)
+{
+  static const GstMetaInfo *h265_nal_meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & h265_nal_meta_info)) {
+    const GstMetaInfo *meta = gst_meta_register (GST_H265_NAL_META_API_TYPE,
+        "GstH265NalMeta", sizeof (GstH265NalMeta),
+        (GstMetaInitFunction) gst_h265_nal_meta_init,
+        (GstMetaFreeFunction) gst_h265_nal_meta_free,
+        (GstMetaTransformFunction) gst_h265_nal_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & h265_nal_meta_info,
+        (GstMetaInfo *) meta);
+  }
+
+  return h265_nal_meta_info;
+}
+
+/**
+ * gst_buffer_add_h265_nal_meta:
+ * @buffer: a #GstBuffer
+ * @units: (array length=n_units): the #GstH265NalMetaUnit to describe
+ * @n_units: the number of @units
+ *
+ * Creates and adds a #GstH265NalMeta to a @buffer. The @units are copied,
+ * including the entry points of their slice headers.
+ *
+ * Returns: (transfer none): a newly created #GstH265NalMeta
+ *
+ * Since: 1.20
+ */
+GstH265NalMeta *
+gst_buffer_add_h265_nal_meta (GstBuffer * buffer,
+    const GstH265NalMetaUnit * units, guint n_units)
+{
+  GstH265NalMeta *h265_meta;
+  guint i;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (units != NULL || n_units == 0, NULL);
+
+  h265_meta = (GstH265NalMeta *) gst_buffer_add_meta (buffer,
+      GST_H265_NAL_META_INFO, NULL);
+
+  GST_TRACE ("adding %u NAL units to buffer %p", n_units, buffer);
+
+  h265_meta->units = g_memdup (units, n_units * sizeof (GstH265NalMetaUnit));
+  h265_meta->n_units = n_units;
+
+  for (i = 0; i < n_units; i++) {
+    GstH265SliceHdr *slice_hdr = &h265_meta->units[i].slice_hdr;
+
+    if (h265_meta->units[i].has_slice_hdr &&
+        slice_hdr->entry_point_offset_minus1) {
+      slice_hdr->entry_point_offset_minus1 =
+          g_memdup (slice_hdr->entry_point_offset_minus1,
+          slice_hdr->num_entry_point_offsets * sizeof (guint32));
+    }
+  }
+
+  return h265_meta;
+}
@@ -0,0 +1,102 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_H265_META_H__
+#define __GST_H265_META_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The H.265 parsing library is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstH265NalMeta GstH265NalMeta;
+typedef struct _GstH265NalMetaUnit GstH265NalMetaUnit;
+
+GST_CODEC_PARSERS_API
+GType gst_h265_nal_meta_api_get_type (void);
+#define GST_H265_NAL_META_API_TYPE  (gst_h265_nal_meta_api_get_type())
+#define GST_H265_NAL_META_INFO  (gst_h265_nal_meta_get_info())
+GST_CODEC_PARSERS_API
+const GstMetaInfo * gst_h265_nal_meta_get_info (void);
+
+/**
+ * GstH265NalMetaUnit:
+ * @nalu: the identified #GstH265NalUnit. Its offsets apply to the buffer
+ *   the meta is attached to and its @data is %NULL
+ * @has_slice_hdr: whether @slice_hdr holds the parsed slice header of @nalu
+ * @pps_id: the id of the PPS referenced by @slice_hdr
+ * @slice_hdr: the parsed #GstH265SliceHdr, with its @pps set to %NULL as
+ *   the PPS belongs to the upstream parser. Its @entry_point_offset_minus1
+ *   is owned by the #GstH265NalMeta
+ *
+ * A NAL unit described by a #GstH265NalMeta
+ *
+ * Since: 1.20
+ */
+struct _GstH265NalMetaUnit
+{
+  GstH265NalUnit nalu;
+
+  gboolean has_slice_hdr;
+  guint8 pps_id;
+  GstH265SliceHdr slice_hdr;
+};
+
+/**
+ * GstH265NalMeta:
+ * @meta: parent #GstMeta
+ * @units: the #GstH265NalMetaUnit of the buffer, in bitstream order
+ * @n_units: the number of @units
+ *
+ * Extra buffer metadata describing the NAL units of an H.265 buffer, from
+ * its first slice to its end, along with their already parsed slice
+ * headers.
+ *
+ * Parsers attach it so that decoders can skip identifying and parsing the
+ * slices of an access unit a second time. Parameter sets and other NAL units
+ * preceding the first slice are not described and still need to be
+ * identified by the decoder.
+ *
+ * The units are only valid during the lifetime of the #GstH265NalMeta.
+ *
+ * Since: 1.20
+ */
+struct _GstH265NalMeta {
+  GstMeta meta;
+
+  GstH265NalMetaUnit *units;
+  guint n_units;
+};
+
+#define gst_buffer_get_h265_nal_meta(b) ((GstH265NalMeta*)gst_buffer_get_meta((b),GST_H265_NAL_META_API_TYPE))
+
+GST_CODEC_PARSERS_API
+GstH265NalMeta *
+gst_buffer_add_h265_nal_meta (GstBuffer * buffer,
+                              const GstH265NalMetaUnit * units,
+                              guint n_units);
+
+G_END_DECLS
+
+#endif
@@ -38,6 +38,14 @@
 #include "nalutils.h"
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NAL_HAVE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NAL_HAVE_NEON 1
+#endif
+
 /* Compute Ceil(Log2(v)) */
 /* Derived from branchless code for integer log2(v) from:
    <http://graphics.stanford.edu/~seander/bithacks.html#IntegerLog> */
@@ -91,6 +99,24 @@ nal_reader_read (NalReader * nr, guint nbits)
   while (nr->bits_in_cache < nbits) {
     guint8 byte;
 
+    /* Fast path: an emulation_prevention_three_byte can only show up where
+     * a 0x03 byte is, so if the next 4 bytes contain none of them they can
+     * go into the cache at once, as long as they fit in the 64 bits cache */
+    if (G_LIKELY (nr->byte + 4 <= nr->size && nr->bits_in_cache <= 32)) {
+      guint32 word = GST_READ_UINT32_BE (nr->data + nr->byte);
+      guint32 x = word ^ 0x03030303;
+
+      if (!((x - 0x01010101) & ~x & 0x80808080)) {
+        nr->cache = (nr->cache << 32) | ((guint64) nr->first_byte << 24) |
+            (word >> 8);
+        nr->first_byte = word & 0xff;
+        nr->epb_cache = word;
+        nr->byte += 4;
+        nr->bits_in_cache += 32;
+        continue;
+      }
+    }
+
   next_byte:
     if (G_UNLIKELY (nr->byte >= nr->size))
       return FALSE;
@@ -171,11 +197,11 @@ nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
   if (!nal_reader_read (nr, nbits)) \
     return FALSE; \
   \
-  /* bring the required bits down and truncate */ \
+  /* bring the required bits down and truncate. The cache may hold more \
+   * than a byte of extra bits after a word refill, so shift the whole \
+   * 64 bits window rather than the cache and first_byte separately */ \
   shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
-  \
-  *val |= nr->cache << (8 - shift); \
+  *val = ((nr->cache << 8) | nr->first_byte) >> shift; \
   /* mask out required bits */ \
   if (nbits < bits) \
     *val &= ((guint##bits)1 << nbits) - 1; \
@@ -247,7 +273,7 @@ nal_reader_get_se (NalReader * nr, gint32 * val)
 gboolean
 nal_reader_is_byte_aligned (NalReader * nr)
 {
-  if (nr->bits_in_cache != 0)
+  if (nr->bits_in_cache % 8 != 0)
     return FALSE;
   return TRUE;
 }
@@ -295,15 +321,81 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
+static inline guint
+nal_ctz (guint64 v)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll (v);
+#else
+  guint n = 0;
+
+  while (!(v & 1)) {
+    v >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  guint i = 0;
+
+  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc.
+   * Each vector step tests 16 candidate offsets at once by comparing the
+   * data at +0, +1 and +2 against 00 00 01; the loop bound guarantees that
+   * any match found still has a byte following it */
+#if defined(NAL_HAVE_SSE2)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i one = _mm_set1_epi8 (1);
+
+    for (; i + 19 <= size; i += 16) {
+      __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + i));
+      __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+      __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+      __m128i m = _mm_and_si128 (_mm_and_si128 (_mm_cmpeq_epi8 (b0, zero),
+              _mm_cmpeq_epi8 (b1, zero)), _mm_cmpeq_epi8 (b2, one));
+      guint mask = _mm_movemask_epi8 (m);
+
+      if (mask)
+        return i + nal_ctz (mask);
+    }
+  }
+#elif defined(NAL_HAVE_NEON)
+  {
+    const uint8x16_t zero = vdupq_n_u8 (0);
+    const uint8x16_t one = vdupq_n_u8 (1);
+
+    for (; i + 19 <= size; i += 16) {
+      uint8x16_t b0 = vld1q_u8 (data + i);
+      uint8x16_t b1 = vld1q_u8 (data + i + 1);
+      uint8x16_t b2 = vld1q_u8 (data + i + 2);
+      uint8x16_t m = vandq_u8 (vandq_u8 (vceqq_u8 (b0, zero),
+              vceqq_u8 (b1, zero)),
+          vceqq_u8 (b2, one));
+      /* narrow to 4 bits per lane to get a 64 bits mask */
+      guint64 mask = vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16
+              (vreinterpretq_u16_u8 (m), 4)), 0);
+
+      if (mask)
+        return i + nal_ctz (mask) / 4;
+    }
+  }
+#endif
+
+  for (; i + 4 <= size; i++) {
+    if (data[i + 2] > 1) {
+      /* no start code can begin at i, i + 1 or i + 2 */
+      i += 2;
+      continue;
+    }
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+      return i;
+  }
 
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  return -1;
 }
 
 void
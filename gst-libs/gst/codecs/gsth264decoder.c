@@ -59,6 +59,7 @@
 #endif
 
 #include <gst/base/base.h>
+#include <gst/codecparsers/gsth264meta.h>
 #include "gsth264decoder.h"
 
 GST_DEBUG_CATEGORY (gst_h264_decoder_debug);
@@ -175,6 +176,8 @@ static gboolean gst_h264_decoder_set_format (GstVideoDecoder * decoder,
 static GstFlowReturn gst_h264_decoder_finish (GstVideoDecoder * decoder);
 static gboolean gst_h264_decoder_flush (GstVideoDecoder * decoder);
 static GstFlowReturn gst_h264_decoder_drain (GstVideoDecoder * decoder);
+static gboolean gst_h264_decoder_propose_allocation (GstVideoDecoder *
+    decoder, GstQuery * query);
 static GstFlowReturn gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame);
 
@@ -183,7 +186,7 @@ static gboolean gst_h264_decoder_process_sps (GstH264Decoder * self,
     GstH264SPS * sps);
 static gboolean gst_h264_decoder_decode_slice (GstH264Decoder * self);
 static gboolean gst_h264_decoder_decode_nal (GstH264Decoder * self,
-    GstH264NalUnit * nalu);
+    GstH264NalUnit * nalu, const GstH264SliceHdr * slice_hdr);
 static gboolean gst_h264_decoder_fill_picture_from_slice (GstH264Decoder * self,
     const GstH264Slice * slice, GstH264Picture * picture);
 static gboolean gst_h264_decoder_calculate_poc (GstH264Decoder * self,
@@ -222,6 +225,8 @@ gst_h264_decoder_class_init (GstH264DecoderClass * klass)
   decoder_class->finish = GST_DEBUG_FUNCPTR (gst_h264_decoder_finish);
   decoder_class->flush = GST_DEBUG_FUNCPTR (gst_h264_decoder_flush);
   decoder_class->drain = GST_DEBUG_FUNCPTR (gst_h264_decoder_drain);
+  decoder_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_h264_decoder_propose_allocation);
   decoder_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_h264_decoder_handle_frame);
 }
@@ -404,6 +409,82 @@ gst_h264_decoder_finish (GstVideoDecoder * decoder)
   return gst_h264_decoder_drain (decoder);
 }
 
+static gboolean
+gst_h264_decoder_propose_allocation (GstVideoDecoder * decoder,
+    GstQuery * query)
+{
+  /* let h264parse know that we can reuse its parsing results */
+  gst_query_add_allocation_meta (query, GST_H264_NAL_META_API_TYPE, NULL);
+
+  return GST_VIDEO_DECODER_CLASS (parent_class)->propose_allocation (decoder,
+      query);
+}
+
+/* Makes sure the units of @meta describe the NAL units of @map, in case the
+ * buffer got modified after the meta was attached */
+static gboolean
+gst_h264_decoder_check_nal_meta (GstH264Decoder * self,
+    const GstH264NalMeta * meta, const GstMapInfo * map)
+{
+  GstH264DecoderPrivate *priv = self->priv;
+  const guint8 *data = map->data;
+  guint i, j;
+
+  if (meta->n_units == 0)
+    return FALSE;
+
+  for (i = 0; i < meta->n_units; i++) {
+    const GstH264NalUnit *nalu = &meta->units[i].nalu;
+
+    if (nalu->size < 1 || nalu->offset < nalu->sc_offset ||
+        (gsize) nalu->offset + nalu->size > map->size)
+      return FALSE;
+
+    if (priv->in_format == GST_H264_DECODER_FORMAT_AVC) {
+      guint32 nal_size = 0;
+
+      if (nalu->offset - nalu->sc_offset != priv->nal_length_size)
+        return FALSE;
+
+      for (j = nalu->sc_offset; j < nalu->offset; j++)
+        nal_size = (nal_size << 8) | data[j];
+
+      if (nal_size != nalu->size)
+        return FALSE;
+    } else if (nalu->offset < 3 || data[nalu->offset - 3] != 0 ||
+        data[nalu->offset - 2] != 0 || data[nalu->offset - 1] != 1) {
+      return FALSE;
+    }
+
+    if ((data[nalu->offset] & 0x1f) != nalu->type ||
+        ((data[nalu->offset] >> 5) & 0x3) != nalu->ref_idc)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_h264_decoder_decode_nal_meta_unit (GstH264Decoder * self,
+    const GstH264NalMetaUnit * unit, guint8 * data)
+{
+  GstH264DecoderPrivate *priv = self->priv;
+  GstH264NalUnit nalu = unit->nalu;
+  GstH264SliceHdr slice_hdr;
+
+  nalu.data = data;
+
+  /* the slice header refers to the PPS of the upstream parser, which must
+   * be known to ours as well */
+  if (!unit->has_slice_hdr || !priv->parser->pps[unit->pps_id].valid)
+    return gst_h264_decoder_decode_nal (self, &nalu, NULL);
+
+  slice_hdr = unit->slice_hdr;
+  slice_hdr.pps = &priv->parser->pps[unit->pps_id];
+
+  return gst_h264_decoder_decode_nal (self, &nalu, &slice_hdr);
+}
+
 static GstFlowReturn
 gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame)
@@ -414,6 +495,9 @@ gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
   GstH264NalUnit nalu;
   GstH264ParserResult pres;
   GstMapInfo map;
+  GstH264NalMeta *meta;
+  gsize end;
+  guint i;
   gboolean decode_ret = TRUE;
 
   GST_LOG_OBJECT (self,
@@ -425,12 +509,22 @@ gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
   priv->last_ret = GST_FLOW_OK;
 
   gst_buffer_map (in_buf, &map, GST_MAP_READ);
+
+  /* With a NAL meta from upstream, only the NAL units preceding the first
+   * slice still need to be identified here */
+  meta = gst_buffer_get_h264_nal_meta (in_buf);
+  if (meta && !gst_h264_decoder_check_nal_meta (self, meta, &map)) {
+    GST_DEBUG_OBJECT (self, "NAL meta doesn't match buffer, ignoring it");
+    meta = NULL;
+  }
+  end = meta ? meta->units[0].nalu.offset : map.size;
+
   if (priv->in_format == GST_H264_DECODER_FORMAT_AVC) {
     pres = gst_h264_parser_identify_nalu_avc (priv->parser,
         map.data, 0, map.size, priv->nal_length_size, &nalu);
 
-    while (pres == GST_H264_PARSER_OK && decode_ret) {
-      decode_ret = gst_h264_decoder_decode_nal (self, &nalu);
+    while (pres == GST_H264_PARSER_OK && decode_ret && nalu.offset < end) {
+      decode_ret = gst_h264_decoder_decode_nal (self, &nalu, NULL);
 
       pres = gst_h264_parser_identify_nalu_avc (priv->parser,
           map.data, nalu.offset + nalu.size, map.size, priv->nal_length_size,
@@ -443,8 +537,8 @@ gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
     if (pres == GST_H264_PARSER_NO_NAL_END)
       pres = GST_H264_PARSER_OK;
 
-    while (pres == GST_H264_PARSER_OK && decode_ret) {
-      decode_ret = gst_h264_decoder_decode_nal (self, &nalu);
+    while (pres == GST_H264_PARSER_OK && decode_ret && nalu.offset < end) {
+      decode_ret = gst_h264_decoder_decode_nal (self, &nalu, NULL);
 
       pres = gst_h264_parser_identify_nalu (priv->parser,
           map.data, nalu.offset + nalu.size, map.size, &nalu);
@@ -454,6 +548,11 @@ gst_h264_decoder_handle_frame (GstVideoDecoder * decoder,
     }
   }
 
+  for (i = 0; meta && i < meta->n_units && decode_ret; i++) {
+    decode_ret = gst_h264_decoder_decode_nal_meta_unit (self,
+        &meta->units[i], map.data);
+  }
+
   gst_buffer_unmap (in_buf, &map);
 
   if (!decode_ret) {
@@ -978,22 +1077,28 @@ gst_h264_decoder_find_first_field_picture (GstH264Decoder * self,
   return TRUE;
 }
 
+/* @slice_hdr is the already parsed header of @nalu, if any */
 static gboolean
-gst_h264_decoder_parse_slice (GstH264Decoder * self, GstH264NalUnit * nalu)
+gst_h264_decoder_parse_slice (GstH264Decoder * self, GstH264NalUnit * nalu,
+    const GstH264SliceHdr * slice_hdr)
 {
   GstH264DecoderPrivate *priv = self->priv;
   GstH264ParserResult pres = GST_H264_PARSER_OK;
 
   memset (&priv->current_slice, 0, sizeof (GstH264Slice));
 
-  pres = gst_h264_parser_parse_slice_hdr (priv->parser, nalu,
-      &priv->current_slice.header, TRUE, TRUE);
+  if (slice_hdr) {
+    priv->current_slice.header = *slice_hdr;
+  } else {
+    pres = gst_h264_parser_parse_slice_hdr (priv->parser, nalu,
+        &priv->current_slice.header, TRUE, TRUE);
 
-  if (pres != GST_H264_PARSER_OK) {
-    GST_ERROR_OBJECT (self, "Failed to parse slice header, ret %d", pres);
-    memset (&priv->current_slice, 0, sizeof (GstH264Slice));
+    if (pres != GST_H264_PARSER_OK) {
+      GST_ERROR_OBJECT (self, "Failed to parse slice header, ret %d", pres);
+      memset (&priv->current_slice, 0, sizeof (GstH264Slice));
 
-    return FALSE;
+      return FALSE;
+    }
   }
 
   priv->current_slice.nalu = *nalu;
@@ -1076,7 +1181,8 @@ gst_h264_decoder_parse_slice (GstH264Decoder * self, GstH264NalUnit * nalu)
 }
 
 static gboolean
-gst_h264_decoder_decode_nal (GstH264Decoder * self, GstH264NalUnit * nalu)
+gst_h264_decoder_decode_nal (GstH264Decoder * self, GstH264NalUnit * nalu,
+    const GstH264SliceHdr * slice_hdr)
 {
   gboolean ret = TRUE;
 
@@ -1096,7 +1202,7 @@ gst_h264_decoder_decode_nal (GstH264Decoder * self, GstH264NalUnit * nalu)
     case GST_H264_NAL_SLICE_DPC:
     case GST_H264_NAL_SLICE_IDR:
     case GST_H264_NAL_SLICE_EXT:
-      ret = gst_h264_decoder_parse_slice (self, nalu);
+      ret = gst_h264_decoder_parse_slice (self, nalu, slice_hdr);
       break;
     default:
       break;
@@ -30,6 +30,7 @@
 #include <config.h>
 #endif
 
+#include <gst/codecparsers/gsth265meta.h>
 #include "gsth265decoder.h"
 
 GST_DEBUG_CATEGORY (gst_h265_decoder_debug);
@@ -136,6 +137,8 @@ static gboolean gst_h265_decoder_set_format (GstVideoDecoder * decoder,
 static GstFlowReturn gst_h265_decoder_finish (GstVideoDecoder * decoder);
 static gboolean gst_h265_decoder_flush (GstVideoDecoder * decoder);
 static GstFlowReturn gst_h265_decoder_drain (GstVideoDecoder * decoder);
+static gboolean gst_h265_decoder_propose_allocation (GstVideoDecoder *
+    decoder, GstQuery * query);
 static GstFlowReturn gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame);
 
@@ -159,6 +162,8 @@ gst_h265_decoder_class_init (GstH265DecoderClass * klass)
   decoder_class->finish = GST_DEBUG_FUNCPTR (gst_h265_decoder_finish);
   decoder_class->flush = GST_DEBUG_FUNCPTR (gst_h265_decoder_flush);
   decoder_class->drain = GST_DEBUG_FUNCPTR (gst_h265_decoder_drain);
+  decoder_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_h265_decoder_propose_allocation);
   decoder_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_h265_decoder_handle_frame);
 }
@@ -589,23 +594,28 @@ gst_h265_decoder_preprocess_slice (GstH265Decoder * self, GstH265Slice * slice)
   return TRUE;
 }
 
+/* @slice_hdr is the already parsed header of @nalu, if any */
 static gboolean
 gst_h265_decoder_parse_slice (GstH265Decoder * self, GstH265NalUnit * nalu,
-    GstClockTime pts)
+    GstClockTime pts, const GstH265SliceHdr * slice_hdr)
 {
   GstH265DecoderPrivate *priv = self->priv;
   GstH265ParserResult pres = GST_H265_PARSER_OK;
 
   memset (&priv->current_slice, 0, sizeof (GstH265Slice));
 
-  pres = gst_h265_parser_parse_slice_hdr (priv->parser, nalu,
-      &priv->current_slice.header);
+  if (slice_hdr) {
+    priv->current_slice.header = *slice_hdr;
+  } else {
+    pres = gst_h265_parser_parse_slice_hdr (priv->parser, nalu,
+        &priv->current_slice.header);
 
-  if (pres != GST_H265_PARSER_OK) {
-    GST_ERROR_OBJECT (self, "Failed to parse slice header, ret %d", pres);
-    memset (&priv->current_slice, 0, sizeof (GstH265Slice));
+    if (pres != GST_H265_PARSER_OK) {
+      GST_ERROR_OBJECT (self, "Failed to parse slice header, ret %d", pres);
+      memset (&priv->current_slice, 0, sizeof (GstH265Slice));
 
-    return FALSE;
+      return FALSE;
+    }
   }
 
   priv->current_slice.nalu = *nalu;
@@ -666,7 +676,7 @@ gst_h265_decoder_parse_slice (GstH265Decoder * self, GstH265NalUnit * nalu,
 
 static GstFlowReturn
 gst_h265_decoder_decode_nal (GstH265Decoder * self, GstH265NalUnit * nalu,
-    GstClockTime pts)
+    GstClockTime pts, const GstH265SliceHdr * slice_hdr)
 {
   GstH265DecoderPrivate *priv = self->priv;
   gboolean ret = TRUE;
@@ -704,7 +714,7 @@ gst_h265_decoder_decode_nal (GstH265Decoder * self, GstH265NalUnit * nalu,
     case GST_H265_NAL_SLICE_IDR_W_RADL:
     case GST_H265_NAL_SLICE_IDR_N_LP:
     case GST_H265_NAL_SLICE_CRA_NUT:
-      ret = gst_h265_decoder_parse_slice (self, nalu, pts);
+      ret = gst_h265_decoder_parse_slice (self, nalu, pts, slice_hdr);
       priv->new_bitstream = FALSE;
       priv->prev_nal_is_eos = FALSE;
       break;
@@ -1676,6 +1686,83 @@ gst_h265_decoder_reset_frame_state (GstH265Decoder * self)
   priv->cur_duplicate_flag = 0;
 }
 
+static gboolean
+gst_h265_decoder_propose_allocation (GstVideoDecoder * decoder,
+    GstQuery * query)
+{
+  /* let h265parse know that we can reuse its parsing results */
+  gst_query_add_allocation_meta (query, GST_H265_NAL_META_API_TYPE, NULL);
+
+  return GST_VIDEO_DECODER_CLASS (parent_class)->propose_allocation (decoder,
+      query);
+}
+
+/* Makes sure the units of @meta describe the NAL units of @map, in case the
+ * buffer got modified after the meta was attached */
+static gboolean
+gst_h265_decoder_check_nal_meta (GstH265Decoder * self,
+    const GstH265NalMeta * meta, const GstMapInfo * map)
+{
+  GstH265DecoderPrivate *priv = self->priv;
+  const guint8 *data = map->data;
+  guint i, j;
+
+  if (meta->n_units == 0)
+    return FALSE;
+
+  for (i = 0; i < meta->n_units; i++) {
+    const GstH265NalUnit *nalu = &meta->units[i].nalu;
+
+    if (nalu->size < 2 || nalu->offset < nalu->sc_offset ||
+        (gsize) nalu->offset + nalu->size > map->size)
+      return FALSE;
+
+    if (priv->in_format == GST_H265_DECODER_FORMAT_HVC1 ||
+        priv->in_format == GST_H265_DECODER_FORMAT_HEV1) {
+      guint32 nal_size = 0;
+
+      if (nalu->offset - nalu->sc_offset != priv->nal_length_size)
+        return FALSE;
+
+      for (j = nalu->sc_offset; j < nalu->offset; j++)
+        nal_size = (nal_size << 8) | data[j];
+
+      if (nal_size != nalu->size)
+        return FALSE;
+    } else if (nalu->offset < 3 || data[nalu->offset - 3] != 0 ||
+        data[nalu->offset - 2] != 0 || data[nalu->offset - 1] != 1) {
+      return FALSE;
+    }
+
+    if (((data[nalu->offset] >> 1) & 0x3f) != nalu->type ||
+        (data[nalu->offset + 1] & 0x7) != nalu->temporal_id_plus1)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_h265_decoder_decode_nal_meta_unit (GstH265Decoder * self,
+    const GstH265NalMetaUnit * unit, guint8 * data, GstClockTime pts)
+{
+  GstH265DecoderPrivate *priv = self->priv;
+  GstH265NalUnit nalu = unit->nalu;
+  GstH265SliceHdr slice_hdr;
+
+  nalu.data = data;
+
+  /* the slice header refers to the PPS of the upstream parser, which must
+   * be known to ours as well */
+  if (!unit->has_slice_hdr || !priv->parser->pps[unit->pps_id].valid)
+    return gst_h265_decoder_decode_nal (self, &nalu, pts, NULL);
+
+  slice_hdr = unit->slice_hdr;
+  slice_hdr.pps = &priv->parser->pps[unit->pps_id];
+
+  return gst_h265_decoder_decode_nal (self, &nalu, pts, &slice_hdr);
+}
+
 static GstFlowReturn
 gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame)
@@ -1686,6 +1773,9 @@ gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
   GstH265NalUnit nalu;
   GstH265ParserResult pres;
   GstMapInfo map;
+  GstH265NalMeta *meta;
+  gsize end;
+  guint i;
   gboolean decode_ret = TRUE;
 
   GST_LOG_OBJECT (self,
@@ -1704,14 +1794,23 @@ gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
     return GST_FLOW_ERROR;
   }
 
+  /* With a NAL meta from upstream, only the NAL units preceding the first
+   * slice still need to be identified here */
+  meta = gst_buffer_get_h265_nal_meta (in_buf);
+  if (meta && !gst_h265_decoder_check_nal_meta (self, meta, &map)) {
+    GST_DEBUG_OBJECT (self, "NAL meta doesn't match buffer, ignoring it");
+    meta = NULL;
+  }
+  end = meta ? meta->units[0].nalu.offset : map.size;
+
   if (priv->in_format == GST_H265_DECODER_FORMAT_HVC1 ||
       priv->in_format == GST_H265_DECODER_FORMAT_HEV1) {
     pres = gst_h265_parser_identify_nalu_hevc (priv->parser,
         map.data, 0, map.size, priv->nal_length_size, &nalu);
 
-    while (pres == GST_H265_PARSER_OK && decode_ret) {
+    while (pres == GST_H265_PARSER_OK && decode_ret && nalu.offset < end) {
       decode_ret = gst_h265_decoder_decode_nal (self,
-          &nalu, GST_BUFFER_PTS (in_buf));
+          &nalu, GST_BUFFER_PTS (in_buf), NULL);
 
       pres = gst_h265_parser_identify_nalu_hevc (priv->parser,
           map.data, nalu.offset + nalu.size, map.size, priv->nal_length_size,
@@ -1724,9 +1823,9 @@ gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
     if (pres == GST_H265_PARSER_NO_NAL_END)
       pres = GST_H265_PARSER_OK;
 
-    while (pres == GST_H265_PARSER_OK && decode_ret) {
+    while (pres == GST_H265_PARSER_OK && decode_ret && nalu.offset < end) {
       decode_ret = gst_h265_decoder_decode_nal (self,
-          &nalu, GST_BUFFER_PTS (in_buf));
+          &nalu, GST_BUFFER_PTS (in_buf), NULL);
 
       pres = gst_h265_parser_identify_nalu (priv->parser,
           map.data, nalu.offset + nalu.size, map.size, &nalu);
@@ -1736,6 +1835,11 @@ gst_h265_decoder_handle_frame (GstVideoDecoder * decoder,
     }
   }
 
+  for (i = 0; meta && i < meta->n_units && decode_ret; i++) {
+    decode_ret = gst_h265_decoder_decode_nal_meta_unit (self,
+        &meta->units[i], map.data, GST_BUFFER_PTS (in_buf));
+  }
+
   gst_buffer_unmap (in_buf, &map);
   priv->current_frame = NULL;
 
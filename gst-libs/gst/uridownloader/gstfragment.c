@@ -46,6 +46,7 @@ struct _GstFragmentPrivate
 {
   GstBuffer *buffer;
   GstCaps *caps;
+  GstStructure *timing;         /* uri-downloader-timing of the download */
   GMutex lock;
 };
 
@@ -185,6 +186,8 @@ gst_fragment_finalize (GObject * gobject)
   g_free (fragment->name);
   if (fragment->headers)
     gst_structure_free (fragment->headers);
+  if (fragment->priv->timing)
+    gst_structure_free (fragment->priv->timing);
   g_mutex_clear (&fragment->priv->lock);
 
   G_OBJECT_CLASS (gst_fragment_parent_class)->finalize (gobject);
@@ -262,6 +265,48 @@ gst_fragment_get_caps (GstFragment * fragment)
   return fragment->priv->caps;
 }
 
+/**
+ * gst_fragment_set_timing:
+ * @fragment: a #GstFragment
+ * @timing: (transfer full) (nullable): the timing of the download
+ *
+ * Sets the "uri-downloader-timing" structure describing how long the steps
+ * of the download of @fragment took.
+ */
+void
+gst_fragment_set_timing (GstFragment * fragment, GstStructure * timing)
+{
+  g_return_if_fail (fragment != NULL);
+
+  g_mutex_lock (&fragment->priv->lock);
+  if (fragment->priv->timing)
+    gst_structure_free (fragment->priv->timing);
+  fragment->priv->timing = timing;
+  g_mutex_unlock (&fragment->priv->lock);
+}
+
+/**
+ * gst_fragment_get_timing:
+ * @fragment: a #GstFragment
+ *
+ * Returns: (transfer full) (nullable): a copy of the "uri-downloader-timing"
+ * structure of the download of @fragment, or %NULL if it is not known.
+ */
+GstStructure *
+gst_fragment_get_timing (GstFragment * fragment)
+{
+  GstStructure *timing = NULL;
+
+  g_return_val_if_fail (fragment != NULL, NULL);
+
+  g_mutex_lock (&fragment->priv->lock);
+  if (fragment->priv->timing)
+    timing = gst_structure_copy (fragment->priv->timing);
+  g_mutex_unlock (&fragment->priv->lock);
+
+  return timing;
+}
+
 gboolean
 gst_fragment_add_buffer (GstFragment * fragment, GstBuffer * buffer)
 {
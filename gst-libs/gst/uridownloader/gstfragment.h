@@ -81,6 +81,12 @@ GstCaps * gst_fragment_get_caps (GstFragment * fragment);
 GST_URI_DOWNLOADER_API
 gboolean gst_fragment_add_buffer (GstFragment *fragment, GstBuffer *buffer);
 
+GST_URI_DOWNLOADER_API
+void gst_fragment_set_timing (GstFragment * fragment, GstStructure * timing);
+
+GST_URI_DOWNLOADER_API
+GstStructure * gst_fragment_get_timing (GstFragment * fragment);
+
 GST_URI_DOWNLOADER_API
 GstFragment * gst_fragment_new (void);
 
@@ -46,6 +46,19 @@ struct _GstUriDownloaderPrivate
 
   GCond cond;
   gboolean cancelled;
+
+  /* Source pool: idle sources kept in READY keyed by scheme, host and
+   * port, so that their HTTP connections stay alive between fetches */
+  guint pool_size;              /* 0 if pooling is disabled */
+  gchar *urisrc_key;            /* pool key of urisrc */
+  GHashTable *idle_sources;     /* key -> GstElement */
+  GQueue idle_keys;             /* most recently used first */
+
+  /* Timing of the current download */
+  gboolean urisrc_reused;
+  GstClockTime request_time;
+  GstClockTime playing_time;
+  GstClockTime first_byte_time;
 };
 
 static void gst_uri_downloader_finalize (GObject * object);
@@ -61,6 +74,7 @@ static GstBusSyncReply gst_uri_downloader_bus_handler (GstBus * bus,
 static gboolean gst_uri_downloader_ensure_src (GstUriDownloader * downloader,
     const gchar * uri);
 static void gst_uri_downloader_destroy_src (GstUriDownloader * downloader);
+static void gst_uri_downloader_release_src (GstElement * urisrc);
 
 static GstStaticPadTemplate sinkpadtemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -108,6 +122,10 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
 
   g_mutex_init (&downloader->priv->download_lock);
   g_cond_init (&downloader->priv->cond);
+
+  downloader->priv->idle_sources = g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, (GDestroyNotify) gst_uri_downloader_release_src);
+  g_queue_init (&downloader->priv->idle_keys);
 }
 
 static void
@@ -117,6 +135,14 @@ gst_uri_downloader_dispose (GObject * object)
 
   gst_uri_downloader_destroy_src (downloader);
 
+  if (downloader->priv->idle_sources) {
+    g_queue_clear (&downloader->priv->idle_keys);
+    g_hash_table_destroy (downloader->priv->idle_sources);
+    downloader->priv->idle_sources = NULL;
+  }
+  g_free (downloader->priv->urisrc_key);
+  downloader->priv->urisrc_key = NULL;
+
   if (downloader->priv->bus != NULL) {
     gst_object_unref (downloader->priv->bus);
     downloader->priv->bus = NULL;
@@ -175,6 +201,39 @@ gst_uri_downloader_set_parent (GstUriDownloader * downloader,
   g_weak_ref_set (&downloader->priv->parent, parent);
 }
 
+/**
+ * gst_uri_downloader_set_pool_size:
+ * @downloader: the #GstUriDownloader
+ * @pool_size: maximum number of idle source elements to keep, or 0
+ *
+ * Enables pooling of the source elements. Instead of having a single
+ * source element that is torn down whenever the protocol changes, one
+ * source element is kept per scheme, host and port, and it is only moved
+ * back to READY between fetches. Sources with keep-alive support then keep
+ * their connections open, so alternating between e.g. the manifest server
+ * and the key server does not reconnect on every request.
+ *
+ * At most @pool_size idle sources are kept, the least recently used one
+ * is released first. 0, the default, disables the pool.
+ */
+void
+gst_uri_downloader_set_pool_size (GstUriDownloader * downloader,
+    guint pool_size)
+{
+  g_return_if_fail (GST_IS_URI_DOWNLOADER (downloader));
+
+  g_mutex_lock (&downloader->priv->download_lock);
+  GST_OBJECT_LOCK (downloader);
+  downloader->priv->pool_size = pool_size;
+  while (g_queue_get_length (&downloader->priv->idle_keys) > pool_size) {
+    gchar *key = g_queue_pop_tail (&downloader->priv->idle_keys);
+
+    g_hash_table_remove (downloader->priv->idle_sources, key);
+  }
+  GST_OBJECT_UNLOCK (downloader);
+  g_mutex_unlock (&downloader->priv->download_lock);
+}
+
 static gboolean
 gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -333,6 +392,8 @@ gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %" G_GSIZE_FORMAT, gst_buffer_get_size (buf));
+  if (!downloader->priv->got_buffer)
+    downloader->priv->first_byte_time = gst_util_get_timestamp ();
   downloader->priv->got_buffer = TRUE;
   if (!gst_fragment_add_buffer (downloader->priv->download, buf)) {
     GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
@@ -397,9 +458,104 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
   return TRUE;
 }
 
+/* scheme://host:port of @uri, or NULL if it can't be parsed */
+static gchar *
+gst_uri_downloader_get_pool_key (const gchar * uri)
+{
+  GstUri *gst_uri;
+  const gchar *scheme;
+  guint port;
+  gchar *key;
+
+  gst_uri = gst_uri_from_string (uri);
+  if (gst_uri == NULL)
+    return NULL;
+
+  /* "http://host/" and "http://host:80/" share connections */
+  scheme = gst_uri_get_scheme (gst_uri);
+  port = gst_uri_get_port (gst_uri);
+  if (port == GST_URI_NO_PORT) {
+    if (g_strcmp0 (scheme, "http") == 0)
+      port = 80;
+    else if (g_strcmp0 (scheme, "https") == 0)
+      port = 443;
+  }
+
+  key = g_strdup_printf ("%s://%s:%u", scheme,
+      GST_STR_NULL (gst_uri_get_host (gst_uri)), port);
+  gst_uri_unref (gst_uri);
+
+  return key;
+}
+
+/* Moves the current source element to the idle pool, releasing the least
+ * recently used one if the pool is full */
+static void
+gst_uri_downloader_park_src (GstUriDownloader * downloader)
+{
+  GstUriDownloaderPrivate *priv = downloader->priv;
+
+  if (priv->urisrc_key == NULL) {
+    gst_uri_downloader_destroy_src (downloader);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (downloader, "Parking source element for %s",
+      priv->urisrc_key);
+
+  g_queue_push_head (&priv->idle_keys, priv->urisrc_key);
+  g_hash_table_insert (priv->idle_sources, priv->urisrc_key, priv->urisrc);
+  priv->urisrc_key = NULL;
+  priv->urisrc = NULL;
+
+  while (g_queue_get_length (&priv->idle_keys) > priv->pool_size) {
+    gchar *key = g_queue_pop_tail (&priv->idle_keys);
+
+    GST_DEBUG_OBJECT (downloader, "Releasing idle source element for %s",
+        key);
+    g_hash_table_remove (priv->idle_sources, key);
+  }
+}
+
+/* Makes the pooled source element for the host of @uri the current one,
+ * if there is any */
+static void
+gst_uri_downloader_select_pooled_src (GstUriDownloader * downloader,
+    const gchar * uri)
+{
+  GstUriDownloaderPrivate *priv = downloader->priv;
+  gpointer orig_key, urisrc;
+  gchar *key;
+
+  key = gst_uri_downloader_get_pool_key (uri);
+  if (key && g_strcmp0 (key, priv->urisrc_key) == 0) {
+    g_free (key);
+    return;
+  }
+
+  if (priv->urisrc)
+    gst_uri_downloader_park_src (downloader);
+
+  if (key && g_hash_table_lookup_extended (priv->idle_sources, key, &orig_key,
+          &urisrc)) {
+    GST_DEBUG_OBJECT (downloader, "Picking up idle source element for %s",
+        key);
+    g_hash_table_steal (priv->idle_sources, key);
+    g_queue_remove (&priv->idle_keys, orig_key);
+    g_free (orig_key);
+    priv->urisrc = urisrc;
+  }
+  priv->urisrc_key = key;
+}
+
 static gboolean
 gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
 {
+  downloader->priv->urisrc_reused = FALSE;
+
+  if (downloader->priv->pool_size > 0)
+    gst_uri_downloader_select_pooled_src (downloader, uri);
+
   if (downloader->priv->urisrc) {
     gchar *old_protocol, *new_protocol;
     gchar *old_uri;
@@ -422,6 +578,8 @@ gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
             "Failed to re-use old source element: %s", err->message);
         g_clear_error (&err);
         gst_uri_downloader_destroy_src (downloader);
+      } else {
+        downloader->priv->urisrc_reused = TRUE;
       }
     }
     g_free (old_uri);
@@ -446,14 +604,20 @@ gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
   return downloader->priv->urisrc != NULL;
 }
 
+static void
+gst_uri_downloader_release_src (GstElement * urisrc)
+{
+  gst_element_set_state (urisrc, GST_STATE_NULL);
+  gst_object_unref (urisrc);
+}
+
 static void
 gst_uri_downloader_destroy_src (GstUriDownloader * downloader)
 {
   if (!downloader->priv->urisrc)
     return;
 
-  gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-  gst_object_unref (downloader->priv->urisrc);
+  gst_uri_downloader_release_src (downloader->priv->urisrc);
   downloader->priv->urisrc = NULL;
 }
 
@@ -531,6 +695,46 @@ gst_uri_downloader_set_method (GstUriDownloader * downloader,
   return FALSE;
 }
 
+static GstStructure *
+gst_uri_downloader_make_timing (GstUriDownloader * downloader,
+    GstFragment * download)
+{
+  GstUriDownloaderPrivate *priv = downloader->priv;
+  GstClockTime stop_time = download->download_stop_time;
+  GstClockTime first_byte_time = priv->first_byte_time;
+  GstClockTime playing_time = priv->playing_time;
+  GstBuffer *buffer;
+  guint64 bytes = 0;
+
+  /* HEAD requests don't get any data */
+  if (!GST_CLOCK_TIME_IS_VALID (first_byte_time))
+    first_byte_time = stop_time;
+
+  /* the source can fail or be cancelled before reaching PLAYING, and can
+   * push data before the state change returned */
+  if (!GST_CLOCK_TIME_IS_VALID (playing_time))
+    playing_time = first_byte_time;
+  playing_time = MIN (playing_time, first_byte_time);
+
+  buffer = gst_fragment_get_buffer (download);
+  if (buffer) {
+    bytes = gst_buffer_get_size (buffer);
+    gst_buffer_unref (buffer);
+  }
+
+  /* source-reused tells whether the source element of an earlier request
+   * was reused. It doesn't mean the transport connection was kept alive,
+   * the source decides whether it keeps or reopens its connection */
+  return gst_structure_new ("uri-downloader-timing",
+      "source-reused", G_TYPE_BOOLEAN, priv->urisrc_reused,
+      "setup-time", GST_TYPE_CLOCK_TIME, playing_time - priv->request_time,
+      "first-byte-time", GST_TYPE_CLOCK_TIME,
+      first_byte_time - priv->request_time,
+      "transfer-time", GST_TYPE_CLOCK_TIME, stop_time - first_byte_time,
+      "total-time", GST_TYPE_CLOCK_TIME, stop_time - priv->request_time,
+      "bytes", G_TYPE_UINT64, bytes, NULL);
+}
+
 GstFragment *
 gst_uri_downloader_fetch_uri (GstUriDownloader * downloader,
     const gchar * uri, const gchar * referer, gboolean compress,
@@ -563,6 +767,9 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
   g_mutex_lock (&downloader->priv->download_lock);
   downloader->priv->err = NULL;
   downloader->priv->got_buffer = FALSE;
+  downloader->priv->request_time = gst_util_get_timestamp ();
+  downloader->priv->playing_time = GST_CLOCK_TIME_NONE;
+  downloader->priv->first_byte_time = GST_CLOCK_TIME_NONE;
 
   GST_OBJECT_LOCK (downloader);
   if (downloader->priv->cancelled) {
@@ -610,6 +817,7 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
   GST_OBJECT_UNLOCK (downloader);
   ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_PLAYING);
   GST_OBJECT_LOCK (downloader);
+  downloader->priv->playing_time = gst_util_get_timestamp ();
   if (ret == GST_STATE_CHANGE_FAILURE) {
     if (downloader->priv->download) {
       g_object_unref (downloader->priv->download);
@@ -652,9 +860,14 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     }
   }
 
-  if (download != NULL)
+  if (download != NULL) {
+    GstStructure *timing;
+
     GST_INFO_OBJECT (downloader, "URI fetched successfully");
-  else
+    timing = gst_uri_downloader_make_timing (downloader, download);
+    GST_DEBUG_OBJECT (downloader, "Download timing: %" GST_PTR_FORMAT, timing);
+    gst_fragment_set_timing (download, timing);
+  } else
     GST_INFO_OBJECT (downloader, "Error fetching URI");
 
 quit:
@@ -60,12 +60,15 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     );
 
 #define DEFAULT_IGNORE_PCR FALSE
+#define DEFAULT_ASYNC_SECTIONS FALSE
 
 enum
 {
   PROP_0,
   PROP_PARSE_PRIVATE_SECTIONS,
   PROP_IGNORE_PCR,
+  PROP_ASYNC_SECTIONS,
+  PROP_SECTION_STATS,
   /* FILL ME */
 };
 
@@ -96,6 +99,7 @@ static gboolean mpegts_base_get_tags_from_eit (MpegTSBase * base,
     GstMpegtsSection * section);
 static gboolean mpegts_base_parse_atsc_mgt (MpegTSBase * base,
     GstMpegtsSection * section);
+static void mpegts_base_stop_section_thread (MpegTSBase * base);
 static gboolean remove_each_program (gpointer key, MpegTSBaseProgram * program,
     MpegTSBase * base);
 
@@ -158,11 +162,73 @@ mpegts_base_class_init (MpegTSBaseClass * klass)
           "Ignore PCR stream for timing", DEFAULT_IGNORE_PCR,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMpegtsBase:async-sections:
+   *
+   * Parse and post sections from a dedicated thread instead of the
+   * streaming thread. Sections affecting the demuxer state (PAT, PMT, ...)
+   * are still applied synchronously, and section messages are posted in
+   * the order the sections were received.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC_SECTIONS,
+      g_param_spec_boolean ("async-sections", "Asynchronous sections",
+          "Parse and post sections from a dedicated thread",
+          DEFAULT_ASYNC_SECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstMpegtsBase:section-stats:
+   *
+   * Per table section handling counters. Contains one "table-0xNN"
+   * structure field per table_id seen, holding the number of sections
+   * handled ("count"), the time spent on the streaming thread
+   * ("streaming-time") and the time spent on the section thread
+   * ("worker-time").
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_SECTION_STATS,
+      g_param_spec_boxed ("section-stats", "Section statistics",
+          "Per table section handling counters", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   klass->sink_query = GST_DEBUG_FUNCPTR (mpegts_base_default_sink_query);
 
   gst_type_mark_as_plugin_api (GST_TYPE_MPEGTS_BASE, 0);
 }
 
+static GstStructure *
+mpegts_base_get_section_stats (MpegTSBase * base)
+{
+  GstStructure *s = gst_structure_new_empty ("section-stats");
+  guint i;
+
+  g_mutex_lock (&base->section_stats_lock);
+  for (i = 0; i < G_N_ELEMENTS (base->section_stats); i++) {
+    MpegTSBaseSectionStats *stats = &base->section_stats[i];
+    GstStructure *table;
+    gchar *name;
+
+    if (stats->count == 0)
+      continue;
+
+    name = g_strdup_printf ("table-0x%02x", i);
+    table = gst_structure_new ("table",
+        "count", G_TYPE_UINT64, stats->count,
+        "streaming-time", G_TYPE_UINT64, stats->streaming_time,
+        "worker-time", G_TYPE_UINT64, stats->worker_time, NULL);
+    gst_structure_set (s, name, GST_TYPE_STRUCTURE, table, NULL);
+    gst_structure_free (table);
+    g_free (name);
+  }
+  g_mutex_unlock (&base->section_stats_lock);
+
+  return s;
+}
+
 static void
 mpegts_base_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -176,6 +242,9 @@ mpegts_base_set_property (GObject * object, guint prop_id,
     case PROP_IGNORE_PCR:
       base->ignore_pcr = g_value_get_boolean (value);
       break;
+    case PROP_ASYNC_SECTIONS:
+      base->async_sections = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -194,6 +263,12 @@ mpegts_base_get_property (GObject * object, guint prop_id,
     case PROP_IGNORE_PCR:
       g_value_set_boolean (value, base->ignore_pcr);
       break;
+    case PROP_ASYNC_SECTIONS:
+      g_value_set_boolean (value, base->async_sections);
+      break;
+    case PROP_SECTION_STATS:
+      g_value_take_boxed (value, mpegts_base_get_section_stats (base));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -204,6 +279,25 @@ static void
 mpegts_base_reset (MpegTSBase * base)
 {
   MpegTSBaseClass *klass = GST_MPEGTS_BASE_GET_CLASS (base);
+  guint i;
+
+  /* Pending sections refer to the programs we are about to remove */
+  mpegts_base_stop_section_thread (base);
+
+  g_mutex_lock (&base->section_stats_lock);
+  for (i = 0; i < G_N_ELEMENTS (base->section_stats); i++) {
+    MpegTSBaseSectionStats *stats = &base->section_stats[i];
+
+    if (stats->count == 0)
+      continue;
+    GST_INFO_OBJECT (base, "table_id 0x%02x: %" G_GUINT64_FORMAT
+        " sections, streaming thread %" GST_TIME_FORMAT
+        ", section thread %" GST_TIME_FORMAT, i, stats->count,
+        GST_TIME_ARGS (stats->streaming_time),
+        GST_TIME_ARGS (stats->worker_time));
+  }
+  memset (base->section_stats, 0, sizeof (base->section_stats));
+  g_mutex_unlock (&base->section_stats_lock);
 
   mpegts_packetizer_clear (base->packetizer);
   memset (base->is_pes, 0, 1024);
@@ -275,6 +369,8 @@ mpegts_base_init (MpegTSBase * base)
   base->push_data = TRUE;
   base->push_section = TRUE;
   base->ignore_pcr = DEFAULT_IGNORE_PCR;
+  base->async_sections = DEFAULT_ASYNC_SECTIONS;
+  g_mutex_init (&base->section_stats_lock);
 
   mpegts_base_reset (base);
 }
@@ -285,6 +381,7 @@ mpegts_base_dispose (GObject * object)
   MpegTSBase *base = GST_MPEGTS_BASE (object);
 
   if (!base->disposed) {
+    mpegts_base_stop_section_thread (base);
     g_object_unref (base->packetizer);
     base->disposed = TRUE;
     g_free (base->known_psi);
@@ -305,6 +402,7 @@ mpegts_base_finalize (GObject * object)
     base->pat = NULL;
   }
   g_hash_table_destroy (base->programs);
+  g_mutex_clear (&base->section_stats_lock);
 
   if (G_OBJECT_CLASS (parent_class)->finalize)
     G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -1203,10 +1301,165 @@ same_program:
   }
 }
 
+typedef struct
+{
+  GstMpegtsSection *section;
+  gboolean post_message;
+} MpegTSBaseQueuedSection;
+
+/* Pushed on the section queue to stop the section thread */
+static MpegTSBaseQueuedSection section_queue_stop;
+
+static void
+mpegts_base_add_section_time (MpegTSBase * base, guint8 table_id,
+    GstClockTime streaming_time, GstClockTime worker_time)
+{
+  MpegTSBaseSectionStats *stats = &base->section_stats[table_id];
+
+  g_mutex_lock (&base->section_stats_lock);
+  if (GST_CLOCK_TIME_IS_VALID (streaming_time)) {
+    stats->count++;
+    stats->streaming_time += streaming_time;
+  }
+  if (GST_CLOCK_TIME_IS_VALID (worker_time))
+    stats->worker_time += worker_time;
+  g_mutex_unlock (&base->section_stats_lock);
+}
+
+/* Parses the section contents so that applications receiving the section
+ * message don't have to. Sections applied on the streaming thread are
+ * already parsed */
+static void
+mpegts_base_parse_section (GstMpegtsSection * section)
+{
+  GPtrArray *array = NULL;
+  GstDateTime *datetime;
+
+  switch (section->section_type) {
+    case GST_MPEGTS_SECTION_CAT:
+      array = gst_mpegts_section_get_cat (section);
+      break;
+    case GST_MPEGTS_SECTION_TSDT:
+      array = gst_mpegts_section_get_tsdt (section);
+      break;
+    case GST_MPEGTS_SECTION_EIT:
+      gst_mpegts_section_get_eit (section);
+      break;
+    case GST_MPEGTS_SECTION_NIT:
+      gst_mpegts_section_get_nit (section);
+      break;
+    case GST_MPEGTS_SECTION_BAT:
+      gst_mpegts_section_get_bat (section);
+      break;
+    case GST_MPEGTS_SECTION_SDT:
+      gst_mpegts_section_get_sdt (section);
+      break;
+    case GST_MPEGTS_SECTION_TDT:
+      if ((datetime = gst_mpegts_section_get_tdt (section)))
+        gst_date_time_unref (datetime);
+      break;
+    case GST_MPEGTS_SECTION_TOT:
+      gst_mpegts_section_get_tot (section);
+      break;
+    case GST_MPEGTS_SECTION_SIT:
+      gst_mpegts_section_get_sit (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_TVCT:
+      gst_mpegts_section_get_atsc_tvct (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_CVCT:
+      gst_mpegts_section_get_atsc_cvct (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_ETT:
+      gst_mpegts_section_get_atsc_ett (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_EIT:
+      gst_mpegts_section_get_atsc_eit (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_STT:
+      gst_mpegts_section_get_atsc_stt (section);
+      break;
+    case GST_MPEGTS_SECTION_ATSC_RRT:
+      gst_mpegts_section_get_atsc_rrt (section);
+      break;
+    case GST_MPEGTS_SECTION_SCTE_SIT:
+      gst_mpegts_section_get_scte_sit (section);
+      break;
+    default:
+      break;
+  }
+
+  if (array)
+    g_ptr_array_unref (array);
+}
+
+static gpointer
+mpegts_base_section_thread_func (MpegTSBase * base)
+{
+  MpegTSBaseQueuedSection *item;
+
+  GST_DEBUG_OBJECT (base, "Section thread started");
+
+  while ((item = g_async_queue_pop (base->section_queue)) !=
+      &section_queue_stop) {
+    GstMpegtsSection *section = item->section;
+    GstClockTime start = gst_util_get_timestamp ();
+
+    if (item->post_message) {
+      mpegts_base_parse_section (section);
+      gst_element_post_message (GST_ELEMENT_CAST (base),
+          gst_message_new_mpegts_section (GST_OBJECT (base), section));
+    }
+
+    mpegts_base_add_section_time (base, section->table_id,
+        GST_CLOCK_TIME_NONE, gst_util_get_timestamp () - start);
+    gst_mpegts_section_unref (section);
+    g_slice_free (MpegTSBaseQueuedSection, item);
+  }
+
+  GST_DEBUG_OBJECT (base, "Section thread stopped");
+
+  return NULL;
+}
+
+static void
+mpegts_base_queue_section (MpegTSBase * base, GstMpegtsSection * section,
+    gboolean post_message)
+{
+  MpegTSBaseQueuedSection *item;
+
+  if (G_UNLIKELY (base->section_thread == NULL)) {
+    base->section_queue = g_async_queue_new ();
+    base->section_thread = g_thread_new ("mpegts-sections",
+        (GThreadFunc) mpegts_base_section_thread_func, base);
+  }
+
+  item = g_slice_new (MpegTSBaseQueuedSection);
+  item->section = section;
+  item->post_message = post_message;
+  g_async_queue_push (base->section_queue, item);
+}
+
+/* Waits for all queued sections to be posted and stops the section thread */
+static void
+mpegts_base_stop_section_thread (MpegTSBase * base)
+{
+  if (base->section_thread == NULL)
+    return;
+
+  g_async_queue_push (base->section_queue, &section_queue_stop);
+  g_thread_join (base->section_thread);
+  base->section_thread = NULL;
+  g_async_queue_unref (base->section_queue);
+  base->section_queue = NULL;
+}
+
 static void
 mpegts_base_handle_psi (MpegTSBase * base, GstMpegtsSection * section)
 {
   gboolean post_message = TRUE;
+  guint8 table_id = section->table_id;
+  GstClockTime start = gst_util_get_timestamp ();
 
   GST_DEBUG ("Handling PSI (pid: 0x%04x , table_id: 0x%02x)",
       section->pid, section->table_id);
@@ -1235,11 +1488,19 @@ mpegts_base_handle_psi (MpegTSBase * base, GstMpegtsSection * section)
       break;
   }
 
-  /* Finally post message (if it wasn't corrupted) */
-  if (post_message)
-    gst_element_post_message (GST_ELEMENT_CAST (base),
-        gst_message_new_mpegts_section (GST_OBJECT (base), section));
-  gst_mpegts_section_unref (section);
+  /* Finally post message (if it wasn't corrupted). In asynchronous mode all
+   * sections go through the queue so that messages keep their order */
+  if (base->async_sections) {
+    mpegts_base_queue_section (base, section, post_message);
+  } else {
+    if (post_message)
+      gst_element_post_message (GST_ELEMENT_CAST (base),
+          gst_message_new_mpegts_section (GST_OBJECT (base), section));
+    gst_mpegts_section_unref (section);
+  }
+
+  mpegts_base_add_section_time (base, table_id,
+      gst_util_get_timestamp () - start, GST_CLOCK_TIME_NONE);
 }
 
 static gboolean
@@ -1434,6 +1695,19 @@ mpegts_base_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
   return GST_MPEGTS_BASE_GET_CLASS (base)->sink_query (base, query);
 }
 
+/* Whether a packet can be dropped without being fully parsed. Packets with
+ * an adaptation field are always parsed since they might carry a PCR */
+static inline gboolean
+mpegts_base_can_skip_packet (MpegTSBase * base,
+    const MpegTSPacketizerPacketInfo * info)
+{
+  if (FLAGS_HAS_AFC (info->scram_afc_cc))
+    return FALSE;
+
+  return !MPEGTS_BIT_IS_SET (base->is_pes, info->pid) &&
+      !MPEGTS_BIT_IS_SET (base->known_psi, info->pid);
+}
+
 static GstFlowReturn
 mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1443,12 +1717,20 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   MpegTSPacketizer2 *packetizer;
   MpegTSPacketizerPacket packet;
   MpegTSBaseClass *klass;
+  MpegTSPacketizerPacketInfo infos[64];
+  guint n_infos = 0, cur_info = 0;
+  guint64 infos_offset = 0;
+  gboolean skip_unhandled;
 
   base = GST_MPEGTS_BASE (parent);
   klass = GST_MPEGTS_BASE_GET_CLASS (base);
 
   packetizer = base->packetizer;
 
+  /* If subclasses don't want to see every packet, runs of packets on PIDs
+   * we don't handle are dropped based on their headers only */
+  skip_unhandled = klass->inspect_packet == NULL && !base->push_unknown;
+
   if (GST_BUFFER_IS_DISCONT (buf)) {
     GST_DEBUG_OBJECT (base, "Got DISCONT buffer, flushing");
     res = mpegts_base_drain (base);
@@ -1470,6 +1752,37 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   mpegts_packetizer_push (base->packetizer, buf);
 
   while (res == GST_FLOW_OK) {
+    if (skip_unhandled) {
+      guint n_skip = 0;
+
+      /* Refill the packet headers once they are all consumed, or if the
+       * packetizer position changed behind our back */
+      if (cur_info >= n_infos || packetizer->map_data == NULL
+          || packetizer->offset != infos_offset) {
+        n_infos = mpegts_packetizer_next_packets (packetizer, infos,
+            G_N_ELEMENTS (infos));
+        if (n_infos == 0)
+          break;
+        cur_info = 0;
+        infos_offset = packetizer->offset;
+      }
+
+      while (cur_info + n_skip < n_infos &&
+          mpegts_base_can_skip_packet (base, &infos[cur_info + n_skip]))
+        n_skip++;
+
+      if (n_skip) {
+        mpegts_packetizer_skip_packets (packetizer, n_skip);
+        cur_info += n_skip;
+        infos_offset += (guint64) n_skip * packetizer->packet_size;
+        continue;
+      }
+
+      /* infos[cur_info] is handled below */
+      cur_info++;
+      infos_offset += packetizer->packet_size;
+    }
+
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
     /* If we don't have enough data, return */
@@ -1497,8 +1810,10 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       GstMpegtsSection *section;
 
       section = mpegts_packetizer_push_section (packetizer, &packet, &others);
+      /* handling the section releases it, possibly from the section thread,
+       * but it is still needed to push the packet below */
       if (section)
-        mpegts_base_handle_psi (base, section);
+        mpegts_base_handle_psi (base, gst_mpegts_section_ref (section));
       if (G_UNLIKELY (others)) {
         for (tmp = others; tmp; tmp = tmp->next)
           mpegts_base_handle_psi (base, (GstMpegtsSection *) tmp->data);
@@ -1509,6 +1824,9 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       if (base->push_section)
         res = klass->push (base, &packet, section);
 
+      if (section)
+        gst_mpegts_section_unref (section);
+
     } else if (base->push_unknown) {
       res = klass->push (base, &packet, NULL);
     } else if (packet.payload && packet.pid != 0x1fff)
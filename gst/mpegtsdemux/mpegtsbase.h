@@ -97,6 +97,16 @@ struct _MpegTSBaseProgram
   gboolean initial_program;
 };
 
+/* Per table_id section handling counters */
+typedef struct
+{
+  guint64      count;
+  /* Time spent handling the section on the streaming thread */
+  GstClockTime streaming_time;
+  /* Time spent parsing/posting the section on the section thread */
+  GstClockTime worker_time;
+} MpegTSBaseSectionStats;
+
 typedef enum {
   /* PULL MODE */
   BASE_MODE_SCANNING,		/* Looking for PAT/PMT */
@@ -170,6 +180,17 @@ struct _MpegTSBase {
   /* Do not use the PCR stream for timestamp calculation. Useful for
    * streams with broken/invalid PCR streams. */
   gboolean ignore_pcr;
+
+  /* Whether sections are parsed and posted from a dedicated thread. Sections
+   * which affect the demuxer state (PAT, PMT, ...) are still applied on the
+   * streaming thread before being queued */
+  gboolean async_sections;
+  GThread *section_thread;
+  GAsyncQueue *section_queue;
+
+  /* Protected by section_stats_lock, indexed by table_id */
+  GMutex section_stats_lock;
+  MpegTSBaseSectionStats section_stats[256];
 };
 
 struct _MpegTSBaseClass {
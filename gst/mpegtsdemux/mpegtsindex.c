@@ -0,0 +1,310 @@
+/*
+ * mpegtsindex.c : MPEG-TS time/offset index
+ * Copyright (C) 2021 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "mpegtsindex.h"
+
+GST_DEBUG_CATEGORY_STATIC (mpegts_index_debug);
+#define GST_CAT_DEFAULT mpegts_index_debug
+
+/* Serialized format (all values big-endian):
+ *
+ *   magic            4 bytes "TSIX"
+ *   version          4 bytes
+ *   upstream_size    8 bytes
+ *   pcr_pid          4 bytes
+ *   n_pcrs           4 bytes
+ *   n_keyframes      4 bytes
+ *   entries          (n_pcrs + n_keyframes) * 16 bytes : ts, offset
+ */
+#define INDEX_MAGIC "TSIX"
+#define INDEX_VERSION 1
+#define INDEX_HEADER_SIZE 28
+#define INDEX_ENTRY_SIZE 16
+
+#define DEFAULT_PCR_INTERVAL GST_SECOND
+
+MpegTSIndex *
+mpegts_index_new (guint64 upstream_size, guint16 pcr_pid)
+{
+  MpegTSIndex *index = g_new0 (MpegTSIndex, 1);
+
+  index->pcrs = g_array_new (FALSE, FALSE, sizeof (MpegTSIndexEntry));
+  index->keyframes = g_array_new (FALSE, FALSE, sizeof (MpegTSIndexEntry));
+  index->pcr_interval = DEFAULT_PCR_INTERVAL;
+  index->upstream_size = upstream_size;
+  index->pcr_pid = pcr_pid;
+
+  return index;
+}
+
+void
+mpegts_index_free (MpegTSIndex * index)
+{
+  g_array_free (index->pcrs, TRUE);
+  g_array_free (index->keyframes, TRUE);
+  g_free (index);
+}
+
+/* Returns the position of the last entry with a time <= @ts, or -1 */
+static gint
+find_entry (GArray * entries, GstClockTime ts)
+{
+  gint low = 0, high = (gint) entries->len - 1;
+
+  while (low <= high) {
+    gint mid = low + (high - low) / 2;
+
+    if (g_array_index (entries, MpegTSIndexEntry, mid).ts <= ts)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+
+  return high;
+}
+
+/* Inserts an entry, unless there is already one closer than @min_distance
+ * in time. Entries are usually appended, but seeking backwards in a
+ * partially indexed file inserts in the middle */
+static void
+insert_entry (MpegTSIndex * index, GArray * entries, GstClockTime ts,
+    guint64 offset, guint32 flags, GstClockTime min_distance)
+{
+  MpegTSIndexEntry entry;
+  gint pos;
+
+  pos = find_entry (entries, ts);
+
+  /* The table must stay sorted by offset as well, entries with bogus
+   * timestamps are ignored */
+  if (pos >= 0) {
+    MpegTSIndexEntry *prev = &g_array_index (entries, MpegTSIndexEntry, pos);
+    if (prev->offset >= offset || ts - prev->ts < min_distance)
+      return;
+  }
+  if (pos + 1 < (gint) entries->len) {
+    MpegTSIndexEntry *next =
+        &g_array_index (entries, MpegTSIndexEntry, pos + 1);
+    if (next->offset <= offset || next->ts - ts < min_distance)
+      return;
+  }
+
+  entry.ts = ts;
+  entry.offset = offset;
+  entry.flags = flags;
+  g_array_insert_val (entries, pos + 1, entry);
+  index->dirty = TRUE;
+
+  GST_LOG ("Added %s entry %" GST_TIME_FORMAT " offset %" G_GUINT64_FORMAT,
+      flags & MPEGTS_INDEX_ENTRY_KEYFRAME ? "keyframe" : "pcr",
+      GST_TIME_ARGS (ts), offset);
+}
+
+void
+mpegts_index_add_pcr (MpegTSIndex * index, GstClockTime ts, guint64 offset)
+{
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (ts));
+
+  insert_entry (index, index->pcrs, ts, offset, 0, index->pcr_interval);
+}
+
+void
+mpegts_index_add_keyframe (MpegTSIndex * index, GstClockTime ts,
+    guint64 offset)
+{
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (ts));
+
+  insert_entry (index, index->keyframes, ts, offset,
+      MPEGTS_INDEX_ENTRY_KEYFRAME, 1);
+}
+
+/* Finds the last entry with a time <= @ts, in the keyframe table if
+ * @keyframe is TRUE, else in the PCR table. */
+gboolean
+mpegts_index_lookup (MpegTSIndex * index, GstClockTime ts, gboolean keyframe,
+    MpegTSIndexEntry * entry)
+{
+  GArray *entries = keyframe ? index->keyframes : index->pcrs;
+  gint pos;
+
+  pos = find_entry (entries, ts);
+  if (pos < 0)
+    return FALSE;
+
+  *entry = g_array_index (entries, MpegTSIndexEntry, pos);
+
+  GST_DEBUG ("%" GST_TIME_FORMAT " => %s entry %" GST_TIME_FORMAT " offset %"
+      G_GUINT64_FORMAT, GST_TIME_ARGS (ts), keyframe ? "keyframe" : "pcr",
+      GST_TIME_ARGS (entry->ts), entry->offset);
+
+  return TRUE;
+}
+
+/* Returns FALSE if the entries are not sorted by both time and offset, as
+ * insert_entry() keeps them */
+static gboolean
+read_entries (GArray * entries, const guint8 * data, guint n, guint32 flags)
+{
+  guint i;
+
+  g_array_set_size (entries, n);
+  for (i = 0; i < n; i++) {
+    MpegTSIndexEntry *entry = &g_array_index (entries, MpegTSIndexEntry, i);
+
+    entry->ts = GST_READ_UINT64_BE (data);
+    entry->offset = GST_READ_UINT64_BE (data + 8);
+    entry->flags = flags;
+    data += INDEX_ENTRY_SIZE;
+
+    if (!GST_CLOCK_TIME_IS_VALID (entry->ts))
+      return FALSE;
+    if (i > 0 && (entry->ts <= entry[-1].ts
+            || entry->offset <= entry[-1].offset))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guint8 *
+write_entries (GArray * entries, guint8 * data)
+{
+  guint i;
+
+  for (i = 0; i < entries->len; i++) {
+    MpegTSIndexEntry *entry = &g_array_index (entries, MpegTSIndexEntry, i);
+
+    GST_WRITE_UINT64_BE (data, entry->ts);
+    GST_WRITE_UINT64_BE (data + 8, entry->offset);
+    data += INDEX_ENTRY_SIZE;
+  }
+
+  return data;
+}
+
+/* Loads the index stored at @location. Fails if the index was created for
+ * a different file (size or PCR pid mismatch) */
+MpegTSIndex *
+mpegts_index_load (const gchar * location, guint64 upstream_size,
+    guint16 pcr_pid, GError ** error)
+{
+  MpegTSIndex *index;
+  gchar *contents;
+  gsize size;
+  guint32 n_pcrs, n_keyframes;
+  const guint8 *data;
+
+  if (!g_file_get_contents (location, &contents, &size, error))
+    return NULL;
+
+  data = (const guint8 *) contents;
+
+  if (size < INDEX_HEADER_SIZE || memcmp (data, INDEX_MAGIC, 4) != 0
+      || GST_READ_UINT32_BE (data + 4) != INDEX_VERSION)
+    goto invalid;
+
+  if (GST_READ_UINT64_BE (data + 8) != upstream_size
+      || GST_READ_UINT32_BE (data + 16) != pcr_pid)
+    goto mismatch;
+
+  n_pcrs = GST_READ_UINT32_BE (data + 20);
+  n_keyframes = GST_READ_UINT32_BE (data + 24);
+  if (size - INDEX_HEADER_SIZE !=
+      ((guint64) n_pcrs + n_keyframes) * INDEX_ENTRY_SIZE)
+    goto invalid;
+
+  index = mpegts_index_new (upstream_size, pcr_pid);
+  data += INDEX_HEADER_SIZE;
+  if (!read_entries (index->pcrs, data, n_pcrs, 0))
+    goto unsorted;
+  data += n_pcrs * INDEX_ENTRY_SIZE;
+  if (!read_entries (index->keyframes, data, n_keyframes,
+          MPEGTS_INDEX_ENTRY_KEYFRAME))
+    goto unsorted;
+
+  GST_INFO ("Loaded index from %s, %u PCR and %u keyframe entries", location,
+      n_pcrs, n_keyframes);
+
+  g_free (contents);
+  return index;
+
+unsorted:
+  mpegts_index_free (index);
+invalid:
+  g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+      "'%s' is not a valid index file", location);
+  g_free (contents);
+  return NULL;
+
+mismatch:
+  g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+      "'%s' is an index for a different file", location);
+  g_free (contents);
+  return NULL;
+}
+
+gboolean
+mpegts_index_save (MpegTSIndex * index, const gchar * location,
+    GError ** error)
+{
+  gsize size;
+  guint8 *contents, *data;
+  gboolean res;
+
+  size = INDEX_HEADER_SIZE +
+      (index->pcrs->len + index->keyframes->len) * INDEX_ENTRY_SIZE;
+  contents = data = g_malloc (size);
+
+  memcpy (data, INDEX_MAGIC, 4);
+  GST_WRITE_UINT32_BE (data + 4, INDEX_VERSION);
+  GST_WRITE_UINT64_BE (data + 8, index->upstream_size);
+  GST_WRITE_UINT32_BE (data + 16, index->pcr_pid);
+  GST_WRITE_UINT32_BE (data + 20, index->pcrs->len);
+  GST_WRITE_UINT32_BE (data + 24, index->keyframes->len);
+  data += INDEX_HEADER_SIZE;
+  data = write_entries (index->pcrs, data);
+  write_entries (index->keyframes, data);
+
+  /* g_file_set_contents() replaces the file atomically */
+  res = g_file_set_contents (location, (const gchar *) contents, size, error);
+  if (res) {
+    GST_INFO ("Saved index to %s, %u PCR and %u keyframe entries", location,
+        index->pcrs->len, index->keyframes->len);
+    index->dirty = FALSE;
+  }
+
+  g_free (contents);
+  return res;
+}
+
+void
+init_mpegts_index (void)
+{
+  GST_DEBUG_CATEGORY_INIT (mpegts_index_debug, "mpegtsindex", 0,
+      "MPEG-TS time/offset index");
+}
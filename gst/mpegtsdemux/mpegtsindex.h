@@ -0,0 +1,89 @@
+/*
+ * mpegtsindex.h : MPEG-TS time/offset index
+ * Copyright (C) 2021 The GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __MPEGTS_INDEX_H__
+#define __MPEGTS_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Flags used on index entries */
+enum
+{
+  /* The entry is the start of a PES containing a keyframe */
+  MPEGTS_INDEX_ENTRY_KEYFRAME = 1 << 0
+};
+
+typedef struct
+{
+  /* Time of the entry, in the packetizer time base (i.e. what
+   * mpegts_packetizer_offset_to_ts() and mpegts_packetizer_pts_to_ts()
+   * return) */
+  GstClockTime ts;
+  /* Offset (in bytes) of the packet */
+  guint64 offset;
+  /* MPEGTS_INDEX_ENTRY_* */
+  guint32 flags;
+} MpegTSIndexEntry;
+
+/* MpegTSIndex: A sparse time to byte offset table.
+ *
+ * Two tables are maintained, both sorted by time:
+ * * PCR observations, at most one entry every @pcr_interval
+ * * Keyframes
+ */
+typedef struct
+{
+  GArray *pcrs;
+  GArray *keyframes;
+
+  /* Minimum distance between two PCR entries */
+  GstClockTime pcr_interval;
+
+  /* Size of the indexed file, used to validate a loaded index */
+  guint64 upstream_size;
+  guint16 pcr_pid;
+
+  /* TRUE if entries were added since the index was created/loaded */
+  gboolean dirty;
+} MpegTSIndex;
+
+G_GNUC_INTERNAL MpegTSIndex *mpegts_index_new (guint64 upstream_size, guint16 pcr_pid);
+G_GNUC_INTERNAL void mpegts_index_free (MpegTSIndex * index);
+
+G_GNUC_INTERNAL void mpegts_index_add_pcr (MpegTSIndex * index, GstClockTime ts,
+    guint64 offset);
+G_GNUC_INTERNAL void mpegts_index_add_keyframe (MpegTSIndex * index, GstClockTime ts,
+    guint64 offset);
+
+G_GNUC_INTERNAL gboolean mpegts_index_lookup (MpegTSIndex * index, GstClockTime ts,
+    gboolean keyframe, MpegTSIndexEntry * entry);
+
+G_GNUC_INTERNAL MpegTSIndex *mpegts_index_load (const gchar * location,
+    guint64 upstream_size, guint16 pcr_pid, GError ** error);
+G_GNUC_INTERNAL gboolean mpegts_index_save (MpegTSIndex * index,
+    const gchar * location, GError ** error);
+
+G_GNUC_INTERNAL void init_mpegts_index (void);
+
+G_END_DECLS
+
+#endif /* __MPEGTS_INDEX_H__ */
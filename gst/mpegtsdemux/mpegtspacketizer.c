@@ -36,6 +36,16 @@
 #include "mpegtspacketizer.h"
 #include "gstmpegdesc.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MPEGTS_HAVE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MPEGTS_HAVE_NEON 1
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (mpegts_packetizer_debug);
 #define GST_CAT_DEFAULT mpegts_packetizer_debug
 
@@ -291,6 +301,7 @@ mpegts_packetizer_dispose (GObject * object)
       g_free (packetizer->streams);
     }
 
+    gst_clear_buffer (&packetizer->map_buffer);
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
     g_mutex_clear (&packetizer->group_lock);
@@ -591,6 +602,7 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  gst_clear_buffer (&packetizer->map_buffer);
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
   packetizer->last_pts = GST_CLOCK_TIME_NONE;
   packetizer->last_dts = GST_CLOCK_TIME_NONE;
@@ -633,6 +645,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  gst_clear_buffer (&packetizer->map_buffer);
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
   packetizer->last_pts = GST_CLOCK_TIME_NONE;
   packetizer->last_dts = GST_CLOCK_TIME_NONE;
@@ -712,6 +725,7 @@ mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  gst_clear_buffer (&packetizer->map_buffer);
 }
 
 static gboolean
@@ -741,11 +755,125 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+static inline guint
+mpegts_ctz (guint32 mask)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz (mask);
+#else
+  guint n = 0;
+
+  while (!(mask & 1)) {
+    mask >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/* Returns the first position @i in [0, @len) for which the @count bytes
+ * data[i], data[i + stride], ..., data[i + (count - 1) * stride] are all
+ * sync bytes, or @len if there is none.
+ *
+ * The caller guarantees that data[len - 1 + (count - 1) * stride] is
+ * readable.
+ *
+ * With @count == 1 this is a plain sync byte scan, with @count > 1 it
+ * checks for a run of consecutive packets of size @stride, which is
+ * what is used for (re)synchronization. Blocks of 16 (32 with AVX2)
+ * candidate positions are compared at once, the scalar loop only handles
+ * the remaining tail. */
+static gsize
+mpegts_find_sync_run (const guint8 * data, gsize len, guint stride,
+    guint count)
+{
+  gsize i = 0;
+  guint k;
+
+#if defined(__AVX2__)
+  {
+    const __m256i sync = _mm256_set1_epi8 (PACKET_SYNC_BYTE);
+
+    for (; i + 32 <= len; i += 32) {
+      __m256i cmp = _mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *)
+              (data + i)), sync);
+      guint32 mask;
+
+      for (k = 1; k < count; k++)
+        cmp = _mm256_and_si256 (cmp,
+            _mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *)
+                    (data + i + k * stride)), sync));
+
+      mask = (guint32) _mm256_movemask_epi8 (cmp);
+      if (mask)
+        return i + mpegts_ctz (mask);
+    }
+  }
+#elif defined(MPEGTS_HAVE_SSE2)
+  {
+    const __m128i sync = _mm_set1_epi8 (PACKET_SYNC_BYTE);
+
+    for (; i + 16 <= len; i += 16) {
+      __m128i cmp = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)
+              (data + i)), sync);
+      guint32 mask;
+
+      for (k = 1; k < count; k++)
+        cmp = _mm_and_si128 (cmp,
+            _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)
+                    (data + i + k * stride)), sync));
+
+      mask = (guint32) _mm_movemask_epi8 (cmp);
+      if (mask)
+        return i + mpegts_ctz (mask);
+    }
+  }
+#elif defined(MPEGTS_HAVE_NEON)
+  {
+    const uint8x16_t sync = vdupq_n_u8 (PACKET_SYNC_BYTE);
+
+    for (; i + 16 <= len; i += 16) {
+      uint8x16_t cmp = vceqq_u8 (vld1q_u8 (data + i), sync);
+      uint64_t mask;
+
+      for (k = 1; k < count; k++)
+        cmp = vandq_u8 (cmp, vceqq_u8 (vld1q_u8 (data + i + k * stride),
+                sync));
+
+      /* Narrow each 16 bits lane to 8 bits, which leaves 4 bits per
+       * input byte in a 64 bits mask */
+      mask = vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16
+              (vreinterpretq_u16_u8 (cmp), 4)), 0);
+      if (mask) {
+        guint32 lo = (guint32) mask;
+
+        if (lo)
+          return i + mpegts_ctz (lo) / 4;
+        return i + 8 + mpegts_ctz ((guint32) (mask >> 32)) / 4;
+      }
+    }
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (data[i] != PACKET_SYNC_BYTE)
+      continue;
+    for (k = 1; k < count; k++) {
+      if (data[i + k * stride] != PACKET_SYNC_BYTE)
+        break;
+    }
+    if (k == count)
+      return i;
+  }
+
+  return len;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, i, j, len;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -760,12 +888,19 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+  len = size > 3 * MPEGTS_MAX_PACKETSIZE ? size - 3 * MPEGTS_MAX_PACKETSIZE : 0;
+
+  /* Find the first position with 4 consecutive sync bytes for any of the
+   * possible packet sizes. Each scan is bounded by the best position found
+   * so far, so in the common (already aligned) case they all stop
+   * immediately */
+  i = len;
+  for (j = 0; j < G_N_ELEMENTS (psizes); j++)
+    i = mpegts_find_sync_run (data, i, psizes[j], 4);
 
-    /* check for 4 consecutive sync bytes with each possible packet size */
+  if (i < len) {
+    /* Several packet sizes can match at the same position, keep the
+     * priority order of psizes[] */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
       guint packet_size = psizes[j];
 
@@ -773,12 +908,11 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
           data[i + 2 * packet_size] == PACKET_SYNC_BYTE &&
           data[i + 3 * packet_size] == PACKET_SYNC_BYTE) {
         packetizer->packet_size = packet_size;
-        goto out;
+        break;
       }
     }
   }
 
-out:
   packetizer->map_offset += i;
 
   if (packetizer->packet_size == 0) {
@@ -818,13 +952,14 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
-        data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
-      found = TRUE;
-      break;
-    }
+  if (size > 2 * packet_size + sync_offset) {
+    gsize len = size - 2 * packet_size - sync_offset;
+
+    i = mpegts_find_sync_run (data + sync_offset, len, packet_size, 3);
+    found = i < len;
+    i += sync_offset;
+  } else {
+    i = sync_offset;
   }
 
   packetizer->map_offset += i - sync_offset;
@@ -888,6 +1023,128 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
   }
 }
 
+/* Returns a GstMemory containing the @size bytes at @data, which must be
+ * located within the currently mapped data (i.e. a packet returned by
+ * mpegts_packetizer_next_packet() which wasn't cleared yet).
+ *
+ * The upstream memory is shared whenever possible, the data is only copied
+ * if it spans several upstream memories or if they can't be shared. */
+GstMemory *
+mpegts_packetizer_get_memory (MpegTSPacketizer2 * packetizer,
+    const guint8 * data, gsize size)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+  gsize offset, skip;
+  guint idx, len;
+
+  g_return_val_if_fail (packetizer->map_data != NULL, NULL);
+  g_return_val_if_fail (data >= packetizer->map_data, NULL);
+  g_return_val_if_fail (data + size <=
+      packetizer->map_data + packetizer->map_size, NULL);
+
+  offset = data - packetizer->map_data;
+
+  /* The mapped data might have been merged by the adapter, get a buffer
+   * referencing the original memories */
+  if (packetizer->map_buffer == NULL)
+    packetizer->map_buffer = gst_adapter_get_buffer_fast (packetizer->adapter,
+        packetizer->map_size);
+
+  if (packetizer->map_buffer && size > 0 &&
+      gst_buffer_find_memory (packetizer->map_buffer, offset, size, &idx, &len,
+          &skip) && len == 1) {
+    mem = gst_buffer_peek_memory (packetizer->map_buffer, idx);
+    if (!GST_MEMORY_FLAG_IS_SET (mem, GST_MEMORY_FLAG_NO_SHARE))
+      return gst_memory_share (mem, skip, size);
+  }
+
+  GST_LOG ("copying %" G_GSIZE_FORMAT " bytes at offset %" G_GSIZE_FORMAT,
+      size, offset);
+  mem = gst_allocator_alloc (NULL, size, NULL);
+  if (size > 0 && gst_memory_map (mem, &map, GST_MAP_WRITE)) {
+    memcpy (map.data, data, size);
+    gst_memory_unmap (mem, &map);
+  }
+
+  return mem;
+}
+
+/* Fills @infos with the headers of up to @max_packets consecutive aligned
+ * packets, starting at the current position. The packets are *not*
+ * consumed, the caller either processes them one by one with
+ * mpegts_packetizer_next_packet() or discards them with
+ * mpegts_packetizer_skip_packets().
+ *
+ * Returns the number of packets filled in, 0 if more data is needed. */
+guint
+mpegts_packetizer_next_packets (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacketInfo * infos, guint max_packets)
+{
+  const guint8 *packet_data;
+  guint packet_size;
+  gsize sync_offset, available;
+  guint i, n;
+
+  packet_size = packetizer->packet_size;
+  if (G_UNLIKELY (!packet_size)) {
+    if (!mpegts_try_discover_packet_size (packetizer))
+      return 0;
+    packet_size = packetizer->packet_size;
+  }
+
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    sync_offset = 4;
+  else
+    sync_offset = 0;
+
+  while (1) {
+    if (packetizer->need_sync) {
+      if (!mpegts_packetizer_sync (packetizer))
+        return 0;
+      packetizer->need_sync = FALSE;
+    }
+
+    if (!mpegts_packetizer_map (packetizer, packet_size))
+      return 0;
+
+    available = packetizer->map_size - packetizer->map_offset;
+    n = MIN (max_packets, available / packet_size);
+    packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
+
+    for (i = 0; i < n; i++, packet_data += packet_size) {
+      if (G_UNLIKELY (packet_data[0] != PACKET_SYNC_BYTE))
+        break;
+
+      infos[i].flags = packet_data[1] & 0xc0;
+      infos[i].pid = GST_READ_UINT16_BE (packet_data + 1) & 0x1FFF;
+      infos[i].scram_afc_cc = packet_data[3];
+    }
+
+    if (i > 0)
+      return i;
+
+    GST_DEBUG ("lost sync");
+    packetizer->need_sync = TRUE;
+  }
+}
+
+/* Discards @n_packets packets previously returned by
+ * mpegts_packetizer_next_packets() */
+void
+mpegts_packetizer_skip_packets (MpegTSPacketizer2 * packetizer,
+    guint n_packets)
+{
+  gsize size = (gsize) n_packets * packetizer->packet_size;
+
+  g_return_if_fail (packetizer->map_size - packetizer->map_offset >= size);
+
+  packetizer->offset += size;
+  packetizer->map_offset += size;
+  if (packetizer->map_size - packetizer->map_offset < packetizer->packet_size)
+    mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
 {
@@ -268,6 +268,9 @@ struct _MpegTSPacketizer2 {
   gsize map_offset;
   gsize map_size;
   gboolean need_sync;
+  /* Buffer referencing the upstream memories of the mapped data, used to
+   * share payloads without copying them. Lazily created */
+  GstBuffer *map_buffer;
 
   /* Reference offset */
   guint64 refoffset;
@@ -314,6 +317,20 @@ typedef struct
   guint64 offset;
 } MpegTSPacketizerPacket;
 
+/* Compact packet header, as returned by mpegts_packetizer_next_packets() */
+typedef struct
+{
+  guint16 pid;
+  /* transport_scrambling_control, adaptation_field_control and
+   * continuity_counter. Use the FLAGS_* macros */
+  guint8  scram_afc_cc;
+  /* MPEGTS_PACKET_INFO_* flags */
+  guint8  flags;
+} MpegTSPacketizerPacketInfo;
+
+#define MPEGTS_PACKET_INFO_TRANSPORT_ERROR 0x80
+#define MPEGTS_PACKET_INFO_PUSI            0x40
+
 typedef struct
 {
   guint8 table_id;
@@ -348,8 +365,14 @@ G_GNUC_INTERNAL void mpegts_packetizer_push (MpegTSPacketizer2 *packetizer, GstB
 G_GNUC_INTERNAL gboolean mpegts_packetizer_has_packets (MpegTSPacketizer2 *packetizer);
 G_GNUC_INTERNAL MpegTSPacketizerPacketReturn mpegts_packetizer_next_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
+G_GNUC_INTERNAL guint mpegts_packetizer_next_packets (MpegTSPacketizer2 *packetizer,
+  MpegTSPacketizerPacketInfo *infos, guint max_packets);
+G_GNUC_INTERNAL void mpegts_packetizer_skip_packets (MpegTSPacketizer2 *packetizer,
+  guint n_packets);
 G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
+G_GNUC_INTERNAL GstMemory *mpegts_packetizer_get_memory (MpegTSPacketizer2 *packetizer,
+  const guint8 *data, gsize size);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
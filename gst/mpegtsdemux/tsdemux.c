@@ -46,7 +46,9 @@
 #include "gstmpegdefs.h"
 #include "mpegtspacketizer.h"
 #include "pesparse.h"
+#include "mpegtsindex.h"
 #include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
 #include <gst/codecparsers/gstmpegvideoparser.h>
 #include <gst/video/video-color.h>
 
@@ -70,11 +72,28 @@
  */
 #define SEEK_TIMESTAMP_OFFSET (2500 * GST_MSECOND)
 
+/* Maximum distance between an indexed keyframe and the seek target for
+ * the keyframe to be used as starting point */
+#define SEEK_INDEX_MAX_KEYFRAME_DISTANCE (10 * GST_SECOND)
+
 #define GST_FLOW_REWINDING GST_FLOW_CUSTOM_ERROR
 
 /* latency in msecs */
 #define DEFAULT_LATENCY (700)
 
+#define DEFAULT_MEASURE_LATENCY FALSE
+
+/* Measured latency: the maximum delay observed over a window of input
+ * time is kept. The reported latency has a margin of 25% of the measured
+ * value (at least LATENCY_MIN_MARGIN) on top, and a latency message is
+ * posted when it drifts from the last reported value by more than that
+ * margin */
+#define LATENCY_WINDOW (5 * GST_SECOND)
+#define LATENCY_MIN_MARGIN (20 * GST_MSECOND)
+
+#define DEFAULT_ZERO_COPY FALSE
+#define DEFAULT_INDEX_LOCATION NULL
+
 /* Limit PES packet collection to a maximum of 32MB
  * which is more than large enough to support an H264 frame at
  * maximum profile/level/bitrate at 30fps or above.
@@ -166,6 +185,11 @@ struct _TSDemuxStream
   /* Whether this is a sparse stream (subtitles or metadata) */
   gboolean sparse;
 
+  /* Whether the PES can be collected without copying and pushed as several
+   * buffers. Only for byte-stream video that a parser re-frames downstream,
+   * everything else is copied into one buffer per PES */
+  gboolean split_pes;
+
   /* TRUE if we are waiting for a valid timestamp */
   gboolean pending_ts;
 
@@ -175,9 +199,21 @@ struct _TSDemuxStream
   /* Data being reconstructed (allocated) */
   guint8 *data;
 
+  /* Data being reconstructed in zero-copy mode. The buffers reference the
+   * upstream memories, there is always at least one buffer */
+  GstBufferList *data_list;
+
   /* Size of data being reconstructed (if known, else 0) */
   guint expected_size;
 
+  /* Offset of the packet containing the current PES header */
+  guint64 pes_offset;
+  /* Whether the current PES started with the random_access_indicator */
+  gboolean pes_random_access;
+  /* Whether the current PES still needs to be checked for a keyframe
+   * to be indexed */
+  gboolean pes_needs_index;
+
   /* Amount of bytes in current ->data */
   guint current_size;
   /* Size of ->data */
@@ -297,6 +333,9 @@ enum
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
   PROP_LATENCY,
+  PROP_MEASURE_LATENCY,
+  PROP_ZERO_COPY,
+  PROP_INDEX_LOCATION,
   /* FILL ME */
 };
 
@@ -364,6 +403,13 @@ gst_ts_demux_dispose (GObject * object)
 
   gst_flow_combiner_free (demux->flowcombiner);
 
+  if (demux->index) {
+    mpegts_index_free (demux->index);
+    demux->index = NULL;
+  }
+  g_free (demux->index_location);
+  demux->index_location = NULL;
+
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
@@ -395,6 +441,52 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           G_MAXINT, DEFAULT_LATENCY,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * tsdemux:measure-latency:
+   *
+   * For live input, report the measured delay between the arrival of the
+   * input buffer and the output of the corresponding access units (plus a
+   * safety margin) instead of the fixed #tsdemux:latency. The fixed value
+   * is used until a measurement is available. A latency message is posted
+   * when the measured value changes significantly.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MEASURE_LATENCY,
+      g_param_spec_boolean ("measure-latency", "Measure latency",
+          "Report the measured latency for live input instead of a fixed one",
+          DEFAULT_MEASURE_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * tsdemux:zero-copy:
+   *
+   * Output PES payloads as buffer lists referencing the incoming memory
+   * instead of copying them into a new buffer. Only used for H.264, H.265
+   * and MPEG video, which a parser re-frames downstream. Other streams, and
+   * keyframe scanning after seeks, still use the copying path.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Output PES payloads without copying them from the input buffers",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * tsdemux:index-location:
+   *
+   * Location of a PCR and keyframe index for the file being played in
+   * pull mode. If the file exists and matches the input, it is used to
+   * seek directly to the closest keyframe. Entries observed during
+   * playback are added to it and it is written back when stopping.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "Location of the seek index file (pull mode only)",
+          DEFAULT_INDEX_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -428,11 +520,106 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
   ts_class->drain = GST_DEBUG_FUNCPTR (gst_ts_demux_drain);
 }
 
+static void
+gst_ts_demux_save_index (GstTSDemux * demux)
+{
+  GError *err = NULL;
+
+  if (!demux->index || !demux->index->dirty || !demux->index_location)
+    return;
+
+  if (!mpegts_index_save (demux->index, demux->index_location, &err)) {
+    GST_WARNING_OBJECT (demux, "Could not save index: %s", err->message);
+    g_clear_error (&err);
+  }
+}
+
+static void
+gst_ts_demux_reset_latency (GstTSDemux * demux)
+{
+  GST_OBJECT_LOCK (demux);
+  demux->measured_latency = GST_CLOCK_TIME_NONE;
+  demux->reported_latency = GST_CLOCK_TIME_NONE;
+  demux->latency_window_start = GST_CLOCK_TIME_NONE;
+  demux->latency_window_max = 0;
+  GST_OBJECT_UNLOCK (demux);
+}
+
+/* Must be called with the OBJECT_LOCK */
+static GstClockTime
+gst_ts_demux_padded_latency (GstTSDemux * demux)
+{
+  if (!demux->measure_latency
+      || !GST_CLOCK_TIME_IS_VALID (demux->measured_latency))
+    return GST_CLOCK_TIME_NONE;
+
+  return demux->measured_latency + MAX (demux->measured_latency / 4,
+      LATENCY_MIN_MARGIN);
+}
+
+/* Records the delay between the most recent input buffer and the access
+ * unit being pushed out with timestamp @ts. Both are in the input timeline
+ * when tracking the clock skew of a live source */
+static void
+gst_ts_demux_update_latency (GstTSDemux * demux, GstClockTime ts)
+{
+  MpegTSPacketizer2 *packetizer = MPEG_TS_BASE_PACKETIZER (demux);
+  GstClockTime in_time = packetizer->last_in_time;
+  GstClockTime delay, padded, reported;
+  gboolean post = FALSE;
+
+  if (!packetizer->calculate_skew || !GST_CLOCK_TIME_IS_VALID (in_time)
+      || !GST_CLOCK_TIME_IS_VALID (ts))
+    return;
+
+  delay = in_time > ts ? in_time - ts : 0;
+
+  GST_OBJECT_LOCK (demux);
+  if (!GST_CLOCK_TIME_IS_VALID (demux->latency_window_start))
+    demux->latency_window_start = in_time;
+  demux->latency_window_max = MAX (demux->latency_window_max, delay);
+
+  /* Grow immediately, only shrink once a full window has been observed */
+  if (!GST_CLOCK_TIME_IS_VALID (demux->measured_latency)
+      || delay > demux->measured_latency) {
+    demux->measured_latency = delay;
+  } else if (in_time >= demux->latency_window_start + LATENCY_WINDOW) {
+    demux->measured_latency = demux->latency_window_max;
+    demux->latency_window_start = in_time;
+    demux->latency_window_max = delay;
+  }
+
+  padded = gst_ts_demux_padded_latency (demux);
+  reported = demux->reported_latency;
+  if (GST_CLOCK_TIME_IS_VALID (padded) && GST_CLOCK_TIME_IS_VALID (reported)
+      && ABS (GST_CLOCK_DIFF (reported, padded)) >
+      MAX (demux->measured_latency / 4, LATENCY_MIN_MARGIN)) {
+    /* Don't repost until the next latency query */
+    demux->reported_latency = padded;
+    post = TRUE;
+  }
+  GST_OBJECT_UNLOCK (demux);
+
+  if (post) {
+    GST_INFO_OBJECT (demux, "Latency changed from %" GST_TIME_FORMAT
+        " to %" GST_TIME_FORMAT, GST_TIME_ARGS (reported),
+        GST_TIME_ARGS (padded));
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_latency (GST_OBJECT_CAST (demux)));
+  }
+}
+
 static void
 gst_ts_demux_reset (MpegTSBase * base)
 {
   GstTSDemux *demux = (GstTSDemux *) base;
 
+  if (demux->index) {
+    gst_ts_demux_save_index (demux);
+    mpegts_index_free (demux->index);
+    demux->index = NULL;
+  }
+
   demux->rate = 1.0;
   if (demux->segment_event) {
     gst_event_unref (demux->segment_event);
@@ -454,6 +641,8 @@ gst_ts_demux_reset (MpegTSBase * base)
 
   demux->last_seek_offset = -1;
   demux->program_generation = 0;
+
+  gst_ts_demux_reset_latency (demux);
 }
 
 static void
@@ -470,6 +659,8 @@ gst_ts_demux_init (GstTSDemux * demux)
   demux->requested_program_number = -1;
   demux->program_number = -1;
   demux->latency = DEFAULT_LATENCY;
+  demux->measure_latency = DEFAULT_MEASURE_LATENCY;
+  demux->zero_copy = DEFAULT_ZERO_COPY;
   gst_ts_demux_reset (base);
 }
 
@@ -492,6 +683,16 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_LATENCY:
       demux->latency = g_value_get_int (value);
       break;
+    case PROP_MEASURE_LATENCY:
+      demux->measure_latency = g_value_get_boolean (value);
+      break;
+    case PROP_ZERO_COPY:
+      demux->zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_INDEX_LOCATION:
+      g_free (demux->index_location);
+      demux->index_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -513,6 +714,15 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_LATENCY:
       g_value_set_int (value, demux->latency);
       break;
+    case PROP_MEASURE_LATENCY:
+      g_value_set_boolean (value, demux->measure_latency);
+      break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, demux->zero_copy);
+      break;
+    case PROP_INDEX_LOCATION:
+      g_value_set_string (value, demux->index_location);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -577,9 +787,8 @@ gst_ts_demux_srcpad_query (GstPad * pad, GstObject * parent, GstQuery * query)
       GST_DEBUG ("query latency");
       res = gst_pad_peer_query (base->sinkpad, query);
       if (res) {
-        GstClockTime min_lat, max_lat;
+        GstClockTime min_lat, max_lat, latency;
         gboolean live;
-        gint latency;
 
         /* According to H.222.0
            Annex D.0.3 (System Time Clock recovery in the decoder)
@@ -588,13 +797,23 @@ gst_ts_demux_srcpad_query (GstPad * pad, GstObject * parent, GstQuery * query)
            We can end up with an interval of up to 700ms between valid
            PTS/DTS. We therefore allow a latency of 700ms for that.
          */
-        latency = demux->latency;
-        if (latency < 0)
-          latency = 700;
+        GST_OBJECT_LOCK (demux);
+        latency = gst_ts_demux_padded_latency (demux);
+        if (!GST_CLOCK_TIME_IS_VALID (latency)) {
+          if (demux->latency < 0)
+            latency = 700 * GST_MSECOND;
+          else
+            latency = demux->latency * GST_MSECOND;
+        }
+        demux->reported_latency = latency;
+        GST_OBJECT_UNLOCK (demux);
+
+        GST_DEBUG_OBJECT (demux, "Reporting latency of %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (latency));
         gst_query_parse_latency (query, &live, &min_lat, &max_lat);
-        min_lat += latency * GST_MSECOND;
+        min_lat += latency;
         if (GST_CLOCK_TIME_IS_VALID (max_lat))
-          max_lat += latency * GST_MSECOND;
+          max_lat += latency;
         gst_query_set_latency (query, live, min_lat, max_lat);
       }
       break;
@@ -905,14 +1124,30 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   /* If the position actually changed, update == TRUE */
   if (update) {
     GstClockTime target = seeksegment.start;
+    MpegTSIndexEntry entry;
+
     if (target >= SEEK_TIMESTAMP_OFFSET)
       target -= SEEK_TIMESTAMP_OFFSET;
     else
       target = 0;
 
-    start_offset =
-        mpegts_packetizer_ts_to_offset (base->packetizer, target,
-        demux->program->pcr_pid);
+    /* Prefer the index: the closest keyframe is the exact place to start
+     * from, else the closest PCR observation is better than an
+     * interpolation */
+    if (demux->index
+        && mpegts_index_lookup (demux->index, seeksegment.start, TRUE, &entry)
+        && entry.ts + SEEK_INDEX_MAX_KEYFRAME_DISTANCE >= seeksegment.start) {
+      GST_DEBUG_OBJECT (demux, "Seeking to indexed keyframe at %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (entry.ts));
+      start_offset = entry.offset;
+    } else if (demux->index
+        && mpegts_index_lookup (demux->index, target, FALSE, &entry)) {
+      start_offset = entry.offset;
+    } else {
+      start_offset =
+          mpegts_packetizer_ts_to_offset (base->packetizer, target,
+          demux->program->pcr_pid);
+    }
     if (G_UNLIKELY (start_offset == -1)) {
       GST_WARNING ("Couldn't convert start position to an offset");
       goto done;
@@ -1031,6 +1266,9 @@ push_event (MpegTSBase * base, GstEvent * event)
     return early_ret;
   }
 
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    gst_ts_demux_save_index (demux);
+
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     TSDemuxStream *stream = (TSDemuxStream *) tmp->data;
     if (stream->pad) {
@@ -1838,6 +2076,13 @@ done:
           GST_STREAM_FLAG_SPARSE);
     }
     stream->sparse = sparse;
+    {
+      const GstStructure *s = gst_caps_get_structure (caps, 0);
+
+      stream->split_pes = is_video && (gst_structure_has_name (s,
+              "video/x-h264") || gst_structure_has_name (s, "video/x-h265")
+          || gst_structure_has_name (s, "video/mpeg"));
+    }
     gst_stream_set_caps (bstream->stream_object, caps);
     if (!stream->taglist)
       stream->taglist = gst_tag_list_new_empty ();
@@ -1977,14 +2222,175 @@ activate_pad_for_stream (GstTSDemux * tsdemux, TSDemuxStream * stream)
   }
 }
 
+static void
+gst_ts_demux_stream_clear_data (TSDemuxStream * stream)
+{
+  g_free (stream->data);
+  stream->data = NULL;
+  gst_clear_buffer_list (&stream->data_list);
+}
+
+/* Whether the PES payload of @stream can be collected without copying it.
+ * Only for streams that may be pushed as several buffers, others are copied
+ * into one buffer per PES */
+static gboolean
+gst_ts_demux_stream_can_zero_copy (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  if (!demux->zero_copy || stream->needs_keyframe)
+    return FALSE;
+
+  return stream->split_pes;
+}
+
+static void
+gst_ts_demux_stream_append_memory (TSDemuxStream * stream, GstMemory * mem)
+{
+  guint n = gst_buffer_list_length (stream->data_list);
+  GstBuffer *buf = gst_buffer_list_get_writable (stream->data_list, n - 1);
+
+  /* Appending more memories than a buffer can hold would merge (and copy)
+   * them, start a new buffer instead */
+  if (gst_buffer_n_memory (buf) >= gst_buffer_get_max_memory ()) {
+    buf = gst_buffer_new ();
+    gst_buffer_list_add (stream->data_list, buf);
+  }
+
+  gst_buffer_append_memory (buf, mem);
+}
+
+/* Scans the NAL units starting in @data for the first VCL unit. @state
+ * holds the last bytes seen, so start codes can span several chunks.
+ * Returns 1 for an IDR/IRAP unit, 0 for another VCL unit and -1 if more
+ * data is needed */
+static gint
+gst_ts_demux_scan_keyframe (const guint8 * data, gsize size, gboolean hevc,
+    guint32 * state)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    guint8 type;
+
+    *state = (*state << 8) | data[i];
+    if ((*state & 0xffffff00) != 0x00000100)
+      continue;
+
+    if (hevc) {
+      type = (data[i] >> 1) & 0x3f;
+      if (GST_H265_IS_NAL_TYPE_IRAP (type))
+        return 1;
+      /* Stop at the first non-IRAP VCL unit */
+      if (type < GST_H265_NAL_SLICE_BLA_W_LP)
+        return 0;
+    } else {
+      type = data[i] & 0x1f;
+      if (type == GST_H264_NAL_SLICE_IDR)
+        return 1;
+      if (type == GST_H264_NAL_SLICE)
+        return 0;
+    }
+    /* Don't take the NAL header for the start of a start code */
+    *state = 0xffffffff;
+  }
+
+  return -1;
+}
+
+static gint
+gst_ts_demux_scan_keyframe_buffer (GstBuffer * buffer, gboolean hevc,
+    guint32 * state)
+{
+  guint i, n = gst_buffer_n_memory (buffer);
+  gint res = -1;
+
+  /* Map the memories one by one, mapping the zero-copy buffers at once
+   * would merge them */
+  for (i = 0; i < n && res < 0; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstMapInfo map;
+
+    if (!gst_memory_map (mem, &map, GST_MAP_READ))
+      return 0;
+    res = gst_ts_demux_scan_keyframe (map.data, map.size, hevc, state);
+    gst_memory_unmap (mem, &map);
+  }
+
+  return res;
+}
+
+/* Whether the current PES of @stream, output as @buffer or @buffer_list,
+ * starts with a keyframe. Relies on the random_access_indicator, or on the
+ * NAL unit types for H.264/H.265 */
+static gboolean
+gst_ts_demux_stream_is_keyframe (TSDemuxStream * stream, GstBuffer * buffer,
+    GstBufferList * buffer_list)
+{
+  MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+  gboolean hevc = FALSE;
+  guint32 state = 0xffffffff;
+  gint res = -1;
+  guint i, n;
+
+  switch (bs->stream_type) {
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG4:
+      return stream->pes_random_access;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+      hevc = TRUE;
+      break;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+      break;
+    default:
+      /* Audio frames are all "random access", only index video */
+      return FALSE;
+  }
+
+  if (stream->pes_random_access)
+    return TRUE;
+
+  if (buffer_list) {
+    n = gst_buffer_list_length (buffer_list);
+    for (i = 0; i < n && res < 0; i++)
+      res = gst_ts_demux_scan_keyframe_buffer (gst_buffer_list_get
+          (buffer_list, i), hevc, &state);
+  } else if (buffer) {
+    res = gst_ts_demux_scan_keyframe_buffer (buffer, hevc, &state);
+  }
+
+  return res > 0;
+}
+
+/* Converts the zero-copy payload of @stream to contiguous data */
+static void
+gst_ts_demux_stream_flatten_data (TSDemuxStream * stream)
+{
+  guint i, n;
+  gsize offset = 0;
+
+  g_assert (stream->data == NULL);
+
+  stream->allocated_size = MAX (stream->current_size, 1);
+  stream->data = g_malloc (stream->allocated_size);
+
+  n = gst_buffer_list_length (stream->data_list);
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_list_get (stream->data_list, i);
+
+    offset += gst_buffer_extract (buf, 0, stream->data + offset,
+        stream->allocated_size - offset);
+  }
+
+  gst_clear_buffer_list (&stream->data_list);
+}
+
 static void
 gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
     gboolean hard)
 {
   GST_DEBUG ("flushing stream %p", stream);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_clear_data (stream);
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
   stream->allocated_size = 0;
@@ -2076,6 +2482,39 @@ gst_ts_demux_update_program (MpegTSBase * base, MpegTSBaseProgram * program)
   }
 }
 
+/* Loads or creates the seek index for @program, if configured */
+static void
+gst_ts_demux_setup_index (GstTSDemux * demux, MpegTSBaseProgram * program)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  GError *err = NULL;
+  gint64 upstream_size;
+
+  if (demux->index) {
+    gst_ts_demux_save_index (demux);
+    mpegts_index_free (demux->index);
+    demux->index = NULL;
+  }
+
+  if (!demux->index_location || base->mode == BASE_MODE_PUSHING)
+    return;
+
+  if (!gst_pad_peer_query_duration (base->sinkpad, GST_FORMAT_BYTES,
+          &upstream_size) || upstream_size <= 0) {
+    GST_WARNING_OBJECT (demux, "Unknown upstream size, not indexing");
+    return;
+  }
+
+  demux->index = mpegts_index_load (demux->index_location, upstream_size,
+      program->pcr_pid, &err);
+  if (!demux->index) {
+    GST_INFO_OBJECT (demux, "Starting a new index: %s",
+        err ? err->message : "");
+    g_clear_error (&err);
+    demux->index = mpegts_index_new (upstream_size, program->pcr_pid);
+  }
+}
+
 static void
 gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
 {
@@ -2146,6 +2585,8 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
       return;
     }
 
+    gst_ts_demux_setup_index (demux, program);
+
     /* If any of the stream is sparse, push a GAP event before anything else
      * This is done here, and not in activate_pad_for_stream() because pushing
      * a GAP event *is* considering data, and we want to ensure the (potential)
@@ -2410,6 +2851,8 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
 
   gst_ts_demux_record_dts (demux, stream, header.DTS, bufferoffset);
   gst_ts_demux_record_pts (demux, stream, header.PTS, bufferoffset);
+  stream->pes_offset = bufferoffset;
+  stream->pes_needs_index = demux->index != NULL;
   if (G_UNLIKELY (stream->pending_ts &&
           (stream->pts != GST_CLOCK_TIME_NONE
               || stream->dts != GST_CLOCK_TIME_NONE))) {
@@ -2442,13 +2885,26 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
+  g_assert (stream->data == NULL && stream->data_list == NULL);
+
+  if (gst_ts_demux_stream_can_zero_copy (demux, stream)) {
+    stream->data_list = gst_buffer_list_new ();
+    gst_buffer_list_add (stream->data_list, gst_buffer_new ());
+    if (length)
+      gst_ts_demux_stream_append_memory (stream,
+          mpegts_packetizer_get_memory (MPEG_TS_BASE_PACKETIZER (demux), data,
+              length));
+    stream->current_size = length;
+    stream->state = PENDING_PACKET_BUFFER;
+    return;
+  }
+
   /* Create the output buffer */
   if (stream->expected_size)
     stream->allocated_size = MAX (stream->expected_size, length);
   else
     stream->allocated_size = MAX (8192, length);
 
-  g_assert (stream->data == NULL);
   stream->data = g_malloc (stream->allocated_size);
   memcpy (stream->data, data, length);
   stream->current_size = length;
@@ -2489,10 +2945,7 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
       if (packet->payload_unit_start_indicator) {
         /* A mismatch is fatal, except if this is the beginning of a new
          * frame (from which we can recover) */
-        if (G_UNLIKELY (stream->data)) {
-          g_free (stream->data);
-          stream->data = NULL;
-        }
+        gst_ts_demux_stream_clear_data (stream);
         stream->state = PENDING_PACKET_HEADER;
       } else {
         GST_WARNING ("CONTINUITY: Mismatch packet %d, stream %d",
@@ -2525,6 +2978,13 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG ("BUFFER: appending data");
+      if (stream->data_list) {
+        gst_ts_demux_stream_append_memory (stream,
+            mpegts_packetizer_get_memory (MPEG_TS_BASE_PACKETIZER (demux),
+                data, size));
+        stream->current_size += size;
+        break;
+      }
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
         GST_LOG ("resizing buffer");
         do {
@@ -2539,10 +2999,7 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_DISCONT:
     {
       GST_LOG ("DISCONT: not storing/pushing");
-      if (G_UNLIKELY (stream->data)) {
-        g_free (stream->data);
-        stream->data = NULL;
-      }
+      gst_ts_demux_stream_clear_data (stream);
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -3060,7 +3517,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
+  if (G_UNLIKELY (stream->data == NULL && stream->data_list == NULL)) {
     GST_LOG ("stream->data == NULL");
     goto beach;
   }
@@ -3081,6 +3538,10 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
     goto beach;
   }
 
+  /* Keyframe scanning needs contiguous data */
+  if (G_UNLIKELY (stream->needs_keyframe && stream->data_list))
+    gst_ts_demux_stream_flatten_data (stream);
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -3130,7 +3591,16 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       goto beach;
     }
   } else {
-    if (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+    if (stream->data_list) {
+      buffer_list = stream->data_list;
+      stream->data_list = NULL;
+
+      if (gst_buffer_list_length (buffer_list) == 1) {
+        buffer = gst_buffer_ref (gst_buffer_list_get (buffer_list, 0));
+        gst_buffer_list_unref (buffer_list);
+        buffer_list = NULL;
+      }
+    } else if (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
         bs->registration_id == DRF_ID_OPUS) {
       buffer_list = parse_opus_access_unit (stream);
       if (!buffer_list) {
@@ -3232,6 +3702,16 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
   GST_DEBUG_OBJECT (stream->pad, "stream->pts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (stream->pts));
 
+  if (stream->pes_needs_index) {
+    GstClockTime ts = GST_CLOCK_TIME_IS_VALID (stream->pts) ?
+        stream->pts : stream->dts;
+
+    if (demux->index && GST_CLOCK_TIME_IS_VALID (ts)
+        && gst_ts_demux_stream_is_keyframe (stream, buffer, buffer_list))
+      mpegts_index_add_keyframe (demux->index, ts, stream->pes_offset);
+    stream->pes_needs_index = FALSE;
+  }
+
   /* Decorate buffer or first buffer of the buffer list */
   if (buffer_list)
     buffer = gst_buffer_list_get (buffer_list, 0);
@@ -3262,6 +3742,10 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       base->out_segment.position = stream->pts;
   }
 
+  if (demux->measure_latency)
+    gst_ts_demux_update_latency (demux,
+        GST_CLOCK_TIME_IS_VALID (stream->dts) ? stream->dts : stream->pts);
+
   if (buffer) {
     res = gst_pad_push (stream->pad, buffer);
     /* Record that a buffer was pushed */
@@ -3312,6 +3796,7 @@ beach:
       stream->expected_size -= stream->current_size;
   }
   stream->data = NULL;
+  gst_clear_buffer_list (&stream->data_list);
   stream->allocated_size = 0;
   stream->current_size = 0;
 
@@ -3334,6 +3819,8 @@ gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
     res = gst_ts_demux_push_pending_data (demux, stream, NULL);
     /* Tell the data collecting to expect this header */
     stream->state = PENDING_PACKET_HEADER;
+    stream->pes_random_access =
+        (packet->afc_flags & MPEGTS_AFC_RANDOM_ACCESS_FLAG) != 0;
   }
 
   if (packet->payload && (res == GST_FLOW_OK || res == GST_FLOW_NOT_LINKED)
@@ -3375,6 +3862,7 @@ gst_ts_demux_flush (MpegTSBase * base, gboolean hard)
     demux->global_tags = NULL;
   }
   if (hard) {
+    gst_ts_demux_reset_latency (demux);
     /* For pull mode seeks the current segment needs to be preserved */
     demux->rate = 1.0;
     gst_segment_init (&base->out_segment, GST_FORMAT_UNDEFINED);
@@ -3414,6 +3902,14 @@ gst_ts_demux_push (MpegTSBase * base, MpegTSPacketizerPacket * packet,
   if (G_LIKELY (demux->program)) {
     stream = (TSDemuxStream *) demux->program->streams[packet->pid];
 
+    if (demux->index && packet->pcr != G_MAXUINT64
+        && packet->pid == demux->program->pcr_pid) {
+      GstClockTime ts = mpegts_packetizer_offset_to_ts (base->packetizer,
+          packet->offset, packet->pid);
+      if (GST_CLOCK_TIME_IS_VALID (ts))
+        mpegts_index_add_pcr (demux->index, ts, packet->offset);
+    }
+
     if (stream) {
       res = gst_ts_demux_handle_packet (demux, stream, packet, section);
     }
@@ -3427,6 +3923,7 @@ gst_ts_demux_plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (ts_demux_debug, "tsdemux", 0,
       "MPEG transport stream demuxer");
   init_pes_parser ();
+  init_mpegts_index ();
 
   return gst_element_register (plugin, "tsdemux",
       GST_RANK_PRIMARY, GST_TYPE_TS_DEMUX);
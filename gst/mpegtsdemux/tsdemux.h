@@ -32,6 +32,7 @@
 #include <gst/base/gstflowcombiner.h>
 #include "mpegtsbase.h"
 #include "mpegtspacketizer.h"
+#include "mpegtsindex.h"
 
 /* color specifications for JPEG 2000 stream over MPEG TS */
 typedef enum
@@ -77,6 +78,9 @@ struct _GstTSDemux
   guint program_number;
   gboolean emit_statistics;
   gint latency; /* latency in ms */
+  gboolean measure_latency;
+  gboolean zero_copy;
+  gchar *index_location;
 
   /*< private >*/
   gint program_generation; /* Incremented each time we switch program 0..15 */
@@ -101,6 +105,15 @@ struct _GstTSDemux
 
   /* Used when seeking for a keyframe to go backward in the stream */
   guint64 last_seek_offset;
+
+  /* Seek index (pull mode only, if index_location is set) */
+  MpegTSIndex *index;
+
+  /* Measured live latency, protected by the OBJECT_LOCK */
+  GstClockTime measured_latency;
+  GstClockTime reported_latency;
+  GstClockTime latency_window_start;
+  GstClockTime latency_window_max;
 };
 
 struct _GstTSDemuxClass
@@ -308,6 +308,192 @@ steal_si_section (GstMpegtsSectionType * type, TsMuxSection * section,
   return TRUE;
 }
 
+/* Pooled output: with a fixed alignment of normal sized packets, TsMux
+ * writes its packets directly into pooled buffers of alignment packets,
+ * which are then output as a whole */
+static gint
+gst_base_ts_mux_get_pooled_alignment (GstBaseTsMux * mux)
+{
+  gint align = mux->alignment;
+
+  if (align < 0)
+    align = mux->automatic_alignment;
+
+  if (align <= 0 || mux->packet_size != GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH)
+    return 0;
+
+  return align;
+}
+
+/* TsMux drops the packet buffer if it fails to write it */
+static void
+packet_buffer_finalized (GstBaseTsMux * mux, GstMiniObject * obj)
+{
+  mux->packet_buffer = NULL;
+  mux->packet_buffer_pending = FALSE;
+}
+
+static void
+gst_base_ts_mux_clear_out_buffer (GstBaseTsMux * mux)
+{
+  /* packet_buffer points into the out_buffer mapping */
+  g_assert (!mux->packet_buffer_pending);
+  gst_clear_buffer (&mux->packet_buffer);
+
+  if (mux->out_buffer) {
+    gst_buffer_unmap (mux->out_buffer, &mux->out_map);
+    gst_clear_buffer (&mux->out_buffer);
+  }
+  mux->out_offset = 0;
+}
+
+/* Pushes the full pooled buffers and moves the partially filled one back to
+ * the adapter */
+static GstFlowReturn
+gst_base_ts_mux_stop_pooled_output (GstBaseTsMux * mux)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buf;
+  gsize size = mux->out_offset;
+
+  if (mux->out_list) {
+    ret = gst_aggregator_finish_buffer_list (GST_AGGREGATOR (mux),
+        mux->out_list);
+    mux->out_list = NULL;
+    if (ret != GST_FLOW_OK)
+      GST_DEBUG_OBJECT (mux, "Pushing pooled buffers returned %s",
+          gst_flow_get_name (ret));
+  }
+
+  if (!mux->out_buffer)
+    return ret;
+
+  buf = gst_buffer_ref (mux->out_buffer);
+  gst_base_ts_mux_clear_out_buffer (mux);
+  if (size > 0) {
+    gst_buffer_resize (buf, 0, size);
+    gst_adapter_push (mux->out_adapter, buf);
+  } else {
+    gst_buffer_unref (buf);
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_base_ts_mux_acquire_out_buffer (GstBaseTsMux * mux, gint align)
+{
+  gsize size = align * GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH;
+
+  if (mux->out_buffer)
+    return TRUE;
+
+  if (mux->out_pool && mux->out_pool_size != size) {
+    gst_buffer_pool_set_active (mux->out_pool, FALSE);
+    gst_clear_object (&mux->out_pool);
+  }
+
+  if (!mux->out_pool) {
+    GstStructure *config;
+
+    mux->out_pool = gst_buffer_pool_new ();
+    mux->out_pool_size = size;
+    config = gst_buffer_pool_get_config (mux->out_pool);
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    if (!gst_buffer_pool_set_config (mux->out_pool, config)
+        || !gst_buffer_pool_set_active (mux->out_pool, TRUE)) {
+      GST_ERROR_OBJECT (mux, "Failed to configure output buffer pool");
+      gst_clear_object (&mux->out_pool);
+      return FALSE;
+    }
+    GST_DEBUG_OBJECT (mux, "Created output pool of %" G_GSIZE_FORMAT
+        " bytes buffers", size);
+  }
+
+  if (gst_buffer_pool_acquire_buffer (mux->out_pool, &mux->out_buffer,
+          NULL) != GST_FLOW_OK)
+    return FALSE;
+
+  if (!gst_buffer_map (mux->out_buffer, &mux->out_map, GST_MAP_WRITE)) {
+    gst_clear_buffer (&mux->out_buffer);
+    return FALSE;
+  }
+  mux->out_offset = 0;
+
+  /* Packets collected before switching to pooled output come first */
+  if (gst_adapter_available (mux->out_adapter) > 0) {
+    GstBufferList *list = gst_adapter_take_buffer_list (mux->out_adapter,
+        gst_adapter_available (mux->out_adapter));
+    guint i, len = gst_buffer_list_length (list);
+
+    GST_DEBUG_OBJECT (mux, "Outputting %u collected buffers first", len);
+    if (!mux->out_list)
+      mux->out_list = gst_buffer_list_new ();
+    for (i = 0; i < len; i++)
+      gst_buffer_list_add (mux->out_list,
+          gst_buffer_ref (gst_buffer_list_get (list, i)));
+    gst_buffer_list_unref (list);
+  }
+
+  return TRUE;
+}
+
+/* Queues the current pooled buffer for output if it is full, or if @force
+ * is set, after padding it with null packets */
+static void
+gst_base_ts_mux_finish_out_buffer (GstBaseTsMux * mux, gboolean force)
+{
+  GstBuffer *buf;
+
+  if (!mux->out_buffer || mux->out_offset == 0)
+    return;
+
+  if (mux->out_offset < mux->out_map.size) {
+    guint8 *data;
+
+    if (!force)
+      return;
+
+    GST_LOG_OBJECT (mux, "adding %" G_GSIZE_FORMAT " null packets",
+        (mux->out_map.size - mux->out_offset) /
+        GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH);
+
+    for (data = mux->out_map.data + mux->out_offset;
+        data < mux->out_map.data + mux->out_map.size;
+        data += GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH) {
+      GST_WRITE_UINT8 (data, TSMUX_SYNC_BYTE);
+      /* null packet PID */
+      GST_WRITE_UINT16_BE (data + 1, 0x1FFF);
+      /* no adaptation field exists | continuity counter undefined */
+      GST_WRITE_UINT8 (data + 3, 0x10);
+      /* payload */
+      memset (data + 4, 0, GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH - 4);
+    }
+    mux->out_offset = mux->out_map.size;
+  }
+
+  buf = gst_buffer_ref (mux->out_buffer);
+  gst_base_ts_mux_clear_out_buffer (mux);
+
+  if (!mux->out_list)
+    mux->out_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->out_list, buf);
+}
+
+/* Copies the metadata of the first packet of the pooled buffer, the same
+ * way the adapter does when merging packets */
+static void
+gst_base_ts_mux_collect_pooled_packet (GstBaseTsMux * mux, GstBuffer * buf)
+{
+  if (mux->out_offset == 0) {
+    GST_BUFFER_PTS (mux->out_buffer) = GST_BUFFER_PTS (buf);
+    GST_BUFFER_FLAGS (mux->out_buffer) = GST_BUFFER_FLAGS (buf) &
+        (GST_BUFFER_FLAG_HEADER | GST_BUFFER_FLAG_DELTA_UNIT |
+        GST_BUFFER_FLAG_DISCONT);
+  }
+  mux->out_offset += GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH;
+}
+
 static void
 gst_base_ts_mux_reset (GstBaseTsMux * mux, gboolean alloc)
 {
@@ -328,6 +514,12 @@ gst_base_ts_mux_reset (GstBaseTsMux * mux, gboolean alloc)
 
   if (mux->out_adapter)
     gst_adapter_clear (mux->out_adapter);
+  gst_base_ts_mux_clear_out_buffer (mux);
+  gst_clear_buffer_list (&mux->out_list);
+  if (mux->out_pool) {
+    gst_buffer_pool_set_active (mux->out_pool, FALSE);
+    gst_clear_object (&mux->out_pool);
+  }
 
   if (mux->tsmux) {
     if (mux->tsmux->si_sections)
@@ -346,7 +538,6 @@ gst_base_ts_mux_reset (GstBaseTsMux * mux, gboolean alloc)
     gst_buffer_unref (buf);
 
   gst_event_replace (&mux->force_key_unit_event, NULL);
-  gst_buffer_replace (&mux->out_buffer, NULL);
 
   GST_OBJECT_LOCK (mux);
 
@@ -857,7 +1048,8 @@ new_packet_common_init (GstBaseTsMux * mux, GstBuffer * buf, guint8 * data,
         hbuf = gst_buffer_new_and_alloc (len);
         gst_buffer_fill (hbuf, 0, data, len);
       } else {
-        hbuf = gst_buffer_copy (buf);
+        /* pooled packets share the memory of the output buffer */
+        hbuf = gst_buffer_copy_deep (buf);
       }
       GST_LOG_OBJECT (mux,
           "Collecting packet with pid 0x%04x into streamheaders", pid);
@@ -888,6 +1080,7 @@ static GstFlowReturn
 gst_base_ts_mux_push_packets (GstBaseTsMux * mux, gboolean force)
 {
   GstBufferList *buffer_list;
+  GstFlowReturn ret;
   gint align = mux->alignment;
   gint av, packet_size;
 
@@ -896,6 +1089,24 @@ gst_base_ts_mux_push_packets (GstBaseTsMux * mux, gboolean force)
   if (align < 0)
     align = mux->automatic_alignment;
 
+  if (gst_base_ts_mux_get_pooled_alignment (mux)) {
+    gst_base_ts_mux_finish_out_buffer (mux, force);
+
+    if (!mux->out_list)
+      return GST_FLOW_OK;
+
+    buffer_list = mux->out_list;
+    mux->out_list = NULL;
+    return gst_aggregator_finish_buffer_list (GST_AGGREGATOR (mux),
+        buffer_list);
+  }
+
+  /* The alignment changed, output what was collected in pooled buffers
+   * first */
+  ret = gst_base_ts_mux_stop_pooled_output (mux);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
   av = gst_adapter_available (mux->out_adapter);
   GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
 
@@ -1917,6 +2128,34 @@ gst_base_ts_mux_default_allocate_packet (GstBaseTsMux * mux,
     GstBuffer ** buffer)
 {
   GstBuffer *buf;
+  gint align = gst_base_ts_mux_get_pooled_alignment (mux);
+
+  if (align && !mux->packet_buffer_pending
+      && gst_base_ts_mux_acquire_out_buffer (mux, align)) {
+    GstMemory *mem;
+
+    if (!mux->packet_buffer) {
+      mux->packet_buffer = gst_buffer_new ();
+      gst_buffer_append_memory (mux->packet_buffer,
+          gst_memory_new_wrapped (0, mux->out_map.data, mux->out_map.size,
+              0, GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH, NULL, NULL));
+      gst_mini_object_weak_ref (GST_MINI_OBJECT_CAST (mux->packet_buffer),
+          (GstMiniObjectNotify) packet_buffer_finalized, mux);
+    }
+
+    /* Point the packet buffer to the next free slot */
+    buf = mux->packet_buffer;
+    mem = gst_buffer_peek_memory (buf, 0);
+    gst_buffer_resize (buf, (gssize) mux->out_offset - (gssize) mem->offset,
+        GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH);
+    GST_BUFFER_FLAGS (buf) = 0;
+    GST_BUFFER_PTS (buf) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DTS (buf) = GST_CLOCK_TIME_NONE;
+
+    mux->packet_buffer_pending = TRUE;
+    *buffer = buf;
+    return;
+  }
 
   buf = gst_buffer_new_and_alloc (mux->packet_size);
 
@@ -1927,6 +2166,30 @@ static gboolean
 gst_base_ts_mux_default_output_packet (GstBaseTsMux * mux, GstBuffer * buffer,
     gint64 new_pcr)
 {
+  gint align = gst_base_ts_mux_get_pooled_alignment (mux);
+
+  if (buffer == mux->packet_buffer && mux->packet_buffer_pending) {
+    /* Already written in place, keep the packet buffer for the next slot */
+    mux->packet_buffer_pending = FALSE;
+    gst_base_ts_mux_collect_pooled_packet (mux, buffer);
+    gst_base_ts_mux_finish_out_buffer (mux, FALSE);
+    return TRUE;
+  }
+
+  /* Packets not allocated by us (sections) are copied into the pooled
+   * buffer. TsMux outputs each packet it allocated before any other one */
+  g_warn_if_fail (!mux->packet_buffer_pending);
+  if (align && !mux->packet_buffer_pending
+      && gst_buffer_get_size (buffer) == GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH
+      && gst_base_ts_mux_acquire_out_buffer (mux, align)) {
+    gst_buffer_extract (buffer, 0, mux->out_map.data + mux->out_offset,
+        GST_BASE_TS_MUX_NORMAL_PACKET_LENGTH);
+    gst_base_ts_mux_collect_pooled_packet (mux, buffer);
+    gst_buffer_unref (buffer);
+    gst_base_ts_mux_finish_out_buffer (mux, FALSE);
+    return TRUE;
+  }
+
   gst_base_ts_mux_collect_packet (mux, buffer);
 
   return TRUE;
@@ -197,6 +197,18 @@ struct GstBaseTsMux {
   /* output buffer aggregation */
   GstAdapter *out_adapter;
   GstBuffer *out_buffer;
+
+  /* pooled output, used instead of out_adapter for aligned output of
+   * normal sized packets. Packets are written directly into out_buffer
+   * through packet_buffer, a buffer wrapping the mapped out_buffer memory
+   * and resized to the current packet slot */
+  GstBufferPool *out_pool;
+  gsize out_pool_size;
+  GstMapInfo out_map;
+  gsize out_offset;
+  GstBuffer *packet_buffer;
+  gboolean packet_buffer_pending;
+  GstBufferList *out_list;
 };
 
 /**
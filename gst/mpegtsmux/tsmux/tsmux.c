@@ -110,6 +110,10 @@
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
 
+/* Index of the byte holding the last bit of program_clock_reference_base in
+ * a packet, which is the byte the PCR value refers to */
+#define TSMUX_PCR_BYTE_OFFSET 10
+
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
 static gboolean tsmux_write_scte_null (TsMux * mux, TsMuxProgram * program);
@@ -800,9 +804,19 @@ tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
     return TRUE;
   }
 
-  if (mux->bitrate)
-    GST_BUFFER_PTS (buf) =
+  /* In constant bitrate mode, each packet is timestamped with its slot on
+   * the packet clock, starting at the output time of the first PCR */
+  if (mux->bitrate) {
+    GstClockTime base = 0;
+
+    if (mux->first_pcr_ts != G_MININT64
+        && mux->first_pcr_ts > CLOCK_BASE + TSMUX_PCR_OFFSET)
+      base = gst_util_uint64_scale (mux->first_pcr_ts - CLOCK_BASE -
+          TSMUX_PCR_OFFSET, GST_SECOND, TSMUX_CLOCK_FREQ);
+
+    GST_BUFFER_PTS (buf) = base +
         gst_util_uint64_scale (mux->n_bytes * 8, GST_SECOND, mux->bitrate);
+  }
 
   mux->n_bytes += gst_buffer_get_size (buf);
 
@@ -1386,75 +1400,120 @@ rewrite_si (TsMux * mux, gint64 cur_ts)
   return TRUE;
 }
 
+/* PCR value for the packet about to be written */
+static gint64
+get_packet_pcr (TsMux * mux, gint64 cur_ts)
+{
+  gint64 cur_pcr = get_current_pcr (mux, cur_ts);
+
+  if (mux->bitrate)
+    cur_pcr += gst_util_uint64_scale (TSMUX_PCR_BYTE_OFFSET * 8,
+        TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+
+  return cur_pcr;
+}
+
 static gboolean
-pad_stream (TsMux * mux, TsMuxStream * stream, gint64 cur_ts)
+write_null_packet (TsMux * mux)
 {
-  guint64 bitrate;
   GstBuffer *buf = NULL;
   GstMapInfo map;
-  gboolean ret = TRUE;
 
-  if (!mux->bitrate)
-    goto done;
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
 
-  do {
-    if (GST_CLOCK_STIME_IS_VALID (cur_ts)) {
-      GstClockTimeDiff diff;
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  tsmux_write_null_ts_header (map.data);
+  memset (map.data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  gst_buffer_unmap (buf, &map);
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
+/* Writes a packet carrying only a PCR on the PID of @stream, if one is due */
+static gboolean
+write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 cur_ts)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  gint64 new_pcr;
+  guint payload_len, payload_offs;
+  gboolean pusi;
+
+  new_pcr = write_new_pcr (mux, stream, get_packet_pcr (mux, cur_ts));
+  if (new_pcr == -1)
+    return TRUE;
 
-      if (!GST_CLOCK_STIME_IS_VALID (stream->first_ts))
-        stream->first_ts = cur_ts;
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
 
-      diff = GST_CLOCK_DIFF (stream->first_ts, cur_ts);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
 
-      if (diff) {
-        bitrate =
-            gst_util_uint64_scale (mux->n_bytes * 8, TSMUX_CLOCK_FREQ, diff);
+  pusi = stream->pi.packet_start_unit_indicator;
+  stream->pi.packet_start_unit_indicator = FALSE;
+  tsmux_write_ts_header (mux, map.data, &stream->pi, &payload_len,
+      &payload_offs, 0);
+  stream->pi.packet_start_unit_indicator = pusi;
+
+  gst_buffer_unmap (buf, &map);
 
-        GST_LOG ("Transport stream bitrate: %" G_GUINT64_FORMAT, bitrate);
+  stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
 
-        if (bitrate < mux->bitrate) {
-          gint64 new_pcr;
-          guint payload_len, payload_offs;
+  return tsmux_packet_out (mux, buf, new_pcr);
+}
 
-          GST_LOG ("Padding transport stream");
+/* Constant bitrate scheduling: output runs on a packet clock of
+ * bitrate / (188 * 8) packets per second, the PCR being the position on
+ * that clock. Before a packet of @stream with timestamp @cur_ts is
+ * written, SI tables and PCRs of all programs are inserted whenever they
+ * are due on the packet clock, and null packets fill the slots until the
+ * packet clock reaches the PCR corresponding to @cur_ts */
+static gboolean
+tsmux_schedule_packets (TsMux * mux, TsMuxStream * stream, gint64 cur_ts)
+{
+  gint64 target, cur_pcr;
+  guint n_null = 0;
 
-          if (!rewrite_si (mux, cur_ts)) {
-            ret = FALSE;
-            goto done;
-          }
+  target = ts_to_pcr (cur_ts);
 
-          if (!tsmux_get_buffer (mux, &buf)) {
-            ret = FALSE;
-            goto done;
-          }
+  while (TRUE) {
+    GList *cur;
+    gboolean waiting;
 
-          gst_buffer_map (buf, &map, GST_MAP_READ);
+    if (!rewrite_si (mux, cur_ts))
+      return FALSE;
 
-          if ((new_pcr =
-                  write_new_pcr (mux, stream, get_current_pcr (mux,
-                          cur_ts)) != -1))
-            tsmux_write_ts_header (mux, map.data, &stream->pi, &payload_len,
-                &payload_offs, 0);
-          else
-            tsmux_write_null_ts_header (map.data);
+    /* The PCR of @stream is carried by its next packet, unless null
+     * packets have to be inserted before it */
+    waiting = get_current_pcr (mux, cur_ts) < target;
 
-          gst_buffer_unmap (buf, &map);
+    for (cur = mux->programs; cur; cur = cur->next) {
+      TsMuxProgram *program = (TsMuxProgram *) cur->data;
 
-          stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
+      if (program->pcr_stream && (program->pcr_stream != stream || waiting)
+          && !write_pcr_packet (mux, program->pcr_stream, cur_ts))
+        return FALSE;
+    }
 
-          if (!(ret = tsmux_packet_out (mux, buf, new_pcr)))
-            goto done;
-        }
-      } else {
-        break;
-      }
-    } else {
+    cur_pcr = get_current_pcr (mux, cur_ts);
+    if (cur_pcr >= target)
       break;
-    }
-  } while (bitrate < mux->bitrate);
 
-done:
-  return ret;
+    if (!write_null_packet (mux))
+      return FALSE;
+    n_null++;
+  }
+
+  if (n_null)
+    GST_LOG ("Inserted %u null packets", n_null);
+
+  /* The packet clock is ahead of the data by more than the PCR offset, the
+   * data is arriving late at the decoder */
+  if (cur_pcr - target > TSMUX_PCR_OFFSET * 300)
+    GST_LOG ("Bitrate too low, data %" G_GINT64_FORMAT " ms late",
+        (cur_pcr - target) / (TSMUX_SYS_CLOCK_FREQ / 1000));
+
+  return TRUE;
 }
 
 /**
@@ -1473,24 +1532,27 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   TsMuxPacketInfo *pi = &stream->pi;
   gboolean res;
   gint64 new_pcr = -1;
+  gint64 cur_ts = CLOCK_BASE;
   GstBuffer *buf = NULL;
   GstMapInfo map;
 
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
-  if (tsmux_stream_is_pcr (stream)) {
-    gint64 cur_ts = CLOCK_BASE;
-
-    if (tsmux_stream_get_dts (stream) != G_MININT64)
-      cur_ts += tsmux_stream_get_dts (stream);
-    else
-      cur_ts += tsmux_stream_get_pts (stream);
+  if (tsmux_stream_get_dts (stream) != G_MININT64)
+    cur_ts += tsmux_stream_get_dts (stream);
+  else
+    cur_ts += tsmux_stream_get_pts (stream);
 
-    if (!rewrite_si (mux, cur_ts))
+  if (mux->bitrate && (tsmux_stream_get_dts (stream) != G_MININT64
+          || tsmux_stream_get_pts (stream) != G_MININT64)) {
+    if (!tsmux_schedule_packets (mux, stream, cur_ts))
       goto fail;
 
-    if (!pad_stream (mux, stream, cur_ts))
+    if (tsmux_stream_is_pcr (stream))
+      new_pcr = write_new_pcr (mux, stream, get_packet_pcr (mux, cur_ts));
+  } else if (tsmux_stream_is_pcr (stream)) {
+    if (!rewrite_si (mux, cur_ts))
       goto fail;
 
     new_pcr = write_new_pcr (mux, stream, get_current_pcr (mux, cur_ts));
@@ -1714,6 +1776,16 @@ tsmux_write_scte_null (TsMux * mux, TsMuxProgram * program)
   return tsmux_section_write_packet (NULL, program->scte35_null_section, mux);
 }
 
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the multiplex bitrate in bits per second, or 0
+ *
+ * Enable constant bitrate output at @bitrate. Packets are then scheduled on
+ * a fixed packet clock: SI tables and PCRs are inserted when due on that
+ * clock, null packets are inserted until data is due, and each output
+ * packet is timestamped with its position on the clock.
+ */
 void
 tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
 {
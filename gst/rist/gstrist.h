@@ -77,5 +77,9 @@ guint32 gst_rist_rtp_ext_seq (guint32 * extseqnum, guint16 seqnum);
 void gst_rist_rtx_send_set_extseqnum (GstRistRtxSend *self, guint32 ssrc,
     guint16 seqnum_ext);
 void gst_rist_rtx_send_clear_extseqnum (GstRistRtxSend *self, guint32 ssrc);
+GstBuffer * gst_rist_rtx_send_get_rtx_buffer (GstRistRtxSend *self,
+    guint32 ssrc, guint16 seqnum);
+void gst_rist_rtx_send_push_rtx_buffer (GstRistRtxSend *self,
+    GstBuffer *rtx_buf);
 
 #endif
@@ -377,6 +377,60 @@ buffer_queue_items_cmp (BufferQueueItem * a, BufferQueueItem * b,
   return a->extseqnum - b->extseqnum;
 }
 
+/* Returns the RIST retransmission of the packet, or NULL if it is no longer
+ * or not yet in the history. With bonding, the packet may have been sent by
+ * the ristrtxsend of another link, so @log_missing is only set when this
+ * element is the only one asked. Called with the object lock. */
+static GstBuffer *
+gst_rist_rtx_send_lookup (GstRistRtxSend * rtx, guint32 ssrc, guint seqnum,
+    gboolean log_missing)
+{
+  SSRCRtxData *data;
+  GSequenceIter *iter;
+  BufferQueueItem search_item;
+  guint32 extseqnum;
+
+  data = gst_rist_rtx_send_get_ssrc_data (rtx, ssrc);
+
+  if (data->has_seqnum_ext) {
+    extseqnum = data->seqnum_ext << 16 | seqnum;
+  } else {
+    guint32 max_extseqnum = data->max_extseqnum;
+    extseqnum = gst_rist_rtp_ext_seq (&max_extseqnum, seqnum);
+  }
+
+  search_item.extseqnum = extseqnum;
+  iter = g_sequence_lookup (data->queue, &search_item,
+      (GCompareDataFunc) buffer_queue_items_cmp, NULL);
+  if (iter) {
+    BufferQueueItem *item = g_sequence_get (iter);
+    GST_LOG_OBJECT (rtx, "found %u (%u:%u)", item->extseqnum,
+        item->extseqnum >> 16, item->extseqnum & 0xFFFF);
+    return gst_rtp_rist_buffer_new (rtx, item->buffer, ssrc);
+  }
+#ifndef GST_DISABLE_DEBUG
+  else if (log_missing) {
+    BufferQueueItem *item = NULL;
+
+    iter = g_sequence_get_begin_iter (data->queue);
+    if (!g_sequence_iter_is_end (iter))
+      item = g_sequence_get (iter);
+
+    if (item && extseqnum < item->extseqnum) {
+      GST_DEBUG_OBJECT (rtx, "requested seqnum %u has already been "
+          "removed from the rtx queue; the first available is %u",
+          seqnum, item->extseqnum);
+    } else {
+      GST_WARNING_OBJECT (rtx, "requested seqnum %u has not been "
+          "transmitted yet in the original stream; either the remote end "
+          "is not configured correctly, or the source is too slow", seqnum);
+    }
+  }
+#endif
+
+  return NULL;
+}
+
 static gboolean
 gst_rist_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -407,53 +461,10 @@ gst_rist_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         GST_OBJECT_LOCK (rtx);
         /* check if request is for us */
         if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc))) {
-          SSRCRtxData *data;
-          GSequenceIter *iter;
-          BufferQueueItem search_item;
-          guint32 extseqnum;
-
           /* update statistics */
           ++rtx->num_rtx_requests;
 
-          data = gst_rist_rtx_send_get_ssrc_data (rtx, ssrc);
-
-
-          if (data->has_seqnum_ext) {
-            extseqnum = data->seqnum_ext << 16 | seqnum;
-          } else {
-            guint32 max_extseqnum = data->max_extseqnum;
-            extseqnum = gst_rist_rtp_ext_seq (&max_extseqnum, seqnum);
-          }
-
-          search_item.extseqnum = extseqnum;
-          iter = g_sequence_lookup (data->queue, &search_item,
-              (GCompareDataFunc) buffer_queue_items_cmp, NULL);
-          if (iter) {
-            BufferQueueItem *item = g_sequence_get (iter);
-            GST_LOG_OBJECT (rtx, "found %u (%u:%u)", item->extseqnum,
-                item->extseqnum >> 16, item->extseqnum & 0xFFFF);
-            rtx_buf = gst_rtp_rist_buffer_new (rtx, item->buffer, ssrc);
-          }
-#ifndef GST_DISABLE_DEBUG
-          else {
-            BufferQueueItem *item = NULL;
-
-            iter = g_sequence_get_begin_iter (data->queue);
-            if (!g_sequence_iter_is_end (iter))
-              item = g_sequence_get (iter);
-
-            if (item && extseqnum < item->extseqnum) {
-              GST_DEBUG_OBJECT (rtx, "requested seqnum %u has already been "
-                  "removed from the rtx queue; the first available is %u",
-                  seqnum, item->extseqnum);
-            } else {
-              GST_WARNING_OBJECT (rtx, "requested seqnum %u has not been "
-                  "transmitted yet in the original stream; either the remote end "
-                  "is not configured correctly, or the source is too slow",
-                  seqnum);
-            }
-#endif
-          }
+          rtx_buf = gst_rist_rtx_send_lookup (rtx, ssrc, seqnum, TRUE);
         }
         GST_OBJECT_UNLOCK (rtx);
 
@@ -833,3 +844,31 @@ gst_rist_rtx_send_clear_extseqnum (GstRistRtxSend * rtx, guint32 ssrc)
     data->has_seqnum_ext = FALSE;
   GST_OBJECT_UNLOCK (rtx);
 }
+
+/* Returns the RIST retransmission of the @seqnum packet of @ssrc if it was
+ * sent by this element and is still in its history, or %NULL */
+GstBuffer *
+gst_rist_rtx_send_get_rtx_buffer (GstRistRtxSend * rtx, guint32 ssrc,
+    guint16 seqnum)
+{
+  GstBuffer *rtx_buf = NULL;
+
+  GST_OBJECT_LOCK (rtx);
+  if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc)))
+    rtx_buf = gst_rist_rtx_send_lookup (rtx, ssrc, seqnum, FALSE);
+  GST_OBJECT_UNLOCK (rtx);
+
+  return rtx_buf;
+}
+
+/* Sends a retransmission, possibly taken from another ristrtxsend, along
+ * with the ones of this element. Takes ownership of @rtx_buf. */
+void
+gst_rist_rtx_send_push_rtx_buffer (GstRistRtxSend * rtx, GstBuffer * rtx_buf)
+{
+  GST_OBJECT_LOCK (rtx);
+  ++rtx->num_rtx_requests;
+  GST_OBJECT_UNLOCK (rtx);
+
+  gst_rist_rtx_send_push_out (rtx, rtx_buf);
+}
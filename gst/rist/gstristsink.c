@@ -49,15 +49,19 @@
  * property. When set, this will replace the value that might have
  * been set on the "address" and "port" properties. Each link will be
  * mapped to its own RTP session. RTX request are only replied to on the
- * link the NACK was received from.
+ * link the NACK was received from, except in "weighted" mode.
  *
- * There are currently two bonding methods in place: "broadcast" and "round-robin".
- * In "broadcast" mode, all the packets are duplicated over all sessions.
- * While in "round-robin" mode, packets are evenly distributed over the links. One
- * can also implement its own dispatcher element and configure it using the
- * "dispatcher" property. As a reference, "broadcast" mode is implemented with
- * the "tee" element, while "round-robin" mode is implemented with the
- * "round-robin" element.
+ * There are currently three bonding methods in place: "broadcast",
+ * "round-robin" and "weighted". In "broadcast" mode, all the packets are
+ * duplicated over all sessions. While in "round-robin" mode, packets are evenly
+ * distributed over the links. In "weighted" mode, packets are distributed in
+ * proportion to the capacity of each link, as estimated from the round trip
+ * time and the loss rate reported by the receiver, and all the retransmissions
+ * are sent on the link with the best estimate, whichever link the NACK was
+ * received from. One can also implement its own dispatcher element and
+ * configure it using the "dispatcher" property. As a reference, "broadcast"
+ * mode is implemented with the "tee" element, while "round-robin" and
+ * "weighted" modes are implemented with the "round-robin" element.
  *
  * ## Example gst-launch line for bonding
  * |[
@@ -78,12 +82,23 @@
 
 /* for strtol() */
 #include <stdlib.h>
+#include <math.h>
 
 #include "gstrist.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rist_sink_debug);
 #define GST_CAT_DEFAULT gst_rist_sink_debug
 
+/* interval between two updates of the link weights in "weighted" mode */
+#define WEIGHT_UPDATE_INTERVAL (250 * GST_MSECOND)
+/* below this loss rate, links are considered equally reliable */
+#define WEIGHT_MIN_LOSS_RATE 0.001
+/* share of the best link kept by the worst ones, so that they keep being
+ * measured and can recover */
+#define WEIGHT_MIN 0.05
+/* how fast the weights follow the measurements */
+#define WEIGHT_SMOOTHING 0.25
+
 enum
 {
   PROP_ADDRESS = 1,
@@ -108,6 +123,7 @@ typedef enum
 {
   GST_RIST_BONDING_METHOD_BROADCAST,
   GST_RIST_BONDING_METHOD_ROUND_ROBIN,
+  GST_RIST_BONDING_METHOD_WEIGHTED,
 } GstRistBondingMethod;
 
 static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -127,6 +143,13 @@ typedef struct
   GstElement *rtx_send;
   GstElement *rtx_queue;
   guint32 rtcp_ssrc;
+
+  /* weighted bonding, protected by the sink object lock */
+  gdouble weight;
+  guint64 last_pkt_sent;
+  /* retransmission requests received on this link */
+  guint64 nacks;
+  guint64 last_nacks;
 } RistSenderBond;
 
 struct _GstRistSink
@@ -160,6 +183,12 @@ struct _GstRistSink
   guint32 rtp_ssrc;
   GstClockID stats_cid;
 
+  /* For weighted bonding */
+  gboolean weighted_bonding;
+  GstClockID weights_cid;
+  /* index of the bond retransmissions are sent on */
+  gint rtx_bond;
+
   /* This is set whenever there is a pipeline construction failure, and used
    * to fail state changes later */
   gboolean construct_failed;
@@ -175,6 +204,8 @@ gst_rist_bonding_method_get_type (void)
         "GST_RIST_BONDING_METHOD_BROADCAST", "broadcast"},
     {GST_RIST_BONDING_METHOD_ROUND_ROBIN,
         "GST_RIST_BONDING_METHOD_ROUND_ROBIN", "round-robin"},
+    {GST_RIST_BONDING_METHOD_WEIGHTED,
+        "GST_RIST_BONDING_METHOD_WEIGHTED", "weighted"},
     {0, NULL, NULL}
   };
 
@@ -191,6 +222,69 @@ G_DEFINE_TYPE_WITH_CODE (GstRistSink, gst_rist_sink, GST_TYPE_BIN,
 
 GQuark session_id_quark = 0;
 
+/* With weighted bonding, retransmissions are sent on the healthiest link,
+ * whichever link the NACK was received from. The packet is only in the
+ * history of the link it was originally sent on. */
+static GstPadProbeReturn
+gst_rist_sink_rtx_request_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstRistSink * sink)
+{
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  GstObject *rtx_send = GST_OBJECT_PARENT (pad);
+  const GstStructure *s;
+  RistSenderBond *target;
+  GstBuffer *rtx_buf;
+  guint seqnum, ssrc;
+  gint i;
+
+  if (!sink->weighted_bonding ||
+      GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM)
+    return GST_PAD_PROBE_OK;
+
+  s = gst_event_get_structure (event);
+  if (!gst_structure_has_name (s, "GstRTPRetransmissionRequest") ||
+      !gst_structure_get (s, "seqnum", G_TYPE_UINT, &seqnum,
+          "ssrc", G_TYPE_UINT, &ssrc, NULL))
+    return GST_PAD_PROBE_OK;
+
+  /* The losses of a link are the NACKs received on it, whichever link the
+   * retransmission is then sent on */
+  GST_OBJECT_LOCK (sink);
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+
+    if (GST_OBJECT_CAST (bond->rtx_send) == rtx_send) {
+      bond->nacks++;
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (sink);
+
+  target = g_ptr_array_index (sink->bonds, g_atomic_int_get (&sink->rtx_bond));
+
+  rtx_buf = gst_rist_rtx_send_get_rtx_buffer (GST_RIST_RTX_SEND
+      (target->rtx_send), ssrc, seqnum);
+  for (i = 0; !rtx_buf && i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+
+    if (bond != target)
+      rtx_buf = gst_rist_rtx_send_get_rtx_buffer (GST_RIST_RTX_SEND
+          (bond->rtx_send), ssrc, seqnum);
+  }
+
+  if (rtx_buf) {
+    GST_LOG_OBJECT (sink, "retransmitting seqnum %u on session %u", seqnum,
+        target->session);
+    gst_rist_rtx_send_push_rtx_buffer (GST_RIST_RTX_SEND (target->rtx_send),
+        rtx_buf);
+  } else {
+    GST_DEBUG_OBJECT (sink, "seqnum %u is no longer in any history", seqnum);
+  }
+
+  gst_event_unref (event);
+  return GST_PAD_PROBE_HANDLED;
+}
+
 static RistSenderBond *
 gst_rist_sink_add_bond (GstRistSink * sink)
 {
@@ -200,6 +294,7 @@ gst_rist_sink_add_bond (GstRistSink * sink)
 
   bond->session = sink->bonds->len;
   bond->address = g_strdup ("localhost");
+  bond->weight = 1.0;
 
   g_snprintf (name, 32, "rist_rtp_udpsink%u", bond->session);
   bond->rtp_sink = gst_element_factory_make ("udpsink", name);
@@ -237,6 +332,8 @@ gst_rist_sink_add_bond (GstRistSink * sink)
   gst_element_link (bond->rtx_queue, bond->rtx_send);
 
   pad = gst_element_get_static_pad (bond->rtx_send, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
+      (GstPadProbeCallback) gst_rist_sink_rtx_request_probe, sink, NULL);
   g_snprintf (name, 32, "src_%u", bond->session);
   gpad = gst_ghost_pad_new (name, pad);
   gst_object_unref (pad);
@@ -468,10 +565,11 @@ gst_rist_sink_on_new_receiver_ssrc (GstRistSink * sink, guint session_id,
 {
   RistSenderBond *bond;
 
-  if (session_id != 0)
+  if (session_id >= sink->bonds->len)
     return;
 
-  GST_INFO_OBJECT (sink, "Got RTCP remote SSRC %u", ssrc);
+  GST_INFO_OBJECT (sink, "Got RTCP remote SSRC %u on session %u", ssrc,
+      session_id);
   bond = g_ptr_array_index (sink->bonds, session_id);
   bond->rtcp_ssrc = ssrc;
 }
@@ -724,9 +822,12 @@ gst_rist_sink_start (GstRistSink * sink)
         }
         break;
       case GST_RIST_BONDING_METHOD_ROUND_ROBIN:
+      case GST_RIST_BONDING_METHOD_WEIGHTED:
         sink->dispatcher = gst_element_factory_make ("roundrobin",
             "rist_dispatcher");
         g_assert (sink->dispatcher);
+        sink->weighted_bonding =
+            sink->bonding_method == GST_RIST_BONDING_METHOD_WEIGHTED;
         break;
     }
   }
@@ -771,6 +872,48 @@ gst_rist_sink_start (GstRistSink * sink)
 }
 
 
+/* Returns FALSE if the session of the bond does not exist yet */
+static gboolean
+gst_rist_sink_get_bond_stats (GstRistSink * sink, guint session_id,
+    guint64 * pkt_sent, guint64 * rtx_sent, guint * rb_rtt,
+    guint * rb_fraction_lost)
+{
+  RistSenderBond *bond = g_ptr_array_index (sink->bonds, session_id);
+  GObject *session = NULL, *source = NULL;
+  GstStructure *sstats = NULL;
+  guint num_rtx_packets = 0;
+
+  g_signal_emit_by_name (sink->rtpbin, "get-internal-session", session_id,
+      &session);
+  if (!session)
+    return FALSE;
+
+  g_signal_emit_by_name (session, "get-source-by-ssrc", sink->rtp_ssrc,
+      &source);
+  if (source) {
+    g_object_get (source, "stats", &sstats, NULL);
+    gst_structure_get_uint64 (sstats, "packets-sent", pkt_sent);
+    gst_structure_free (sstats);
+    g_clear_object (&source);
+  }
+
+  g_signal_emit_by_name (session, "get-source-by-ssrc", bond->rtcp_ssrc,
+      &source);
+  if (source) {
+    g_object_get (source, "stats", &sstats, NULL);
+    gst_structure_get_uint (sstats, "rb-round-trip", rb_rtt);
+    gst_structure_get_uint (sstats, "rb-fractionlost", rb_fraction_lost);
+    gst_structure_free (sstats);
+    g_clear_object (&source);
+  }
+  g_object_unref (session);
+
+  g_object_get (bond->rtx_send, "num-rtx-packets", &num_rtx_packets, NULL);
+  *rtx_sent = num_rtx_packets;
+
+  return TRUE;
+}
+
 static GstStructure *
 gst_rist_sink_create_stats (GstRistSink * sink)
 {
@@ -784,39 +927,22 @@ gst_rist_sink_create_stats (GstRistSink * sink)
   session_stats = g_value_array_new (sink->bonds->len);
 
   for (i = 0; i < sink->bonds->len; i++) {
-    GObject *session = NULL, *source = NULL;
-    GstStructure *sstats = NULL, *stats;
+    GstStructure *stats;
     guint64 pkt_sent = 0, rtx_sent = 0, rtt;
-    guint rb_rtt = 0;
+    guint rb_rtt = 0, rb_fraction_lost = 0;
+    gdouble weight;
     GValue value = G_VALUE_INIT;
 
-    g_signal_emit_by_name (sink->rtpbin, "get-internal-session", i, &session);
-    if (!session)
+    if (!gst_rist_sink_get_bond_stats (sink, i, &pkt_sent, &rtx_sent, &rb_rtt,
+            &rb_fraction_lost))
       continue;
 
     stats = gst_structure_new_empty ("rist/x-sender-session-stats");
     bond = g_ptr_array_index (sink->bonds, i);
 
-    g_signal_emit_by_name (session, "get-source-by-ssrc", sink->rtp_ssrc,
-        &source);
-    if (source) {
-      g_object_get (source, "stats", &sstats, NULL);
-      gst_structure_get_uint64 (sstats, "packets-sent", &pkt_sent);
-      gst_structure_free (sstats);
-      g_clear_object (&source);
-    }
-
-    g_signal_emit_by_name (session, "get-source-by-ssrc", bond->rtcp_ssrc,
-        &source);
-    if (source) {
-      g_object_get (source, "stats", &sstats, NULL);
-      gst_structure_get_uint (sstats, "rb-round-trip", &rb_rtt);
-      gst_structure_free (sstats);
-      g_clear_object (&source);
-    }
-    g_object_unref (session);
-
-    g_object_get (bond->rtx_send, "num-rtx-packets", &rtx_sent, NULL);
+    GST_OBJECT_LOCK (sink);
+    weight = bond->weight;
+    GST_OBJECT_UNLOCK (sink);
 
     /* rb_rtt is in Q16 in NTP time */
     rtt = gst_util_uint64_scale (rb_rtt, GST_SECOND, 65536);
@@ -824,7 +950,8 @@ gst_rist_sink_create_stats (GstRistSink * sink)
     gst_structure_set (stats, "session-id", G_TYPE_INT, i,
         "sent-original-packets", G_TYPE_UINT64, pkt_sent,
         "sent-retransmitted-packets", G_TYPE_UINT64, rtx_sent,
-        "round-trip-time", G_TYPE_UINT64, rtt, NULL);
+        "round-trip-time", G_TYPE_UINT64, rtt,
+        "weight", G_TYPE_DOUBLE, weight, NULL);
 
     g_value_init (&value, GST_TYPE_STRUCTURE);
     g_value_take_boxed (&value, stats);
@@ -887,6 +1014,128 @@ gst_rist_sink_disable_stats_interval (GstRistSink * sink)
   }
 }
 
+/* Estimates the capacity of each link from the last receiver report and
+ * the retransmission requests received on it since the previous update, and
+ * distributes the packets accordingly */
+static gboolean
+gst_rist_sink_update_weights (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  GstRistSink *sink = GST_RIST_SINK (user_data);
+  gdouble *capacity, *weights;
+  gdouble max_capacity = 0.0;
+  gint i, rtx_bond = 0;
+
+  capacity = g_new0 (gdouble, sink->bonds->len);
+  weights = g_new0 (gdouble, sink->bonds->len);
+
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+    guint64 pkt_sent = 0, rtx_sent = 0, sent, rtx;
+    guint rb_rtt = 0, rb_fraction_lost = 0;
+    gdouble loss, rtt;
+
+    if (!gst_rist_sink_get_bond_stats (sink, i, &pkt_sent, &rtx_sent, &rb_rtt,
+            &rb_fraction_lost))
+      continue;
+
+    GST_OBJECT_LOCK (sink);
+    sent = pkt_sent - bond->last_pkt_sent;
+    rtx = bond->nacks - bond->last_nacks;
+    bond->last_pkt_sent = pkt_sent;
+    bond->last_nacks = bond->nacks;
+    GST_OBJECT_UNLOCK (sink);
+
+    /* no receiver report yet, keep the current weight */
+    if (rb_rtt == 0)
+      continue;
+
+    /* the retransmission requests also account for the losses since the
+     * last receiver report */
+    loss = rb_fraction_lost / 256.0;
+    if (sent > 0)
+      loss = MAX (loss, (gdouble) rtx / sent);
+    loss = MAX (loss, WEIGHT_MIN_LOSS_RATE);
+
+    /* rb_rtt is in Q16 in NTP time */
+    rtt = MAX (rb_rtt / 65536.0, 0.001);
+
+    /* Mathis et al., the throughput of a link is proportional to
+     * 1 / (RTT * sqrt (loss)) */
+    capacity[i] = 1.0 / (rtt * sqrt (loss));
+    max_capacity = MAX (max_capacity, capacity[i]);
+
+    GST_LOG_OBJECT (sink, "session %u: rtt %f s, loss %f, capacity %f",
+        bond->session, rtt, loss, capacity[i]);
+  }
+
+  GST_OBJECT_LOCK (sink);
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+
+    if (capacity[i] > 0.0) {
+      gdouble weight = MAX (capacity[i] / max_capacity, WEIGHT_MIN);
+
+      bond->weight += WEIGHT_SMOOTHING * (weight - bond->weight);
+    }
+
+    weights[i] = bond->weight;
+    if (weights[i] > weights[rtx_bond])
+      rtx_bond = i;
+  }
+  GST_OBJECT_UNLOCK (sink);
+
+  g_atomic_int_set (&sink->rtx_bond, rtx_bond);
+
+  for (i = 0; i < sink->bonds->len; i++) {
+    RistSenderBond *bond = g_ptr_array_index (sink->bonds, i);
+    GstPad *pad;
+    gchar name[32];
+
+    g_snprintf (name, 32, "src_%u", bond->session);
+    pad = gst_element_get_static_pad (sink->dispatcher, name);
+    if (pad) {
+      g_object_set (pad, "weight", weights[i], NULL);
+      gst_object_unref (pad);
+    }
+  }
+
+  g_free (capacity);
+  g_free (weights);
+
+  return TRUE;
+}
+
+static void
+gst_rist_sink_enable_weights_update (GstRistSink * sink)
+{
+  GstClock *clock;
+  GstClockTime start;
+
+  if (!sink->weighted_bonding)
+    return;
+
+  clock = gst_system_clock_obtain ();
+  start = gst_clock_get_time (clock) + WEIGHT_UPDATE_INTERVAL;
+
+  sink->weights_cid = gst_clock_new_periodic_id (clock, start,
+      WEIGHT_UPDATE_INTERVAL);
+  gst_clock_id_wait_async (sink->weights_cid, gst_rist_sink_update_weights,
+      gst_object_ref (sink), (GDestroyNotify) gst_object_unref);
+
+  gst_object_unref (clock);
+}
+
+static void
+gst_rist_sink_disable_weights_update (GstRistSink * sink)
+{
+  if (sink->weights_cid) {
+    gst_clock_id_unschedule (sink->weights_cid);
+    gst_clock_id_unref (sink->weights_cid);
+    sink->weights_cid = NULL;
+  }
+}
+
 static GstStateChangeReturn
 gst_rist_sink_change_state (GstElement * element, GstStateChange transition)
 {
@@ -896,6 +1145,7 @@ gst_rist_sink_change_state (GstElement * element, GstStateChange transition)
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_rist_sink_disable_stats_interval (sink);
+      gst_rist_sink_disable_weights_update (sink);
       break;
     default:
       break;
@@ -910,6 +1160,7 @@ gst_rist_sink_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       gst_rist_sink_enable_stats_interval (sink);
+      gst_rist_sink_enable_weights_update (sink);
       break;
     default:
       break;
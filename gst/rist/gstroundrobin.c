@@ -27,6 +27,13 @@
  * element, which duplicates buffers over all pads. This element 
  * can be used to distrute load across multiple branches when the buffer
  * can be processed independently.
+ *
+ * Each src pad has a "weight" property. Buffers are distributed in
+ * proportion to the weights using a smooth weighted round robin, so that
+ * the buffers of a heavier pad are interleaved with the others instead of
+ * being sent in bursts. With equal weights, the buffers are distributed
+ * equally, one pad after the other. A pad with a weight of 0 receives no
+ * buffers.
  */
 
 #include "gstroundrobin.h"
@@ -47,36 +54,164 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src_%d",
 struct _GstRoundRobin
 {
   GstElement parent;
-  gint index;
 };
 
+#define DEFAULT_PAD_WEIGHT 1.0
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_WEIGHT,
+};
+
+#define GST_TYPE_ROUND_ROBIN_PAD (gst_round_robin_pad_get_type())
+#define GST_ROUND_ROBIN_PAD(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_ROUND_ROBIN_PAD,GstRoundRobinPad))
+typedef struct _GstRoundRobinPad GstRoundRobinPad;
+typedef struct
+{
+  GstPadClass parent;
+} GstRoundRobinPadClass;
+
+struct _GstRoundRobinPad
+{
+  GstPad parent;
+
+  /* protected by the element object lock */
+  gdouble weight;
+  gdouble current_weight;
+};
+
+GType gst_round_robin_pad_get_type (void);
+G_DEFINE_TYPE (GstRoundRobinPad, gst_round_robin_pad, GST_TYPE_PAD);
+
 G_DEFINE_TYPE_WITH_CODE (GstRoundRobin, gst_round_robin,
     GST_TYPE_ELEMENT, GST_DEBUG_CATEGORY_INIT (gst_round_robin_debug,
         "roundrobin", 0, "Round Robin"));
 
+static void
+gst_round_robin_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobinPad *pad = GST_ROUND_ROBIN_PAD (object);
+  GstObject *parent;
+
+  switch (prop_id) {
+    case PROP_PAD_WEIGHT:
+      parent = gst_object_get_parent (GST_OBJECT (pad));
+      if (parent)
+        GST_OBJECT_LOCK (parent);
+      g_value_set_double (value, pad->weight);
+      if (parent) {
+        GST_OBJECT_UNLOCK (parent);
+        gst_object_unref (parent);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_round_robin_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRoundRobinPad *pad = GST_ROUND_ROBIN_PAD (object);
+  GstObject *parent;
+
+  switch (prop_id) {
+    case PROP_PAD_WEIGHT:
+      parent = gst_object_get_parent (GST_OBJECT (pad));
+      if (parent)
+        GST_OBJECT_LOCK (parent);
+      pad->weight = g_value_get_double (value);
+      if (parent) {
+        GST_OBJECT_UNLOCK (parent);
+        gst_object_unref (parent);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_round_robin_pad_init (GstRoundRobinPad * pad)
+{
+  pad->weight = DEFAULT_PAD_WEIGHT;
+}
+
+static void
+gst_round_robin_pad_class_init (GstRoundRobinPadClass * klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+
+  object_class->get_property = gst_round_robin_pad_get_property;
+  object_class->set_property = gst_round_robin_pad_set_property;
+
+  /**
+   * GstRoundRobinPad:weight:
+   *
+   * The share of the buffers to send on this pad, relative to the weights
+   * of the other pads.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (object_class, PROP_PAD_WEIGHT,
+      g_param_spec_double ("weight", "Weight",
+          "Share of the buffers sent on this pad, relative to the other pads",
+          0.0, G_MAXDOUBLE, DEFAULT_PAD_WEIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+/* Smooth weighted round robin: every pad accumulates its weight, the pad
+ * with the highest accumulated weight is picked and pays back the sum of
+ * all weights. Called with the object lock. */
+static GstPad *
+gst_round_robin_pick_pad (GstRoundRobin * disp)
+{
+  GstRoundRobinPad *best = NULL;
+  gdouble total = 0.0;
+  GList *l;
+
+  for (l = GST_ELEMENT (disp)->srcpads; l; l = l->next) {
+    GstRoundRobinPad *pad = l->data;
+
+    if (pad->weight <= 0.0)
+      continue;
+
+    pad->current_weight += pad->weight;
+    total += pad->weight;
+
+    if (!best || pad->current_weight > best->current_weight)
+      best = pad;
+  }
+
+  if (best)
+    best->current_weight -= total;
+
+  return (GstPad *) best;
+}
+
 static GstFlowReturn
 gst_round_robin_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstRoundRobin *disp = (GstRoundRobin *) parent;
-  GstElement *elem = (GstElement *) parent;
   GstPad *src_pad = NULL;
   GstFlowReturn ret;
 
   GST_OBJECT_LOCK (disp);
-  if (disp->index >= elem->numsrcpads)
-    disp->index = 0;
-
-  src_pad = g_list_nth_data (elem->srcpads, disp->index);
-
-  if (src_pad) {
+  src_pad = gst_round_robin_pick_pad (disp);
+  if (src_pad)
     gst_object_ref (src_pad);
-    disp->index += 1;
-  }
   GST_OBJECT_UNLOCK (disp);
 
-  if (!src_pad)
+  if (!src_pad) {
     /* no pad, that's fine */
+    gst_buffer_unref (buffer);
     return GST_FLOW_OK;
+  }
 
   ret = gst_pad_push (src_pad, buffer);
   gst_object_unref (src_pad);
@@ -96,7 +231,8 @@ gst_round_robin_request_pad (GstElement * element, GstPadTemplate * templ,
     return NULL;
   }
 
-  pad = gst_pad_new_from_static_template (&src_templ, name);
+  pad = g_object_new (GST_TYPE_ROUND_ROBIN_PAD, "name", name,
+      "direction", templ->direction, "template", templ, NULL);
   gst_element_add_pad (element, pad);
 
   return pad;
@@ -128,8 +264,11 @@ gst_round_robin_class_init (GstRoundRobinClass * klass)
       "Nicolas Dufresne <nicolas.dufresne@collabora.com");
 
   gst_element_class_add_static_pad_template (element_class, &sink_templ);
-  gst_element_class_add_static_pad_template (element_class, &src_templ);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_templ, GST_TYPE_ROUND_ROBIN_PAD);
 
   element_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_round_robin_request_pad);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_ROUND_ROBIN_PAD, 0);
 }
@@ -201,6 +201,9 @@ gst_h264_parse_init (GstH264Parse * h264parse)
   h264parse->aud_needed = TRUE;
   h264parse->aud_insert = TRUE;
   h264parse->update_timecode = DEFAULT_UPDATE_TIMECODE;
+
+  h264parse->nal_meta_units =
+      g_array_new (FALSE, FALSE, sizeof (GstH264NalMetaUnit));
 }
 
 static void
@@ -209,6 +212,7 @@ gst_h264_parse_finalize (GObject * object)
   GstH264Parse *h264parse = GST_H264_PARSE (object);
 
   g_object_unref (h264parse->frame_out);
+  g_array_unref (h264parse->nal_meta_units);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -234,6 +238,7 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->have_sps_in_frame = FALSE;
   h264parse->have_pps_in_frame = FALSE;
   gst_adapter_clear (h264parse->frame_out);
+  g_array_set_size (h264parse->nal_meta_units, 0);
 }
 
 static void
@@ -302,6 +307,7 @@ gst_h264_parse_reset (GstH264Parse * h264parse)
   h264parse->discont = FALSE;
   h264parse->discard_bidirectional = FALSE;
   h264parse->marker = FALSE;
+  h264parse->send_nal_meta = FALSE;
 
   gst_h264_parse_reset_stream_info (h264parse);
 }
@@ -921,6 +927,34 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   g_array_free (messages, TRUE);
 }
 
+/* Records @nalu for the GstH264NalMeta of the current frame, with
+ * @sc_offset and @offset applying to the outgoing frame data. Recording
+ * starts with the first slice of the frame.
+ * Returns the index of the recorded unit or -1 */
+static gint
+gst_h264_parse_record_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    guint sc_offset, guint offset)
+{
+  GstH264NalMetaUnit unit = { 0, };
+
+  /* split packetized output doesn't map to the input offsets */
+  if (!h264parse->send_nal_meta || h264parse->split_packetized)
+    return -1;
+
+  if (h264parse->nal_meta_units->len == 0 &&
+      (nalu->type < GST_H264_NAL_SLICE || nalu->type > GST_H264_NAL_SLICE_IDR)
+      && nalu->type != GST_H264_NAL_SLICE_EXT)
+    return -1;
+
+  unit.nalu = *nalu;
+  unit.nalu.data = NULL;
+  unit.nalu.sc_offset = sc_offset;
+  unit.nalu.offset = offset;
+  g_array_append_val (h264parse->nal_meta_units, unit);
+
+  return h264parse->nal_meta_units->len - 1;
+}
+
 /* caller guarantees 2 bytes of nal payload */
 static gboolean
 gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
@@ -931,6 +965,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   GstH264NalParser *nalparser = h264parse->nalparser;
   GstH264ParserResult pres;
   GstH264SliceHdr slice;
+  gboolean full_slice_hdr = FALSE;
+  gint meta_idx = -1;
+
+  /* without transformation every NAL ends up in the outgoing frame */
+  if (!h264parse->transform)
+    meta_idx = gst_h264_parse_record_nal (h264parse, nalu, nalu->sc_offset,
+        nalu->offset);
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -1063,8 +1104,17 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       if (nal_type == GST_H264_NAL_SLICE_EXT && !GST_H264_IS_MVC_NALU (nalu))
         break;
 
-      pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
-          FALSE, FALSE);
+      /* decoders need the complete header from the NAL meta, fall back to
+       * the parts we need ourselves if it can't be parsed */
+      if (h264parse->send_nal_meta && !h264parse->split_packetized) {
+        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
+            TRUE, TRUE);
+        full_slice_hdr = pres == GST_H264_PARSER_OK;
+      }
+      if (!full_slice_hdr) {
+        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
+            FALSE, FALSE);
+      }
       GST_DEBUG_OBJECT (h264parse,
           "parse result %d, first MB: %u, slice type: %u",
           pres, slice.first_mb_in_slice, slice.type);
@@ -1142,12 +1192,28 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
    * and use that to replace outgoing buffer data later on */
   if (h264parse->transform) {
     GstBuffer *buf;
+    guint pos = gst_adapter_available (h264parse->frame_out);
+    guint prefix;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
     buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
         nalu->data + nalu->offset, nalu->size);
+    prefix = gst_buffer_get_size (buf) - nalu->size;
     gst_adapter_push (h264parse->frame_out, buf);
+
+    meta_idx = gst_h264_parse_record_nal (h264parse, nalu, pos, pos + prefix);
+  }
+
+  if (meta_idx >= 0 && full_slice_hdr) {
+    GstH264NalMetaUnit *unit = &g_array_index (h264parse->nal_meta_units,
+        GstH264NalMetaUnit, meta_idx);
+
+    unit->has_slice_hdr = TRUE;
+    unit->pps_id = slice.pps->id;
+    unit->slice_hdr = slice;
+    unit->slice_hdr.pps = NULL;
   }
+
   return TRUE;
 }
 
@@ -2007,6 +2073,24 @@ get_level_string (GstH264SPS * sps)
   }
 }
 
+/* Asks downstream whether it wants GstH264NalMeta on the buffers with @caps.
+ * Only a consumer of the meta, like the GstH264Decoder based elements, adds
+ * it to the allocation query, so nothing is attached otherwise. */
+static void
+gst_h264_parse_query_nal_meta (GstH264Parse * h264parse, GstCaps * caps)
+{
+  GstQuery *query;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  h264parse->send_nal_meta =
+      gst_pad_peer_query (GST_BASE_PARSE_SRC_PAD (h264parse), query) &&
+      gst_query_find_allocation_meta (query, GST_H264_NAL_META_API_TYPE, NULL);
+  gst_query_unref (query);
+
+  GST_DEBUG_OBJECT (h264parse, "Downstream can handle GstH264NalMeta : %d",
+      h264parse->send_nal_meta);
+}
+
 static void
 gst_h264_parse_update_src_caps (GstH264Parse * h264parse, GstCaps * caps)
 {
@@ -2381,6 +2465,7 @@ gst_h264_parse_update_src_caps (GstH264Parse * h264parse, GstCaps * caps)
       }
 
       gst_pad_set_caps (GST_BASE_PARSE_SRC_PAD (h264parse), caps);
+      gst_h264_parse_query_nal_meta (h264parse, caps);
     } else if (codec_data_modified) {
       GST_DEBUG_OBJECT (h264parse,
           "Only codec_data is different, need inband sps/pps update");
@@ -3069,6 +3154,36 @@ gst_h264_parse_create_pic_timing_sei (GstH264Parse * h264parse,
   return out_buf;
 }
 
+/* Attaches the NAL units recorded for the frame, @size being the frame
+ * size they were recorded against */
+static void
+gst_h264_parse_add_nal_meta (GstH264Parse * h264parse, GstBuffer * buffer,
+    gsize size)
+{
+  GArray *units = h264parse->nal_meta_units;
+  gsize buffer_size = gst_buffer_get_size (buffer);
+  GstH264NalMetaUnit *last;
+  guint shift, i;
+
+  last = &g_array_index (units, GstH264NalMetaUnit, units->len - 1);
+  if (buffer_size < size || last->nalu.offset + last->nalu.size > size) {
+    GST_DEBUG_OBJECT (h264parse, "frame shrunk, not adding NAL meta");
+    return;
+  }
+
+  shift = buffer_size - size;
+  for (i = 0; i < units->len; i++) {
+    GstH264NalMetaUnit *unit = &g_array_index (units, GstH264NalMetaUnit, i);
+
+    unit->nalu.sc_offset += shift;
+    unit->nalu.offset += shift;
+  }
+
+  GST_LOG_OBJECT (h264parse, "adding NAL meta with %u units", units->len);
+  gst_buffer_add_h264_nal_meta (buffer, (GstH264NalMetaUnit *) units->data,
+      units->len);
+}
+
 static GstFlowReturn
 gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
@@ -3078,9 +3193,15 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   GstEvent *event;
   GstBuffer *parse_buffer = NULL;
   gboolean is_interlaced = FALSE;
+  gsize nal_meta_size;
 
   h264parse = GST_H264_PARSE (parse);
 
+  /* size of the data the NAL meta offsets apply to, anything inserted
+   * below goes in front of the first slice */
+  nal_meta_size = gst_buffer_get_size (frame->out_buffer ? frame->out_buffer :
+      frame->buffer);
+
   if (h264parse->first_frame) {
     GstTagList *taglist;
     GstCaps *caps;
@@ -3323,6 +3444,9 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   gst_video_push_user_data ((GstElement *) h264parse, &h264parse->user_data,
       parse_buffer);
 
+  if (h264parse->nal_meta_units->len > 0)
+    gst_h264_parse_add_nal_meta (h264parse, parse_buffer, nal_meta_size);
+
   gst_h264_parse_reset_frame (h264parse);
 
   return GST_FLOW_OK;
@@ -28,6 +28,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstbaseparse.h>
 #include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth264meta.h>
 #include <gst/video/video.h>
 #include "gstvideoparseutils.h"
 
@@ -134,6 +135,10 @@ struct _GstH264Parse
   /* AU state */
   gboolean picture_start;
 
+  /* GstH264NalMetaUnit of the current frame, from its first slice on */
+  gboolean send_nal_meta;
+  GArray *nal_meta_units;
+
   /* props */
   gint interval;
   gboolean update_timecode;
@@ -167,15 +167,35 @@ gst_h265_parse_init (GstH265Parse * h265parse)
   gst_base_parse_set_infer_ts (GST_BASE_PARSE (h265parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (h265parse));
   GST_PAD_SET_ACCEPT_TEMPLATE (GST_BASE_PARSE_SINK_PAD (h265parse));
+
+  h265parse->nal_meta_units =
+      g_array_new (FALSE, FALSE, sizeof (GstH265NalMetaUnit));
 }
 
 
+static void
+gst_h265_parse_clear_nal_meta_units (GstH265Parse * h265parse)
+{
+  guint i;
+
+  for (i = 0; i < h265parse->nal_meta_units->len; i++) {
+    GstH265NalMetaUnit *unit = &g_array_index (h265parse->nal_meta_units,
+        GstH265NalMetaUnit, i);
+
+    if (unit->has_slice_hdr)
+      gst_h265_slice_hdr_free (&unit->slice_hdr);
+  }
+  g_array_set_size (h265parse->nal_meta_units, 0);
+}
+
 static void
 gst_h265_parse_finalize (GObject * object)
 {
   GstH265Parse *h265parse = GST_H265_PARSE (object);
 
   g_object_unref (h265parse->frame_out);
+  gst_h265_parse_clear_nal_meta_units (h265parse);
+  g_array_unref (h265parse->nal_meta_units);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -199,6 +219,7 @@ gst_h265_parse_reset_frame (GstH265Parse * h265parse)
   h265parse->have_sps_in_frame = FALSE;
   h265parse->have_pps_in_frame = FALSE;
   gst_adapter_clear (h265parse->frame_out);
+  gst_h265_parse_clear_nal_meta_units (h265parse);
 }
 
 static void
@@ -261,6 +282,7 @@ gst_h265_parse_reset (GstH265Parse * h265parse)
   h265parse->discont = FALSE;
   h265parse->discard_bidirectional = FALSE;
   h265parse->marker = FALSE;
+  h265parse->send_nal_meta = FALSE;
 
   gst_h265_parse_reset_stream_info (h265parse);
 }
@@ -705,6 +727,35 @@ gst_h265_parse_process_sei_user_data (GstH265Parse * h265parse,
 
 }
 
+/* Records @nalu for the GstH265NalMeta of the current frame, with
+ * @sc_offset and @offset applying to the outgoing frame data. Recording
+ * starts with the first slice of the frame.
+ * Returns the index of the recorded unit or -1 */
+static gint
+gst_h265_parse_record_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu,
+    guint sc_offset, guint offset)
+{
+  GstH265NalMetaUnit unit = { 0, };
+
+  /* split packetized output doesn't map to the input offsets */
+  if (!h265parse->send_nal_meta || h265parse->split_packetized)
+    return -1;
+
+  if (h265parse->nal_meta_units->len == 0 &&
+      ((nalu->type > GST_H265_NAL_SLICE_RASL_R &&
+              nalu->type < GST_H265_NAL_SLICE_BLA_W_LP) ||
+          nalu->type > GST_H265_NAL_SLICE_CRA_NUT))
+    return -1;
+
+  unit.nalu = *nalu;
+  unit.nalu.data = NULL;
+  unit.nalu.sc_offset = sc_offset;
+  unit.nalu.offset = offset;
+  g_array_append_val (h265parse->nal_meta_units, unit);
+
+  return h265parse->nal_meta_units->len - 1;
+}
+
 /* caller guarantees 2 bytes of nal payload */
 static gboolean
 gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
@@ -715,6 +766,14 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   guint nal_type;
   GstH265Parser *nalparser = h265parse->nalparser;
   GstH265ParserResult pres = GST_H265_PARSER_ERROR;
+  GstH265SliceHdr meta_slice_hdr = { 0, };
+  gboolean have_meta_slice_hdr = FALSE;
+  gint meta_idx = -1;
+
+  /* without transformation every NAL ends up in the outgoing frame */
+  if (!h265parse->transform)
+    meta_idx = gst_h265_parse_record_nal (h265parse, nalu, nalu->sc_offset,
+        nalu->offset);
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -900,6 +959,14 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
           "parse result %d, first slice_segment: %u, slice type: %u",
           pres, slice.first_slice_segment_in_pic_flag, slice.type);
 
+      /* keep the header around for the NAL meta, entry points included */
+      if (pres == GST_H265_PARSER_OK && h265parse->send_nal_meta &&
+          !h265parse->split_packetized) {
+        meta_slice_hdr = slice;
+        have_meta_slice_hdr = TRUE;
+        slice.entry_point_offset_minus1 = NULL;
+      }
+
       gst_h265_slice_hdr_free (&slice);
 
       /* FIXME: NoRaslOutputFlag can be equal to 1 for CRA if
@@ -976,11 +1043,30 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
    * and use that to replace outgoing buffer data later on */
   if (h265parse->transform) {
     GstBuffer *buf;
+    guint pos = gst_adapter_available (h265parse->frame_out);
+    guint prefix;
 
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
     buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
         nalu->data + nalu->offset, nalu->size);
+    prefix = gst_buffer_get_size (buf) - nalu->size;
     gst_adapter_push (h265parse->frame_out, buf);
+
+    meta_idx = gst_h265_parse_record_nal (h265parse, nalu, pos, pos + prefix);
+  }
+
+  if (have_meta_slice_hdr) {
+    if (meta_idx >= 0) {
+      GstH265NalMetaUnit *unit = &g_array_index (h265parse->nal_meta_units,
+          GstH265NalMetaUnit, meta_idx);
+
+      unit->has_slice_hdr = TRUE;
+      unit->pps_id = meta_slice_hdr.pps->id;
+      unit->slice_hdr = meta_slice_hdr;
+      unit->slice_hdr.pps = NULL;
+    } else {
+      gst_h265_slice_hdr_free (&meta_slice_hdr);
+    }
   }
 
   return TRUE;
@@ -1954,6 +2040,24 @@ gst_h265_parse_is_field_interlaced (GstH265Parse * h265parse)
   return FALSE;
 }
 
+/* Asks downstream whether it wants GstH265NalMeta on the buffers with @caps.
+ * Only a consumer of the meta, like the GstH265Decoder based elements, adds
+ * it to the allocation query, so nothing is attached otherwise. */
+static void
+gst_h265_parse_query_nal_meta (GstH265Parse * h265parse, GstCaps * caps)
+{
+  GstQuery *query;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  h265parse->send_nal_meta =
+      gst_pad_peer_query (GST_BASE_PARSE_SRC_PAD (h265parse), query) &&
+      gst_query_find_allocation_meta (query, GST_H265_NAL_META_API_TYPE, NULL);
+  gst_query_unref (query);
+
+  GST_DEBUG_OBJECT (h265parse, "Downstream can handle GstH265NalMeta : %d",
+      h265parse->send_nal_meta);
+}
+
 static void
 gst_h265_parse_update_src_caps (GstH265Parse * h265parse, GstCaps * caps)
 {
@@ -2343,6 +2447,7 @@ gst_h265_parse_update_src_caps (GstH265Parse * h265parse, GstCaps * caps)
       }
 
       gst_pad_set_caps (GST_BASE_PARSE_SRC_PAD (h265parse), caps);
+      gst_h265_parse_query_nal_meta (h265parse, caps);
     } else if (codec_data_modified) {
       GST_DEBUG_OBJECT (h265parse,
           "Only codec_data is different, need inband vps/sps/pps update");
@@ -2671,6 +2776,36 @@ gst_h265_parse_handle_vps_sps_pps_nals (GstH265Parse * h265parse,
   return send_done;
 }
 
+/* Attaches the NAL units recorded for the frame, @size being the frame
+ * size they were recorded against */
+static void
+gst_h265_parse_add_nal_meta (GstH265Parse * h265parse, GstBuffer * buffer,
+    gsize size)
+{
+  GArray *units = h265parse->nal_meta_units;
+  gsize buffer_size = gst_buffer_get_size (buffer);
+  GstH265NalMetaUnit *last;
+  guint shift, i;
+
+  last = &g_array_index (units, GstH265NalMetaUnit, units->len - 1);
+  if (buffer_size < size || last->nalu.offset + last->nalu.size > size) {
+    GST_DEBUG_OBJECT (h265parse, "frame shrunk, not adding NAL meta");
+    return;
+  }
+
+  shift = buffer_size - size;
+  for (i = 0; i < units->len; i++) {
+    GstH265NalMetaUnit *unit = &g_array_index (units, GstH265NalMetaUnit, i);
+
+    unit->nalu.sc_offset += shift;
+    unit->nalu.offset += shift;
+  }
+
+  GST_LOG_OBJECT (h265parse, "adding NAL meta with %u units", units->len);
+  gst_buffer_add_h265_nal_meta (buffer, (GstH265NalMetaUnit *) units->data,
+      units->len);
+}
+
 static GstFlowReturn
 gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
@@ -2678,9 +2813,15 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   GstBuffer *buffer;
   GstEvent *event;
   GstBuffer *parse_buffer = NULL;
+  gsize nal_meta_size;
 
   h265parse = GST_H265_PARSE (parse);
 
+  /* size of the data the NAL meta offsets apply to, anything inserted
+   * below goes in front of the first slice */
+  nal_meta_size = gst_buffer_get_size (frame->out_buffer ? frame->out_buffer :
+      frame->buffer);
+
   if (h265parse->first_frame) {
     GstTagList *taglist;
     GstCaps *caps;
@@ -2889,6 +3030,9 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   gst_video_push_user_data ((GstElement *) h265parse, &h265parse->user_data,
       parse_buffer);
 
+  if (h265parse->nal_meta_units->len > 0)
+    gst_h265_parse_add_nal_meta (h265parse, parse_buffer, nal_meta_size);
+
   gst_h265_parse_reset_frame (h265parse);
 
   return GST_FLOW_OK;
@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstbaseparse.h>
 #include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gsth265meta.h>
 #include <gst/video/video.h>
 #include "gstvideoparseutils.h"
 
@@ -114,6 +115,10 @@ struct _GstH265Parse
   /* AU state */
   gboolean picture_start;
 
+  /* GstH265NalMetaUnit of the current frame, from its first slice on */
+  gboolean send_nal_meta;
+  GArray *nal_meta_units;
+
   GstVideoParseUserData user_data;
 
   /* props */
@@ -0,0 +1,251 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * dashmpdparser.c: DASH manifest parsing benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../../ext/dash/gstmpdparser.c"
+#include "../../ext/dash/gstxmlhelper.c"
+#include "../../ext/dash/gstmpdhelper.c"
+#include "../../ext/dash/gstmpdnode.c"
+#include "../../ext/dash/gstmpdrepresentationbasenode.c"
+#include "../../ext/dash/gstmpdmultsegmentbasenode.c"
+#include "../../ext/dash/gstmpdrootnode.c"
+#include "../../ext/dash/gstmpdbaseurlnode.c"
+#include "../../ext/dash/gstmpdutctimingnode.c"
+#include "../../ext/dash/gstmpdservicedescriptionnode.c"
+#include "../../ext/dash/gstmpdmetricsnode.c"
+#include "../../ext/dash/gstmpdmetricsrangenode.c"
+#include "../../ext/dash/gstmpdsnode.c"
+#include "../../ext/dash/gstmpdsegmenttimelinenode.c"
+#include "../../ext/dash/gstmpdsegmenttemplatenode.c"
+#include "../../ext/dash/gstmpdsegmenturlnode.c"
+#include "../../ext/dash/gstmpdsegmentlistnode.c"
+#include "../../ext/dash/gstmpdsegmentbasenode.c"
+#include "../../ext/dash/gstmpdperiodnode.c"
+#include "../../ext/dash/gstmpdsubrepresentationnode.c"
+#include "../../ext/dash/gstmpdrepresentationnode.c"
+#include "../../ext/dash/gstmpdcontentcomponentnode.c"
+#include "../../ext/dash/gstmpdadaptationsetnode.c"
+#include "../../ext/dash/gstmpdsubsetnode.c"
+#include "../../ext/dash/gstmpdprograminformationnode.c"
+#include "../../ext/dash/gstmpdlocationnode.c"
+#include "../../ext/dash/gstmpdreportingnode.c"
+#include "../../ext/dash/gstmpdurltypenode.c"
+#include "../../ext/dash/gstmpddescriptortypenode.c"
+#include "../../ext/dash/gstmpdclient.c"
+#undef GST_CAT_DEFAULT
+
+GST_DEBUG_CATEGORY (gst_dash_demux_debug);
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_ (x)
+
+#define NUM_RUNS 10
+#define NUM_PERIODS 300
+#define NUM_SEGMENTS 64
+
+typedef enum
+{
+  PARSE_DOM,
+  PARSE_STREAMING,
+  PARSE_REFRESH,
+} ParseMode;
+
+/* Builds a live manifest with NUM_PERIODS periods, each with a video and
+ * an audio SegmentTimeline. @extra_segments segments are appended to the
+ * timelines of the last period, as on a refresh of a live manifest */
+static gchar *
+make_manifest (guint extra_segments)
+{
+  GString *s = g_string_new (NULL);
+  guint i, j;
+
+  g_string_append (s, "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      " profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      " type=\"dynamic\" availabilityStartTime=\"2021-01-01T00:00:00Z\""
+      " minimumUpdatePeriod=\"PT2S\" minBufferTime=\"PT2S\">\n");
+
+  for (i = 0; i < NUM_PERIODS; i++) {
+    guint n = NUM_SEGMENTS + (i == NUM_PERIODS - 1 ? extra_segments : 0);
+
+    g_string_append_printf (s, "<Period id=\"p%u\" start=\"PT%uS\">\n", i,
+        i * NUM_SEGMENTS * 2);
+    g_string_append (s, "<AdaptationSet mimeType=\"video/mp4\">"
+        "<SegmentTemplate timescale=\"90000\" media=\"v/$Time$.m4s\">"
+        "<SegmentTimeline>\n");
+    /* alternate durations so runs cannot be merged */
+    for (j = 0; j < n; j++)
+      g_string_append_printf (s, "<S d=\"%u\"/>\n", 180000 + (j % 2) * 3000);
+    g_string_append (s, "</SegmentTimeline></SegmentTemplate>"
+        "<Representation id=\"v0\" bandwidth=\"3000000\" width=\"1280\""
+        " height=\"720\" codecs=\"avc1.4d401f\"/>"
+        "<Representation id=\"v1\" bandwidth=\"800000\" width=\"640\""
+        " height=\"360\" codecs=\"avc1.42c015\"/>"
+        "</AdaptationSet>\n");
+    g_string_append (s, "<AdaptationSet mimeType=\"audio/mp4\" lang=\"en\">"
+        "<SegmentTemplate timescale=\"48000\" media=\"a/$Time$.m4s\">"
+        "<SegmentTimeline>\n");
+    for (j = 0; j < n; j++)
+      g_string_append_printf (s, "<S d=\"%u\"/>\n", 96256 - (j % 2) * 1024);
+    g_string_append (s, "</SegmentTimeline></SegmentTemplate>"
+        "<Representation id=\"a0\" bandwidth=\"128000\""
+        " codecs=\"mp4a.40.2\"/>" "</AdaptationSet>\n</Period>\n");
+  }
+
+  g_string_append (s, "</MPD>\n");
+
+  return g_string_free (s, FALSE);
+}
+
+static gboolean
+parse (ParseMode mode, GstMPDClient * client, const gchar * data,
+    gsize size, GstMPDClient * previous)
+{
+  switch (mode) {
+    case PARSE_DOM:
+      return gst_mpd_client_parse (client, data, size);
+    case PARSE_STREAMING:
+      return gst_mpd_client_parse_update (client, data, size, NULL);
+    case PARSE_REFRESH:
+      return gst_mpd_client_parse_update (client, data, size, previous);
+  }
+
+  g_assert_not_reached ();
+  return FALSE;
+}
+
+/* @previous_data is the manifest the client is refreshed from in
+ * PARSE_REFRESH mode, the time it takes to parse it is not measured */
+static void
+bench (const gchar * name, ParseMode mode, const gchar * previous_data,
+    const gchar * data)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  gsize size = strlen (data);
+  guint run;
+
+  for (run = 0; run < NUM_RUNS; run++) {
+    GstMPDClient *previous = NULL;
+    GstMPDClient *client;
+
+    if (mode == PARSE_REFRESH) {
+      previous = gst_mpd_client_new ();
+      if (!gst_mpd_client_parse_update (previous, previous_data,
+              strlen (previous_data), NULL)) {
+        g_printerr ("%s: failed to parse the previous manifest\n", name);
+        gst_mpd_client_free (previous);
+        return;
+      }
+    }
+
+    client = gst_mpd_client_new ();
+    start = gst_util_get_timestamp ();
+    if (!parse (mode, client, data, size, previous)) {
+      g_printerr ("%s: failed to parse the manifest\n", name);
+      gst_mpd_client_free (client);
+      gst_mpd_client_free (previous);
+      return;
+    }
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+
+    gst_mpd_client_free (client);
+    gst_mpd_client_free (previous);
+  }
+
+  g_print ("%-48s %8" G_GSIZE_FORMAT " bytes in %" GST_TIME_FORMAT
+      " : %.2f MB/s\n", name, size, GST_TIME_ARGS (best),
+      (gdouble) size * GST_SECOND / best / 1e6);
+}
+
+static void
+bench_manifest (const gchar * label, const gchar * previous_data,
+    const gchar * data)
+{
+  gchar *name;
+
+  name = g_strdup_printf ("%s (dom)", label);
+  bench (name, PARSE_DOM, NULL, data);
+  g_free (name);
+
+  name = g_strdup_printf ("%s (streaming)", label);
+  bench (name, PARSE_STREAMING, NULL, data);
+  g_free (name);
+
+  name = g_strdup_printf ("%s (refresh)", label);
+  bench (name, PARSE_REFRESH, previous_data, data);
+  g_free (name);
+}
+
+/* Every .mpd file of the dash_mpd test data is refreshed from itself,
+ * the best case of a live manifest whose Periods did not change */
+static void
+bench_data_dir (const gchar * path)
+{
+  GDir *dir;
+  const gchar *filename;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL) {
+    g_printerr ("could not open %s\n", path);
+    return;
+  }
+
+  while ((filename = g_dir_read_name (dir))) {
+    gchar *file, *data;
+
+    if (!g_str_has_suffix (filename, ".mpd"))
+      continue;
+
+    file = g_build_filename (path, filename, NULL);
+    if (g_file_get_contents (file, &data, NULL, NULL)) {
+      bench_manifest (filename, data, data);
+      g_free (data);
+    }
+    g_free (file);
+  }
+
+  g_dir_close (dir);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gchar *previous, *current;
+
+  gst_init (&argc, &argv);
+
+  GST_DEBUG_CATEGORY_INIT (gst_dash_demux_debug, "dashdemux", 0,
+      "DASH demuxer benchmark");
+
+  previous = make_manifest (0);
+  current = make_manifest (1);
+  bench_manifest ("synthetic", previous, current);
+  g_free (previous);
+  g_free (current);
+
+  bench_data_dir (argc > 1 ? argv[1] : STRINGIFY (DASH_MPD_DATADIR));
+
+  return 0;
+}
@@ -0,0 +1,264 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * h26xparserbench.c: H.264/H.265 NAL parsing throughput benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/nalutils.h>
+
+#define NUM_GOPS 16
+#define GOP_LENGTH 30
+#define NUM_RUNS 5
+
+/* Parameter sets taken from the h264parser and h265parser tests */
+static const guint8 h264_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28,
+  0xac, 0xd9, 0x40, 0x78, 0x04, 0x4f, 0xde, 0x03,
+  0xd2, 0x02, 0x02, 0x02, 0x80, 0x00, 0x01, 0xf4,
+  0x80, 0x00, 0x75, 0x30, 0x4f, 0x8b, 0x16, 0xcb
+};
+
+static const guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x5d, 0xac, 0x59
+};
+
+static const guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x21, 0x60, 0x00, 0x00, 0x03,
+  0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x99, 0xa0, 0x01,
+  0xe0, 0x20, 0x02, 0x1c, 0x59, 0x4b, 0x92, 0x42, 0x96, 0x11, 0x80, 0xb5,
+  0x01, 0x01, 0x01, 0x14, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03,
+  0x00, 0xf3, 0xf2, 0x00, 0x6e, 0x00, 0x17, 0xbd, 0xf8, 0x00, 0x02, 0x94,
+  0xb4, 0x00, 0x06, 0x9b, 0x60, 0x00, 0xd3, 0x6c, 0x00, 0x01, 0x4a, 0x5a,
+  0x40, 0x00, 0x14, 0xa5, 0xa0, 0x00, 0x34, 0xdb, 0x00, 0x06, 0x9b, 0x60,
+  0x00, 0x0a, 0x52, 0xd0, 0x40,
+};
+
+typedef struct
+{
+  GByteArray *data;
+  guint n_nals;
+} Stream;
+
+/* Appends a slice NAL with a random payload, escaped the way an encoder
+ * would. Zero bytes are made more likely than in uniform noise so that
+ * emulation prevention bytes show up at a realistic rate */
+static void
+append_slice (Stream * stream, const guint8 * header, guint header_size)
+{
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  guint size = g_random_int_range (1024, 16384);
+  guint zeros = 0, i;
+
+  g_byte_array_append (stream->data, start_code, sizeof (start_code));
+  g_byte_array_append (stream->data, header, header_size);
+
+  for (i = 0; i < size; i++) {
+    guint8 byte = g_random_int_range (0, 8) ? g_random_int_range (0, 256) : 0;
+
+    if (zeros >= 2 && byte <= 0x03) {
+      guint8 epb = 0x03;
+      g_byte_array_append (stream->data, &epb, 1);
+      zeros = 0;
+    }
+    g_byte_array_append (stream->data, &byte, 1);
+    zeros = byte ? 0 : zeros + 1;
+  }
+
+  /* never end on a zero byte, it would be taken as trailing_zero_8bits */
+  if (zeros) {
+    guint8 stop = 0x80;
+    g_byte_array_append (stream->data, &stop, 1);
+  }
+
+  stream->n_nals++;
+}
+
+static void
+append_param_set (Stream * stream, const guint8 * data, guint size)
+{
+  g_byte_array_append (stream->data, data, size);
+  stream->n_nals++;
+}
+
+static void
+make_h264_stream (Stream * stream)
+{
+  /* nal_ref_idc 2, non-IDR slice */
+  static const guint8 slice_header[] = { 0x41 };
+  guint i, j;
+
+  stream->data = g_byte_array_new ();
+  stream->n_nals = 0;
+
+  for (i = 0; i < NUM_GOPS; i++) {
+    append_param_set (stream, h264_sps, sizeof (h264_sps));
+    for (j = 0; j < GOP_LENGTH; j++)
+      append_slice (stream, slice_header, sizeof (slice_header));
+  }
+}
+
+static void
+make_h265_stream (Stream * stream)
+{
+  /* TRAIL_R slice, nuh_layer_id 0, nuh_temporal_id_plus1 1 */
+  static const guint8 slice_header[] = { 0x02, 0x01 };
+  guint i, j;
+
+  stream->data = g_byte_array_new ();
+  stream->n_nals = 0;
+
+  for (i = 0; i < NUM_GOPS; i++) {
+    append_param_set (stream, h265_vps, sizeof (h265_vps));
+    append_param_set (stream, h265_sps, sizeof (h265_sps));
+    for (j = 0; j < GOP_LENGTH; j++)
+      append_slice (stream, slice_header, sizeof (slice_header));
+  }
+}
+
+static void
+report (const gchar * name, gsize size, GstClockTime best)
+{
+  g_print ("%-20s %8" G_GSIZE_FORMAT " bytes in %" GST_TIME_FORMAT
+      " : %.2f MB/s\n", name, size, GST_TIME_ARGS (best),
+      (gdouble) size * GST_SECOND / best / (1024 * 1024));
+}
+
+static guint
+run_h264 (const Stream * stream)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0, n = 0;
+
+  do {
+    res = gst_h264_parser_identify_nalu (parser, stream->data->data, offset,
+        stream->data->len, &nalu);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+
+    if (nalu.type == GST_H264_NAL_SPS)
+      g_assert_cmpint (gst_h264_parser_parse_nal (parser, &nalu), ==,
+          GST_H264_PARSER_OK);
+
+    offset = nalu.offset + nalu.size;
+    n++;
+  } while (res == GST_H264_PARSER_OK);
+
+  gst_h264_nal_parser_free (parser);
+
+  return n;
+}
+
+static guint
+run_h265 (const Stream * stream)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint offset = 0, n = 0;
+
+  do {
+    res = gst_h265_parser_identify_nalu (parser, stream->data->data, offset,
+        stream->data->len, &nalu);
+    if (res != GST_H265_PARSER_OK && res != GST_H265_PARSER_NO_NAL_END)
+      break;
+
+    if (nalu.type == GST_H265_NAL_VPS || nalu.type == GST_H265_NAL_SPS)
+      g_assert_cmpint (gst_h265_parser_parse_nal (parser, &nalu), ==,
+          GST_H265_PARSER_OK);
+
+    offset = nalu.offset + nalu.size;
+    n++;
+  } while (res == GST_H265_PARSER_OK);
+
+  gst_h265_parser_free (parser);
+
+  return n;
+}
+
+/* Reads the whole stream as Exp-Golomb codes, which is what dominates
+ * slice header and SEI parsing. Codes too long to be valid are skipped
+ * over a bit at a time */
+static guint
+run_nal_reader (const Stream * stream)
+{
+  NalReader nr;
+  guint32 val;
+  guint n = 0;
+
+  nal_reader_init (&nr, stream->data->data, stream->data->len);
+  while (nal_reader_get_remaining (&nr) > 0) {
+    if (nal_reader_get_ue (&nr, &val))
+      n++;
+    else if (!nal_reader_skip (&nr, 1))
+      break;
+  }
+
+  return n;
+}
+
+static void
+bench (const gchar * name, const Stream * stream,
+    guint (*func) (const Stream *), guint expected)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint run, n;
+
+  for (run = 0; run < NUM_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    n = func (stream);
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+
+    if (expected)
+      g_assert_cmpuint (n, ==, expected);
+  }
+
+  report (name, stream->data->len, best);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  Stream stream;
+
+  gst_init (&argc, &argv);
+
+  make_h264_stream (&stream);
+  bench ("h264parser", &stream, run_h264, stream.n_nals);
+  bench ("nalreader (h264)", &stream, run_nal_reader, 0);
+  g_byte_array_unref (stream.data);
+
+  make_h265_stream (&stream);
+  bench ("h265parser", &stream, run_h265, stream.n_nals);
+  bench ("nalreader (h265)", &stream, run_nal_reader, 0);
+  g_byte_array_unref (stream.data);
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * hlsdecrypt.c: HLS AES-128 fragment decryption benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+#include "gsthlsdecrypt.h"
+
+GST_DEBUG_CATEGORY (gst_hls_demux_debug);
+
+#define NUM_RUNS 10
+#define FRAGMENT_SIZE (8 * 1024 * 1024)
+
+typedef enum
+{
+  MODE_PLAIN,
+  MODE_INLINE,
+  MODE_WORKERS,
+} DecryptMode;
+
+static const guint8 key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2,
+  0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const guint8 iv[16] = { 0 };
+
+static guint64 checksum;
+
+/* Stands for the TS parsing done by hlsdemux on every decrypted chunk */
+static void
+consume (GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gsize i;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i += 188)
+    checksum += map.data[i];
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+/* Runs a fragment through the demuxer in chunks of @chunk_size, as they
+ * come from the source element */
+static gboolean
+run_fragment (DecryptMode mode, const guint8 * data, gsize chunk_size)
+{
+  GstHLSDecryptor *decryptor = NULL;
+  GstBuffer *chunk, *out;
+  GstMapInfo map;
+  gsize offset;
+  guint8 chunk_iv[16];
+  gboolean ok = TRUE;
+
+  if (mode == MODE_WORKERS)
+    decryptor = gst_hls_decryptor_new (key, iv);
+  memcpy (chunk_iv, iv, sizeof (chunk_iv));
+
+  for (offset = 0; ok && offset < FRAGMENT_SIZE; offset += chunk_size) {
+    gsize size = MIN (chunk_size, FRAGMENT_SIZE - offset);
+
+    chunk = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (gpointer) (data + offset), size, 0, size, NULL, NULL);
+
+    switch (mode) {
+      case MODE_PLAIN:
+        /* unencrypted streams are parsed in place */
+        consume (chunk);
+        break;
+      case MODE_INLINE:
+        /* what hlsdemux did before, decrypt on the streaming thread */
+        out = gst_buffer_new_allocate (NULL, size, NULL);
+        gst_buffer_map (out, &map, GST_MAP_WRITE);
+        ok = gst_hls_aes128_cbc_decrypt (key, chunk_iv, data + offset,
+            map.data, size);
+        gst_buffer_unmap (out, &map);
+        memcpy (chunk_iv, data + offset + size - 16, 16);
+        gst_buffer_unref (chunk);
+        consume (out);
+        break;
+      case MODE_WORKERS:
+        ok = gst_hls_decryptor_push (decryptor, chunk, &out, NULL);
+        if (out)
+          consume (out);
+        break;
+    }
+  }
+
+  if (decryptor) {
+    /* random data, the padding will be invalid */
+    if (ok && gst_hls_decryptor_finish (decryptor, &out, NULL) && out)
+      consume (out);
+    gst_hls_decryptor_free (decryptor);
+  }
+
+  return ok;
+}
+
+static gdouble
+bench (DecryptMode mode, const guint8 * data, gsize chunk_size)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint run;
+
+  for (run = 0; run < NUM_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    if (!run_fragment (mode, data, chunk_size))
+      return 0;
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+  }
+
+  return (gdouble) FRAGMENT_SIZE * GST_SECOND / best / 1e6;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const gsize chunk_sizes[] = { 4096, 16384, 65536, 262144,
+    FRAGMENT_SIZE
+  };
+  guint8 *data;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  GST_DEBUG_CATEGORY_INIT (gst_hls_demux_debug, "hlsdemux", 0,
+      "HLS decryption benchmark");
+
+  data = g_malloc (FRAGMENT_SIZE);
+  for (i = 0; i < FRAGMENT_SIZE / 4; i++)
+    ((guint32 *) data)[i] = g_random_int ();
+
+  g_print ("%u threads, %u MB fragment\n", g_get_num_processors (),
+      FRAGMENT_SIZE / (1024 * 1024));
+  g_print ("%10s %12s %12s %12s\n", "chunk", "plain MB/s", "inline MB/s",
+      "workers MB/s");
+
+  for (i = 0; i < G_N_ELEMENTS (chunk_sizes); i++) {
+    gsize chunk_size = chunk_sizes[i];
+
+    g_print ("%10" G_GSIZE_FORMAT " %12.1f %12.1f %12.1f\n", chunk_size,
+        bench (MODE_PLAIN, data, chunk_size),
+        bench (MODE_INLINE, data, chunk_size),
+        bench (MODE_WORKERS, data, chunk_size));
+  }
+
+  g_print ("checksum %" G_GUINT64_FORMAT "\n", checksum);
+  g_free (data);
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * srtpdec.c: SRTP decryption throughput benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Decrypts the same SRTP packets with srtpdec pushing one buffer at a time
+ * and in buffer lists, as received by an SFU from many senders. Needs the
+ * srtp plugin, e.g. with GST_PLUGIN_PATH pointing to the build directory. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/check/gstharness.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define NUM_RUNS 5
+#define NUM_SSRCS 200
+/* consecutive packets of the same sender */
+#define RUN_LENGTH 4
+#define NUM_PACKETS (NUM_SSRCS * RUN_LENGTH * 50)
+#define PAYLOAD_SIZE 1100
+
+#define KEY "012345678901234567890123456789012345678901234567890123456789"
+
+static GstCaps *
+request_key (GstElement * srtpdec, guint ssrc, gpointer user_data)
+{
+  return gst_caps_new_simple ("application/x-srtp",
+      "ssrc", G_TYPE_UINT, ssrc,
+      "srtp-key", GST_TYPE_BUFFER, user_data,
+      "srtp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtp-auth", G_TYPE_STRING, "hmac-sha1-80",
+      "srtcp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtcp-auth", G_TYPE_STRING, "hmac-sha1-80", NULL);
+}
+
+static GstBuffer *
+make_key (void)
+{
+  GstBuffer *key;
+  GstMapInfo map;
+  guint i;
+
+  key = gst_buffer_new_allocate (NULL, 30, NULL);
+  gst_buffer_map (key, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++) {
+    gchar byte[3] = { KEY[2 * i], KEY[2 * i + 1], 0 };
+    map.data[i] = g_ascii_strtoull (byte, NULL, 16);
+  }
+  gst_buffer_unmap (key, &map);
+
+  return key;
+}
+
+/* Returns the packets as encrypted by srtpenc */
+static GPtrArray *
+make_packets (GstBuffer * key)
+{
+  GPtrArray *packets = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) gst_buffer_unref);
+  GstHarness *h;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  g_object_set (h->element, "key", key, NULL);
+  gst_harness_set_src_caps_str (h, "application/x-rtp, payload=(int)96, "
+      "clock-rate=(int)90000");
+
+  for (i = 0; i < NUM_PACKETS; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    guint sender = (i / RUN_LENGTH) % NUM_SSRCS;
+    GstBuffer *buf;
+
+    buf = gst_rtp_buffer_new_allocate (PAYLOAD_SIZE, 0, 0);
+    gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+    gst_rtp_buffer_set_payload_type (&rtp, 96);
+    gst_rtp_buffer_set_ssrc (&rtp, 0x10000 + sender);
+    gst_rtp_buffer_set_seq (&rtp, i / (RUN_LENGTH * NUM_SSRCS) * RUN_LENGTH
+        + i % RUN_LENGTH);
+    gst_rtp_buffer_set_timestamp (&rtp, i * 3000);
+    gst_rtp_buffer_unmap (&rtp);
+
+    g_ptr_array_add (packets, gst_harness_push_and_pull (h, buf));
+  }
+
+  gst_harness_teardown (h);
+
+  return packets;
+}
+
+static GstHarness *
+make_decoder (GstBuffer * key)
+{
+  GstHarness *h;
+
+  h = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  g_signal_connect (h->element, "request-key", G_CALLBACK (request_key), key);
+  gst_harness_set_src_caps_str (h, "application/x-srtp");
+  gst_harness_set_drop_buffers (h, TRUE);
+
+  return h;
+}
+
+/* Returns the time taken to decrypt all the packets, in lists of
+ * @list_size or one by one if 0 */
+static GstClockTime
+run (GPtrArray * packets, GstBuffer * key, guint list_size)
+{
+  GstClockTime start, elapsed;
+  GstBufferList *list = NULL;
+  GPtrArray *copies;
+  GstHarness *h;
+  guint i;
+
+  /* the replay protection needs a new decoder for every run, and the
+   * packets are decrypted in place */
+  h = make_decoder (key);
+  copies = g_ptr_array_new ();
+  for (i = 0; i < packets->len; i++)
+    g_ptr_array_add (copies, gst_buffer_copy_deep (packets->pdata[i]));
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < copies->len; i++) {
+    if (list_size == 0) {
+      gst_pad_push (h->srcpad, copies->pdata[i]);
+      continue;
+    }
+
+    if (list == NULL)
+      list = gst_buffer_list_new_sized (list_size);
+    gst_buffer_list_add (list, copies->pdata[i]);
+    if (gst_buffer_list_length (list) == list_size) {
+      gst_pad_push_list (h->srcpad, list);
+      list = NULL;
+    }
+  }
+  if (list)
+    gst_pad_push_list (h->srcpad, list);
+  elapsed = gst_util_get_timestamp () - start;
+
+  g_ptr_array_free (copies, TRUE);
+  gst_harness_teardown (h);
+
+  return elapsed;
+}
+
+static void
+bench (const gchar * name, GPtrArray * packets, GstBuffer * key,
+    guint list_size)
+{
+  GstClockTime best = GST_CLOCK_TIME_NONE;
+  guint i;
+
+  for (i = 0; i < NUM_RUNS; i++)
+    best = MIN (best, run (packets, key, list_size));
+
+  g_print ("%-24s %8.0f packets/s %8.1f Mbit/s\n", name,
+      (gdouble) packets->len * GST_SECOND / best,
+      (gdouble) packets->len * PAYLOAD_SIZE * 8 * GST_SECOND / best / 1e6);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const guint list_sizes[] = { 8, 32, 128 };
+  GPtrArray *packets;
+  GstBuffer *key;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (!gst_registry_check_feature_version (gst_registry_get (), "srtpdec",
+          GST_VERSION_MAJOR, GST_VERSION_MINOR, 0)) {
+    g_printerr ("srtpdec is not available\n");
+    return 1;
+  }
+
+  key = make_key ();
+  packets = make_packets (key);
+
+  g_print ("%u packets of %u bytes from %u senders\n", packets->len,
+      PAYLOAD_SIZE, NUM_SSRCS);
+
+  bench ("buffers", packets, key, 0);
+  for (i = 0; i < G_N_ELEMENTS (list_sizes); i++) {
+    gchar *name = g_strdup_printf ("lists of %u", list_sizes[i]);
+
+    bench (name, packets, key, list_sizes[i]);
+    g_free (name);
+  }
+
+  g_ptr_array_free (packets, TRUE);
+  gst_buffer_unref (key);
+
+  return 0;
+}
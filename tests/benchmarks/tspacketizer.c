@@ -0,0 +1,212 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * tspacketizer.c: MPEG-TS packetizer throughput benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#include "mpegtspacketizer.h"
+
+#define NUM_PACKETS (1 << 18)
+/* 7 packets per buffer, as received from UDP */
+#define PACKETS_PER_BUFFER 7
+#define NUM_PIDS 16
+#define NUM_RUNS 5
+
+/* Builds a synthetic multiplex: NUM_PIDS elementary streams, a PCR every
+ * 40 packets on the first PID and ~10% null packets. If @garbage is set,
+ * a few random bytes are inserted every 1000 packets so the packetizer
+ * has to resync */
+static guint8 *
+make_multiplex (gsize * out_size, gboolean garbage)
+{
+  guint8 *data, *p;
+  guint cc[NUM_PIDS] = { 0, };
+  guint i;
+  guint64 pcr = 0;
+
+  data = p = g_malloc (NUM_PACKETS * (188 + 8));
+
+  for (i = 0; i < NUM_PACKETS; i++) {
+    guint16 pid;
+    guint idx = g_random_int_range (0, NUM_PIDS + 2);
+
+    if (garbage && i % 1000 == 999) {
+      guint j, n = g_random_int_range (1, 8);
+      for (j = 0; j < n; j++)
+        *p++ = g_random_int_range (0, 0x47);
+    }
+
+    p[0] = 0x47;
+    if (idx >= NUM_PIDS) {
+      pid = 0x1fff;
+      p[1] = pid >> 8;
+      p[2] = pid & 0xff;
+      p[3] = 0x10;
+      memset (p + 4, 0xff, 184);
+    } else if (i % 40 == 0) {
+      pid = 0x100;
+      p[1] = 0x40 | (pid >> 8);
+      p[2] = pid & 0xff;
+      p[3] = 0x30 | (cc[0]++ & 0xf);
+      /* adaptation field with PCR */
+      p[4] = 7;
+      p[5] = 0x10;
+      GST_WRITE_UINT32_BE (p + 6, (guint32) (pcr >> 1));
+      p[10] = ((pcr & 1) << 7) | 0x7e;
+      p[11] = 0;
+      memset (p + 12, 0xaa, 176);
+      pcr += 2700;
+    } else {
+      pid = 0x100 + idx;
+      p[1] = pid >> 8;
+      p[2] = pid & 0xff;
+      p[3] = 0x10 | (cc[idx]++ & 0xf);
+      memset (p + 4, 0xaa, 184);
+    }
+    p += 188;
+  }
+
+  *out_size = p - data;
+  return data;
+}
+
+static GstBufferList *
+make_buffers (const guint8 * data, gsize size)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+  gsize offset = 0;
+
+  while (offset < size) {
+    gsize len = MIN (size - offset, PACKETS_PER_BUFFER * 188);
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, len, NULL);
+
+    gst_buffer_fill (buf, 0, data + offset, len);
+    GST_BUFFER_OFFSET (buf) = offset;
+    gst_buffer_list_add (list, buf);
+    offset += len;
+  }
+
+  return list;
+}
+
+static guint
+run_single (MpegTSPacketizer2 * packetizer, GstBufferList * list)
+{
+  MpegTSPacketizerPacket packet;
+  MpegTSPacketizerPacketReturn ret;
+  guint i, len, n = 0;
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    mpegts_packetizer_push (packetizer,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+
+    while ((ret = mpegts_packetizer_next_packet (packetizer, &packet))
+        != PACKET_NEED_MORE) {
+      if (ret == PACKET_OK && packet.pid != 0x1fff)
+        n++;
+      mpegts_packetizer_clear_packet (packetizer, &packet);
+    }
+  }
+
+  return n;
+}
+
+static guint
+run_batched (MpegTSPacketizer2 * packetizer, GstBufferList * list)
+{
+  MpegTSPacketizerPacketInfo infos[64];
+  guint i, j, len, n_infos, n = 0;
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    mpegts_packetizer_push (packetizer,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+
+    while ((n_infos = mpegts_packetizer_next_packets (packetizer, infos,
+                G_N_ELEMENTS (infos)))) {
+      for (j = 0; j < n_infos; j++) {
+        if (!(infos[j].flags & MPEGTS_PACKET_INFO_TRANSPORT_ERROR)
+            && infos[j].pid != 0x1fff)
+          n++;
+      }
+      mpegts_packetizer_skip_packets (packetizer, n_infos);
+    }
+  }
+
+  return n;
+}
+
+static void
+bench (const gchar * name, GstBufferList * list,
+    guint (*func) (MpegTSPacketizer2 *, GstBufferList *))
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint run, n = 0;
+
+  for (run = 0; run < NUM_RUNS; run++) {
+    MpegTSPacketizer2 *packetizer = mpegts_packetizer_new ();
+
+    start = gst_util_get_timestamp ();
+    n = func (packetizer, list);
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+
+    g_object_unref (packetizer);
+  }
+
+  g_print ("%-24s %8u packets in %" GST_TIME_FORMAT " : %.2f Mpackets/s\n",
+      name, n, GST_TIME_ARGS (best),
+      (gdouble) NUM_PACKETS * GST_SECOND / best / 1e6);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstBufferList *aligned, *garbled;
+  guint8 *data;
+  gsize size;
+
+  gst_init (&argc, &argv);
+
+  data = make_multiplex (&size, FALSE);
+  aligned = make_buffers (data, size);
+  g_free (data);
+
+  data = make_multiplex (&size, TRUE);
+  garbled = make_buffers (data, size);
+  g_free (data);
+
+  bench ("single", aligned, run_single);
+  bench ("batched", aligned, run_batched);
+  bench ("single (resync)", garbled, run_single);
+  bench ("batched (resync)", garbled, run_batched);
+
+  gst_buffer_list_unref (aligned);
+  gst_buffer_list_unref (garbled);
+
+  return 0;
+}
@@ -27,6 +27,7 @@
 #include "../../ext/dash/gstmpdrootnode.c"
 #include "../../ext/dash/gstmpdbaseurlnode.c"
 #include "../../ext/dash/gstmpdutctimingnode.c"
+#include "../../ext/dash/gstmpdservicedescriptionnode.c"
 #include "../../ext/dash/gstmpdmetricsnode.c"
 #include "../../ext/dash/gstmpdmetricsrangenode.c"
 #include "../../ext/dash/gstmpdsnode.c"
@@ -4799,6 +4800,107 @@ GST_START_TEST (dash_mpdparser_segment_template)
 
 GST_END_TEST;
 
+/*
+ * Test parsing of the low-latency DASH attributes and their effect on the
+ * segment availability
+ *
+ */
+GST_START_TEST (dash_mpdparser_low_latency)
+{
+  GList *adaptationSets;
+  GstMPDAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstMPDServiceDescriptionNode *service_description;
+  GstMPDSegmentBaseNode *segment_base;
+  GstDateTime *segmentAvailability;
+  GstDateTime *segmentStart;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     type=\"dynamic\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\""
+      "     mediaPresentationDuration=\"P0Y0M0DT3H3M30S\">"
+      "  <ServiceDescription id=\"0\">"
+      "    <Latency target=\"3000\" min=\"2000\" max=\"6000\"/>"
+      "    <PlaybackRate min=\"0.96\" max=\"1.04\"/>"
+      "  </ServiceDescription>"
+      "  <Period id=\"Period0\" start=\"P0Y0M0DT0H0M10S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <SegmentTemplate media=\"$Number$.m4s\""
+      "                       timescale=\"1000\""
+      "                       duration=\"4000\""
+      "                       availabilityTimeOffset=\"3.5\""
+      "                       availabilityTimeComplete=\"false\">"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMPDClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_client_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  service_description = gst_mpd_client_get_service_description (mpdclient);
+  fail_if (service_description == NULL);
+  assert_equals_int64 (service_description->latency_target, 3000);
+  assert_equals_int64 (service_description->latency_min, 2000);
+  assert_equals_int64 (service_description->latency_max, 6000);
+  assert_equals_float (service_description->playback_rate_min, 0.96);
+  assert_equals_float (service_description->playback_rate_max, 1.04);
+
+  /* process the xml data */
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+
+  adapt_set = (GstMPDAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  segment_base =
+      GST_MPD_MULT_SEGMENT_BASE_NODE (adapt_set->SegmentTemplate)->SegmentBase;
+  assert_equals_float (segment_base->availabilityTimeOffset, 3.5);
+  assert_equals_int (segment_base->availabilityTimeComplete, FALSE);
+
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpd_client_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+
+  assert_equals_uint64 (gst_mpd_client_get_availability_time_offset (mpdclient,
+          activeStream), 3500 * GST_MSECOND);
+  assert_equals_int (gst_mpd_client_is_availability_time_complete (mpdclient,
+          activeStream), FALSE);
+
+  /* The first segment starts at the period start (10s) and lasts 4s. It is
+   * complete at 14s, but can be requested 3.5s before that */
+  segmentStart =
+      gst_mpd_client_get_next_segment_start_time (mpdclient, activeStream);
+  assert_equals_int (gst_date_time_get_minute (segmentStart), 0);
+  assert_equals_int (gst_date_time_get_second (segmentStart), 10);
+  assert_equals_int (gst_date_time_get_microsecond (segmentStart), 0);
+  gst_date_time_unref (segmentStart);
+
+  segmentAvailability =
+      gst_mpd_client_get_next_segment_availability_start_time (mpdclient,
+      activeStream);
+  assert_equals_int (gst_date_time_get_minute (segmentAvailability), 0);
+  assert_equals_int (gst_date_time_get_second (segmentAvailability), 10);
+  assert_equals_int (gst_date_time_get_microsecond (segmentAvailability),
+      500000);
+  gst_date_time_unref (segmentAvailability);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test segment timeline
  *
@@ -4969,6 +5071,198 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
 
 GST_END_TEST;
 
+/*
+ * Test seeking inside a SegmentTimeline with several runs of repeated
+ * segments
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_seek)
+{
+  GList *adaptationSets;
+  GstMPDAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstClockTime final_ts;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M13S\">"
+      "  <Period start=\"P0Y0M0DT0H0M0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <SegmentTemplate media=\"$Number$.m4s\" timescale=\"1\">"
+      "        <SegmentTimeline>"
+      "          <S t=\"0\" d=\"2\" r=\"2\"></S>"
+      "          <S d=\"3\" r=\"1\"></S>"
+      "          <S d=\"1\"></S>"
+      "        </SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMPDClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_client_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  /* process the xml data */
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+
+  adapt_set = (GstMPDAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpd_client_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+  /* one entry per S element, not per segment */
+  assert_equals_int (activeStream->segments->len, 3);
+
+  /* inside the first run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      5 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 2);
+  assert_equals_uint64 (final_ts, 4 * GST_SECOND);
+
+  /* inside the second run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      10 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 1);
+  assert_equals_uint64 (final_ts, 9 * GST_SECOND);
+
+  /* snapping after moves to the next segment of the run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE,
+      GST_SEEK_FLAG_SNAP_AFTER, 1 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 1);
+  assert_equals_uint64 (final_ts, 2 * GST_SECOND);
+
+  /* on a run boundary in reverse mode, use the end of the previous run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, FALSE, 0,
+      6 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 2);
+  assert_equals_uint64 (final_ts, 4 * GST_SECOND);
+
+  /* last segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      12 * GST_SECOND + 500 * GST_MSECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 2);
+  assert_equals_uint64 (final_ts, 12 * GST_SECOND);
+
+  /* after the end */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      20 * GST_SECOND, NULL);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (activeStream->segment_index, 3);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that refreshing a manifest with the streaming parser reuses the
+ * Periods which did not change and parses the others again
+ *
+ */
+GST_START_TEST (dash_mpdparser_update_reuse_periods)
+{
+  GstMPDPeriodNode *old_period0, *old_period1, *new_period0, *new_period1;
+  GstMPDClient *old_client, *new_client;
+  gboolean ret;
+  const gchar *xml_old =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\""
+      "     type=\"dynamic\" minimumUpdatePeriod=\"PT2S\">"
+      "  <Period id=\"Period0\" start=\"PT0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>"
+      "      </Representation></AdaptationSet></Period>"
+      "  <Period id=\"Period1\" start=\"PT60S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+  const gchar *xml_new =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\""
+      "     type=\"dynamic\" minimumUpdatePeriod=\"PT4S\">"
+      "  <Period id=\"Period0\" start=\"PT0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>"
+      "      </Representation></AdaptationSet></Period>"
+      "  <Period id=\"Period1\" start=\"PT60S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"500000\">"
+      "        <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  old_client = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse_update (old_client, xml_old,
+      (gint) strlen (xml_old), NULL);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (old_client->mpd_root_node->Periods), 2);
+  old_period0 = g_list_nth_data (old_client->mpd_root_node->Periods, 0);
+  old_period1 = g_list_nth_data (old_client->mpd_root_node->Periods, 1);
+
+  new_client = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse_update (new_client, xml_new,
+      (gint) strlen (xml_new), old_client);
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (new_client->mpd_root_node->minimumUpdatePeriod, 4000);
+  assert_equals_int (g_list_length (new_client->mpd_root_node->Periods), 2);
+  new_period0 = g_list_nth_data (new_client->mpd_root_node->Periods, 0);
+  new_period1 = g_list_nth_data (new_client->mpd_root_node->Periods, 1);
+
+  /* the unchanged Period is shared, the updated one is parsed again */
+  fail_unless (new_period0 == old_period0);
+  fail_unless (new_period1 != old_period1);
+  assert_equals_string (new_period1->id, "Period1");
+
+  /* the shared Period outlives the client it was parsed for */
+  gst_mpd_client_free (old_client);
+  assert_equals_string (new_period0->id, "Period0");
+  assert_equals_int (g_list_length (new_period0->AdaptationSets), 1);
+
+  /* the streaming parser builds the same tree as the DOM parser */
+  old_client = gst_mpd_client_new ();
+  ret = gst_mpd_client_parse (old_client, xml_new, (gint) strlen (xml_new));
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (old_client->mpd_root_node->minimumUpdatePeriod, 4000);
+  assert_equals_int (g_list_length (old_client->mpd_root_node->Periods), 2);
+  assert_equals_uint64 (((GstMPDPeriodNode *)
+          g_list_nth_data (old_client->mpd_root_node->Periods, 1))->start,
+      new_period1->start);
+
+  /* malformed manifests are rejected */
+  ret = gst_mpd_client_parse_update (new_client, "<MPD><Period>", 13, NULL);
+  assert_equals_int (ret, FALSE);
+
+  gst_mpd_client_free (old_client);
+  gst_mpd_client_free (new_client);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple inherited segmentURLs
  *
@@ -5198,6 +5492,113 @@ GST_START_TEST (dash_mpdparser_multipleSegmentURL)
 
 GST_END_TEST;
 
+/* Checks that peeking at the upcoming fragments of the first adaptation set
+ * of @xml gives what advancing to them does */
+static void
+check_peek_fragment (const gchar * xml, guint n_fragments)
+{
+  GList *adaptationSets;
+  GstMPDAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstMediaFragmentInfo fragment;
+  GstFlowReturn flow = GST_FLOW_OK;
+  GPtrArray *uris = g_ptr_array_new_with_free_func (g_free);
+  gboolean ret;
+  guint i, n;
+  GstMPDClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_client_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+  adapt_set = (GstMPDAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+  activeStream = gst_mpd_client_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+
+  /* the fragments, by advancing */
+  while (flow == GST_FLOW_OK) {
+    ret = gst_mpd_client_get_next_fragment (mpdclient, 0, &fragment);
+    assert_equals_int (ret, TRUE);
+    g_ptr_array_add (uris, fragment.uri);
+    fragment.uri = NULL;
+    gst_mpdparser_media_fragment_info_clear (&fragment);
+    flow = gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
+  }
+  assert_equals_int (flow, GST_FLOW_EOS);
+  assert_equals_int (uris->len, n_fragments);
+
+  /* and by peeking from each position, which doesn't move it */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0, 0, NULL);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  for (i = 0; i < n_fragments; i++) {
+    for (n = 0; i + n < n_fragments; n++) {
+      ret = gst_mpd_client_peek_fragment (mpdclient, 0, n, &fragment);
+      assert_equals_int (ret, TRUE);
+      assert_equals_string (fragment.uri, g_ptr_array_index (uris, i + n));
+      gst_mpdparser_media_fragment_info_clear (&fragment);
+    }
+    ret = gst_mpd_client_peek_fragment (mpdclient, 0, n, &fragment);
+    assert_equals_int (ret, FALSE);
+
+    ret = gst_mpd_client_get_next_fragment (mpdclient, 0, &fragment);
+    assert_equals_int (ret, TRUE);
+    assert_equals_string (fragment.uri, g_ptr_array_index (uris, i));
+    gst_mpdparser_media_fragment_info_clear (&fragment);
+    gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
+  }
+
+  g_ptr_array_unref (uris);
+  gst_mpd_client_free (mpdclient);
+}
+
+/*
+ * Test looking ahead at fragments without advancing
+ *
+ */
+GST_START_TEST (dash_mpdparser_peek_fragment)
+{
+  const gchar *xml_timeline =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M9S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia-$Time$.mp4\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"2\"></S>"
+      "            <S d=\"3\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+  const gchar *xml_template =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M8S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia-$Number$.mp4\""
+      "                         duration=\"2\" startNumber=\"1\">"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  check_peek_fragment (xml_timeline, 4);
+  check_peek_fragment (xml_template, 4);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing empty xml string
  *
@@ -6482,7 +6883,11 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_inherited_segmentURL);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_low_latency);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline_seek);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_peek_fragment);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_update_reuse_periods);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
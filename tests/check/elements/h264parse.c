@@ -26,6 +26,7 @@
 #include <gst/check/check.h>
 #include <gst/video/video.h>
 #include "gst-libs/gst/codecparsers/gsth264parser.h"
+#include "gst-libs/gst/codecparsers/gsth264meta.h"
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -1151,6 +1152,105 @@ GST_START_TEST (test_parse_sliced_sps_pps_sps)
 
 GST_END_TEST;
 
+/* Checks that the GstH264NalMeta of @buffer describes the two slices of
+ * the test AU, as they are found in the buffer data */
+static void
+check_nal_meta (GstBuffer * buffer)
+{
+  const guint8 *slices[] = { h264_idr_slice_1, h264_idr_slice_2 };
+  const gsize sizes[] = { sizeof (h264_idr_slice_1),
+    sizeof (h264_idr_slice_2)
+  };
+  GstH264NalMeta *meta;
+  GstMapInfo map;
+  guint i;
+
+  meta = gst_buffer_get_h264_nal_meta (buffer);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->n_units, 2);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < meta->n_units; i++) {
+    const GstH264NalMetaUnit *unit = &meta->units[i];
+
+    fail_unless_equals_int (unit->nalu.type, GST_H264_NAL_SLICE_IDR);
+    fail_unless (unit->has_slice_hdr);
+    fail_unless (unit->nalu.data == NULL);
+    fail_unless_equals_int (unit->nalu.size, sizes[i] - 4);
+    fail_unless (unit->nalu.offset + unit->nalu.size <= map.size);
+    fail_unless (memcmp (map.data + unit->nalu.offset, slices[i] + 4,
+            unit->nalu.size) == 0);
+  }
+  gst_buffer_unmap (buffer, &map);
+}
+
+static GstHarness *
+nal_meta_harness_new (gboolean consumer)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstBuffer *buf;
+
+  /* the decoders add the meta API to the allocation query */
+  if (consumer)
+    gst_harness_add_propose_allocation_meta (h, GST_H264_NAL_META_API_TYPE,
+        NULL);
+
+  gst_harness_set_caps_str (h,
+      "video/x-h264,stream-format=byte-stream,alignment=au,parsed=false,framerate=30/1",
+      "video/x-h264,stream-format=byte-stream,alignment=au,parsed=true");
+
+  buf = composite_buffer (100, 0, 4,
+      h264_slicing_sps, sizeof (h264_slicing_sps),
+      h264_slicing_pps, sizeof (h264_slicing_pps),
+      h264_idr_slice_1, sizeof (h264_idr_slice_1),
+      h264_idr_slice_2, sizeof (h264_idr_slice_2));
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  buf = composite_buffer (200, 0, 2,
+      h264_idr_slice_1, sizeof (h264_idr_slice_1),
+      h264_idr_slice_2, sizeof (h264_idr_slice_2));
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+
+  return h;
+}
+
+GST_START_TEST (test_parse_nal_meta)
+{
+  GstHarness *h = nal_meta_harness_new (TRUE);
+  GstBuffer *buf;
+
+  /* the output caps, and so the meta negotiation, may only be known after
+   * the first AU was parsed */
+  pull_and_drop (h);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_clocktime (GST_BUFFER_PTS (buf), 200);
+  check_nal_meta (buf);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_nal_meta_no_consumer)
+{
+  GstHarness *h = nal_meta_harness_new (FALSE);
+  GstBuffer *buf;
+
+  while ((buf = gst_harness_try_pull (h))) {
+    fail_unless (gst_buffer_get_h264_nal_meta (buf) == NULL);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 h264parse_sliced_suite (void)
@@ -1163,6 +1263,8 @@ h264parse_sliced_suite (void)
   tcase_add_test (tc_chain, test_parse_sliced_au_nal);
   tcase_add_test (tc_chain, test_parse_sliced_nal_au);
   tcase_add_test (tc_chain, test_parse_sliced_sps_pps_sps);
+  tcase_add_test (tc_chain, test_parse_nal_meta);
+  tcase_add_test (tc_chain, test_parse_nal_meta_no_consumer);
 
   return s;
 }
@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/check.h>
+#include "gst-libs/gst/codecparsers/gsth265meta.h"
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h265, parsed=(boolean)false"
@@ -1051,6 +1052,99 @@ GST_START_TEST (test_drain)
 
 GST_END_TEST;
 
+/* Checks that the GstH265NalMeta of @buffer describes the two slices of
+ * the sliced test AU, as they are found in the buffer data */
+static void
+check_nal_meta (GstBuffer * buffer)
+{
+  const guint8 *slices[] = { h265_128x128_slice_1_idr_n_lp,
+    h265_128x128_slice_2_idr_n_lp
+  };
+  const gsize sizes[] = { sizeof (h265_128x128_slice_1_idr_n_lp),
+    sizeof (h265_128x128_slice_2_idr_n_lp)
+  };
+  GstH265NalMeta *meta;
+  GstMapInfo map;
+  guint i;
+
+  meta = gst_buffer_get_h265_nal_meta (buffer);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->n_units, 2);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < meta->n_units; i++) {
+    const GstH265NalMetaUnit *unit = &meta->units[i];
+
+    fail_unless_equals_int (unit->nalu.type, GST_H265_NAL_SLICE_IDR_N_LP);
+    fail_unless (unit->has_slice_hdr);
+    fail_unless (unit->nalu.data == NULL);
+    fail_unless_equals_int (unit->nalu.size, sizes[i] - 4);
+    fail_unless (unit->nalu.offset + unit->nalu.size <= map.size);
+    fail_unless (memcmp (map.data + unit->nalu.offset, slices[i] + 4,
+            unit->nalu.size) == 0);
+  }
+  gst_buffer_unmap (buffer, &map);
+}
+
+static GstHarness *
+nal_meta_harness_new (gboolean consumer)
+{
+  GstHarness *h = gst_harness_new ("h265parse");
+  GstBuffer *buf;
+
+  /* the decoders add the meta API to the allocation query */
+  if (consumer)
+    gst_harness_add_propose_allocation_meta (h, GST_H265_NAL_META_API_TYPE,
+        NULL);
+
+  bytestream_set_caps (h, "au", "au");
+  bytestream_push_first_au_inalign_au (h, TRUE);
+
+  buf = composite_buffer (100, 0, 2,
+      h265_128x128_slice_1_idr_n_lp, sizeof (h265_128x128_slice_1_idr_n_lp),
+      h265_128x128_slice_2_idr_n_lp, sizeof (h265_128x128_slice_2_idr_n_lp));
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+
+  return h;
+}
+
+GST_START_TEST (test_nal_meta)
+{
+  GstHarness *h = nal_meta_harness_new (TRUE);
+  GstBuffer *buf;
+
+  /* the output caps, and so the meta negotiation, may only be known after
+   * the first AU was parsed */
+  pull_and_drop (h);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_clocktime (GST_BUFFER_PTS (buf), 100);
+  check_nal_meta (buf);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_nal_meta_no_consumer)
+{
+  GstHarness *h = nal_meta_harness_new (FALSE);
+  GstBuffer *buf;
+
+  while ((buf = gst_harness_try_pull (h))) {
+    fail_unless (gst_buffer_get_h265_nal_meta (buf) == NULL);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 h265parse_harnessed_suite (void)
@@ -1087,6 +1181,9 @@ h265parse_harnessed_suite (void)
 
   tcase_add_test (tc_chain, test_drain);
 
+  tcase_add_test (tc_chain, test_nal_meta);
+  tcase_add_test (tc_chain, test_nal_meta_no_consumer);
+
   return s;
 }
 
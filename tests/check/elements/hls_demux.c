@@ -726,6 +726,89 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+/* Number of fragment requests, and whether all the fragments of the live
+ * playlist were requested while the blocking reload was pending */
+static gint blocking_reload_fragments;
+static gint blocking_reload_saw_fragments;
+
+static gboolean
+gst_hlsdemux_test_blocking_reload_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  if (g_str_has_suffix (uri, ".ts")) {
+    g_atomic_int_inc (&blocking_reload_fragments);
+  } else if (strstr (uri, "_HLS_msn=3")) {
+    gint64 deadline = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    /* The server holds the request until the playlist changes. The fragments
+     * already in the playlist have to be downloaded meanwhile */
+    while (g_atomic_int_get (&blocking_reload_fragments) < 3
+        && g_get_monotonic_time () < deadline)
+      g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+    if (g_atomic_int_get (&blocking_reload_fragments) >= 3)
+      g_atomic_int_set (&blocking_reload_saw_fragments, 1);
+  }
+
+  return gst_hlsdemux_test_src_start (src, uri, input_data, user_data);
+}
+
+/*
+ * Test that fragments keep being downloaded while a blocking playlist reload
+ * is held back by the server
+ */
+GST_START_TEST (testBlockingReload)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *live_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n" "#EXTINF:1,Test\n" "003.ts\n";
+  const gchar *final_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) live_playlist, 0},
+    {"http://unit.test/media.m3u8?_HLS_msn=3", (guint8 *) final_playlist, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  g_atomic_int_set (&blocking_reload_fragments, 0);
+  g_atomic_int_set (&blocking_reload_saw_fragments, 0);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_blocking_reload_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  fail_unless (g_atomic_int_get (&blocking_reload_saw_fragments));
+
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -745,6 +828,7 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testSeekSnapAfterPosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapBeforePosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapAfterPosition);
+  tcase_add_test (tc_basicTest, testBlockingReload);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
@@ -0,0 +1,197 @@
+/* GStreamer
+ *
+ * unit test for the hlsdemux AES-128 decryptor
+ *
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <gst/check/gstcheck.h>
+
+#include "gsthlsdecrypt.h"
+
+GST_DEBUG_CATEGORY (gst_hls_demux_debug);
+
+/* big enough for the decryptor to split chunks in several slices */
+#define FRAGMENT_SIZE (200 * 1024)
+#define PADDING 5
+
+static const guint8 key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2,
+  0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const guint8 iv[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+/* Random ciphertext, whose last block decrypts to a valid PKCS#7 padding
+ * of PADDING bytes */
+static guint8 *
+create_fragment (void)
+{
+  static const guint8 zero_iv[16] = { 0 };
+  guint8 *data = g_malloc (FRAGMENT_SIZE);
+  guint8 *last = data + FRAGMENT_SIZE - 16;
+  guint8 block[16];
+  guint i;
+
+  for (i = 0; i < FRAGMENT_SIZE / 4; i++)
+    ((guint32 *) data)[i] = g_random_int ();
+
+  /* the last plaintext block is the decrypted last ciphertext block xored
+   * with the one before it, pick the latter to end with the padding */
+  fail_unless (gst_hls_aes128_cbc_decrypt (key, zero_iv, last, block, 16));
+  for (i = 16 - PADDING; i < 16; i++)
+    last[i - 16] = block[i] ^ PADDING;
+
+  return data;
+}
+
+/* Decrypts the whole fragment at once, then unpads it */
+static GstBuffer *
+decrypt_fragment (const guint8 * data)
+{
+  GstBuffer *out = gst_buffer_new_allocate (NULL, FRAGMENT_SIZE, NULL);
+  GstMapInfo map;
+
+  gst_buffer_map (out, &map, GST_MAP_WRITE);
+  fail_unless (gst_hls_aes128_cbc_decrypt (key, iv, data, map.data,
+          FRAGMENT_SIZE));
+  fail_unless_equals_int (map.data[FRAGMENT_SIZE - 1], PADDING);
+  gst_buffer_unmap (out, &map);
+  gst_buffer_resize (out, 0, FRAGMENT_SIZE - PADDING);
+
+  return out;
+}
+
+/* Pushes the fragment to a decryptor in chunks of @chunk_sizes, the last
+ * chunk taking what is left, and returns everything it output */
+static GstBuffer *
+decrypt_fragment_chunked (const guint8 * data, const gsize * chunk_sizes,
+    guint n_chunks)
+{
+  GstHLSDecryptor *decryptor = gst_hls_decryptor_new (key, iv);
+  GstBuffer *result = gst_buffer_new ();
+  GstBuffer *chunk, *out;
+  gsize offset = 0;
+  guint i;
+
+  for (i = 0; i < n_chunks; i++) {
+    gsize size =
+        (i == n_chunks - 1) ? FRAGMENT_SIZE - offset : chunk_sizes[i];
+
+    fail_unless (offset + size <= FRAGMENT_SIZE);
+    chunk = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_fill (chunk, 0, data + offset, size);
+    fail_unless (gst_hls_decryptor_push (decryptor, chunk, &out, NULL));
+    /* the newest chunk is always kept back */
+    if (i == 0)
+      fail_unless (out == NULL);
+    else
+      fail_unless (out != NULL);
+    if (out)
+      result = gst_buffer_append (result, out);
+    offset += size;
+  }
+
+  fail_unless (gst_hls_decryptor_finish (decryptor, &out, NULL));
+  fail_unless (out != NULL);
+  result = gst_buffer_append (result, out);
+  gst_hls_decryptor_free (decryptor);
+
+  return result;
+}
+
+static void
+check_chunked (const gsize * chunk_sizes, guint n_chunks)
+{
+  guint8 *data = create_fragment ();
+  GstBuffer *expected, *result;
+  GstMapInfo expected_map, result_map;
+
+  expected = decrypt_fragment (data);
+  result = decrypt_fragment_chunked (data, chunk_sizes, n_chunks);
+
+  gst_buffer_map (expected, &expected_map, GST_MAP_READ);
+  gst_buffer_map (result, &result_map, GST_MAP_READ);
+  fail_unless_equals_uint64 (result_map.size, expected_map.size);
+  fail_unless (memcmp (result_map.data, expected_map.data,
+          expected_map.size) == 0);
+  gst_buffer_unmap (result, &result_map);
+  gst_buffer_unmap (expected, &expected_map);
+
+  gst_buffer_unref (result);
+  gst_buffer_unref (expected);
+  g_free (data);
+}
+
+GST_START_TEST (test_decrypt_uneven_chunks)
+{
+  /* a chunk decrypted on the calling thread, one handed to a single
+   * worker, one split in several slices and the remainder */
+  static const gsize chunk_sizes[] = { 1040, 40992, 139264, 0 };
+
+  check_chunked (chunk_sizes, G_N_ELEMENTS (chunk_sizes));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decrypt_single_chunk)
+{
+  static const gsize chunk_sizes[] = { 0 };
+
+  check_chunked (chunk_sizes, G_N_ELEMENTS (chunk_sizes));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decrypt_unaligned_chunk)
+{
+  GstHLSDecryptor *decryptor = gst_hls_decryptor_new (key, iv);
+  GstBuffer *out;
+  GError *err = NULL;
+
+  fail_if (gst_hls_decryptor_push (decryptor, gst_buffer_new_allocate (NULL,
+              100, NULL), &out, &err));
+  fail_unless (out == NULL);
+  fail_unless (g_error_matches (err, GST_STREAM_ERROR,
+          GST_STREAM_ERROR_DECRYPT));
+  g_clear_error (&err);
+  gst_hls_decryptor_free (decryptor);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsdemux_decrypt_suite (void)
+{
+  Suite *s = suite_create ("hlsdemux_decrypt");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (gst_hls_demux_debug, "hlsdemux", 0,
+      "hlsdemux decryption test");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_decrypt_uneven_chunks);
+  tcase_add_test (tc_chain, test_decrypt_single_chunk);
+  tcase_add_test (tc_chain, test_decrypt_unaligned_chunk);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsdemux_decrypt);
@@ -27,6 +27,7 @@
 #undef GST_CAT_DEFAULT
 #include "m3u8.h"
 #include "m3u8.c"
+#include "gstm3u8playlist.c"
 
 GST_DEBUG_CATEGORY (hls_debug);
 
@@ -82,6 +83,42 @@ https://priv.example.com/fileSequence3003.ts\n\
 #EXTINF:8,\n\
 https://priv.example.com/fileSequence3004.ts";
 
+static const gchar *LOW_LATENCY_PLAYLIST = "#EXTM3U\n\
+#EXT-X-VERSION:6\n\
+#EXT-X-TARGETDURATION:2\n\
+#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.0\n\
+#EXT-X-PART-INF:PART-TARGET=0.5\n\
+#EXT-X-MEDIA-SEQUENCE:100\n\
+#EXTINF:2.0,\n\
+http://media.example.com/seg100.mp4\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.0.mp4\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.1.mp4\"\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.2.mp4\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.3.mp4\"\n\
+#EXTINF:2.0,\n\
+http://media.example.com/seg101.mp4\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg102.0.mp4\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg102.1.mp4\"\n\
+#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"http://media.example.com/seg102.2.mp4\"";
+
+static const gchar *LOW_LATENCY_AES_128_PLAYLIST = "#EXTM3U\n\
+#EXT-X-VERSION:6\n\
+#EXT-X-TARGETDURATION:2\n\
+#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.0\n\
+#EXT-X-PART-INF:PART-TARGET=0.5\n\
+#EXT-X-MEDIA-SEQUENCE:100\n\
+#EXT-X-KEY:METHOD=AES-128,URI=\"https://priv.example.com/key.bin\"\n\
+#EXTINF:2.0,\n\
+http://media.example.com/seg100.ts\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.0.ts\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.1.ts\"\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.2.ts\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg101.3.ts\"\n\
+#EXTINF:2.0,\n\
+http://media.example.com/seg101.ts\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg102.0.ts\",INDEPENDENT=YES\n\
+#EXT-X-PART:DURATION=0.5,URI=\"http://media.example.com/seg102.1.ts\"";
+
 static const gchar *VARIANT_PLAYLIST = "#EXTM3U \n\
 #EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=128000\n\
 http://example.com/low.m3u8\n\
@@ -366,7 +403,7 @@ GST_START_TEST (test_load_main_playlist_rendition)
   master = load_playlist (ON_DEMAND_PLAYLIST);
   variant = master->default_variant;
 
-  assert_equals_int (g_list_length (variant->m3u8->files), 4);
+  assert_equals_int (variant->m3u8->files->len, 4);
   assert_equals_int (master->version, 0);
 
   gst_hls_master_playlist_unref (master);
@@ -476,13 +513,14 @@ check_on_demand_playlist (const gchar * data)
   /* Check that we are not live */
   assert_equals_int (gst_m3u8_is_live (pl), FALSE);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/004.ts");
   assert_equals_int (file->sequence, 3);
 
@@ -532,14 +570,15 @@ GST_START_TEST (test_live_playlist)
   assert_equals_int (gst_m3u8_is_live (pl), TRUE);
   assert_equals_int (pl->sequence, 2680);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2680.ts");
   assert_equals_int (file->sequence, 2680);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2683.ts");
   assert_equals_int (file->sequence, 2683);
@@ -567,7 +606,7 @@ GST_START_TEST (test_live_playlist_rotated)
 
   assert_equals_int (pl->sequence, 2680);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_int (file->sequence, 2680);
 
   ret = gst_m3u8_update (pl, g_strdup (LIVE_ROTATED_PLAYLIST));
@@ -579,7 +618,7 @@ GST_START_TEST (test_live_playlist_rotated)
   /* FIXME: Sequence should last - 3. Should it? */
   assert_equals_int (pl->sequence, 3001);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_int (file->sequence, 3001);
 
   gst_hls_master_playlist_unref (master);
@@ -599,13 +638,13 @@ GST_START_TEST (test_playlist_with_doubles_duration)
   pl = master->default_variant->m3u8;
 
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_float (file->duration / (double) GST_SECOND, 10.321);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 1));
   assert_equals_float (file->duration / (double) GST_SECOND, 9.6789);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 2));
   assert_equals_float (file->duration / (double) GST_SECOND, 10.2344);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 3));
   assert_equals_float (file->duration / (double) GST_SECOND, 9.92);
   fail_unless (gst_m3u8_get_seek_range (pl, &start, &stop));
   assert_equals_int64 (start, 0);
@@ -631,26 +670,26 @@ GST_START_TEST (test_playlist_with_encryption)
   master = load_playlist (AES_128_ENCRYPTED_PLAYLIST);
   pl = master->default_variant->m3u8;
 
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
 
   /* Check all media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 1));
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 2));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key.bin");
   fail_unless (memcmp (&file->iv, iv2, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 3));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 4));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 4));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
@@ -670,7 +709,7 @@ GST_START_TEST (test_update_invalid_playlist)
   /* Test updates in on-demand playlists */
   master = load_playlist (ON_DEMAND_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_update (pl, g_strdup ("#INVALID"));
   assert_equals_int (ret, FALSE);
 
@@ -689,31 +728,310 @@ GST_START_TEST (test_update_playlist)
   /* Test updates in on-demand playlists */
   master = load_playlist (ON_DEMAND_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_update (pl, g_strdup (ON_DEMAND_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   gst_hls_master_playlist_unref (master);
 
   /* Test updates in live playlists */
   master = load_playlist (LIVE_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Add a new entry to the playlist and check the update */
   live_pl = g_strdup_printf ("%s\n%s\n%s", LIVE_PLAYLIST, "#EXTINF:8",
       "https://priv.example.com/fileSequence2683.ts");
   ret = gst_m3u8_update (pl, live_pl);
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
   /* Test sliding window */
   ret = gst_m3u8_update (pl, g_strdup (LIVE_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
+/* Live playlist reloads only create the files that were added since the
+ * previous update and keep the ones that were already known */
+GST_START_TEST (test_update_live_playlist_incremental)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file, *known;
+  gchar *live_pl;
+  gboolean ret;
+
+  master = load_playlist (LIVE_PLAYLIST);
+  pl = master->default_variant->m3u8;
+  assert_equals_int (pl->files->len, 4);
+  known = g_ptr_array_index (pl->files, 2);
+
+  /* The window slides by one fragment */
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:2681\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2681.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2682.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2683.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2684.ts");
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 4);
+  fail_unless (g_ptr_array_index (pl->files, 1) == known);
+  file = g_ptr_array_index (pl->files, 3);
+  assert_equals_int64 (file->sequence, 2684);
+  assert_equals_string (file->uri,
+      "https://priv.example.com/fileSequence2684.ts");
+
+  /* Fragments are looked up by sequence number */
+  pl->sequence = 2683;
+  pl->current_file = -1;
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_int64 (file->sequence, 2683);
+  gst_m3u8_media_file_unref (file);
+  fail_unless (gst_m3u8_has_next_fragment (pl, TRUE));
+  gst_m3u8_advance_fragment (pl, TRUE);
+  assert_equals_int64 (pl->sequence, 2684);
+  fail_if (gst_m3u8_has_next_fragment (pl, TRUE));
+
+  /* A known sequence number can't change its URI */
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:2682\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2682.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/otherSequence2683.ts");
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, FALSE);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
+/* Known files are matched on their resolved URI, not on the end of it */
+GST_START_TEST (test_update_live_playlist_relative_uris)
+{
+  GstM3U8 *pl;
+  GstM3U8MediaFile *known;
+  gchar *live_pl;
+  gboolean ret;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://media.example.com/live/playlist.m3u8", NULL,
+      NULL);
+
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:10\n\
+#EXTINF:8,\n\
+11.ts\n\
+#EXTINF:8,\n\
+12.ts");
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 2);
+  known = g_ptr_array_index (pl->files, 1);
+  assert_equals_string (known->uri, "http://media.example.com/live/12.ts");
+
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:11\n\
+#EXTINF:8,\n\
+12.ts\n\
+#EXTINF:8,\n\
+13.ts");
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 2);
+  fail_unless (g_ptr_array_index (pl->files, 0) == known);
+
+  /* "2.ts" is another file than "12.ts" */
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:11\n\
+#EXTINF:8,\n\
+2.ts\n\
+#EXTINF:8,\n\
+13.ts");
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, FALSE);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_low_latency_playlist)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  gchar *uri;
+
+  master = load_playlist (LOW_LATENCY_PLAYLIST);
+  pl = master->default_variant->m3u8;
+  assert_equals_int (pl->can_block_reload, TRUE);
+  assert_equals_uint64 (pl->part_hold_back, GST_SECOND);
+  assert_equals_uint64 (pl->part_target, GST_SECOND / 2);
+
+  /* Complete files keep their parts */
+  assert_equals_int (pl->files->len, 2);
+  file = g_ptr_array_index (pl->files, 1);
+  assert_equals_int64 (file->sequence, 101);
+  fail_unless (file->partial_segments != NULL);
+  assert_equals_int (file->partial_segments->len, 4);
+  file = g_ptr_array_index (file->partial_segments, 3);
+  assert_equals_string (file->uri, "http://media.example.com/seg101.3.mp4");
+  assert_equals_int64 (file->sequence, 101);
+  fail_if (file->independent);
+
+  /* The file being produced only has parts */
+  fail_unless (pl->partial_file != NULL);
+  assert_equals_int64 (pl->partial_file->sequence, 102);
+  assert_equals_int (pl->partial_file->partial_segments->len, 2);
+  assert_equals_uint64 (pl->partial_file->duration, GST_SECOND);
+  fail_unless (pl->preload_hint != NULL);
+  assert_equals_string (pl->preload_hint->uri,
+      "http://media.example.com/seg102.2.mp4");
+
+  /* Playback starts PART-HOLD-BACK from the live edge, at an independent
+   * part */
+  assert_equals_int64 (pl->sequence, 102);
+  assert_equals_int (pl->part, 0);
+  assert_equals_uint64 (pl->sequence_position, 4 * GST_SECOND);
+
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_string (file->uri, "http://media.example.com/seg102.0.mp4");
+  gst_m3u8_media_file_unref (file);
+
+  /* The preload hint follows the last part */
+  file = gst_m3u8_peek_fragment (pl, TRUE, 1);
+  assert_equals_string (file->uri, "http://media.example.com/seg102.1.mp4");
+  gst_m3u8_media_file_unref (file);
+  file = gst_m3u8_peek_fragment (pl, TRUE, 2);
+  fail_unless (file == pl->preload_hint);
+  gst_m3u8_media_file_unref (file);
+
+  fail_unless (gst_m3u8_has_next_fragment (pl, TRUE));
+  gst_m3u8_advance_fragment (pl, TRUE);
+  assert_equals_int (pl->part, 1);
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  assert_equals_string (file->uri, "http://media.example.com/seg102.1.mp4");
+  gst_m3u8_media_file_unref (file);
+
+  /* The next part isn't in the playlist yet */
+  fail_if (gst_m3u8_has_next_fragment (pl, TRUE));
+  gst_m3u8_advance_fragment (pl, TRUE);
+  fail_unless (gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL) == NULL);
+
+  /* Which is what the reload asks for */
+  assert_equals_uint64 (gst_m3u8_get_reload_interval (pl), 0);
+  uri = gst_m3u8_get_blocking_reload_uri (pl);
+  assert_equals_string (uri,
+      "http://localhost/test.m3u8?_HLS_msn=102&_HLS_part=2");
+  g_free (uri);
+
+  /* A failed reload, or one answered with nothing new, is followed by a
+   * regular reload instead of retrying right away */
+  gst_m3u8_reload_failed (pl);
+  assert_equals_uint64 (gst_m3u8_get_reload_interval (pl), GST_SECOND / 2);
+  fail_unless (gst_m3u8_update (pl, g_strdup (LOW_LATENCY_PLAYLIST)));
+  assert_equals_uint64 (gst_m3u8_get_reload_interval (pl), GST_SECOND / 2);
+
   gst_hls_master_playlist_unref (master);
 }
 
 GST_END_TEST;
 
+GST_START_TEST (test_low_latency_aes_128_playlist)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  gchar *uri;
+
+  master = load_playlist (LOW_LATENCY_AES_128_PLAYLIST);
+  pl = master->default_variant->m3u8;
+  fail_unless (pl->partial_file != NULL);
+
+  /* The parts of encrypted files are not played, the IV and the padding
+   * are those of the whole file */
+  assert_equals_int (pl->part, -1);
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_string (file->uri, "http://media.example.com/seg100.ts");
+  assert_equals_string (file->key, "https://priv.example.com/key.bin");
+  gst_m3u8_media_file_unref (file);
+  assert_equals_int (pl->part, -1);
+
+  /* Reloads wait for the next complete file */
+  uri = gst_m3u8_get_blocking_reload_uri (pl);
+  assert_equals_string (uri, "http://localhost/test.m3u8?_HLS_msn=102");
+  g_free (uri);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_write_low_latency_playlist)
+{
+  GstM3U8Playlist *writer;
+  GstM3U8MediaFile *file;
+  GstM3U8 *pl;
+  gchar *data;
+
+  writer = gst_m3u8_playlist_new (6, 5, FALSE);
+  writer->part_target = GST_SECOND / 2;
+  gst_m3u8_playlist_set_map (writer, "init00000.mp4");
+  gst_m3u8_playlist_add_part (writer, "segment00000.0.m4s", GST_SECOND / 2,
+      TRUE);
+  gst_m3u8_playlist_add_part (writer, "segment00000.1.m4s", GST_SECOND / 2,
+      FALSE);
+  gst_m3u8_playlist_add_entry (writer, "segment00000.m4s", NULL, NULL,
+      GST_SECOND, 0, FALSE);
+  gst_m3u8_playlist_add_part (writer, "segment00001.0.m4s", GST_SECOND / 2,
+      TRUE);
+
+  data = gst_m3u8_playlist_render (writer);
+  fail_unless (strstr (data, "#EXT-X-MAP:URI=\"init00000.mp4\"\n") != NULL);
+  fail_unless (strstr (data, "#EXT-X-PART-INF:PART-TARGET=0.5\n") != NULL);
+  gst_m3u8_playlist_free (writer);
+
+  /* What hlsdemux reads back from it */
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live.m3u8", NULL, NULL);
+  fail_unless (gst_m3u8_update (pl, data));
+  assert_equals_uint64 (pl->part_target, GST_SECOND / 2);
+  assert_equals_uint64 (pl->part_hold_back, 3 * GST_SECOND / 2);
+  assert_equals_int (pl->files->len, 1);
+  file = g_ptr_array_index (pl->files, 0);
+  assert_equals_string (file->init_file->uri,
+      "http://localhost/init00000.mp4");
+  assert_equals_int (file->partial_segments->len, 2);
+  file = g_ptr_array_index (file->partial_segments, 0);
+  fail_unless (file->independent);
+  fail_unless (pl->partial_file != NULL);
+  assert_equals_int64 (pl->partial_file->sequence, 1);
+  assert_equals_int (pl->partial_file->partial_segments->len, 1);
+  file = g_ptr_array_index (pl->partial_file->partial_segments, 0);
+  assert_equals_string (file->uri, "http://localhost/segment00001.0.m4s");
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_playlist_media_files)
 {
   GstHLSMasterPlaylist *master;
@@ -724,9 +1042,9 @@ GST_START_TEST (test_playlist_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -749,16 +1067,17 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 100);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -772,16 +1091,17 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 0);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -845,6 +1165,51 @@ GST_START_TEST (test_get_next_fragment)
 
 GST_END_TEST;
 
+GST_START_TEST (test_peek_fragment)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *mf;
+
+  master = load_playlist (BYTE_RANGES_PLAYLIST);
+  pl = master->default_variant->m3u8;
+
+  mf = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  /* Peeking doesn't advance */
+  mf = gst_m3u8_peek_fragment (pl, TRUE, 2);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 2000);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_peek_fragment (pl, TRUE, 1);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 1000);
+  gst_m3u8_media_file_unref (mf);
+
+  fail_unless (gst_m3u8_peek_fragment (pl, TRUE, 4) == NULL);
+  fail_unless (gst_m3u8_peek_fragment (pl, FALSE, 1) == NULL);
+
+  gst_m3u8_advance_fragment (pl, TRUE);
+
+  mf = gst_m3u8_peek_fragment (pl, TRUE, 0);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 1000);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_peek_fragment (pl, FALSE, 1);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_get_duration)
 {
   GstHLSMasterPlaylist *master;
@@ -1413,8 +1778,9 @@ GST_START_TEST (test_map_tag)
   GstHLSMasterPlaylist *master;
   GstHLSVariantStream *stream;
   GstM3U8 *m3u8;
-  GList *files, *walk;
+  GPtrArray *files;
   GstM3U8MediaFile *seg1, *seg2, *seg3;
+  guint i;
   GstM3U8InitFile *init1, *init2;
 
   /* Test EXT-X-MAP tag
@@ -1434,18 +1800,18 @@ GST_START_TEST (test_map_tag)
 
   files = m3u8->files;
   fail_unless (m3u8 != NULL);
-  assert_equals_int (g_list_length (files), 3);
-  for (walk = files; walk; walk = g_list_next (walk)) {
-    GstM3U8MediaFile *file = (GstM3U8MediaFile *) walk->data;
+  assert_equals_int (files->len, 3);
+  for (i = 0; i < files->len; i++) {
+    GstM3U8MediaFile *file = g_ptr_array_index (files, i);
 
     GstM3U8InitFile *init_file = file->init_file;
     fail_unless (init_file != NULL);
     fail_unless (init_file->uri != NULL);
   }
 
-  seg1 = g_list_nth_data (files, 0);
-  seg2 = g_list_nth_data (files, 1);
-  seg3 = g_list_nth_data (files, 2);
+  seg1 = g_ptr_array_index (files, 0);
+  seg2 = g_ptr_array_index (files, 1);
+  seg3 = g_ptr_array_index (files, 2);
 
   /* Segment 1 and 2 share the identical init segment */
   fail_unless (seg1->init_file == seg2->init_file);
@@ -1495,9 +1861,15 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
+  tcase_add_test (tc_m3u8, test_update_live_playlist_incremental);
+  tcase_add_test (tc_m3u8, test_update_live_playlist_relative_uris);
+  tcase_add_test (tc_m3u8, test_low_latency_playlist);
+  tcase_add_test (tc_m3u8, test_low_latency_aes_128_playlist);
+  tcase_add_test (tc_m3u8, test_write_low_latency_playlist);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
+  tcase_add_test (tc_m3u8, test_peek_fragment);
   tcase_add_test (tc_m3u8, test_get_duration);
   tcase_add_test (tc_m3u8, test_get_target_duration);
   tcase_add_test (tc_m3u8, test_get_stream_for_bitrate);
@@ -0,0 +1,261 @@
+/* GStreamer
+ *
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gst/check/gstcheck.h>
+
+#define FRAME_DURATION (500 * GST_MSECOND)
+#define FRAMES_PER_CAPS 4
+
+/* avcC with the SPS and PPS of a 128x128 stream. The second one only
+ * differs by a byte of its PPS, so both init segments have the same size */
+static const guint8 codec_data_1[] = {
+  0x01, 0x42, 0xc0, 0x0b, 0xff, 0xe1, 0x00, 0x0e,
+  0x67, 0x42, 0xc0, 0x0b, 0x8c, 0x8d, 0x41, 0x02,
+  0x24, 0x03, 0xc2, 0x21, 0x1a, 0x80, 0x01, 0x00,
+  0x04, 0x68, 0xce, 0x3c, 0x80
+};
+
+static const guint8 codec_data_2[] = {
+  0x01, 0x42, 0xc0, 0x0b, 0xff, 0xe1, 0x00, 0x0e,
+  0x67, 0x42, 0xc0, 0x0b, 0x8c, 0x8d, 0x41, 0x02,
+  0x24, 0x03, 0xc2, 0x21, 0x1a, 0x80, 0x01, 0x00,
+  0x04, 0x68, 0xce, 0x38, 0x80
+};
+
+/* a length-prefixed IDR slice */
+static const guint8 idr_frame[] = {
+  0x00, 0x00, 0x00, 0x05, 0x65, 0x88, 0x84, 0x00, 0x33
+};
+
+/* The files written by hlssink2, by location */
+static GHashTable *files;
+static GPtrArray *deleted;
+
+static GOutputStream *
+get_stream (GstElement * sink, const gchar * location, gpointer user_data)
+{
+  GOutputStream *stream = g_memory_output_stream_new_resizable ();
+
+  g_hash_table_insert (files, g_strdup (location), g_object_ref (stream));
+
+  return stream;
+}
+
+static void
+delete_fragment (GstElement * sink, const gchar * location, gpointer user_data)
+{
+  g_ptr_array_add (deleted, g_strdup (location));
+}
+
+static gboolean
+was_deleted (const gchar * location)
+{
+  guint i;
+
+  for (i = 0; i < deleted->len; i++) {
+    if (g_str_equal (g_ptr_array_index (deleted, i), location))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Returns the types of the top-level boxes of the file at @location */
+static GArray *
+get_boxes (const gchar * location)
+{
+  GMemoryOutputStream *stream = g_hash_table_lookup (files, location);
+  GArray *boxes = g_array_new (FALSE, FALSE, sizeof (guint32));
+  const guint8 *data;
+  gsize size;
+
+  fail_unless (stream != NULL, "%s was not written", location);
+  data = g_memory_output_stream_get_data (stream);
+  size = g_memory_output_stream_get_data_size (stream);
+
+  while (size >= 8) {
+    guint32 box_size = GST_READ_UINT32_BE (data);
+    guint32 type = GST_READ_UINT32_LE (data + 4);
+
+    fail_unless (box_size >= 8 && box_size <= size);
+    g_array_append_val (boxes, type);
+    data += box_size;
+    size -= box_size;
+  }
+  fail_unless_equals_int (size, 0);
+
+  return boxes;
+}
+
+static gboolean
+file_contains (const gchar * location, const guint8 * needle, gsize len)
+{
+  GMemoryOutputStream *stream = g_hash_table_lookup (files, location);
+  const guint8 *data = g_memory_output_stream_get_data (stream);
+  gsize size = g_memory_output_stream_get_data_size (stream);
+  gsize i;
+
+  for (i = 0; i + len <= size; i++) {
+    if (memcmp (data + i, needle, len) == 0)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static GstCaps *
+create_caps (const guint8 * codec_data, gsize size)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+  GstCaps *caps;
+
+  gst_buffer_fill (buf, 0, codec_data, size);
+
+  caps = gst_caps_new_simple ("video/x-h264",
+      "stream-format", G_TYPE_STRING, "avc",
+      "alignment", G_TYPE_STRING, "au",
+      "width", G_TYPE_INT, 128, "height", G_TYPE_INT, 128,
+      "framerate", GST_TYPE_FRACTION, 2, 1,
+      "codec_data", GST_TYPE_BUFFER, buf, NULL);
+  gst_buffer_unref (buf);
+
+  return caps;
+}
+
+static void
+push_frames (GstHarness * h, guint * n)
+{
+  guint i;
+
+  for (i = 0; i < FRAMES_PER_CAPS; i++, (*n)++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, sizeof (idr_frame), NULL);
+
+    gst_buffer_fill (buf, 0, idr_frame, sizeof (idr_frame));
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = *n * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (test_cmaf_init_segment)
+{
+  GstElement *mp4mux;
+  GstHarness *h;
+  GArray *boxes;
+  guint n = 0, i;
+  gchar *location;
+
+  mp4mux = gst_element_factory_make ("mp4mux", NULL);
+  if (mp4mux == NULL) {
+    GST_INFO ("Skipping test, mp4mux is not available");
+    return;
+  }
+  gst_object_unref (mp4mux);
+
+  files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_object_unref);
+  deleted = g_ptr_array_new_with_free_func (g_free);
+
+  h = gst_harness_new_with_padnames ("hlssink2", "video", NULL);
+  gst_util_set_object_arg (G_OBJECT (h->element), "muxer-type", "cmaf");
+  g_object_set (h->element, "location", "segment%05d.m4s",
+      "target-duration", 1,
+      "max-files", 2, "send-keyframe-requests", FALSE, NULL);
+  g_signal_connect (h->element, "get-playlist-stream",
+      G_CALLBACK (get_stream), NULL);
+  g_signal_connect (h->element, "get-fragment-stream",
+      G_CALLBACK (get_stream), NULL);
+  g_signal_connect (h->element, "delete-fragment",
+      G_CALLBACK (delete_fragment), NULL);
+
+  gst_harness_set_src_caps (h, create_caps (codec_data_1,
+          sizeof (codec_data_1)));
+  push_frames (h, &n);
+
+  /* same size, different content */
+  fail_unless (gst_harness_push_event (h,
+          gst_event_new_caps (create_caps (codec_data_2,
+                  sizeof (codec_data_2)))));
+  push_frames (h, &n);
+
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  /* the init segments only hold the ftyp and moov */
+  for (i = 0; i < 2; i++) {
+    location = g_strdup_printf ("init%05d.mp4", i);
+    boxes = get_boxes (location);
+    fail_unless_equals_int (boxes->len, 2);
+    fail_unless_equals_int (g_array_index (boxes, guint32, 0),
+        GST_MAKE_FOURCC ('f', 't', 'y', 'p'));
+    fail_unless_equals_int (g_array_index (boxes, guint32, 1),
+        GST_MAKE_FOURCC ('m', 'o', 'o', 'v'));
+    g_array_unref (boxes);
+    g_free (location);
+  }
+
+  /* the caps change produced a new one, and no other init segment was
+   * written as the following segments only differ by their times */
+  fail_unless (file_contains ("init00000.mp4", codec_data_1,
+          sizeof (codec_data_1)));
+  fail_unless (file_contains ("init00001.mp4", codec_data_2,
+          sizeof (codec_data_2)));
+  fail_if (g_hash_table_contains (files, "init00002.mp4"));
+
+  /* the segments hold the fragments */
+  for (i = 0; i < 2 * FRAMES_PER_CAPS * FRAME_DURATION / GST_SECOND; i++) {
+    location = g_strdup_printf ("segment%05d.m4s", i);
+    boxes = get_boxes (location);
+    fail_unless (boxes->len > 0);
+    fail_if (g_array_index (boxes, guint32, 0) ==
+        GST_MAKE_FOURCC ('f', 't', 'y', 'p'));
+    fail_if (g_array_index (boxes, guint32, 0) ==
+        GST_MAKE_FOURCC ('m', 'o', 'o', 'v'));
+    g_array_unref (boxes);
+    g_free (location);
+  }
+
+  /* the first init segment goes along with the last segment using it */
+  fail_unless (was_deleted ("segment00001.m4s"));
+  fail_unless (was_deleted ("init00000.mp4"));
+  fail_if (was_deleted ("init00001.mp4"));
+
+  gst_harness_teardown (h);
+  g_hash_table_unref (files);
+  g_ptr_array_unref (deleted);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink2_suite (void)
+{
+  Suite *s = suite_create ("hlssink2");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_cmaf_init_segment);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink2);
@@ -18,9 +18,16 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <string.h>
+
+#include <glib/gstdio.h>
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
+#include <gst/mpegts/mpegts.h>
+
+/* The index is internal to the plugin */
+#include "../../../gst/mpegtsdemux/mpegtsindex.c"
 
 #define PACKETSIZE 188
 
@@ -335,6 +342,41 @@ GST_START_TEST (test_tsparse_padding)
 
 GST_END_TEST;
 
+GST_START_TEST (test_tsparse_async_sections)
+{
+  GstHarness *h =
+      gst_harness_new_with_padnames ("tsparse", "sink", "program_1");
+  GstBuffer *buf;
+  gsize size;
+  guint i;
+
+  /* the section packets are pushed on the program pads while the sections
+   * are handled on the section thread */
+  gst_harness_set (h, "tsparse", "async-sections", TRUE, NULL);
+
+  gst_harness_set_src_caps_str (h, "video/mpegts,systemstream=true");
+
+  for (i = 0; i < 10; i++) {
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (guint8 *) aac_ts, sizeof aac_ts, 0, sizeof aac_ts, NULL, NULL);
+    fail_unless (gst_harness_push (h, buf) == GST_FLOW_OK);
+  }
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  buf = gst_harness_take_all_data_as_buffer (h);
+  size = gst_buffer_get_size (buf);
+  fail_unless (size > 0);
+  fail_unless (size % PACKETSIZE == 0);
+  fail_unless (size <= 10 * sizeof aac_ts);
+  /* starts with the PAT */
+  fail_unless (gst_buffer_memcmp (buf, 0, aac_ts, PACKETSIZE) == 0);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static void
 tsdemux_simple_pad_added (GstElement * tsdemux, GstPad * pad, GstHarness * h)
 {
@@ -377,12 +419,679 @@ GST_START_TEST (test_tsdemux_simple)
 
 GST_END_TEST;
 
+#define TEST_PMT_PID 0x20
+#define TEST_ES_PID 0x41
+
+/* Appends one TS packet to @ts, with as much of @data as fits. A PCR
+ * (in 90kHz units) is added if @pcr is not -1. Returns the number of bytes
+ * of @data that were used */
+static gsize
+append_ts_packet (GByteArray * ts, guint16 pid, gboolean pusi, guint8 * cc,
+    gint64 pcr, const guint8 * data, gsize len)
+{
+  guint8 pkt[PACKETSIZE];
+  guint af_size = pcr >= 0 ? 8 : 0;
+  gsize payload;
+
+  payload = MIN (len, PACKETSIZE - 4 - af_size);
+  /* Fill the rest of the packet with adaptation field stuffing */
+  if (payload < PACKETSIZE - 4 - af_size)
+    af_size = PACKETSIZE - 4 - payload;
+
+  memset (pkt, 0xff, sizeof pkt);
+  pkt[0] = 0x47;
+  pkt[1] = (pusi ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+  pkt[2] = pid & 0xff;
+  pkt[3] = (af_size ? 0x30 : 0x10) | (*cc & 0x0f);
+  *cc = (*cc + 1) & 0x0f;
+
+  if (af_size) {
+    pkt[4] = af_size - 1;
+    if (af_size > 1)
+      pkt[5] = 0x00;
+    if (pcr >= 0) {
+      pkt[5] = 0x10;
+      pkt[6] = (pcr >> 25) & 0xff;
+      pkt[7] = (pcr >> 17) & 0xff;
+      pkt[8] = (pcr >> 9) & 0xff;
+      pkt[9] = (pcr >> 1) & 0xff;
+      pkt[10] = ((pcr & 0x1) << 7) | 0x7e;
+      pkt[11] = 0x00;
+    }
+  }
+
+  memcpy (pkt + 4 + af_size, data, payload);
+  g_byte_array_append (ts, pkt, sizeof pkt);
+
+  return payload;
+}
+
+static void
+append_ts_section (GByteArray * ts, GstMpegtsSection * section, guint16 pid,
+    guint8 * cc)
+{
+  guint8 buf[PACKETSIZE];
+  guint8 *data;
+  gsize size;
+
+  data = gst_mpegts_section_packetize (section, &size);
+  fail_unless (data != NULL);
+  fail_unless (size < PACKETSIZE - 5);
+
+  /* pointer_field, then the section, padded with 0xff */
+  memset (buf, 0xff, sizeof buf);
+  buf[0] = 0x00;
+  memcpy (buf + 1, data, size);
+  append_ts_packet (ts, pid, TRUE, cc, -1, buf, PACKETSIZE - 4);
+
+  gst_mpegts_section_unref (section);
+}
+
+/* PAT and PMT of a single program carrying one stream of @stream_type on
+ * TEST_ES_PID, which is also the PCR PID */
+static void
+append_ts_tables (GByteArray * ts, guint8 stream_type, const gchar * reg_id)
+{
+  GPtrArray *pat = gst_mpegts_pat_new ();
+  GstMpegtsPatProgram *program = gst_mpegts_pat_program_new ();
+  GstMpegtsPMT *pmt = gst_mpegts_pmt_new ();
+  GstMpegtsPMTStream *stream = gst_mpegts_pmt_stream_new ();
+  guint8 pat_cc = 0, pmt_cc = 0;
+
+  program->program_number = 1;
+  program->network_or_program_map_PID = TEST_PMT_PID;
+  g_ptr_array_add (pat, program);
+  append_ts_section (ts, gst_mpegts_section_from_pat (pat, 1), 0x00, &pat_cc);
+
+  pmt->program_number = 1;
+  pmt->pcr_pid = TEST_ES_PID;
+  stream->stream_type = stream_type;
+  stream->pid = TEST_ES_PID;
+  if (reg_id)
+    g_ptr_array_add (stream->descriptors,
+        gst_mpegts_descriptor_from_registration (reg_id, NULL, 0));
+  g_ptr_array_add (pmt->streams, stream);
+  append_ts_section (ts, gst_mpegts_section_from_pmt (pmt, TEST_PMT_PID),
+      TEST_PMT_PID, &pmt_cc);
+}
+
+/* Appends one PES with a PTS (in 90kHz units) on TEST_ES_PID. The first
+ * packet carries @pcr if it is not -1 */
+static void
+append_ts_pes (GByteArray * ts, guint8 * cc, guint8 stream_id, guint64 pts,
+    gint64 pcr, const guint8 * payload, gsize len)
+{
+  GByteArray *pes = g_byte_array_new ();
+  guint8 hdr[14];
+  gsize offset = 0;
+
+  hdr[0] = 0x00;
+  hdr[1] = 0x00;
+  hdr[2] = 0x01;
+  hdr[3] = stream_id;
+  hdr[4] = ((len + 8) >> 8) & 0xff;
+  hdr[5] = (len + 8) & 0xff;
+  hdr[6] = 0x80;
+  hdr[7] = 0x80;
+  hdr[8] = 5;
+  hdr[9] = 0x21 | ((pts >> 29) & 0x0e);
+  hdr[10] = (pts >> 22) & 0xff;
+  hdr[11] = ((pts >> 14) & 0xfe) | 0x01;
+  hdr[12] = (pts >> 7) & 0xff;
+  hdr[13] = ((pts << 1) & 0xfe) | 0x01;
+  g_byte_array_append (pes, hdr, sizeof hdr);
+  g_byte_array_append (pes, payload, len);
+
+  while (offset < pes->len) {
+    offset += append_ts_packet (ts, TEST_ES_PID, offset == 0, cc,
+        offset == 0 ? pcr : -1, pes->data + offset, pes->len - offset);
+  }
+
+  g_byte_array_unref (pes);
+}
+
+static void
+tsdemux_pad_added (GstElement * tsdemux, GstPad * pad, GstHarness * h)
+{
+  gst_harness_add_element_src_pad (h, pad);
+}
+
+/* Live input comes with a TIME segment and arrival timestamps */
+static GstHarness *
+tsdemux_harness_new (GstFormat format)
+{
+  GstHarness *h = gst_harness_new_with_padnames ("tsdemux", "sink", NULL);
+  GstCaps *caps;
+  GstSegment segment;
+
+  caps = gst_caps_from_string ("video/mpegts,systemstream=true");
+  gst_harness_push_event (h, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, format);
+  gst_harness_push_event (h, gst_event_new_segment (&segment));
+
+  g_signal_connect (h->element, "pad-added",
+      G_CALLBACK (tsdemux_pad_added), h);
+
+  return h;
+}
+
+static GstFlowReturn
+tsdemux_harness_push_ts (GstHarness * h, GByteArray * ts)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, ts->len, NULL);
+
+  gst_buffer_fill (buf, 0, ts->data, ts->len);
+
+  return gst_harness_push (h, buf);
+}
+
+GST_START_TEST (test_tsdemux_large_pes_single_buffer)
+{
+  GstHarness *h = tsdemux_harness_new (GST_FORMAT_BYTES);
+  GByteArray *ts = g_byte_array_new ();
+  guint8 small[100], large[4000];
+  GstBuffer *buf1, *buf2;
+  guint8 cc = 0;
+  guint i;
+
+  for (i = 0; i < sizeof large; i++)
+    large[i] = i & 0xff;
+  memset (small, 0x42, sizeof small);
+
+  /* KLV is output with parsed=TRUE, one PES has to be one buffer even with
+   * zero-copy enabled. The large PES needs more TS packets than a buffer can
+   * hold memories */
+  g_object_set (h->element, "zero-copy", TRUE, NULL);
+  gst_harness_set_sink_caps_str (h, "meta/x-klv,parsed=true");
+
+  append_ts_tables (ts, GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS, "KLVA");
+  append_ts_pes (ts, &cc, 0xbd, 90000, 81000, small, sizeof small);
+  append_ts_pes (ts, &cc, 0xbd, 99000, 90000, large, sizeof large);
+  fail_unless (sizeof large / (PACKETSIZE - 4) > gst_buffer_get_max_memory ());
+
+  fail_unless (tsdemux_harness_push_ts (h, ts) == GST_FLOW_OK);
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  fail_unless_equals_int (gst_harness_buffers_received (h), 2);
+  buf1 = gst_harness_pull (h);
+  buf2 = gst_harness_pull (h);
+
+  gst_check_buffer_data (buf1, small, sizeof small);
+  gst_check_buffer_data (buf2, large, sizeof large);
+  fail_unless (GST_BUFFER_PTS_IS_VALID (buf1));
+  fail_unless (GST_BUFFER_PTS_IS_VALID (buf2));
+  fail_unless_equals_clocktime (GST_BUFFER_PTS (buf2) - GST_BUFFER_PTS (buf1),
+      100 * GST_MSECOND);
+
+  gst_buffer_unref (buf1);
+  gst_buffer_unref (buf2);
+  g_byte_array_unref (ts);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Number of PES in the indexed stream, one every 100ms, with a keyframe
+ * every second */
+#define INDEX_N_PES 80
+#define INDEX_KEYFRAME_INTERVAL 10
+
+static const guint8 h264_idr[] = {
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00, 0x33
+};
+
+static const guint8 h264_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x02, 0x04
+};
+
+/* Writes an H.264 stream to a temporary file, and stores the offsets of
+ * the keyframe PES in @keyframe_offsets */
+static gchar *
+create_indexed_ts_file (guint64 * keyframe_offsets, gsize * size)
+{
+  GByteArray *ts = g_byte_array_new ();
+  GError *err = NULL;
+  gchar *location;
+  guint8 cc = 0;
+  gint fd;
+  guint i;
+
+  append_ts_tables (ts, GST_MPEGTS_STREAM_TYPE_VIDEO_H264, NULL);
+  for (i = 0; i < INDEX_N_PES; i++) {
+    guint64 pts = 90000 + i * 9000;
+
+    if (i % INDEX_KEYFRAME_INTERVAL == 0) {
+      keyframe_offsets[i / INDEX_KEYFRAME_INTERVAL] = ts->len;
+      append_ts_pes (ts, &cc, 0xe0, pts, pts - 9000, h264_idr,
+          sizeof h264_idr);
+    } else {
+      append_ts_pes (ts, &cc, 0xe0, pts, pts - 9000, h264_slice,
+          sizeof h264_slice);
+    }
+  }
+
+  fd = g_file_open_tmp ("tsdemux-index-XXXXXX.ts", &location, &err);
+  fail_unless (fd >= 0, "Could not create a file: %s", err ? err->message : "");
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (location, (const gchar *) ts->data,
+          ts->len, NULL));
+
+  *size = ts->len;
+  g_byte_array_unref (ts);
+
+  return location;
+}
+
+typedef struct
+{
+  GMutex lock;
+  /* the buffers received since the last flush */
+  GPtrArray *buffers;
+} IndexTestData;
+
+static GstPadProbeReturn
+index_sink_probe (GstPad * pad, GstPadProbeInfo * info, IndexTestData * data)
+{
+  g_mutex_lock (&data->lock);
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+    g_ptr_array_add (data->buffers,
+        gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) ==
+      GST_EVENT_FLUSH_STOP)
+    g_ptr_array_set_size (data->buffers, 0);
+  g_mutex_unlock (&data->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+index_pad_added (GstElement * tsdemux, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+/* filesrc ! tsdemux ! fakesink, tsdemux operates in pull mode */
+static GstElement *
+index_pipeline_new (const gchar * location, const gchar * index_location,
+    gboolean zero_copy, IndexTestData * data)
+{
+  GstElement *pipeline, *src, *demux, *sink;
+  GstPad *sinkpad;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make ("tsdemux", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (src && demux && sink);
+
+  g_object_set (src, "location", location, NULL);
+  g_object_set (demux, "index-location", index_location, "zero-copy",
+      zero_copy, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, sink, NULL);
+  fail_unless (gst_element_link (src, demux));
+  g_signal_connect (demux, "pad-added", G_CALLBACK (index_pad_added), sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+      (GstPadProbeCallback) index_sink_probe, data, NULL);
+  gst_object_unref (sinkpad);
+
+  return pipeline;
+}
+
+static void
+index_pipeline_run (GstElement * pipeline)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* the index is saved when stopping */
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+}
+
+static gboolean
+buffer_is_idr (GstBuffer * buf)
+{
+  return gst_buffer_get_size (buf) == sizeof h264_idr
+      && gst_buffer_memcmp (buf, 0, h264_idr, sizeof h264_idr) == 0;
+}
+
+static void
+check_index_build (gboolean zero_copy)
+{
+  guint64 keyframe_offsets[INDEX_N_PES / INDEX_KEYFRAME_INTERVAL];
+  IndexTestData data;
+  GstElement *pipeline;
+  MpegTSIndex *index;
+  GError *err = NULL;
+  gchar *location, *index_location;
+  gsize size;
+  guint i;
+
+  g_mutex_init (&data.lock);
+  data.buffers = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) gst_buffer_unref);
+
+  location = create_indexed_ts_file (keyframe_offsets, &size);
+  index_location = g_strconcat (location, ".index", NULL);
+
+  pipeline = index_pipeline_new (location, index_location, zero_copy, &data);
+  index_pipeline_run (pipeline);
+  gst_object_unref (pipeline);
+  fail_unless_equals_int (data.buffers->len, INDEX_N_PES);
+
+  /* the keyframes are indexed at the start of their PES */
+  index = mpegts_index_load (index_location, size, TEST_ES_PID, &err);
+  fail_unless (index != NULL, "Could not load the index: %s",
+      err ? err->message : "");
+  fail_unless_equals_int (index->keyframes->len,
+      G_N_ELEMENTS (keyframe_offsets));
+  for (i = 0; i < index->keyframes->len; i++) {
+    MpegTSIndexEntry *entry =
+        &g_array_index (index->keyframes, MpegTSIndexEntry, i);
+
+    fail_unless_equals_uint64 (entry->offset, keyframe_offsets[i]);
+    fail_unless (entry->flags & MPEGTS_INDEX_ENTRY_KEYFRAME);
+    if (i > 0)
+      fail_unless_equals_clocktime (entry->ts - (entry - 1)->ts, GST_SECOND);
+  }
+
+  /* the PCR observations are sparse */
+  fail_unless (index->pcrs->len > 1);
+  fail_unless (index->pcrs->len < INDEX_N_PES);
+  for (i = 1; i < index->pcrs->len; i++) {
+    MpegTSIndexEntry *entry = &g_array_index (index->pcrs, MpegTSIndexEntry, i);
+
+    fail_unless (entry->ts - (entry - 1)->ts >= GST_SECOND);
+    fail_unless (entry->offset > (entry - 1)->offset);
+  }
+  mpegts_index_free (index);
+
+  /* an index is only valid for the file it was built from */
+  fail_if (mpegts_index_load (index_location, size + PACKETSIZE, TEST_ES_PID,
+          &err));
+  g_clear_error (&err);
+
+  g_unlink (index_location);
+  g_unlink (location);
+  g_free (index_location);
+  g_free (location);
+  g_ptr_array_unref (data.buffers);
+  g_mutex_clear (&data.lock);
+}
+
+GST_START_TEST (test_tsdemux_index_build)
+{
+  check_index_build (FALSE);
+}
+
+GST_END_TEST;
+
+/* The payload of the keyframes is only available as the collected buffers */
+GST_START_TEST (test_tsdemux_index_build_zero_copy)
+{
+  check_index_build (TRUE);
+}
+
+GST_END_TEST;
+
+static void
+check_index_entries (GArray * entries, GArray * expected)
+{
+  guint i;
+
+  fail_unless_equals_int (entries->len, expected->len);
+  for (i = 0; i < entries->len; i++) {
+    MpegTSIndexEntry *entry = &g_array_index (entries, MpegTSIndexEntry, i);
+    MpegTSIndexEntry *exp = &g_array_index (expected, MpegTSIndexEntry, i);
+
+    fail_unless_equals_clocktime (entry->ts, exp->ts);
+    fail_unless_equals_uint64 (entry->offset, exp->offset);
+    fail_unless_equals_int (entry->flags, exp->flags);
+  }
+}
+
+GST_START_TEST (test_tsdemux_index_save_load)
+{
+  MpegTSIndex *index, *loaded;
+  MpegTSIndexEntry entry;
+  GError *err = NULL;
+  gchar *location, *contents;
+  guint8 swapped[16];
+  gsize size;
+  gint fd;
+
+  index = mpegts_index_new (1000 * PACKETSIZE, TEST_ES_PID);
+  fail_if (index->dirty);
+
+  /* at most one PCR entry per second */
+  mpegts_index_add_pcr (index, 0, 0);
+  mpegts_index_add_pcr (index, 500 * GST_MSECOND, 10 * PACKETSIZE);
+  mpegts_index_add_pcr (index, GST_SECOND, 20 * PACKETSIZE);
+  mpegts_index_add_pcr (index, 2 * GST_SECOND, 40 * PACKETSIZE);
+  fail_unless_equals_int (index->pcrs->len, 3);
+
+  /* keyframes are all kept, also when added out of order, but not when the
+   * offsets are not in the same order as the times */
+  mpegts_index_add_keyframe (index, GST_SECOND, 20 * PACKETSIZE);
+  mpegts_index_add_keyframe (index, 100 * GST_MSECOND, 2 * PACKETSIZE);
+  mpegts_index_add_keyframe (index, 500 * GST_MSECOND, 30 * PACKETSIZE);
+  mpegts_index_add_keyframe (index, 2 * GST_SECOND, 40 * PACKETSIZE);
+  fail_unless_equals_int (index->keyframes->len, 3);
+  fail_unless (index->dirty);
+
+  fd = g_file_open_tmp ("tsdemux-index-XXXXXX", &location, &err);
+  fail_unless (fd >= 0, "Could not create a file: %s", err ? err->message : "");
+  g_close (fd, NULL);
+  fail_unless (mpegts_index_save (index, location, NULL));
+  fail_if (index->dirty);
+
+  loaded = mpegts_index_load (location, 1000 * PACKETSIZE, TEST_ES_PID, NULL);
+  fail_unless (loaded != NULL);
+  fail_if (loaded->dirty);
+  check_index_entries (loaded->pcrs, index->pcrs);
+  check_index_entries (loaded->keyframes, index->keyframes);
+
+  /* lookups return the last entry at or before the time */
+  fail_if (mpegts_index_lookup (loaded, 50 * GST_MSECOND, TRUE, &entry));
+  fail_unless (mpegts_index_lookup (loaded, 1500 * GST_MSECOND, TRUE,
+          &entry));
+  fail_unless_equals_clocktime (entry.ts, GST_SECOND);
+  fail_unless_equals_uint64 (entry.offset, 20 * PACKETSIZE);
+  fail_unless (mpegts_index_lookup (loaded, 10 * GST_SECOND, FALSE, &entry));
+  fail_unless_equals_clocktime (entry.ts, 2 * GST_SECOND);
+  fail_unless_equals_uint64 (entry.offset, 40 * PACKETSIZE);
+
+  /* the index of another file or PCR PID is rejected */
+  fail_if (mpegts_index_load (location, 1001 * PACKETSIZE, TEST_ES_PID, &err));
+  g_clear_error (&err);
+  fail_if (mpegts_index_load (location, 1000 * PACKETSIZE, TEST_PMT_PID,
+          &err));
+  g_clear_error (&err);
+
+  /* so are truncated or padded entries */
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  fail_unless_equals_int (size, 28 + 6 * 16);
+  contents = g_realloc (contents, size + 15);
+  memset (contents + size, 0, 15);
+  fail_unless (g_file_set_contents (location, contents, size + 15, NULL));
+  fail_if (mpegts_index_load (location, 1000 * PACKETSIZE, TEST_ES_PID, &err));
+  g_clear_error (&err);
+  fail_unless (g_file_set_contents (location, contents, size - 1, NULL));
+  fail_if (mpegts_index_load (location, 1000 * PACKETSIZE, TEST_ES_PID, &err));
+  g_clear_error (&err);
+
+  /* and entries that are not sorted, the first two keyframes are swapped */
+  memcpy (swapped, contents + 28 + 3 * 16, 16);
+  memmove (contents + 28 + 3 * 16, contents + 28 + 4 * 16, 16);
+  memcpy (contents + 28 + 4 * 16, swapped, 16);
+  fail_unless (g_file_set_contents (location, contents, size, NULL));
+  fail_if (mpegts_index_load (location, 1000 * PACKETSIZE, TEST_ES_PID, &err));
+  g_clear_error (&err);
+  g_free (contents);
+
+  mpegts_index_free (loaded);
+  mpegts_index_free (index);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_tsdemux_index_seek)
+{
+  guint64 keyframe_offsets[INDEX_N_PES / INDEX_KEYFRAME_INTERVAL];
+  IndexTestData data;
+  GstElement *pipeline;
+  GstClockTime first_pts;
+  GstBuffer *buf;
+  gchar *location, *index_location;
+  gsize size;
+
+  g_mutex_init (&data.lock);
+  data.buffers = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) gst_buffer_unref);
+
+  location = create_indexed_ts_file (keyframe_offsets, &size);
+  index_location = g_strconcat (location, ".index", NULL);
+
+  /* build the index */
+  pipeline = index_pipeline_new (location, index_location, FALSE, &data);
+  index_pipeline_run (pipeline);
+  gst_object_unref (pipeline);
+  fail_unless (g_file_test (index_location, G_FILE_TEST_EXISTS));
+  buf = g_ptr_array_index (data.buffers, 0);
+  fail_unless (buffer_is_idr (buf));
+  first_pts = GST_BUFFER_PTS (buf);
+  g_ptr_array_set_size (data.buffers, 0);
+
+  /* Seek through the loaded index. Without it, playback would restart
+   * SEEK_TIMESTAMP_OFFSET before the target, on a delta frame */
+  pipeline = index_pipeline_new (location, index_location, FALSE, &data);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, 5700 * GST_MSECOND));
+  index_pipeline_run (pipeline);
+  gst_object_unref (pipeline);
+
+  /* playback restarted from the keyframe before the target */
+  fail_unless_equals_int (data.buffers->len, INDEX_N_PES - 50);
+  buf = g_ptr_array_index (data.buffers, 0);
+  fail_unless (buffer_is_idr (buf));
+  fail_unless_equals_clocktime (GST_BUFFER_PTS (buf) - first_pts,
+      5 * GST_SECOND);
+
+  g_unlink (index_location);
+  g_unlink (location);
+  g_free (index_location);
+  g_free (location);
+  g_ptr_array_unref (data.buffers);
+  g_mutex_clear (&data.lock);
+}
+
+GST_END_TEST;
+
+/* Pushes one PES per buffer, arriving at @in_time with its PCR equal to
+ * its PTS, so an access unit is only output when the next one arrives */
+static void
+push_live_pes (GstHarness * h, guint8 * cc, GstClockTime in_time)
+{
+  GByteArray *ts = g_byte_array_new ();
+  guint64 pts = 90000 + gst_util_uint64_scale (in_time, 90000, GST_SECOND);
+  GstBuffer *buf;
+
+  append_ts_pes (ts, cc, 0xe0, pts, pts, h264_slice, sizeof h264_slice);
+  buf = gst_buffer_new_allocate (NULL, ts->len, NULL);
+  gst_buffer_fill (buf, 0, ts->data, ts->len);
+  GST_BUFFER_DTS (buf) = in_time;
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  g_byte_array_unref (ts);
+}
+
+GST_START_TEST (test_tsdemux_measured_latency)
+{
+  GstHarness *h = tsdemux_harness_new (GST_FORMAT_TIME);
+  GByteArray *ts = g_byte_array_new ();
+  GstBus *bus = gst_bus_new ();
+  GstClockTime latency, in_time = 0;
+  GstMessage *msg;
+  guint8 cc = 0;
+  guint i;
+
+  g_object_set (h->element, "measure-latency", TRUE, NULL);
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_upstream_latency (h, 0);
+
+  append_ts_tables (ts, GST_MPEGTS_STREAM_TYPE_VIDEO_H264, NULL);
+  fail_unless (tsdemux_harness_push_ts (h, ts) == GST_FLOW_OK);
+  g_byte_array_unref (ts);
+
+  /* one access unit every 100ms, each is output 100ms late */
+  for (i = 0; i < 10; i++, in_time += 100 * GST_MSECOND)
+    push_live_pes (h, &cc, in_time);
+  fail_unless (gst_harness_buffers_received (h) > 0);
+
+  /* the measured value with its margin, not the default 700ms */
+  latency = gst_harness_query_latency (h);
+  fail_unless (latency > 100 * GST_MSECOND, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+  fail_unless (latency < 200 * GST_MSECOND, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_LATENCY);
+  fail_unless (msg == NULL);
+
+  /* one access unit every 500ms: the latency grows and is posted */
+  for (i = 0; i < 4; i++, in_time += 500 * GST_MSECOND)
+    push_live_pes (h, &cc, in_time);
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_LATENCY);
+  fail_unless (msg != NULL);
+  fail_unless (GST_MESSAGE_SRC (msg) == GST_OBJECT (h->element));
+  gst_message_unref (msg);
+
+  latency = gst_harness_query_latency (h);
+  fail_unless (latency > 500 * GST_MSECOND, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+  fail_unless (latency < 700 * GST_MSECOND, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsdemux_suite (void)
 {
   Suite *s = suite_create ("mpegtsdemux");
   TCase *tc;
 
+  gst_mpegts_initialize ();
+  init_mpegts_index ();
+
   tc = tcase_create ("tsparse");
   suite_add_tcase (s, tc);
   tcase_add_test (tc, test_tsparse_simple);
@@ -390,10 +1099,17 @@ mpegtsdemux_suite (void)
   tcase_add_test (tc, test_tsparse_align_fuse);
   tcase_add_test (tc, test_tsparse_align_split);
   tcase_add_test (tc, test_tsparse_padding);
+  tcase_add_test (tc, test_tsparse_async_sections);
 
   tc = tcase_create ("tsdemux");
   suite_add_tcase (s, tc);
   tcase_add_test (tc, test_tsdemux_simple);
+  tcase_add_test (tc, test_tsdemux_large_pes_single_buffer);
+  tcase_add_test (tc, test_tsdemux_index_build);
+  tcase_add_test (tc, test_tsdemux_index_build_zero_copy);
+  tcase_add_test (tc, test_tsdemux_index_save_load);
+  tcase_add_test (tc, test_tsdemux_index_seek);
+  tcase_add_test (tc, test_tsdemux_measured_latency);
 
   return s;
 }
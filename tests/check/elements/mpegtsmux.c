@@ -19,6 +19,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include <string.h>
 #include <gst/video/video.h>
 
@@ -557,6 +558,15 @@ GST_START_TEST (test_align)
 
 GST_END_TEST;
 
+GST_START_TEST (test_align_audio)
+{
+  /* few packets, so that the last output buffer gets padded on drain */
+  check_tsmux_pad (&audio_src_template, AUDIO_CAPS_STRING, 0xC0, 0x03,
+      "sink_%d", test_align_check_output, 3, 1, 7);
+}
+
+GST_END_TEST;
+
 static void
 test_keyframe_propagation_check_output (GList * bufs)
 {
@@ -586,6 +596,116 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+#define CBR_BITRATE 1000000
+#define CBR_PCR_INTERVAL 1800
+
+/* Returns the PCR (in 27MHz units) of the packet, or -1 */
+static gint64
+get_packet_pcr (const guint8 * data)
+{
+  guint64 base;
+
+  /* adaptation field with a PCR */
+  if (!(data[3] & 0x20) || data[4] == 0 || !(data[5] & 0x10))
+    return -1;
+
+  base = ((guint64) data[6] << 25) | (data[7] << 17) | (data[8] << 9) |
+      (data[9] << 1) | (data[10] >> 7);
+
+  return base * 300 + (((data[10] & 0x01) << 8) | data[11]);
+}
+
+GST_START_TEST (test_cbr_packet_clock)
+{
+  GstHarness *h = gst_harness_new_with_padnames ("mpegtsmux", "sink_%d",
+      "src");
+  GstClockTime first_pts = GST_CLOCK_TIME_NONE;
+  gint64 pcr, first_pcr = -1, last_pcr = -1;
+  guint64 first_pcr_offset = 0, pcr_packet_ticks;
+  guint n_pcrs = 0, n_null = 0, n_packets, i;
+  gint pcr_pid = -1;
+
+  g_object_set (h->element, "bitrate", (guint64) CBR_BITRATE,
+      "pcr-interval", CBR_PCR_INTERVAL, "alignment", 1, NULL);
+  gst_harness_set_src_caps_str (h, AUDIO_CAPS_STRING);
+
+  /* 1s of audio, one small frame every 20ms */
+  for (i = 0; i < 50; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 100, NULL);
+
+    gst_buffer_memset (buf, 0, 0, 100);
+    GST_BUFFER_PTS (buf) = i * 20 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 20 * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  pcr_packet_ticks = gst_util_uint64_scale (188 * 8, 27000000, CBR_BITRATE);
+
+  n_packets = gst_harness_buffers_in_queue (h);
+
+  for (i = 0; i < n_packets; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    GstMapInfo map;
+    gint pid;
+
+    fail_unless_equals_int (gst_buffer_get_size (buf), 188);
+
+    /* every packet is output on its slot of the packet clock */
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    if (i == 0)
+      first_pts = GST_BUFFER_PTS (buf);
+    fail_unless_equals_clocktime (GST_BUFFER_PTS (buf) - first_pts,
+        gst_util_uint64_scale (i * 188 * 8, GST_SECOND, CBR_BITRATE));
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.data[0], 0x47);
+    pid = ((map.data[1] & 0x1f) << 8) | map.data[2];
+    if (pid == 0x1fff)
+      n_null++;
+
+    pcr = get_packet_pcr (map.data);
+    if (pcr != -1) {
+      if (pcr_pid == -1)
+        pcr_pid = pid;
+      fail_unless_equals_int (pid, pcr_pid);
+
+      /* the PCR is the position on the packet clock */
+      if (first_pcr == -1) {
+        first_pcr = pcr;
+        first_pcr_offset = i * 188;
+      }
+      fail_unless (ABS (pcr - first_pcr - (gint64)
+              gst_util_uint64_scale ((i * 188 - first_pcr_offset) * 8,
+                  27000000, CBR_BITRATE)) <= 1, "PCR %" G_GINT64_FORMAT
+          " of packet %u is not on the packet clock", pcr, i);
+
+      /* and is sent every pcr-interval, give or take the slots it had to
+       * wait for */
+      if (last_pcr != -1) {
+        fail_unless (pcr - last_pcr <= CBR_PCR_INTERVAL * 300 +
+            2 * pcr_packet_ticks, "PCR interval %" G_GINT64_FORMAT,
+            pcr - last_pcr);
+        fail_unless (pcr - last_pcr >= CBR_PCR_INTERVAL * 300 -
+            2 * pcr_packet_ticks, "PCR interval %" G_GINT64_FORMAT,
+            pcr - last_pcr);
+      }
+      last_pcr = pcr;
+      n_pcrs++;
+    }
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  /* the gaps between the audio frames are filled with null packets */
+  fail_unless (n_null > 0);
+  fail_unless (n_pcrs > 1);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -598,10 +718,12 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_video);
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
+  tcase_add_test (tc_chain, test_align_audio);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
   tcase_add_test (tc_chain, test_reappearing_pad_while_playing);
   tcase_add_test (tc_chain, test_reappearing_pad_while_stopped);
   tcase_add_test (tc_chain, test_unused_pad);
+  tcase_add_test (tc_chain, test_cbr_packet_clock);
 
   return s;
 }
@@ -0,0 +1,340 @@
+/* GStreamer
+ *
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* using GValueArray, which has not replacement */
+#define GLIB_DISABLE_DEPRECATION_WARNINGS
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/app/app.h>
+#include <gst/rtp/rtp.h>
+
+#define N_LINKS 2
+#define RTP_SSRC 0x1234
+#define RECEIVER_SSRC 0x5678
+/* every NACK_INTERVAL-th packet is reported lost on the lossy link */
+#define NACK_INTERVAL 8
+#define PACKET_INTERVAL (2 * G_TIME_SPAN_MILLISECOND)
+
+/* The receiving end of one link */
+typedef struct
+{
+  GSocket *rtp;
+  GSocket *rtcp;
+  guint port;
+  GSocketAddress *sender;
+  guint32 sender_ssrc;
+} TestLink;
+
+static GSocket *
+bind_udp_socket (guint port)
+{
+  GInetAddress *iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *addr = g_inet_socket_address_new (iaddr, port);
+  GSocket *socket;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  g_socket_set_blocking (socket, FALSE);
+
+  if (!g_socket_bind (socket, addr, FALSE, NULL))
+    g_clear_object (&socket);
+
+  g_object_unref (addr);
+  g_object_unref (iaddr);
+
+  return socket;
+}
+
+/* RTP goes to an even port, RTCP to the next one */
+static void
+test_link_init (TestLink * link)
+{
+  memset (link, 0, sizeof (TestLink));
+
+  while (link->rtp == NULL || link->rtcp == NULL) {
+    g_clear_object (&link->rtp);
+    g_clear_object (&link->rtcp);
+
+    link->port = g_random_int_range (20000, 60000) & ~1;
+    link->rtp = bind_udp_socket (link->port);
+    link->rtcp = bind_udp_socket (link->port + 1);
+  }
+}
+
+static void
+test_link_clear (TestLink * link)
+{
+  g_clear_object (&link->rtp);
+  g_clear_object (&link->rtcp);
+  g_clear_object (&link->sender);
+}
+
+static void
+test_link_send (TestLink * link, GstBuffer * buf)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  g_socket_send_to (link->rtcp, link->sender, (const gchar *) map.data,
+      map.size, NULL, NULL);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+}
+
+static void
+add_sdes (GstRTCPBuffer * rtcp)
+{
+  GstRTCPPacket packet;
+  const gchar *cname = "receiver";
+
+  gst_rtcp_buffer_add_packet (rtcp, GST_RTCP_TYPE_SDES, &packet);
+  gst_rtcp_packet_sdes_add_item (&packet, RECEIVER_SSRC);
+  gst_rtcp_packet_sdes_add_entry (&packet, GST_RTCP_SDES_CNAME, strlen (cname),
+      (const guint8 *) cname);
+}
+
+/* Answers a sender report with a receiver report without losses, claiming
+ * a round trip time of 100 ms on every link */
+static void
+test_link_send_rr (TestLink * link, guint64 ntptime)
+{
+  GstBuffer *buf = gst_rtcp_buffer_new (1400);
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  guint32 lsr;
+
+  lsr = ((ntptime >> 16) & 0xffffffff) - 6554;
+
+  gst_rtcp_buffer_map (buf, GST_MAP_READWRITE, &rtcp);
+  gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RR, &packet);
+  gst_rtcp_packet_rr_set_ssrc (&packet, RECEIVER_SSRC);
+  gst_rtcp_packet_add_rb (&packet, link->sender_ssrc, 0, 0, 0, 0, lsr, 0);
+  add_sdes (&rtcp);
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  test_link_send (link, buf);
+}
+
+static void
+test_link_send_nack (TestLink * link, guint16 seqnum)
+{
+  GstBuffer *buf = gst_rtcp_buffer_new (1400);
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  guint8 *fci;
+
+  gst_rtcp_buffer_map (buf, GST_MAP_READWRITE, &rtcp);
+  gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RR, &packet);
+  gst_rtcp_packet_rr_set_ssrc (&packet, RECEIVER_SSRC);
+  add_sdes (&rtcp);
+  gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RTPFB, &packet);
+  gst_rtcp_packet_fb_set_type (&packet, GST_RTCP_RTPFB_TYPE_NACK);
+  gst_rtcp_packet_fb_set_sender_ssrc (&packet, RECEIVER_SSRC);
+  gst_rtcp_packet_fb_set_media_ssrc (&packet, link->sender_ssrc);
+  gst_rtcp_packet_fb_set_fci_length (&packet, 1);
+  fci = gst_rtcp_packet_fb_get_fci (&packet);
+  GST_WRITE_UINT32_BE (fci, seqnum << 16);
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  test_link_send (link, buf);
+}
+
+/* Reads the RTCP sent by ristsink on @link and answers its sender reports */
+static void
+test_link_process_rtcp (TestLink * link)
+{
+  gchar data[1500];
+  GSocketAddress *from = NULL;
+  gssize len;
+
+  while ((len = g_socket_receive_from (link->rtcp, &from, data, sizeof data,
+              NULL, NULL)) > 0) {
+    GstBuffer *buf = gst_buffer_new_wrapped (g_memdup (data, len), len);
+    GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+    GstRTCPPacket packet;
+    gboolean more;
+    guint64 ntptime = 0;
+    gboolean have_sr = FALSE;
+
+    g_clear_object (&link->sender);
+    link->sender = from;
+    from = NULL;
+
+    if (!gst_rtcp_buffer_validate_reduced (buf)) {
+      gst_buffer_unref (buf);
+      continue;
+    }
+
+    gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+    for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet); more;
+        more = gst_rtcp_packet_move_to_next (&packet)) {
+      if (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_SR) {
+        gst_rtcp_packet_sr_get_sender_info (&packet, &link->sender_ssrc,
+            &ntptime, NULL, NULL, NULL);
+        have_sr = TRUE;
+      }
+    }
+    gst_rtcp_buffer_unmap (&rtcp);
+    gst_buffer_unref (buf);
+
+    if (have_sr)
+      test_link_send_rr (link, ntptime);
+  }
+}
+
+static void
+get_weights (GstElement * sink, gdouble * weights)
+{
+  GstStructure *stats;
+  const GValue *session_stats;
+  guint i;
+
+  for (i = 0; i < N_LINKS; i++)
+    weights[i] = -1.0;
+
+  g_object_get (sink, "stats", &stats, NULL);
+  session_stats = gst_structure_get_value (stats, "session-stats");
+  fail_unless (session_stats != NULL);
+
+  for (i = 0; i < ((GValueArray *) g_value_get_boxed (session_stats))->n_values;
+      i++) {
+    const GValue *v =
+        g_value_array_get_nth (g_value_get_boxed (session_stats), i);
+    const GstStructure *s = gst_value_get_structure (v);
+    gint id;
+
+    fail_unless (gst_structure_get_int (s, "session-id", &id));
+    fail_unless (id < N_LINKS);
+    fail_unless (gst_structure_get_double (s, "weight", &weights[id]));
+  }
+
+  gst_structure_free (stats);
+}
+
+static GstBuffer *
+create_rtp_buffer (guint16 seqnum)
+{
+  GstBuffer *buf = gst_rtp_buffer_new_allocate (7 * 188, 0, 0);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, RTP_SSRC);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, seqnum * 180);
+  gst_rtp_buffer_set_payload_type (&rtp, 33);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buf;
+}
+
+/* Losses reported on one link only must lower the weight of that link.
+ * The retransmissions are all sent on the best link, and must not count
+ * as losses of the best link, or the weights would oscillate */
+GST_START_TEST (test_weighted_bonding_asymmetric_loss)
+{
+  TestLink links[N_LINKS];
+  GstElement *pipeline, *src, *sink;
+  gchar *desc;
+  gdouble weights[N_LINKS];
+  gint64 start, now, next_sample;
+  guint16 seqnum = 0;
+  guint samples = 0;
+  guint i;
+
+  for (i = 0; i < N_LINKS; i++)
+    test_link_init (&links[i]);
+
+  desc = g_strdup_printf ("appsrc name=src is-live=true do-timestamp=true "
+      "format=time caps=\"application/x-rtp,media=video,clock-rate=90000,"
+      "encoding-name=MP2T,payload=33,ssrc=(uint)%u\" ! ristsink name=sink "
+      "bonding-method=weighted bonding-addresses=127.0.0.1:%u,127.0.0.1:%u",
+      RTP_SSRC, links[0].port, links[1].port);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  start = g_get_monotonic_time ();
+  next_sample = start + 2 * G_TIME_SPAN_SECOND;
+
+  do {
+    fail_unless_equals_int (gst_app_src_push_buffer (GST_APP_SRC (src),
+            create_rtp_buffer (seqnum)), GST_FLOW_OK);
+
+    for (i = 0; i < N_LINKS; i++)
+      test_link_process_rtcp (&links[i]);
+
+    /* only the first link loses packets */
+    if (links[0].sender != NULL && seqnum % NACK_INTERVAL == 0)
+      test_link_send_nack (&links[0], seqnum);
+
+    seqnum++;
+    g_usleep (PACKET_INTERVAL);
+    now = g_get_monotonic_time ();
+
+    /* Once settled, the lossy link must stay the worst one */
+    if (now >= next_sample) {
+      get_weights (sink, weights);
+      GST_DEBUG ("weights %f %f", weights[0], weights[1]);
+      fail_unless (weights[0] > 0.0);
+      fail_unless (weights[1] > 0.0);
+      fail_unless (weights[0] < weights[1]);
+      next_sample += 250 * G_TIME_SPAN_MILLISECOND;
+      samples++;
+    }
+  } while (now < start + 4 * G_TIME_SPAN_SECOND);
+
+  fail_unless (samples >= 4);
+  fail_unless (weights[0] < 0.5);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  for (i = 0; i < N_LINKS; i++)
+    test_link_clear (&links[i]);
+}
+
+GST_END_TEST;
+
+static Suite *
+ristsink_suite (void)
+{
+  Suite *s = suite_create ("ristsink");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_set_timeout (tc, 20);
+  tcase_add_test (tc, test_weighted_bonding_asymmetric_loss);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ristsink);
@@ -0,0 +1,203 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * roundrobin.c: tests for the roundrobin dispatcher of the RIST plugin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#define NUM_PADS 3
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+typedef struct
+{
+  GstElement *rr;
+  GstPad *srcpad;
+  GstPad *rr_srcpads[NUM_PADS];
+  GstPad *sinkpads[NUM_PADS];
+  guint counts[NUM_PADS];
+  /* pad index of each buffer, in order */
+  GArray *order;
+} RoundRobinTest;
+
+static GstFlowReturn
+count_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  RoundRobinTest *t = g_object_get_data (G_OBJECT (pad), "test");
+  guint idx = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad), "index"));
+
+  t->counts[idx]++;
+  g_array_append_val (t->order, idx);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static void
+setup (RoundRobinTest * t)
+{
+  guint i;
+
+  memset (t, 0, sizeof (RoundRobinTest));
+  t->order = g_array_new (FALSE, FALSE, sizeof (guint));
+  t->rr = gst_check_setup_element ("roundrobin");
+  t->srcpad = gst_check_setup_src_pad (t->rr, &srctemplate);
+
+  for (i = 0; i < NUM_PADS; i++) {
+    gchar *name = g_strdup_printf ("src_%u", i);
+
+    t->rr_srcpads[i] = gst_element_get_request_pad (t->rr, name);
+    fail_unless (t->rr_srcpads[i] != NULL);
+    g_free (name);
+
+    t->sinkpads[i] = gst_pad_new_from_static_template (&sinktemplate, "sink");
+    g_object_set_data (G_OBJECT (t->sinkpads[i]), "test", t);
+    g_object_set_data (G_OBJECT (t->sinkpads[i]), "index",
+        GUINT_TO_POINTER (i));
+    gst_pad_set_chain_function (t->sinkpads[i], count_chain);
+    gst_pad_set_active (t->sinkpads[i], TRUE);
+    fail_unless_equals_int (gst_pad_link (t->rr_srcpads[i], t->sinkpads[i]),
+        GST_PAD_LINK_OK);
+  }
+
+  gst_pad_set_active (t->srcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (t->rr, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_check_setup_events (t->srcpad, t->rr, NULL, GST_FORMAT_BYTES);
+}
+
+static void
+teardown (RoundRobinTest * t)
+{
+  guint i;
+
+  gst_element_set_state (t->rr, GST_STATE_NULL);
+  for (i = 0; i < NUM_PADS; i++) {
+    gst_pad_unlink (t->rr_srcpads[i], t->sinkpads[i]);
+    gst_object_unref (t->rr_srcpads[i]);
+    gst_object_unref (t->sinkpads[i]);
+  }
+  gst_pad_set_active (t->srcpad, FALSE);
+  gst_check_teardown_src_pad (t->rr);
+  gst_check_teardown_element (t->rr);
+  g_array_free (t->order, TRUE);
+}
+
+static void
+push_buffers (RoundRobinTest * t, guint num)
+{
+  guint i;
+
+  for (i = 0; i < num; i++)
+    fail_unless_equals_int (gst_pad_push (t->srcpad, gst_buffer_new ()),
+        GST_FLOW_OK);
+}
+
+GST_START_TEST (test_equal_weights)
+{
+  RoundRobinTest t;
+  guint i;
+
+  setup (&t);
+  push_buffers (&t, 3 * NUM_PADS);
+
+  /* one pad after the other */
+  for (i = 0; i < t.order->len; i++)
+    fail_unless_equals_int (g_array_index (t.order, guint, i), i % NUM_PADS);
+
+  teardown (&t);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_weights)
+{
+  RoundRobinTest t;
+  gdouble weight;
+  guint i, run;
+
+  setup (&t);
+  g_object_set (t.rr_srcpads[0], "weight", 3.0, NULL);
+  g_object_set (t.rr_srcpads[1], "weight", 1.0, NULL);
+  g_object_set (t.rr_srcpads[2], "weight", 0.0, NULL);
+  g_object_get (t.rr_srcpads[0], "weight", &weight, NULL);
+  fail_unless_equals_float (weight, 3.0);
+
+  push_buffers (&t, 400);
+  fail_unless_equals_int (t.counts[0], 300);
+  fail_unless_equals_int (t.counts[1], 100);
+  fail_unless_equals_int (t.counts[2], 0);
+
+  /* the heavier pad never gets more than its share in a row */
+  run = 0;
+  for (i = 0; i < t.order->len; i++) {
+    if (g_array_index (t.order, guint, i) == 0)
+      run++;
+    else
+      run = 0;
+    fail_unless (run <= 3);
+  }
+
+  teardown (&t);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_no_weight)
+{
+  RoundRobinTest t;
+  guint i;
+
+  setup (&t);
+  for (i = 0; i < NUM_PADS; i++)
+    g_object_set (t.rr_srcpads[i], "weight", 0.0, NULL);
+
+  /* dropped */
+  push_buffers (&t, 10);
+  fail_unless_equals_int (t.order->len, 0);
+
+  teardown (&t);
+}
+
+GST_END_TEST;
+
+static Suite *
+roundrobin_suite (void)
+{
+  Suite *s = suite_create ("roundrobin");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_equal_weights);
+  tcase_add_test (tc_chain, test_weights);
+  tcase_add_test (tc_chain, test_no_weight);
+
+  return s;
+}
+
+GST_CHECK_MAIN (roundrobin);
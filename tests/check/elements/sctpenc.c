@@ -0,0 +1,332 @@
+/* GStreamer
+ *
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+/* Two SCTP associations talking to each other. The messages sent on side A
+ * are received by the fakesink of side B */
+typedef struct
+{
+  GstElement *enc_a, *dec_a;
+  GstElement *enc_b, *dec_b;
+  GstElement *sink;
+
+  GMutex lock;
+  GCond cond;
+  gboolean established;
+  guint received;
+} SctpTest;
+
+static void
+on_association_established (GstElement * enc, gboolean established,
+    SctpTest * t)
+{
+  g_mutex_lock (&t->lock);
+  t->established = established;
+  g_cond_broadcast (&t->cond);
+  g_mutex_unlock (&t->lock);
+}
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad, SctpTest * t)
+{
+  g_mutex_lock (&t->lock);
+  t->received++;
+  g_cond_broadcast (&t->cond);
+  g_mutex_unlock (&t->lock);
+}
+
+static void
+on_dec_pad_added (GstElement * dec, GstPad * pad, SctpTest * t)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (t->sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+static void
+link_elements (GstElement * src, GstElement * sink)
+{
+  GstPad *srcpad = gst_element_get_static_pad (src, "src");
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (srcpad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+}
+
+static SctpTest *
+sctp_test_new (guint association_id)
+{
+  SctpTest *t = g_new0 (SctpTest, 1);
+  gint64 deadline;
+
+  g_mutex_init (&t->lock);
+  g_cond_init (&t->cond);
+
+  t->enc_a = gst_element_factory_make ("sctpenc", NULL);
+  t->dec_a = gst_element_factory_make ("sctpdec", NULL);
+  t->enc_b = gst_element_factory_make ("sctpenc", NULL);
+  t->dec_b = gst_element_factory_make ("sctpdec", NULL);
+  t->sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (t->enc_a && t->dec_a && t->enc_b && t->dec_b && t->sink);
+
+  g_object_set (t->enc_a, "sctp-association-id", association_id, NULL);
+  g_object_set (t->dec_a, "sctp-association-id", association_id, NULL);
+  g_object_set (t->enc_b, "sctp-association-id", association_id + 1, NULL);
+  g_object_set (t->dec_b, "sctp-association-id", association_id + 1, NULL);
+  g_object_set (t->sink, "sync", FALSE, "async", FALSE, "signal-handoffs",
+      TRUE, NULL);
+
+  g_signal_connect (t->enc_a, "sctp-association-established",
+      G_CALLBACK (on_association_established), t);
+  g_signal_connect (t->dec_b, "pad-added", G_CALLBACK (on_dec_pad_added), t);
+  g_signal_connect (t->sink, "handoff", G_CALLBACK (on_handoff), t);
+
+  link_elements (t->enc_a, t->dec_b);
+  link_elements (t->enc_b, t->dec_a);
+
+  fail_unless (gst_element_set_state (t->sink,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_set_state (t->dec_a,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (t->dec_b,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (t->enc_a,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (t->enc_b,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  deadline = g_get_monotonic_time () + TIMEOUT;
+  g_mutex_lock (&t->lock);
+  while (!t->established && g_cond_wait_until (&t->cond, &t->lock, deadline));
+  fail_unless (t->established, "The SCTP association was not established");
+  g_mutex_unlock (&t->lock);
+
+  return t;
+}
+
+static void
+sctp_test_free (SctpTest * t)
+{
+  gst_element_set_state (t->enc_a, GST_STATE_NULL);
+  gst_element_set_state (t->enc_b, GST_STATE_NULL);
+  gst_element_set_state (t->dec_a, GST_STATE_NULL);
+  gst_element_set_state (t->dec_b, GST_STATE_NULL);
+  gst_element_set_state (t->sink, GST_STATE_NULL);
+
+  gst_object_unref (t->enc_a);
+  gst_object_unref (t->enc_b);
+  gst_object_unref (t->dec_a);
+  gst_object_unref (t->dec_b);
+  gst_object_unref (t->sink);
+
+  g_mutex_clear (&t->lock);
+  g_cond_clear (&t->cond);
+  g_free (t);
+}
+
+static void
+sctp_test_wait_received (SctpTest * t, guint received)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT;
+
+  g_mutex_lock (&t->lock);
+  while (t->received < received
+      && g_cond_wait_until (&t->cond, &t->lock, deadline));
+  fail_unless_equals_int (t->received, received);
+  g_mutex_unlock (&t->lock);
+}
+
+static GstBufferList *
+create_message_list (const gsize * sizes, guint n)
+{
+  GstBufferList *list = gst_buffer_list_new_sized (n);
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, sizes[i], NULL);
+
+    gst_buffer_memset (buf, 0, i, sizes[i]);
+    gst_buffer_list_add (list, buf);
+  }
+
+  return list;
+}
+
+typedef struct
+{
+  guint64 messages_sent;
+  guint64 bytes_sent;
+  guint64 messages_dropped;
+  guint64 bytes_dropped;
+} StreamStats;
+
+static void
+get_stream_stats (GstElement * enc, StreamStats * stream_stats)
+{
+  GstStructure *stats;
+  const GstStructure *s;
+  const GValue *streams;
+
+  g_object_get (enc, "stats", &stats, NULL);
+  fail_unless (gst_structure_has_name (stats, "application/x-sctp-enc-stats"));
+  streams = gst_structure_get_value (stats, "streams");
+  fail_unless (streams != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (streams), 1);
+
+  s = gst_value_get_structure (gst_value_array_get_value (streams, 0));
+  fail_unless (gst_structure_get (s,
+          "messages-sent", G_TYPE_UINT64, &stream_stats->messages_sent,
+          "bytes-sent", G_TYPE_UINT64, &stream_stats->bytes_sent,
+          "messages-dropped", G_TYPE_UINT64, &stream_stats->messages_dropped,
+          "bytes-dropped", G_TYPE_UINT64, &stream_stats->bytes_dropped,
+          NULL));
+
+  gst_structure_free (stats);
+}
+
+static const gsize message_sizes[] = { 100, 200, 300 };
+
+GST_START_TEST (test_sctpenc_list_stats)
+{
+  SctpTest *t = sctp_test_new (100);
+  GstHarness *h = gst_harness_new_with_element (t->enc_a, "sink_0", NULL);
+  StreamStats stats;
+
+  gst_harness_set_src_caps_str (h, "application/data");
+
+  /* all the messages of a batch are received, the last one flushes the ones
+   * SCTP held back */
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad,
+          create_message_list (message_sizes, G_N_ELEMENTS (message_sizes))),
+      GST_FLOW_OK);
+  sctp_test_wait_received (t, 3);
+
+  get_stream_stats (t->enc_a, &stats);
+  fail_unless_equals_uint64 (stats.messages_sent, 3);
+  fail_unless_equals_uint64 (stats.bytes_sent, 600);
+  fail_unless_equals_uint64 (stats.messages_dropped, 0);
+  fail_unless_equals_uint64 (stats.bytes_dropped, 0);
+
+  /* a list of a single message is sent without batching */
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad,
+          create_message_list (message_sizes, 1)), GST_FLOW_OK);
+  sctp_test_wait_received (t, 4);
+
+  get_stream_stats (t->enc_a, &stats);
+  fail_unless_equals_uint64 (stats.messages_sent, 4);
+  fail_unless_equals_uint64 (stats.bytes_sent, 700);
+
+  gst_harness_teardown (h);
+  sctp_test_free (t);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sctpenc_list_dropped)
+{
+  SctpTest *t = sctp_test_new (200);
+  GstHarness *h = gst_harness_new_with_element (t->enc_a, "sink_0", NULL);
+  StreamStats before, after;
+  GstPad *srcpad, *sinkpad;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "application/data");
+
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad,
+          create_message_list (message_sizes, G_N_ELEMENTS (message_sizes))),
+      GST_FLOW_OK);
+  sctp_test_wait_received (t, 3);
+
+  /* pushing the SCTP packets fails from now on, which fails the messages
+   * sent after that */
+  srcpad = gst_element_get_static_pad (t->enc_a, "src");
+  sinkpad = gst_element_get_static_pad (t->dec_b, "sink");
+  fail_unless (gst_pad_unlink (srcpad, sinkpad));
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  for (i = 0; i < 100 && ret == GST_FLOW_OK; i++) {
+    ret = gst_harness_push (h, gst_buffer_new_allocate (NULL, 10, NULL));
+    if (ret == GST_FLOW_OK)
+      g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+  }
+  fail_unless_equals_int (ret, GST_FLOW_NOT_LINKED);
+
+  /* the failed message was dropped as a whole */
+  get_stream_stats (t->enc_a, &before);
+  fail_unless (before.messages_dropped >= 1);
+  fail_unless_equals_uint64 (before.bytes_dropped,
+      10 * before.messages_dropped);
+
+  /* all the messages of the list are dropped, the one that failed and the
+   * ones that were not sent */
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad,
+          create_message_list (message_sizes, G_N_ELEMENTS (message_sizes))),
+      GST_FLOW_NOT_LINKED);
+
+  get_stream_stats (t->enc_a, &after);
+  fail_unless_equals_uint64 (after.messages_sent, before.messages_sent);
+  fail_unless_equals_uint64 (after.bytes_sent, before.bytes_sent);
+  fail_unless_equals_uint64 (after.messages_dropped,
+      before.messages_dropped + 3);
+  fail_unless_equals_uint64 (after.bytes_dropped, before.bytes_dropped + 600);
+
+  gst_harness_teardown (h);
+  sctp_test_free (t);
+}
+
+GST_END_TEST;
+
+static Suite *
+sctpenc_suite (void)
+{
+  Suite *s = suite_create ("sctpenc");
+  TCase *tc_chain = tcase_create ("general");
+  GstRegistry *registry = gst_registry_get ();
+  GstPluginFeature *sctpenc, *sctpdec;
+
+  suite_add_tcase (s, tc_chain);
+
+  sctpenc = gst_registry_lookup_feature (registry, "sctpenc");
+  sctpdec = gst_registry_lookup_feature (registry, "sctpdec");
+
+  if (sctpenc && sctpdec) {
+    tcase_add_test (tc_chain, test_sctpenc_list_stats);
+    tcase_add_test (tc_chain, test_sctpenc_list_dropped);
+  } else {
+    GST_INFO ("Skipping tests, sctpenc %p, sctpdec %p", sctpenc, sctpdec);
+  }
+
+  if (sctpenc)
+    gst_object_unref (sctpenc);
+  if (sctpdec)
+    gst_object_unref (sctpdec);
+
+  return s;
+}
+
+GST_CHECK_MAIN (sctpenc);
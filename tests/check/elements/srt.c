@@ -0,0 +1,359 @@
+/* GStreamer
+ *
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#define GLIB_DISABLE_DEPRECATION_WARNINGS
+
+#include <gio/gio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/app/gstappsink.h>
+
+#define TIMEOUT (5 * G_TIME_SPAN_SECOND)
+/* one SRT message per buffer */
+#define MESSAGE_SIZE 1316
+
+static GMutex callers_lock;
+static GCond callers_cond;
+static guint callers_added;
+static guint callers_removed;
+
+static void
+on_caller_added (GstElement * sink, gint unused, GSocketAddress * addr,
+    gpointer user_data)
+{
+  g_mutex_lock (&callers_lock);
+  callers_added++;
+  g_cond_broadcast (&callers_cond);
+  g_mutex_unlock (&callers_lock);
+}
+
+static void
+on_caller_removed (GstElement * sink, gint unused, GSocketAddress * addr,
+    gpointer user_data)
+{
+  g_mutex_lock (&callers_lock);
+  callers_removed++;
+  g_cond_broadcast (&callers_cond);
+  g_mutex_unlock (&callers_lock);
+}
+
+static void
+wait_callers (guint * counter, guint n)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT;
+
+  g_mutex_lock (&callers_lock);
+  while (*counter < n
+      && g_cond_wait_until (&callers_cond, &callers_lock, deadline));
+  fail_unless_equals_int (*counter, n);
+  g_mutex_unlock (&callers_lock);
+}
+
+/* An srtsink listening on a free port, fed by the harness */
+static GstHarness *
+sink_harness_new (guint backlog, const gchar * backlog_action)
+{
+  GstElement *sink = gst_element_factory_make ("srtsink", NULL);
+  GstHarness *h;
+
+  g_mutex_lock (&callers_lock);
+  callers_added = callers_removed = 0;
+  g_mutex_unlock (&callers_lock);
+
+  /* the tests wait for the callers themselves, and pushing goes on once a
+   * caller was disconnected. localport 0 overrides the port of the URI, which
+   * can't hold 0, so the system picks a free port */
+  g_object_set (sink, "uri", "srt://:7001", "localport", 0, "sync", FALSE,
+      "async", FALSE, "wait-for-connection", FALSE, "caller-backlog", backlog,
+      NULL);
+  gst_util_set_object_arg (G_OBJECT (sink), "caller-backlog-action",
+      backlog_action);
+  g_signal_connect (sink, "caller-added", G_CALLBACK (on_caller_added), NULL);
+  g_signal_connect (sink, "caller-removed", G_CALLBACK (on_caller_removed),
+      NULL);
+
+  h = gst_harness_new_with_element (sink, "sink", NULL);
+  gst_harness_set_src_caps_str (h, "application/x-test");
+  gst_object_unref (sink);
+
+  return h;
+}
+
+/* The port the sink of @h is listening on */
+static guint
+sink_harness_get_port (GstHarness * h)
+{
+  guint port;
+
+  g_object_get (h->element, "localport", &port, NULL);
+  fail_if (port == 0);
+
+  return port;
+}
+
+/* An srtsrc calling the sink on @port, returns the pipeline */
+static GstElement *
+receiver_new (guint port, GstElement ** appsink)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *src = gst_element_factory_make ("srtsrc", NULL);
+  gchar *uri = g_strdup_printf ("srt://127.0.0.1:%u", port);
+
+  *appsink = gst_element_factory_make ("appsink", NULL);
+  g_object_set (src, "uri", uri, "latency", 20, NULL);
+  g_object_set (*appsink, "sync", FALSE, NULL);
+  g_free (uri);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, *appsink, NULL);
+  fail_unless (gst_element_link (src, *appsink));
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  return pipeline;
+}
+
+static void
+receiver_free (GstElement * pipeline)
+{
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static GstBuffer *
+create_message (guint index, gsize size)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_memset (buf, 0, index & 0xff, size);
+
+  return buf;
+}
+
+static void
+check_received (GstElement * appsink, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    GstSample *sample = gst_app_sink_try_pull_sample (GST_APP_SINK (appsink),
+        TIMEOUT * GST_USECOND);
+    GstBuffer *expected = create_message (i, MESSAGE_SIZE);
+    GstMapInfo map;
+
+    fail_unless (sample != NULL, "message %u was not received", i);
+    gst_buffer_map (expected, &map, GST_MAP_READ);
+    gst_check_buffer_data (gst_sample_get_buffer (sample), map.data, map.size);
+    gst_buffer_unmap (expected, &map);
+    gst_buffer_unref (expected);
+    gst_sample_unref (sample);
+  }
+}
+
+/* Returns the statistics the sink keeps about its first caller */
+static GstStructure *
+get_caller_stats (GstHarness * h)
+{
+  GstStructure *stats, *caller_stats;
+  const GValue *callers;
+  GValueArray *array;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  callers = gst_structure_get_value (stats, "callers");
+  fail_unless (callers != NULL);
+  array = g_value_get_boxed (callers);
+  fail_unless (array->n_values > 0);
+  caller_stats =
+      gst_structure_copy (gst_value_get_structure (g_value_array_get_nth (array,
+              0)));
+  gst_structure_free (stats);
+
+  return caller_stats;
+}
+
+GST_START_TEST (test_srtsink_callers)
+{
+  GstHarness *h = sink_harness_new (1000, "skip");
+  GstElement *receiver1, *receiver2, *appsink1, *appsink2;
+  guint i;
+
+  receiver1 = receiver_new (sink_harness_get_port (h), &appsink1);
+  receiver2 = receiver_new (sink_harness_get_port (h), &appsink2);
+  wait_callers (&callers_added, 2);
+
+  /* each caller is sent to from its own thread, and gets all the data in
+   * order */
+  for (i = 0; i < 20; i++)
+    fail_unless_equals_int (gst_harness_push (h, create_message (i,
+                MESSAGE_SIZE)), GST_FLOW_OK);
+
+  check_received (appsink1, 20);
+  check_received (appsink2, 20);
+
+  g_mutex_lock (&callers_lock);
+  fail_unless_equals_int (callers_removed, 0);
+  g_mutex_unlock (&callers_lock);
+
+  receiver_free (receiver1);
+  receiver_free (receiver2);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_srtsink_eos_drain)
+{
+  GstHarness *h = sink_harness_new (1000, "skip");
+  GstElement *receiver, *appsink;
+  GstStructure *stats;
+  guint backlog_buffers;
+  guint i;
+
+  receiver = receiver_new (sink_harness_get_port (h), &appsink);
+  wait_callers (&callers_added, 1);
+
+  for (i = 0; i < 50; i++)
+    fail_unless_equals_int (gst_harness_push (h, create_message (i,
+                MESSAGE_SIZE)), GST_FLOW_OK);
+
+  /* nothing is left waiting to be sent once EOS was handled */
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  stats = get_caller_stats (h);
+  fail_unless (gst_structure_get_uint (stats, "backlog-buffers",
+          &backlog_buffers));
+  fail_unless_equals_int (backlog_buffers, 0);
+  gst_structure_free (stats);
+
+  check_received (appsink, 50);
+
+  receiver_free (receiver);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Large buffers are split in many SRT messages by the send thread, so
+ * pushing them in a burst fills a small backlog */
+#define BURST_MESSAGE_SIZE (100 * MESSAGE_SIZE)
+
+/* Pushes large buffers until the first caller of the sink dropped some of
+ * them, or it was removed */
+static void
+push_until_dropped (GstHarness * h, guint64 * buffers_dropped,
+    guint64 * bytes_dropped)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT;
+  guint i = 0;
+  gboolean removed;
+
+  do {
+    fail_unless_equals_int (gst_harness_push (h, create_message (i++,
+                BURST_MESSAGE_SIZE)), GST_FLOW_OK);
+
+    g_mutex_lock (&callers_lock);
+    removed = callers_removed > 0;
+    g_mutex_unlock (&callers_lock);
+
+    if (buffers_dropped && !removed) {
+      GstStructure *stats = get_caller_stats (h);
+
+      fail_unless (gst_structure_get (stats,
+              "buffers-dropped", G_TYPE_UINT64, buffers_dropped,
+              "bytes-dropped", G_TYPE_UINT64, bytes_dropped, NULL));
+      gst_structure_free (stats);
+      if (*buffers_dropped > 0)
+        break;
+    }
+  } while (!removed && g_get_monotonic_time () < deadline);
+}
+
+GST_START_TEST (test_srtsink_caller_backlog_skip)
+{
+  GstHarness *h = sink_harness_new (1, "skip");
+  GstElement *receiver, *appsink;
+  guint64 buffers_dropped = 0, bytes_dropped = 0;
+
+  receiver = receiver_new (sink_harness_get_port (h), &appsink);
+  wait_callers (&callers_added, 1);
+
+  /* the caller is kept, buffers are skipped for it once it falls behind */
+  push_until_dropped (h, &buffers_dropped, &bytes_dropped);
+  fail_unless (buffers_dropped > 0);
+  fail_unless_equals_uint64 (bytes_dropped,
+      buffers_dropped * BURST_MESSAGE_SIZE);
+
+  g_mutex_lock (&callers_lock);
+  fail_unless_equals_int (callers_removed, 0);
+  g_mutex_unlock (&callers_lock);
+
+  receiver_free (receiver);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_srtsink_caller_backlog_disconnect)
+{
+  GstHarness *h = sink_harness_new (1, "disconnect");
+  GstElement *receiver, *appsink;
+
+  receiver = receiver_new (sink_harness_get_port (h), &appsink);
+  wait_callers (&callers_added, 1);
+
+  /* the caller that falls behind is dropped, the sink keeps going */
+  push_until_dropped (h, NULL, NULL);
+  wait_callers (&callers_removed, 1);
+
+  receiver_free (receiver);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+srt_suite (void)
+{
+  Suite *s = suite_create ("srt");
+  TCase *tc_chain = tcase_create ("general");
+  GstRegistry *registry = gst_registry_get ();
+  GstPluginFeature *srtsink, *srtsrc;
+
+  suite_add_tcase (s, tc_chain);
+
+  srtsink = gst_registry_lookup_feature (registry, "srtsink");
+  srtsrc = gst_registry_lookup_feature (registry, "srtsrc");
+
+  if (srtsink && srtsrc) {
+    tcase_add_test (tc_chain, test_srtsink_callers);
+    tcase_add_test (tc_chain, test_srtsink_eos_drain);
+    tcase_add_test (tc_chain, test_srtsink_caller_backlog_skip);
+    tcase_add_test (tc_chain, test_srtsink_caller_backlog_disconnect);
+  } else {
+    GST_INFO ("Skipping tests, srtsink %p, srtsrc %p", srtsink, srtsrc);
+  }
+
+  if (srtsink)
+    gst_object_unref (srtsink);
+  if (srtsrc)
+    gst_object_unref (srtsrc);
+
+  return s;
+}
+
+GST_CHECK_MAIN (srt);
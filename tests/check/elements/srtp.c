@@ -338,6 +338,80 @@ GST_START_TEST (test_srtpdec_multiple_mki)
 
 GST_END_TEST;
 
+GST_START_TEST (test_srtpdec_list)
+{
+  static const char CAPS_RTP[] =
+      "application/x-rtp, media=(string)audio, clock-rate=(int)8000, encoding-name=(string)PCMA, payload=(int)8, ssrc=(uint)2648728855";
+  static const char CAPS_SRTP[] =
+      "application/x-srtp, media=(string)audio, clock-rate=(int)8000, encoding-name=(string)PCMA, payload=(int)8, ssrc=(uint)2648728855, srtp-key=(buffer)012345678901234567890123456789012345678901234567890123456789, mki=(buffer)01, srtp-cipher=(string)aes-128-icm, srtp-auth=(string)hmac-sha1-80, srtcp-cipher=(string)aes-128-icm, srtcp-auth=(string)hmac-sha1-80";
+
+  unsigned char DECRYPTED_1_PKT[] = {
+    0x80, 0x88, 0x13, 0xe1, 0x87, 0x76, 0xda, 0x98, 0x9d, 0xe0, 0x65, 0x17,
+    0xb4, 0xa5, 0xa3, 0xac, 0xac, 0xa3, 0xa5, 0xb7, 0xfc, 0x0a
+  };
+  unsigned int DECRYPTED_1_PKT_LEN = 22;
+  unsigned char DECRYPTED_3_PKT[] = {
+    0x80, 0x08, 0x13, 0xe3, 0x87, 0x76, 0xda, 0xac, 0x9d, 0xe0, 0x65, 0x17,
+    0xa0, 0xad, 0xac, 0xa2, 0xa7, 0xb0, 0x96, 0x0c, 0x39, 0x21
+  };
+  unsigned int DECRYPTED_3_PKT_LEN = 22;
+  unsigned char MKI_1_01_PKT[] = {
+    0x80, 0x88, 0x13, 0xe1, 0x87, 0x76, 0xda, 0x98, 0x9d, 0xe0, 0x65, 0x17,
+    0xd7, 0x16, 0xac, 0x3e, 0x60, 0x08, 0x04, 0xd6, 0xfb, 0x0e, 0x01, 0x77,
+    0x93, 0x20, 0x3f, 0x45, 0x2c, 0xb3, 0x74, 0xd1, 0x20
+  };
+  unsigned int MKI_1_01_PKT_LEN = 33;
+  unsigned char MKI_3_01_PKT[] = {
+    0x80, 0x08, 0x13, 0xe3, 0x87, 0x76, 0xda, 0xac, 0x9d, 0xe0, 0x65, 0x17,
+    0xa6, 0xdf, 0x77, 0x4c, 0xb0, 0xe9, 0x3c, 0x1a, 0x54, 0x6f, 0x01, 0x9d,
+    0xc3, 0x4b, 0x1d, 0x29, 0x67, 0xa0, 0x4d, 0xde, 0xec
+  };
+  unsigned int MKI_3_01_PKT_LEN = 33;
+
+  GstHarness *h =
+      gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  GstBufferList *list;
+  GstBuffer *buf;
+
+  gst_harness_set_caps_str (h, CAPS_SRTP, CAPS_RTP);
+
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list,
+      gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (char *) MKI_1_01_PKT, MKI_1_01_PKT_LEN, 0, MKI_1_01_PKT_LEN, NULL,
+          NULL));
+  /* replayed, dropped from the list */
+  gst_buffer_list_add (list,
+      gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (char *) MKI_1_01_PKT, MKI_1_01_PKT_LEN, 0, MKI_1_01_PKT_LEN, NULL,
+          NULL));
+  gst_buffer_list_add (list,
+      gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (char *) MKI_3_01_PKT, MKI_3_01_PKT_LEN, 0, MKI_3_01_PKT_LEN, NULL,
+          NULL));
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf);
+  fail_unless_equals_int (gst_buffer_get_size (buf), DECRYPTED_1_PKT_LEN);
+  fail_unless (!gst_buffer_memcmp (buf, 0, DECRYPTED_1_PKT,
+          DECRYPTED_1_PKT_LEN));
+  gst_buffer_unref (buf);
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf);
+  fail_unless_equals_int (gst_buffer_get_size (buf), DECRYPTED_3_PKT_LEN);
+  fail_unless (!gst_buffer_memcmp (buf, 0, DECRYPTED_3_PKT,
+          DECRYPTED_3_PKT_LEN));
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 
 #endif
 
@@ -355,6 +429,7 @@ srtp_suite (void)
 #ifdef HAVE_SRTP2
   tcase_add_test (tc_chain, test_simple_mki);
   tcase_add_test (tc_chain, test_srtpdec_multiple_mki);
+  tcase_add_test (tc_chain, test_srtpdec_list);
 #endif
 
   return s;
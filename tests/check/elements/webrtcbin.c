@@ -1489,6 +1489,132 @@ GST_START_TEST (test_session_stats)
 
 GST_END_TEST;
 
+static gboolean
+check_stats_type_foreach (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  GstWebRTCStatsType expected = GPOINTER_TO_INT (user_data), type;
+
+  gst_structure_get (gst_value_get_structure (value), "type",
+      GST_TYPE_WEBRTC_STATS_TYPE, &type, NULL);
+  fail_unless_equals_int (type, expected);
+
+  return TRUE;
+}
+
+static GstStructure *
+get_stats_by_type (GstElement * webrtc, GstWebRTCStatsType type)
+{
+  GstStructure *reply;
+  GstPromise *p;
+
+  p = gst_promise_new ();
+  g_signal_emit_by_name (webrtc, "get-stats-by-type", NULL, type, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  reply = gst_structure_copy (gst_promise_get_reply (p));
+  gst_promise_unref (p);
+
+  return reply;
+}
+
+static gboolean
+check_inbound_stats_foreach (GQuark field_id, const GValue * value,
+    const GstStructure * full)
+{
+  const GstStructure *s = gst_value_get_structure (value);
+  guint64 packets_received = 0;
+  guint ssrc = 0;
+
+  validate_rtc_stats (s);
+  fail_unless (gst_structure_get (s, "ssrc", G_TYPE_UINT, &ssrc,
+          "packets-received", G_TYPE_UINT64, &packets_received, NULL));
+  fail_unless (packets_received > 0);
+
+  /* the full report has the same inbound statistics */
+  fail_unless (gst_structure_has_field (full, g_quark_to_string (field_id)));
+
+  return TRUE;
+}
+
+/* a 20ms opus frame, the payload content doesn't matter */
+static void
+push_rtp_packet (GstHarness * h, guint16 seq)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, 12 + 16, NULL);
+  GstMapInfo map;
+
+  gst_buffer_memset (buf, 0, 0, gst_buffer_get_size (buf));
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  map.data[0] = 0x80;
+  map.data[1] = 96;
+  GST_WRITE_UINT16_BE (map.data + 2, seq);
+  GST_WRITE_UINT32_BE (map.data + 4, seq * 960);
+  GST_WRITE_UINT32_BE (map.data + 8, 3384078950u);
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+GST_START_TEST (test_session_stats_by_type)
+{
+  struct test_webrtc *t = create_audio_test ();
+  GstStructure *reply, *full;
+  GstHarness *h = t->harnesses->data;
+  GstPromise *p;
+  guint16 seq;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  test_validate_sdp_full (t, NULL, NULL, 0, FALSE);
+
+  reply = get_stats_by_type (t->webrtc1, GST_WEBRTC_STATS_PEER_CONNECTION);
+  validate_stats (reply);
+  fail_unless_equals_int (gst_structure_n_fields (reply), 1);
+  gst_structure_foreach (reply, check_stats_type_foreach,
+      GINT_TO_POINTER (GST_WEBRTC_STATS_PEER_CONNECTION));
+  gst_structure_free (reply);
+
+  /* send media until the receiver reports its inbound stream */
+  reply = NULL;
+  for (seq = 0; seq < 500; seq++) {
+    push_rtp_packet (h, seq);
+    g_usleep (20 * G_TIME_SPAN_MILLISECOND);
+
+    if (seq % 10 != 9)
+      continue;
+
+    reply = get_stats_by_type (t->webrtc2, GST_WEBRTC_STATS_INBOUND_RTP);
+    if (gst_structure_n_fields (reply) > 0)
+      break;
+    gst_structure_free (reply);
+    reply = NULL;
+  }
+  fail_unless (reply != NULL, "no inbound statistics were reported");
+
+  gst_structure_foreach (reply, check_stats_type_foreach,
+      GINT_TO_POINTER (GST_WEBRTC_STATS_INBOUND_RTP));
+
+  /* the statistics referenced by the inbound ones are only part of the full
+   * report */
+  p = gst_promise_new ();
+  g_signal_emit_by_name (t->webrtc2, "get-stats", NULL, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  full = gst_structure_copy (gst_promise_get_reply (p));
+  gst_promise_unref (p);
+  validate_stats (full);
+  gst_structure_foreach (reply,
+      (GstStructureForeachFunc) check_inbound_stats_foreach, full);
+  gst_structure_free (full);
+  gst_structure_free (reply);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_add_transceiver)
 {
   struct test_webrtc *t = test_webrtc_new ();
@@ -2967,6 +3093,7 @@ webrtcbin_suite (void)
   if (nicesrc && nicesink && dtlssrtpenc && dtlssrtpdec) {
     tcase_add_test (tc, test_sdp_no_media);
     tcase_add_test (tc, test_session_stats);
+    tcase_add_test (tc, test_session_stats_by_type);
     tcase_add_test (tc, test_audio);
     tcase_add_test (tc, test_ice_port_restriction);
     tcase_add_test (tc, test_audio_video);
@@ -0,0 +1,307 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * adaptivedemuxabr.c: replays bandwidth traces through the bitrate
+ * adaptation algorithms of GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
+
+GST_DEBUG_CATEGORY (adaptivedemux_debug);
+
+#define FRAGMENT_DURATION (4 * GST_SECOND)
+#define NUM_FRAGMENTS 60
+#define REQUEST_LATENCY (100 * GST_MSECOND)
+/* how much data downstream queues before blocking the stream */
+#define DOWNSTREAM_QUEUE_DURATION (12 * GST_SECOND)
+#define BITRATE_LIMIT 0.8
+
+/* Representations available for the stream, in kbps */
+static const guint ladder[] = { 300, 750, 1200, 2400, 4800, 7500 };
+
+typedef struct
+{
+  GstClockTime duration;
+  guint kbps;
+} TraceSegment;
+
+typedef struct
+{
+  const gchar *name;
+  const TraceSegment *segments;
+  guint n_segments;
+} Trace;
+
+/* The traces are looped if the simulation outlasts them. Their shape follows
+ * throughput measurements made on fixed, 3G and LTE links */
+static const TraceSegment stable_trace[] = {
+  {60 * GST_SECOND, 5000},
+};
+
+static const TraceSegment mobile_trace[] = {
+  {3 * GST_SECOND, 3500}, {2 * GST_SECOND, 1200}, {4 * GST_SECOND, 5200},
+  {1 * GST_SECOND, 600}, {3 * GST_SECOND, 2800}, {5 * GST_SECOND, 4200},
+  {2 * GST_SECOND, 900}, {4 * GST_SECOND, 3100}, {3 * GST_SECOND, 6000},
+  {2 * GST_SECOND, 1500}, {4 * GST_SECOND, 2600}, {3 * GST_SECOND, 800},
+  {5 * GST_SECOND, 3900}, {2 * GST_SECOND, 2200}, {4 * GST_SECOND, 4700},
+  {3 * GST_SECOND, 1800},
+};
+
+static const TraceSegment sudden_drop_trace[] = {
+  {40 * GST_SECOND, 6000}, {30 * GST_SECOND, 700}, {40 * GST_SECOND, 6000},
+};
+
+static const TraceSegment partial_drop_trace[] = {
+  {40 * GST_SECOND, 6000}, {30 * GST_SECOND, 1500}, {40 * GST_SECOND, 6000},
+};
+
+static const TraceSegment umts_trace[] = {
+  {5 * GST_SECOND, 900}, {3 * GST_SECOND, 400}, {6 * GST_SECOND, 1300},
+  {2 * GST_SECOND, 250}, {5 * GST_SECOND, 700}, {4 * GST_SECOND, 1100},
+  {3 * GST_SECOND, 500}, {5 * GST_SECOND, 1600},
+};
+
+static const TraceSegment lte_trace[] = {
+  {4 * GST_SECOND, 12000}, {3 * GST_SECOND, 7000}, {2 * GST_SECOND, 2500},
+  {5 * GST_SECOND, 9000}, {3 * GST_SECOND, 15000}, {2 * GST_SECOND, 4000},
+  {4 * GST_SECOND, 8000}, {3 * GST_SECOND, 3000},
+};
+
+#define TRACE(name, segments) { name, segments, G_N_ELEMENTS (segments) }
+
+static const Trace traces[] = {
+  TRACE ("stable", stable_trace),
+  TRACE ("mobile", mobile_trace),
+  TRACE ("sudden drop", sudden_drop_trace),
+  TRACE ("partial drop", partial_drop_trace),
+  TRACE ("umts", umts_trace),
+  TRACE ("lte", lte_trace),
+};
+
+typedef struct
+{
+  GstClockTime rebuffer_time;
+  guint64 bitrate_sum;
+  guint n_switches;
+} SimulationResult;
+
+static guint64
+trace_get_rate (const Trace * trace, GstClockTime time,
+    GstClockTime * segment_end)
+{
+  GstClockTime total = 0, offset, start = 0;
+  guint i;
+
+  for (i = 0; i < trace->n_segments; i++)
+    total += trace->segments[i].duration;
+
+  offset = time % total;
+  for (i = 0; i < trace->n_segments; i++) {
+    if (offset < start + trace->segments[i].duration)
+      break;
+    start += trace->segments[i].duration;
+  }
+
+  *segment_end = time - offset + start + trace->segments[i].duration;
+
+  return trace->segments[i].kbps * 1000;
+}
+
+/* Returns the time needed to transfer @bits starting at @start */
+static GstClockTime
+trace_download (const Trace * trace, GstClockTime start, guint64 bits)
+{
+  GstClockTime now = start, segment_end;
+
+  while (bits > 0) {
+    guint64 rate = trace_get_rate (trace, now, &segment_end);
+    guint64 available = gst_util_uint64_scale (segment_end - now, rate,
+        GST_SECOND);
+
+    if (available >= bits) {
+      now += gst_util_uint64_scale_ceil (bits, GST_SECOND, rate);
+      bits = 0;
+    } else {
+      bits -= available;
+      now = segment_end;
+    }
+  }
+
+  return now - start;
+}
+
+/* Does what the subclasses do in stream_select_bitrate() */
+static guint
+select_representation (guint64 bitrate)
+{
+  guint i, selected = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (ladder); i++) {
+    if (ladder[i] * 1000 <= bitrate)
+      selected = i;
+  }
+
+  return selected;
+}
+
+/* Downloads the fragments one after the other, like the download loop of a
+ * stream, while a player consumes them in real time once the first one
+ * arrived */
+static void
+simulate (const Trace * trace, GstAdaptiveDemuxAbrAlgorithm algorithm,
+    SimulationResult * result)
+{
+  GstAdaptiveDemuxAbr *abr = gst_adaptive_demux_abr_new ();
+  GstClockTime now = 0, level = 0;
+  guint current = 0, next, i;
+
+  memset (result, 0, sizeof (SimulationResult));
+
+  for (i = 0; i < NUM_FRAGMENTS; i++) {
+    guint64 bits = gst_util_uint64_scale (ladder[current] * 1000,
+        FRAGMENT_DURATION, GST_SECOND);
+    GstClockTime download_time = REQUEST_LATENCY +
+        trace_download (trace, now + REQUEST_LATENCY, bits);
+    guint64 bitrate;
+
+    if (i > 0) {
+      if (level >= download_time) {
+        level -= download_time;
+      } else {
+        result->rebuffer_time += download_time - level;
+        level = 0;
+      }
+    }
+    now += download_time;
+    level += FRAGMENT_DURATION;
+    result->bitrate_sum += ladder[current];
+
+    /* downstream is full and blocks until there's room for a fragment */
+    if (level > DOWNSTREAM_QUEUE_DURATION - FRAGMENT_DURATION) {
+      now += level - (DOWNSTREAM_QUEUE_DURATION - FRAGMENT_DURATION);
+      level = DOWNSTREAM_QUEUE_DURATION - FRAGMENT_DURATION;
+    }
+
+    bitrate = gst_util_uint64_scale (bits, GST_SECOND, download_time);
+    gst_adaptive_demux_abr_add_sample (abr, bitrate, download_time,
+        REQUEST_LATENCY);
+    next = select_representation (gst_adaptive_demux_abr_get_bitrate (abr,
+            algorithm, BITRATE_LIMIT, FRAGMENT_DURATION, level));
+    if (next != current)
+      result->n_switches++;
+    current = next;
+  }
+
+  gst_adaptive_demux_abr_free (abr);
+}
+
+static void
+report (const gchar * trace, const gchar * algorithm,
+    const SimulationResult * result)
+{
+  g_print ("%-14s %-16s rebuffering %" GST_TIME_FORMAT
+      " average quality %5" G_GUINT64_FORMAT " kbps, %2u switches\n", trace,
+      algorithm, GST_TIME_ARGS (result->rebuffer_time),
+      result->bitrate_sum / NUM_FRAGMENTS, result->n_switches);
+}
+
+GST_START_TEST (test_abr_trace_replay)
+{
+  SimulationResult moving_average, hybrid;
+  GstClockTime moving_average_rebuffer = 0, hybrid_rebuffer = 0;
+  guint moving_average_switches = 0, hybrid_switches = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (traces); i++) {
+    simulate (&traces[i], GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+        &moving_average);
+    simulate (&traces[i], GST_ADAPTIVE_DEMUX_ABR_HYBRID, &hybrid);
+    report (traces[i].name, "moving-average", &moving_average);
+    report (traces[i].name, "hybrid", &hybrid);
+
+    /* No trace should make the hybrid algorithm stall noticeably more */
+    fail_unless (hybrid.rebuffer_time <=
+        moving_average.rebuffer_time + GST_SECOND);
+
+    moving_average_rebuffer += moving_average.rebuffer_time;
+    hybrid_rebuffer += hybrid.rebuffer_time;
+    moving_average_switches += moving_average.n_switches;
+    hybrid_switches += hybrid.n_switches;
+  }
+
+  fail_unless (hybrid_rebuffer <= moving_average_rebuffer);
+  fail_unless (hybrid_switches < moving_average_switches);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_abr_stable_link)
+{
+  GstAdaptiveDemuxAbr *abr = gst_adaptive_demux_abr_new ();
+  guint64 first, bitrate;
+  guint i;
+
+  /* 2 Mbps fragments downloaded at 4 Mbps with 100ms of latency */
+  gst_adaptive_demux_abr_add_sample (abr, 4000000, 2 * GST_SECOND,
+      REQUEST_LATENCY);
+  first = gst_adaptive_demux_abr_get_bitrate (abr,
+      GST_ADAPTIVE_DEMUX_ABR_HYBRID, BITRATE_LIMIT, FRAGMENT_DURATION,
+      FRAGMENT_DURATION);
+  fail_unless (first > 2500000 && first < 4000000);
+
+  /* A steady link and a full buffer don't change the target */
+  for (i = 0; i < 10; i++) {
+    gst_adaptive_demux_abr_add_sample (abr, 4000000, 2 * GST_SECOND,
+        REQUEST_LATENCY);
+    bitrate = gst_adaptive_demux_abr_get_bitrate (abr,
+        GST_ADAPTIVE_DEMUX_ABR_HYBRID, BITRATE_LIMIT, FRAGMENT_DURATION,
+        DOWNSTREAM_QUEUE_DURATION);
+  }
+  fail_unless (bitrate >= first);
+  fail_unless (bitrate < 4000000);
+
+  /* An empty buffer makes it drop right away */
+  gst_adaptive_demux_abr_add_sample (abr, 4000000, 2 * GST_SECOND,
+      REQUEST_LATENCY);
+  fail_unless (gst_adaptive_demux_abr_get_bitrate (abr,
+          GST_ADAPTIVE_DEMUX_ABR_HYBRID, BITRATE_LIMIT, FRAGMENT_DURATION,
+          0) < bitrate * 0.7);
+
+  gst_adaptive_demux_abr_free (abr);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemuxabr_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemux bitrate adaptation");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (adaptivedemux_debug, "adaptivedemux", 0,
+      "Base Adaptive Demux");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_abr_stable_link);
+  tcase_add_test (tc_chain, test_abr_trace_replay);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemuxabr);
@@ -0,0 +1,303 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * adaptivedemuxcache.c: tests for the shared fragment cache of
+ * GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemuxcache.h>
+
+GST_DEBUG_CATEGORY (adaptivedemux_debug);
+
+#define FILE_SIZE 4096
+
+static gchar *
+make_file (guint8 fill, gchar ** uri)
+{
+  gchar *filename = NULL;
+  gchar data[FILE_SIZE];
+  gint fd;
+
+  memset (data, fill, sizeof (data));
+  fd = g_file_open_tmp ("adaptivedemuxcache-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (filename, data, sizeof (data), NULL));
+
+  *uri = gst_filename_to_uri (filename, NULL);
+  return filename;
+}
+
+static GstBuffer *
+fetch (GstAdaptiveDemuxCache * cache, GstUriDownloader * downloader,
+    const gchar * uri, guint8 fill)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  GError *err = NULL;
+  gsize i;
+
+  buffer = gst_adaptive_demux_cache_fetch (cache, downloader, uri, NULL,
+      -1, -1, NULL, NULL, &err);
+  fail_unless (buffer != NULL, "failed to fetch %s: %s", uri,
+      err ? err->message : "no error");
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  assert_equals_uint64 (map.size, FILE_SIZE);
+  for (i = 0; i < map.size; i++)
+    fail_unless (map.data[i] == fill);
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+static void
+check_stats (GstAdaptiveDemuxCache * cache, guint64 hits, guint64 misses,
+    guint64 evictions, guint entries)
+{
+  GstStructure *stats;
+  guint64 val64;
+  guint val;
+
+  stats = gst_adaptive_demux_cache_get_stats (cache);
+  fail_unless (gst_structure_get_uint64 (stats, "hits", &val64));
+  assert_equals_uint64 (val64, hits);
+  fail_unless (gst_structure_get_uint64 (stats, "misses", &val64));
+  assert_equals_uint64 (val64, misses);
+  fail_unless (gst_structure_get_uint64 (stats, "evictions", &val64));
+  assert_equals_uint64 (val64, evictions);
+  fail_unless (gst_structure_get_uint (stats, "entries", &val));
+  assert_equals_int (val, entries);
+  fail_unless (gst_structure_get_uint64 (stats, "size", &val64));
+  assert_equals_uint64 (val64, (guint64) entries * FILE_SIZE);
+  gst_structure_free (stats);
+}
+
+GST_START_TEST (test_cache_hit)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstUriDownloader *downloader;
+  GstBuffer *first, *second;
+  gchar *filename, *uri;
+
+  filename = make_file (0x42, &uri);
+  cache = gst_adaptive_demux_cache_new (4 * FILE_SIZE);
+  downloader = gst_uri_downloader_new ();
+
+  first = fetch (cache, downloader, uri, 0x42);
+  check_stats (cache, 0, 1, 0, 1);
+
+  /* served from memory even once the file is gone */
+  g_unlink (filename);
+  second = fetch (cache, downloader, uri, 0x42);
+  check_stats (cache, 1, 1, 0, 1);
+
+  gst_buffer_unref (first);
+  gst_buffer_unref (second);
+  gst_object_unref (downloader);
+  gst_object_unref (cache);
+  g_free (filename);
+  g_free (uri);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cache_eviction)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstUriDownloader *downloader;
+  gchar *filename1, *filename2, *uri1, *uri2;
+
+  filename1 = make_file (0x01, &uri1);
+  filename2 = make_file (0x02, &uri2);
+  cache = gst_adaptive_demux_cache_new (FILE_SIZE + FILE_SIZE / 2);
+  downloader = gst_uri_downloader_new ();
+
+  gst_buffer_unref (fetch (cache, downloader, uri1, 0x01));
+  gst_buffer_unref (fetch (cache, downloader, uri2, 0x02));
+  check_stats (cache, 0, 2, 1, 1);
+
+  /* the least recently used entry was dropped */
+  gst_buffer_unref (fetch (cache, downloader, uri2, 0x02));
+  check_stats (cache, 1, 2, 1, 1);
+  gst_buffer_unref (fetch (cache, downloader, uri1, 0x01));
+  check_stats (cache, 1, 3, 2, 1);
+
+  gst_object_unref (downloader);
+  gst_object_unref (cache);
+
+  /* too big to be kept at all */
+  cache = gst_adaptive_demux_cache_new (FILE_SIZE / 2);
+  downloader = gst_uri_downloader_new ();
+  gst_buffer_unref (fetch (cache, downloader, uri1, 0x01));
+  check_stats (cache, 0, 1, 0, 0);
+
+  gst_object_unref (downloader);
+  gst_object_unref (cache);
+  g_unlink (filename1);
+  g_unlink (filename2);
+  g_free (filename1);
+  g_free (filename2);
+  g_free (uri1);
+  g_free (uri2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cache_buffer_metadata)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstUriDownloader *downloader;
+  GstBuffer *first, *second, *third;
+  gchar *filename, *uri;
+
+  filename = make_file (0x42, &uri);
+  cache = gst_adaptive_demux_cache_new (4 * FILE_SIZE);
+  downloader = gst_uri_downloader_new ();
+
+  /* a demuxer timestamps and flags the buffer it got */
+  first = fetch (cache, downloader, uri, 0x42);
+  fail_unless (gst_buffer_is_writable (first));
+  GST_BUFFER_PTS (first) = 10 * GST_SECOND;
+  GST_BUFFER_FLAG_SET (first, GST_BUFFER_FLAG_DISCONT);
+
+  /* which doesn't affect the cached fragment */
+  second = fetch (cache, downloader, uri, 0x42);
+  check_stats (cache, 1, 1, 0, 1);
+  fail_unless (second != first);
+  fail_unless (gst_buffer_is_writable (second));
+  fail_if (GST_BUFFER_PTS_IS_VALID (second));
+  fail_if (GST_BUFFER_FLAG_IS_SET (second, GST_BUFFER_FLAG_DISCONT));
+
+  GST_BUFFER_PTS (second) = 20 * GST_SECOND;
+  third = fetch (cache, downloader, uri, 0x42);
+  fail_if (GST_BUFFER_PTS_IS_VALID (third));
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (first), 10 * GST_SECOND);
+
+  gst_buffer_unref (first);
+  gst_buffer_unref (second);
+  gst_buffer_unref (third);
+  gst_object_unref (downloader);
+  gst_object_unref (cache);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (uri);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GstAdaptiveDemuxCache *cache;
+  const gchar *uri;
+} FetchData;
+
+static gpointer
+fetch_thread (gpointer user_data)
+{
+  FetchData *data = user_data;
+  GstUriDownloader *downloader;
+
+  downloader = gst_uri_downloader_new ();
+  gst_buffer_unref (fetch (data->cache, downloader, data->uri, 0x42));
+  gst_object_unref (downloader);
+
+  return NULL;
+}
+
+GST_START_TEST (test_cache_concurrent)
+{
+  GstAdaptiveDemuxCache *cache;
+  GstStructure *stats;
+  GThread *thread1, *thread2;
+  FetchData data;
+  gchar *filename, *uri;
+  guint64 hits, misses, coalesced;
+
+  filename = make_file (0x42, &uri);
+  cache = gst_adaptive_demux_cache_new (4 * FILE_SIZE);
+  data.cache = cache;
+  data.uri = uri;
+
+  thread1 = g_thread_new ("fetch1", fetch_thread, &data);
+  thread2 = g_thread_new ("fetch2", fetch_thread, &data);
+  g_thread_join (thread1);
+  g_thread_join (thread2);
+
+  /* only one of the two fetches downloaded the file */
+  stats = gst_adaptive_demux_cache_get_stats (cache);
+  fail_unless (gst_structure_get (stats, "hits", G_TYPE_UINT64, &hits,
+          "misses", G_TYPE_UINT64, &misses,
+          "coalesced", G_TYPE_UINT64, &coalesced, NULL));
+  assert_equals_uint64 (misses, 1);
+  assert_equals_uint64 (hits + coalesced, 1);
+  gst_structure_free (stats);
+
+  gst_object_unref (cache);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (uri);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cache_context)
+{
+  GstAdaptiveDemuxCache *cache, *shared;
+  GstContext *context;
+
+  cache = gst_adaptive_demux_cache_new (FILE_SIZE);
+  context = gst_adaptive_demux_cache_context_new (cache);
+  fail_unless (gst_context_is_persistent (context));
+  fail_unless_equals_string (gst_context_get_context_type (context),
+      GST_ADAPTIVE_DEMUX_CACHE_CONTEXT_TYPE);
+
+  shared = gst_adaptive_demux_cache_from_context (context);
+  fail_unless (shared == cache);
+  gst_object_unref (shared);
+  gst_context_unref (context);
+
+  context = gst_context_new ("gst.other.context", TRUE);
+  fail_unless (gst_adaptive_demux_cache_from_context (context) == NULL);
+  gst_context_unref (context);
+
+  gst_object_unref (cache);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemuxcache_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemuxcache");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_cache_hit);
+  tcase_add_test (tc_chain, test_cache_eviction);
+  tcase_add_test (tc_chain, test_cache_buffer_metadata);
+  tcase_add_test (tc_chain, test_cache_concurrent);
+  tcase_add_test (tc_chain, test_cache_context);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemuxcache);
@@ -0,0 +1,274 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * adaptivedemuxprefetch.c: tests for the fragment prefetching of
+ * GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemuxprefetch.h>
+
+GST_DEBUG_CATEGORY (adaptivedemux_debug);
+
+#define FILE_SIZE 4096
+#define N_FILES 3
+#define TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  gchar *filenames[N_FILES];
+  gchar *uris[N_FILES];
+  /* a uri that can't be downloaded */
+  gchar *missing_uri;
+  GstElement *parent;
+} PrefetchFixture;
+
+static PrefetchFixture fixture;
+
+static void
+setup (void)
+{
+  gchar data[FILE_SIZE];
+  gchar *missing;
+  guint i;
+  gint fd;
+
+  for (i = 0; i < N_FILES; i++) {
+    memset (data, i + 1, sizeof (data));
+    fd = g_file_open_tmp ("adaptivedemuxprefetch-XXXXXX",
+        &fixture.filenames[i], NULL);
+    fail_unless (fd >= 0);
+    g_close (fd, NULL);
+    fail_unless (g_file_set_contents (fixture.filenames[i], data,
+            sizeof (data), NULL));
+    fixture.uris[i] = gst_filename_to_uri (fixture.filenames[i], NULL);
+  }
+
+  missing = g_strconcat (fixture.filenames[0], "-missing", NULL);
+  fixture.missing_uri = gst_filename_to_uri (missing, NULL);
+  g_free (missing);
+
+  fixture.parent = gst_object_ref_sink (gst_bin_new (NULL));
+}
+
+static void
+teardown (void)
+{
+  guint i;
+
+  for (i = 0; i < N_FILES; i++) {
+    g_unlink (fixture.filenames[i]);
+    g_free (fixture.filenames[i]);
+    g_free (fixture.uris[i]);
+  }
+  g_free (fixture.missing_uri);
+  gst_object_unref (fixture.parent);
+  memset (&fixture, 0, sizeof (fixture));
+}
+
+static GstAdaptiveDemuxPrefetch *
+prefetch_new (guint depth, gsize max_bytes)
+{
+  return gst_adaptive_demux_prefetch_new (fixture.parent, depth, max_bytes,
+      NULL);
+}
+
+static void
+request (GstAdaptiveDemuxPrefetch * prefetch, const gchar * uri)
+{
+  gst_adaptive_demux_prefetch_request (prefetch, uri, 0, -1);
+}
+
+/* Takes the next fragment and checks it is the file filled with @fill */
+static void
+check_take (GstAdaptiveDemuxPrefetch * prefetch, guint8 fill)
+{
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize i;
+
+  buffer = gst_adaptive_demux_prefetch_take (prefetch, &download_time);
+  fail_unless (buffer != NULL, "fragment %u was not prefetched", fill);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (download_time));
+
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  assert_equals_uint64 (map.size, FILE_SIZE);
+  for (i = 0; i < map.size; i++)
+    fail_unless (map.data[i] == fill);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+/* Downloads complete in the background, wait for the cache to fill up */
+static void
+wait_cache_full (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT;
+
+  while (gst_adaptive_demux_prefetch_can_request (prefetch)
+      && g_get_monotonic_time () < deadline)
+    g_usleep (G_USEC_PER_SEC / 100);
+}
+
+GST_START_TEST (test_prefetch_order)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = prefetch_new (4, 20 * FILE_SIZE);
+  guint i;
+
+  /* fragments come out in request order, whichever download ends first */
+  for (i = 0; i < N_FILES; i++)
+    request (prefetch, fixture.uris[i]);
+  /* already queued */
+  request (prefetch, fixture.uris[1]);
+
+  for (i = 0; i < N_FILES; i++)
+    check_take (prefetch, i + 1);
+
+  /* nothing left */
+  fail_unless (gst_adaptive_demux_prefetch_take (prefetch, NULL) == NULL);
+
+  gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_skip_to)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = prefetch_new (4, 20 * FILE_SIZE);
+  guint i;
+
+  for (i = 0; i < N_FILES; i++)
+    request (prefetch, fixture.uris[i]);
+
+  /* the fragments before the current one are dropped */
+  fail_unless (gst_adaptive_demux_prefetch_skip_to (prefetch,
+          fixture.uris[1], 0, -1));
+  check_take (prefetch, 2);
+
+  /* a range of a prefetched uri is another fragment */
+  fail_if (gst_adaptive_demux_prefetch_skip_to (prefetch,
+          fixture.uris[2], 0, FILE_SIZE / 2 - 1));
+  fail_unless (gst_adaptive_demux_prefetch_take (prefetch, NULL) == NULL);
+  fail_unless (gst_adaptive_demux_prefetch_can_request (prefetch));
+
+  gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_max_bytes)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  /* no more than @depth fragments in flight */
+  prefetch = prefetch_new (2, 20 * FILE_SIZE);
+  request (prefetch, fixture.uris[0]);
+  fail_unless (gst_adaptive_demux_prefetch_can_request (prefetch));
+  request (prefetch, fixture.uris[1]);
+  fail_if (gst_adaptive_demux_prefetch_can_request (prefetch));
+  check_take (prefetch, 1);
+  fail_unless (gst_adaptive_demux_prefetch_can_request (prefetch));
+  gst_adaptive_demux_prefetch_free (prefetch);
+
+  /* and no more new requests once the downloads filled the cache */
+  prefetch = prefetch_new (4, FILE_SIZE + FILE_SIZE / 2);
+  request (prefetch, fixture.uris[0]);
+  request (prefetch, fixture.uris[1]);
+  wait_cache_full (prefetch);
+  fail_if (gst_adaptive_demux_prefetch_can_request (prefetch));
+
+  check_take (prefetch, 1);
+  fail_unless (gst_adaptive_demux_prefetch_can_request (prefetch));
+  request (prefetch, fixture.uris[2]);
+  check_take (prefetch, 2);
+  check_take (prefetch, 3);
+  gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_failure)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = prefetch_new (4, 20 * FILE_SIZE);
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+
+  request (prefetch, fixture.missing_uri);
+  request (prefetch, fixture.uris[0]);
+
+  /* a failed prefetch gives no buffer, the demuxer then downloads the
+   * fragment through its source element */
+  fail_unless (gst_adaptive_demux_prefetch_skip_to (prefetch,
+          fixture.missing_uri, 0, -1));
+  fail_unless (gst_adaptive_demux_prefetch_take (prefetch,
+          &download_time) == NULL);
+  fail_if (GST_CLOCK_TIME_IS_VALID (download_time));
+
+  /* the following fragments are still served from the prefetcher */
+  fail_unless (gst_adaptive_demux_prefetch_skip_to (prefetch,
+          fixture.uris[0], 0, -1));
+  check_take (prefetch, 1);
+
+  gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_flush)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = prefetch_new (4, 20 * FILE_SIZE);
+  guint i;
+
+  for (i = 0; i < N_FILES; i++)
+    request (prefetch, fixture.uris[i]);
+
+  /* after a seek, nothing that was requested is pushed */
+  gst_adaptive_demux_prefetch_flush (prefetch);
+  fail_unless (gst_adaptive_demux_prefetch_take (prefetch, NULL) == NULL);
+
+  request (prefetch, fixture.uris[2]);
+  check_take (prefetch, 3);
+
+  gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemuxprefetch_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemuxprefetch");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (adaptivedemux_debug, "adaptivedemux", 0,
+      "adaptivedemux prefetch test");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, teardown);
+  tcase_add_test (tc_chain, test_prefetch_order);
+  tcase_add_test (tc_chain, test_prefetch_skip_to);
+  tcase_add_test (tc_chain, test_prefetch_max_bytes);
+  tcase_add_test (tc_chain, test_prefetch_failure);
+  tcase_add_test (tc_chain, test_prefetch_flush);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemuxprefetch);
@@ -102,6 +102,111 @@ GST_START_TEST (test_nal_writer_emulation_preventation)
 
 GST_END_TEST;
 
+/* Fills @data with random bytes biased towards 0x00-0x03 so that start
+ * codes and emulation prevention bytes show up often */
+static void
+fill_nal_like_data (guint8 * data, guint size)
+{
+  guint i;
+
+  for (i = 0; i < size; i++) {
+    switch (g_random_int_range (0, 4)) {
+      case 0:
+        data[i] = 0;
+        break;
+      case 1:
+        data[i] = g_random_int_range (0, 4);
+        break;
+      default:
+        data[i] = g_random_int_range (0, 256);
+        break;
+    }
+  }
+}
+
+GST_START_TEST (test_nal_reader_emulation_prevention)
+{
+  guint8 data[96], rbsp[96];
+  guint iter;
+
+  for (iter = 0; iter < 20000; iter++) {
+    guint size = g_random_int_range (0, sizeof (data));
+    guint rbsp_size = 0, pos = 0, n_epb, i;
+    guint32 epb_cache = 0xff;
+    NalReader nr;
+
+    fill_nal_like_data (data, size);
+
+    /* reference unescaping, byte by byte */
+    for (i = 0; i < size; i++) {
+      epb_cache = (epb_cache << 8) | data[i];
+      if ((epb_cache & 0xffffff) == 0x3)
+        continue;
+      rbsp[rbsp_size++] = data[i];
+    }
+
+    nal_reader_init (&nr, data, size);
+    while (TRUE) {
+      guint nbits = g_random_int_range (0, 33);
+      guint32 val, expected = 0;
+      gboolean ret = nal_reader_get_bits_uint32 (&nr, &val, nbits);
+
+      if (pos + nbits > rbsp_size * 8) {
+        fail_if (ret);
+        break;
+      }
+      fail_unless (ret);
+
+      for (i = pos; i < pos + nbits; i++)
+        expected = (expected << 1) | ((rbsp[i / 8] >> (7 - i % 8)) & 1);
+      assert_equals_uint64 (val, expected);
+      pos += nbits;
+
+      assert_equals_int (nal_reader_is_byte_aligned (&nr), pos % 8 == 0);
+    }
+
+    /* A read that doesn't fit in the remaining bits is refused before any
+     * byte is consumed, so trailing emulation prevention bytes may not have
+     * been seen. Only count the ones in the bytes the reader consumed */
+    n_epb = 0;
+    epb_cache = 0xff;
+    for (i = 0; i < nr.byte; i++) {
+      epb_cache = (epb_cache << 8) | data[i];
+      if ((epb_cache & 0xffffff) == 0x3)
+        n_epb++;
+    }
+    assert_equals_int (nal_reader_get_epb_count (&nr), n_epb);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_scan_for_start_codes)
+{
+  guint8 data[128];
+  guint iter;
+
+  for (iter = 0; iter < 20000; iter++) {
+    guint size = g_random_int_range (0, sizeof (data));
+    gint expected = -1;
+    guint i;
+
+    fill_nal_like_data (data, size);
+
+    /* a start code needs at least one byte following it */
+    for (i = 0; i + 4 <= size; i++) {
+      if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+        expected = i;
+        break;
+      }
+    }
+
+    assert_equals_int (scan_for_start_codes (data, size), expected);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 nalutils_suite (void)
 {
@@ -112,6 +217,8 @@ nalutils_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_nal_writer_init);
   tcase_add_test (tc_chain, test_nal_writer_emulation_preventation);
+  tcase_add_test (tc_chain, test_nal_reader_emulation_prevention);
+  tcase_add_test (tc_chain, test_scan_for_start_codes);
 
   return s;
 }
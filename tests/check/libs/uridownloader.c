@@ -0,0 +1,169 @@
+/* GStreamer
+ * Copyright (C) 2021 GStreamer developers
+ *
+ * uridownloader.c: tests for GstUriDownloader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+
+#define FILE_SIZE 4096
+
+static gchar *
+make_file (gchar ** uri)
+{
+  gchar *filename = NULL;
+  gchar data[FILE_SIZE];
+  gint fd;
+
+  memset (data, 0x42, sizeof (data));
+  fd = g_file_open_tmp ("uridownloader-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (filename, data, sizeof (data), NULL));
+
+  *uri = gst_filename_to_uri (filename, NULL);
+  return filename;
+}
+
+static GstFragment *
+fetch (GstUriDownloader * downloader, const gchar * uri)
+{
+  GstFragment *download;
+  GError *err = NULL;
+
+  download = gst_uri_downloader_fetch_uri (downloader, uri, NULL, FALSE,
+      FALSE, TRUE, &err);
+  fail_unless (download != NULL, "failed to fetch %s: %s", uri,
+      err ? err->message : "no error");
+  fail_unless (download->completed);
+
+  return download;
+}
+
+static void
+check_timing (GstFragment * download, gboolean reused)
+{
+  GstClockTime setup, first_byte, transfer, total;
+  GstStructure *timing;
+  gboolean source_reused;
+  guint64 bytes;
+
+  timing = gst_fragment_get_timing (download);
+  fail_unless (timing != NULL);
+  fail_unless (gst_structure_has_name (timing, "uri-downloader-timing"));
+  fail_unless (gst_structure_get (timing,
+          "source-reused", G_TYPE_BOOLEAN, &source_reused,
+          "setup-time", GST_TYPE_CLOCK_TIME, &setup,
+          "first-byte-time", GST_TYPE_CLOCK_TIME, &first_byte,
+          "transfer-time", GST_TYPE_CLOCK_TIME, &transfer,
+          "total-time", GST_TYPE_CLOCK_TIME, &total,
+          "bytes", G_TYPE_UINT64, &bytes, NULL));
+
+  gst_structure_free (timing);
+
+  assert_equals_int (source_reused, reused);
+  assert_equals_uint64 (bytes, FILE_SIZE);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (setup));
+  fail_unless (setup <= first_byte);
+  assert_equals_uint64 (first_byte + transfer, total);
+}
+
+GST_START_TEST (test_downloader_timing)
+{
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  gchar *filename, *uri;
+
+  filename = make_file (&uri);
+  downloader = gst_uri_downloader_new ();
+
+  download = fetch (downloader, uri);
+  check_timing (download, FALSE);
+  g_object_unref (download);
+
+  /* same protocol, the source element is reused */
+  download = fetch (downloader, uri);
+  check_timing (download, TRUE);
+  g_object_unref (download);
+
+  gst_object_unref (downloader);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (uri);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_downloader_pool)
+{
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  gchar *filename1, *filename2, *uri1, *uri2;
+
+  filename1 = make_file (&uri1);
+  filename2 = make_file (&uri2);
+  downloader = gst_uri_downloader_new ();
+  gst_uri_downloader_set_pool_size (downloader, 2);
+
+  download = fetch (downloader, uri1);
+  check_timing (download, FALSE);
+  g_object_unref (download);
+
+  /* same scheme and host, the current source is kept */
+  download = fetch (downloader, uri2);
+  check_timing (download, TRUE);
+  g_object_unref (download);
+
+  download = fetch (downloader, uri1);
+  check_timing (download, TRUE);
+  g_object_unref (download);
+
+  /* shrinking the pool releases the idle sources but not the current one */
+  gst_uri_downloader_set_pool_size (downloader, 0);
+  download = fetch (downloader, uri2);
+  check_timing (download, TRUE);
+  g_object_unref (download);
+
+  gst_object_unref (downloader);
+  g_unlink (filename1);
+  g_unlink (filename2);
+  g_free (filename1);
+  g_free (filename2);
+  g_free (uri1);
+  g_free (uri2);
+}
+
+GST_END_TEST;
+
+static Suite *
+uridownloader_suite (void)
+{
+  Suite *s = suite_create ("uridownloader");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_downloader_timing);
+  tcase_add_test (tc_chain, test_downloader_pool);
+
+  return s;
+}
+
+GST_CHECK_MAIN (uridownloader);